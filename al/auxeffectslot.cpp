@@ -128,7 +128,7 @@ inline ALbuffer *LookupBuffer(ALCdevice *device, ALuint id) noexcept
 inline auto GetEffectBuffer(ALbuffer *buffer) noexcept -> EffectState::Buffer
 {
     if(!buffer) return EffectState::Buffer{};
-    return EffectState::Buffer{buffer, buffer->mData};
+    return EffectState::Buffer{buffer, buffer->samples()};
 }
 
 
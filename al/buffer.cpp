@@ -26,9 +26,12 @@
 #include <array>
 #include <atomic>
 #include <cassert>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <exception>
+#include <functional>
 #include <iterator>
 #include <limits>
 #include <memory>
@@ -36,6 +39,8 @@
 #include <new>
 #include <numeric>
 #include <stdexcept>
+#include <string>
+#include <thread>
 #include <utility>
 
 #include "AL/al.h"
@@ -44,17 +49,25 @@
 
 #include "albit.h"
 #include "albyte.h"
+#include "alc/alconfig.h"
 #include "alc/context.h"
 #include "alc/device.h"
 #include "alc/inprogext.h"
+#include "aldeque.h"
 #include "almalloc.h"
 #include "alnumeric.h"
 #include "aloptional.h"
 #include "atomic.h"
+#include "core/async_event.h"
+#include "core/device.h"
 #include "core/except.h"
 #include "core/logging.h"
+#include "core/resample_cache.h"
 #include "core/voice.h"
 #include "opthelpers.h"
+#include "ringbuffer.h"
+#include "threads.h"
+#include "vector.h"
 
 #ifdef ALSOFT_EAX
 #include "eax/globals.h"
@@ -64,191 +77,6 @@
 
 namespace {
 
-constexpr int MaxAdpcmChannels{2};
-
-/* IMA ADPCM Stepsize table */
-constexpr int IMAStep_size[89] = {
-       7,    8,    9,   10,   11,   12,   13,   14,   16,   17,   19,
-      21,   23,   25,   28,   31,   34,   37,   41,   45,   50,   55,
-      60,   66,   73,   80,   88,   97,  107,  118,  130,  143,  157,
-     173,  190,  209,  230,  253,  279,  307,  337,  371,  408,  449,
-     494,  544,  598,  658,  724,  796,  876,  963, 1060, 1166, 1282,
-    1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660,
-    4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493,10442,
-   11487,12635,13899,15289,16818,18500,20350,22358,24633,27086,29794,
-   32767
-};
-
-/* IMA4 ADPCM Codeword decode table */
-constexpr int IMA4Codeword[16] = {
-    1, 3, 5, 7, 9, 11, 13, 15,
-   -1,-3,-5,-7,-9,-11,-13,-15,
-};
-
-/* IMA4 ADPCM Step index adjust decode table */
-constexpr int IMA4Index_adjust[16] = {
-   -1,-1,-1,-1, 2, 4, 6, 8,
-   -1,-1,-1,-1, 2, 4, 6, 8
-};
-
-
-/* MSADPCM Adaption table */
-constexpr int MSADPCMAdaption[16] = {
-    230, 230, 230, 230, 307, 409, 512, 614,
-    768, 614, 512, 409, 307, 230, 230, 230
-};
-
-/* MSADPCM Adaption Coefficient tables */
-constexpr int MSADPCMAdaptionCoeff[7][2] = {
-    { 256,    0 },
-    { 512, -256 },
-    {   0,    0 },
-    { 192,   64 },
-    { 240,    0 },
-    { 460, -208 },
-    { 392, -232 }
-};
-
-
-void DecodeIMA4Block(int16_t *dst, const al::byte *src, size_t numchans, size_t align)
-{
-    int sample[MaxAdpcmChannels]{};
-    int index[MaxAdpcmChannels]{};
-    ALuint code[MaxAdpcmChannels]{};
-
-    for(size_t c{0};c < numchans;c++)
-    {
-        sample[c] = src[0] | (src[1]<<8);
-        sample[c] = (sample[c]^0x8000) - 32768;
-        src += 2;
-        index[c] = src[0] | (src[1]<<8);
-        index[c] = clampi((index[c]^0x8000) - 32768, 0, 88);
-        src += 2;
-
-        *(dst++) = static_cast<int16_t>(sample[c]);
-    }
-
-    for(size_t i{1};i < align;i++)
-    {
-        if((i&7) == 1)
-        {
-            for(size_t c{0};c < numchans;c++)
-            {
-                code[c] = ALuint{src[0]} | (ALuint{src[1]}<< 8) | (ALuint{src[2]}<<16)
-                    | (ALuint{src[3]}<<24);
-                src += 4;
-            }
-        }
-
-        for(size_t c{0};c < numchans;c++)
-        {
-            const ALuint nibble{code[c]&0xf};
-            code[c] >>= 4;
-
-            sample[c] += IMA4Codeword[nibble] * IMAStep_size[index[c]] / 8;
-            sample[c] = clampi(sample[c], -32768, 32767);
-
-            index[c] += IMA4Index_adjust[nibble];
-            index[c] = clampi(index[c], 0, 88);
-
-            *(dst++) = static_cast<int16_t>(sample[c]);
-        }
-    }
-}
-
-void DecodeMSADPCMBlock(int16_t *dst, const al::byte *src, size_t numchans, size_t align)
-{
-    uint8_t blockpred[MaxAdpcmChannels]{};
-    int delta[MaxAdpcmChannels]{};
-    int16_t samples[MaxAdpcmChannels][2]{};
-
-    for(size_t c{0};c < numchans;c++)
-    {
-        blockpred[c] = std::min<ALubyte>(src[0], 6);
-        ++src;
-    }
-    for(size_t c{0};c < numchans;c++)
-    {
-        delta[c] = src[0] | (src[1]<<8);
-        delta[c] = (delta[c]^0x8000) - 32768;
-        src += 2;
-    }
-    for(size_t c{0};c < numchans;c++)
-    {
-        samples[c][0] = static_cast<ALshort>(src[0] | (src[1]<<8));
-        src += 2;
-    }
-    for(size_t c{0};c < numchans;c++)
-    {
-        samples[c][1] = static_cast<ALshort>(src[0] | (src[1]<<8));
-        src += 2;
-    }
-
-    /* Second sample is written first. */
-    for(size_t c{0};c < numchans;c++)
-        *(dst++) = samples[c][1];
-    for(size_t c{0};c < numchans;c++)
-        *(dst++) = samples[c][0];
-
-    int num{0};
-    for(size_t i{2};i < align;i++)
-    {
-        for(size_t c{0};c < numchans;c++)
-        {
-            /* Read the nibble (first is in the upper bits). */
-            al::byte nibble;
-            if(!(num++ & 1))
-                nibble = *src >> 4;
-            else
-                nibble = *(src++) & 0x0f;
-
-            int pred{(samples[c][0]*MSADPCMAdaptionCoeff[blockpred[c]][0] +
-                samples[c][1]*MSADPCMAdaptionCoeff[blockpred[c]][1]) / 256};
-            pred += ((nibble^0x08) - 0x08) * delta[c];
-            pred  = clampi(pred, -32768, 32767);
-
-            samples[c][1] = samples[c][0];
-            samples[c][0] = static_cast<int16_t>(pred);
-
-            delta[c] = (MSADPCMAdaption[nibble] * delta[c]) / 256;
-            delta[c] = maxi(16, delta[c]);
-
-            *(dst++) = static_cast<int16_t>(pred);
-        }
-    }
-}
-
-void Convert_int16_ima4(int16_t *dst, const al::byte *src, size_t numchans, size_t len,
-    size_t align)
-{
-    assert(numchans <= MaxAdpcmChannels);
-    const size_t byte_align{((align-1)/2 + 4) * numchans};
-
-    len /= align;
-    while(len--)
-    {
-        DecodeIMA4Block(dst, src, numchans, align);
-        src += byte_align;
-        dst += align*numchans;
-    }
-}
-
-void Convert_int16_msadpcm(int16_t *dst, const al::byte *src, size_t numchans, size_t len,
-    size_t align)
-{
-    assert(numchans <= MaxAdpcmChannels);
-    const size_t byte_align{((align-2)/2 + 7) * numchans};
-
-    len /= align;
-    while(len--)
-    {
-        DecodeMSADPCMBlock(dst, src, numchans, align);
-        src += byte_align;
-        dst += align*numchans;
-    }
-}
-
-
 ALuint BytesFromUserFmt(UserFmtType type) noexcept
 {
     switch(type)
@@ -259,6 +87,7 @@ ALuint BytesFromUserFmt(UserFmtType type) noexcept
     case UserFmtDouble: return sizeof(double);
     case UserFmtMulaw: return sizeof(uint8_t);
     case UserFmtAlaw: return sizeof(uint8_t);
+    case UserFmtHalf: return sizeof(uint16_t);
     case UserFmtIMA4: break; /* not handled here */
     case UserFmtMSADPCM: break; /* not handled here */
     }
@@ -354,6 +183,7 @@ al::optional<FmtType> FmtFromUserFmt(UserFmtType type)
     case UserFmtDouble: return al::make_optional(FmtDouble);
     case UserFmtMulaw: return al::make_optional(FmtMulaw);
     case UserFmtAlaw: return al::make_optional(FmtAlaw);
+    case UserFmtHalf: return al::make_optional(FmtHalf);
     /* ADPCM not handled here. */
     case UserFmtIMA4: break;
     case UserFmtMSADPCM: break;
@@ -396,6 +226,9 @@ void eax_x_ram_clear(ALCdevice& al_device, ALbuffer& al_buffer)
 #endif // ALSOFT_EAX
 
 
+/* Maximum number of threads to upload buffer data with. */
+constexpr uint MaxUploadThreads{8u};
+
 constexpr ALbitfieldSOFT INVALID_STORAGE_MASK{~unsigned(AL_MAP_READ_BIT_SOFT |
     AL_MAP_WRITE_BIT_SOFT | AL_MAP_PERSISTENT_BIT_SOFT | AL_PRESERVE_DATA_BIT_SOFT)};
 constexpr ALbitfieldSOFT MAP_READ_WRITE_FLAGS{AL_MAP_READ_BIT_SOFT | AL_MAP_WRITE_BIT_SOFT};
@@ -447,19 +280,35 @@ ALbuffer *AllocBuffer(ALCdevice *device)
     return buffer;
 }
 
-void FreeBuffer(ALCdevice *device, ALbuffer *buffer)
+/* Drops any resampled copies of the buffer, when its samples or loop points
+ * change. This waits for a copy being built, so it needs to happen before the
+ * samples are freed or replaced.
+ */
+void InvalidateResampled(ALCdevice *device, ALbuffer *buffer)
+{
+    if(ResampleCache *cache{device->mResampleCache.get()})
+        cache->invalidate(buffer);
+}
+
+/* Returns the release callback for the buffer's static samples, to call after
+ * unlocking the buffer lock.
+ */
+ALbuffer::StaticRelease FreeBuffer(ALCdevice *device, ALbuffer *buffer)
 {
 #ifdef ALSOFT_EAX
     eax_x_ram_clear(*device, *buffer);
 #endif // ALSOFT_EAX
+    InvalidateResampled(device, buffer);
 
     const ALuint id{buffer->id - 1};
     const size_t lidx{id >> 6};
     const ALuint slidx{id & 0x3f};
 
+    const ALbuffer::StaticRelease release{buffer->releaseStaticData()};
     al::destroy_at(buffer);
 
     device->BufferList[lidx].FreeMask |= 1_u64 << slidx;
+    return release;
 }
 
 inline ALbuffer *LookupBuffer(ALCdevice *device, ALuint id)
@@ -520,61 +369,81 @@ const ALchar *NameFromUserFmtType(UserFmtType type)
     case UserFmtDouble: return "Float64";
     case UserFmtMulaw: return "muLaw";
     case UserFmtAlaw: return "aLaw";
+    case UserFmtHalf: return "Float16";
     case UserFmtIMA4: return "IMA4 ADPCM";
     case UserFmtMSADPCM: return "MSADPCM";
     }
     return "<internal type error>";
 }
 
-/** Loads the specified data into the buffer, using the specified format. */
-void LoadData(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq, ALuint size,
-    UserFmtChannels SrcChannels, UserFmtType SrcType, const al::byte *SrcData,
-    ALbitfieldSOFT access)
+/* The storage needed for data loaded into a buffer, once it's been checked
+ * against the buffer.
+ */
+struct DataLayout {
+    FmtChannels mChannels;
+    FmtType mType;
+    UserFmtType mSrcType;
+    ALuint mAmbiOrder;
+    ALuint mBlockAlign;
+    ALuint mSampleLen;
+    ALuint mSrcSize;
+    size_t mDataSize;
+};
+
+/** Checks that data of the given format and size can be loaded into the buffer. */
+al::optional<DataLayout> GetDataLayout(ALCcontext *context, ALbuffer *ALBuf, ALuint size,
+    UserFmtChannels SrcChannels, UserFmtType SrcType, ALbitfieldSOFT access)
 {
     if UNLIKELY(ReadRef(ALBuf->ref) != 0 || ALBuf->MappedAccess != 0)
-        SETERR_RETURN(context, AL_INVALID_OPERATION,, "Modifying storage for in-use buffer %u",
-                      ALBuf->id);
+        SETERR_RETURN(context, AL_INVALID_OPERATION, al::nullopt,
+            "Modifying storage for in-use buffer %u", ALBuf->id);
 
     /* Currently no channel configurations need to be converted. */
     auto DstChannels = FmtFromUserFmt(SrcChannels);
     if UNLIKELY(!DstChannels)
-        SETERR_RETURN(context, AL_INVALID_ENUM, , "Invalid format");
+        SETERR_RETURN(context, AL_INVALID_ENUM, al::nullopt, "Invalid format");
 
-    /* IMA4 and MSADPCM convert to 16-bit short.
+    /* IMA4 and MSADPCM are stored as-is, and decoded as they're mixed.
      *
-     * TODO: Currently we can only map samples when they're not converted. To
-     * allow it would need some kind of double-buffering to hold onto a copy of
-     * the original data.
+     * TODO: Mapping only deals in whole sample frames, which compressed
+     * blocks don't have, so ADPCM samples can't be mapped.
      */
     if((access&MAP_READ_WRITE_FLAGS))
     {
         if UNLIKELY(SrcType == UserFmtIMA4 || SrcType == UserFmtMSADPCM)
-            SETERR_RETURN(context, AL_INVALID_VALUE,, "%s samples cannot be mapped",
+            SETERR_RETURN(context, AL_INVALID_VALUE, al::nullopt, "%s samples cannot be mapped",
                 NameFromUserFmtType(SrcType));
     }
-    auto DstType = (SrcType == UserFmtIMA4 || SrcType == UserFmtMSADPCM)
-        ? al::make_optional(FmtShort) : FmtFromUserFmt(SrcType);
+    auto DstType = (SrcType == UserFmtIMA4) ? al::make_optional(FmtIMA4) :
+        (SrcType == UserFmtMSADPCM) ? al::make_optional(FmtMSADPCM) : FmtFromUserFmt(SrcType);
     if UNLIKELY(!DstType)
-        SETERR_RETURN(context, AL_INVALID_ENUM, , "Invalid format");
+        SETERR_RETURN(context, AL_INVALID_ENUM, al::nullopt, "Invalid format");
 
     const ALuint unpackalign{ALBuf->UnpackAlign};
     const ALuint align{SanitizeAlignment(SrcType, unpackalign)};
     if UNLIKELY(align < 1)
-        SETERR_RETURN(context, AL_INVALID_VALUE,, "Invalid unpack alignment %u for %s samples",
-            unpackalign, NameFromUserFmtType(SrcType));
+        SETERR_RETURN(context, AL_INVALID_VALUE, al::nullopt,
+            "Invalid unpack alignment %u for %s samples", unpackalign,
+            NameFromUserFmtType(SrcType));
 
     const ALuint ambiorder{IsBFormat(*DstChannels) ? ALBuf->UnpackAmbiOrder :
         (IsUHJ(*DstChannels) ? 1 : 0)};
 
     if((access&AL_PRESERVE_DATA_BIT_SOFT))
     {
+        if UNLIKELY(ALBuf->mStaticData.data())
+            SETERR_RETURN(context, AL_INVALID_OPERATION, al::nullopt,
+                "Preserving data of static buffer %u", ALBuf->id);
         /* Can only preserve data with the same format and alignment. */
         if UNLIKELY(ALBuf->mChannels != *DstChannels || ALBuf->OriginalType != SrcType)
-            SETERR_RETURN(context, AL_INVALID_VALUE,, "Preserving data of mismatched format");
+            SETERR_RETURN(context, AL_INVALID_VALUE, al::nullopt,
+                "Preserving data of mismatched format");
         if UNLIKELY(ALBuf->OriginalAlign != align)
-            SETERR_RETURN(context, AL_INVALID_VALUE,, "Preserving data of mismatched alignment");
+            SETERR_RETURN(context, AL_INVALID_VALUE, al::nullopt,
+                "Preserving data of mismatched alignment");
         if(ALBuf->mAmbiOrder != ambiorder)
-            SETERR_RETURN(context, AL_INVALID_VALUE,, "Preserving data of mismatched order");
+            SETERR_RETURN(context, AL_INVALID_VALUE, al::nullopt,
+                "Preserving data of mismatched order");
     }
 
     /* Convert the input/source size in bytes to sample frames using the unpack
@@ -585,127 +454,187 @@ void LoadData(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq, ALuint size,
         (SrcType == UserFmtMSADPCM) ? (align-2)/2 + 7 :
         (align * BytesFromUserFmt(SrcType)))};
     if UNLIKELY((size%SrcByteAlign) != 0)
-        SETERR_RETURN(context, AL_INVALID_VALUE,,
+        SETERR_RETURN(context, AL_INVALID_VALUE, al::nullopt,
             "Data size %d is not a multiple of frame size %d (%d unpack alignment)",
             size, SrcByteAlign, align);
 
     if UNLIKELY(size/SrcByteAlign > std::numeric_limits<ALsizei>::max()/align)
-        SETERR_RETURN(context, AL_OUT_OF_MEMORY,,
+        SETERR_RETURN(context, AL_OUT_OF_MEMORY, al::nullopt,
             "Buffer size overflow, %d blocks x %d samples per block", size/SrcByteAlign, align);
     const ALuint frames{size / SrcByteAlign * align};
 
     /* Convert the sample frames to the number of bytes needed for internal
-     * storage.
+     * storage. ADPCM blocks are stored as given.
      */
-    ALuint NumChannels{ChannelsFromFmt(*DstChannels, ambiorder)};
-    ALuint FrameSize{NumChannels * BytesFromFmt(*DstType)};
-    if UNLIKELY(frames > std::numeric_limits<size_t>::max()/FrameSize)
-        SETERR_RETURN(context, AL_OUT_OF_MEMORY,,
-            "Buffer size overflow, %d frames x %d bytes per frame", frames, FrameSize);
-    size_t newsize{static_cast<size_t>(frames) * FrameSize};
+    const ALuint BlockAlign{IsAdpcm(*DstType) ? align : 1u};
+    const ALuint BlockSize{BlockSizeFromFmt(*DstType, BlockAlign,
+        ChannelsFromFmt(*DstChannels, ambiorder))};
+    if UNLIKELY(frames/BlockAlign > std::numeric_limits<size_t>::max()/BlockSize)
+        SETERR_RETURN(context, AL_OUT_OF_MEMORY, al::nullopt,
+            "Buffer size overflow, %d frames x %d bytes per frame", frames, BlockSize);
+
+    return DataLayout{*DstChannels, *DstType, SrcType, ambiorder, BlockAlign, frames, size,
+        static_cast<size_t>(frames/BlockAlign) * BlockSize};
+}
+
+/** Sets the buffer's format and length for the loaded data. */
+void SetDataLayout(ALbuffer *ALBuf, const DataLayout &layout, ALsizei freq,
+    ALbitfieldSOFT access)
+{
+    ALBuf->OriginalAlign = layout.mBlockAlign;
+    ALBuf->OriginalSize = layout.mSrcSize;
+    ALBuf->OriginalType = layout.mSrcType;
+
+    ALBuf->Access = access;
+
+    ALBuf->mSampleRate = static_cast<ALuint>(freq);
+    ALBuf->mChannels = layout.mChannels;
+    ALBuf->mType = layout.mType;
+    ALBuf->mAmbiOrder = layout.mAmbiOrder;
+
+    ALBuf->mCallback = nullptr;
+    ALBuf->mUserData = nullptr;
+    ALBuf->mStream = nullptr;
+
+    ALBuf->mSampleLen = layout.mSampleLen;
+    ALBuf->mBlockAlign = layout.mBlockAlign;
+    ALBuf->mLoopStart = 0;
+    ALBuf->mLoopEnd = ALBuf->mSampleLen;
+}
+
+/* Application-owned memory for a buffer to reference instead of copying. */
+struct StaticData {
+    ALBUFFERRELEASETYPESOFT release;
+    void *userptr;
+};
+
+/**
+ * Loads the specified data into the buffer, using the specified format. With
+ * static data, the buffer references SrcData directly instead of copying it.
+ * Returns the release callback for the static data it replaced, to call after
+ * unlocking the buffer lock.
+ */
+ALbuffer::StaticRelease LoadData(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq, ALuint size,
+    UserFmtChannels SrcChannels, UserFmtType SrcType, const al::byte *SrcData,
+    ALbitfieldSOFT access, const StaticData *staticdata=nullptr)
+{
+    auto layout = GetDataLayout(context, ALBuf, size, SrcChannels, SrcType, access);
+    if UNLIKELY(!layout) return {};
+
+    /* The mixer reads static samples in place, so they need to be aligned to
+     * the sample type.
+     */
+    const ALuint typealign{IsAdpcm(layout->mType) ? 1u : BytesFromFmt(layout->mType)};
+    if UNLIKELY(staticdata && (reinterpret_cast<uintptr_t>(SrcData)%typealign) != 0)
+        SETERR_RETURN(context, AL_INVALID_VALUE, {},
+            "Static data %p is not aligned to the %u-byte sample size", SrcData, typealign);
 
 #ifdef ALSOFT_EAX
-    if(ALBuf->eax_x_ram_mode == AL_STORAGE_HARDWARE)
+    if(!staticdata && ALBuf->eax_x_ram_mode == AL_STORAGE_HARDWARE)
     {
         ALCdevice &device = *context->mALDevice;
         if(!eax_x_ram_check_availability(device, *ALBuf, size))
-            SETERR_RETURN(context, AL_OUT_OF_MEMORY,,
+            SETERR_RETURN(context, AL_OUT_OF_MEMORY, {},
                 "Out of X-RAM memory (avail: %u, needed: %u)", device.eax_x_ram_free_size, size);
     }
 #endif
 
-    /* Round up to the next 16-byte multiple. This could reallocate only when
-     * increasing or the new size is less than half the current, but then the
-     * buffer's AL_SIZE would not be very reliable for accounting buffer memory
-     * usage, and reporting the real size could cause problems for apps that
-     * use AL_SIZE to try to get the buffer's play length.
-     */
-    newsize = RoundUp(newsize, 16);
-    if(newsize != ALBuf->mData.size())
+    /* Stop any copy of the old samples being made before replacing them. */
+    InvalidateResampled(context->mALDevice.get(), ALBuf);
+
+    const ALbuffer::StaticRelease release{ALBuf->releaseStaticData()};
+    if(staticdata)
+    {
+        /* Static samples are only ever read, by the mixer and convolution
+         * effect, so the buffer's own storage can be freed.
+         */
+        al::vector<al::byte,16>{}.swap(ALBuf->mData);
+        ALBuf->mStaticData = {const_cast<al::byte*>(SrcData), layout->mDataSize};
+        ALBuf->mStaticRelease = staticdata->release;
+        ALBuf->mStaticUserData = staticdata->userptr;
+    }
+    else
     {
-        auto newdata = al::vector<al::byte,16>(newsize, al::byte{});
-        if((access&AL_PRESERVE_DATA_BIT_SOFT))
+        /* Round up to the next 16-byte multiple. This could reallocate only
+         * when increasing or the new size is less than half the current, but
+         * then the buffer's AL_SIZE would not be very reliable for accounting
+         * buffer memory usage, and reporting the real size could cause
+         * problems for apps that use AL_SIZE to try to get the buffer's play
+         * length.
+         */
+        const size_t newsize{RoundUp(layout->mDataSize, 16)};
+        if(newsize != ALBuf->mData.size())
         {
-            const size_t tocopy{minz(newdata.size(), ALBuf->mData.size())};
-            std::copy_n(ALBuf->mData.begin(), tocopy, newdata.begin());
+            auto newdata = al::vector<al::byte,16>(newsize, al::byte{});
+            if((access&AL_PRESERVE_DATA_BIT_SOFT))
+            {
+                const size_t tocopy{minz(newdata.size(), ALBuf->mData.size())};
+                std::copy_n(ALBuf->mData.begin(), tocopy, newdata.begin());
+            }
+            newdata.swap(ALBuf->mData);
         }
-        newdata.swap(ALBuf->mData);
     }
 #ifdef ALSOFT_EAX
     eax_x_ram_clear(*context->mALDevice, *ALBuf);
 #endif
 
-    if(SrcType == UserFmtIMA4)
-    {
-        assert(*DstType == FmtShort);
-        if(SrcData != nullptr && !ALBuf->mData.empty())
-            Convert_int16_ima4(reinterpret_cast<int16_t*>(ALBuf->mData.data()), SrcData,
-                NumChannels, frames, align);
-        ALBuf->OriginalAlign = align;
-    }
-    else if(SrcType == UserFmtMSADPCM)
-    {
-        assert(*DstType == FmtShort);
-        if(SrcData != nullptr && !ALBuf->mData.empty())
-            Convert_int16_msadpcm(reinterpret_cast<int16_t*>(ALBuf->mData.data()), SrcData,
-                NumChannels, frames, align);
-        ALBuf->OriginalAlign = align;
-    }
-    else
-    {
-        assert(DstType.has_value());
-        if(SrcData != nullptr && !ALBuf->mData.empty())
-            std::copy_n(SrcData, frames*FrameSize, ALBuf->mData.begin());
-        ALBuf->OriginalAlign = 1;
-    }
-    ALBuf->OriginalSize = size;
-    ALBuf->OriginalType = SrcType;
-
-    ALBuf->Access = access;
-
-    ALBuf->mSampleRate = static_cast<ALuint>(freq);
-    ALBuf->mChannels = *DstChannels;
-    ALBuf->mType = *DstType;
-    ALBuf->mAmbiOrder = ambiorder;
-
-    ALBuf->mCallback = nullptr;
-    ALBuf->mUserData = nullptr;
-
-    ALBuf->mSampleLen = frames;
-    ALBuf->mLoopStart = 0;
-    ALBuf->mLoopEnd = ALBuf->mSampleLen;
+    if(SrcData != nullptr && !ALBuf->mData.empty())
+        std::copy_n(SrcData, layout->mDataSize, ALBuf->mData.begin());
+    SetDataLayout(ALBuf, *layout, freq, access);
 
 #ifdef ALSOFT_EAX
-    if(eax_g_is_enabled && ALBuf->eax_x_ram_mode != AL_STORAGE_ACCESSIBLE)
+    if(!staticdata && eax_g_is_enabled && ALBuf->eax_x_ram_mode != AL_STORAGE_ACCESSIBLE)
         eax_x_ram_apply(*context->mALDevice, *ALBuf);
 #endif
+    return release;
 }
 
-/** Prepares the buffer to use the specified callback, using the specified format. */
-void PrepareCallback(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq,
+/**
+ * Prepares the buffer to use the specified callback, using the specified
+ * format. Returns the release callback for the static data it replaced, to
+ * call after unlocking the buffer lock.
+ */
+ALbuffer::StaticRelease PrepareCallback(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq,
     UserFmtChannels SrcChannels, UserFmtType SrcType, ALBUFFERCALLBACKTYPESOFT callback,
     void *userptr)
 {
     if UNLIKELY(ReadRef(ALBuf->ref) != 0 || ALBuf->MappedAccess != 0)
-        SETERR_RETURN(context, AL_INVALID_OPERATION,, "Modifying callback for in-use buffer %u",
+        SETERR_RETURN(context, AL_INVALID_OPERATION, {}, "Modifying callback for in-use buffer %u",
             ALBuf->id);
 
     /* Currently no channel configurations need to be converted. */
     auto DstChannels = FmtFromUserFmt(SrcChannels);
     if UNLIKELY(!DstChannels)
-        SETERR_RETURN(context, AL_INVALID_ENUM,, "Invalid format");
+        SETERR_RETURN(context, AL_INVALID_ENUM, {}, "Invalid format");
 
     /* IMA4 and MSADPCM convert to 16-bit short. Not supported with callbacks. */
     auto DstType = FmtFromUserFmt(SrcType);
     if UNLIKELY(!DstType)
-        SETERR_RETURN(context, AL_INVALID_ENUM,, "Unsupported callback format");
+        SETERR_RETURN(context, AL_INVALID_ENUM, {}, "Unsupported callback format");
 
     const ALuint ambiorder{IsBFormat(*DstChannels) ? ALBuf->UnpackAmbiOrder :
         (IsUHJ(*DstChannels) ? 1 : 0)};
 
+    InvalidateResampled(context->mALDevice.get(), ALBuf);
+    const ALbuffer::StaticRelease release{ALBuf->releaseStaticData()};
+
     static constexpr uint line_size{BufferLineSize + MaxPostVoiceLoad};
-    al::vector<al::byte,16>(FrameSizeFromFmt(*DstChannels, *DstType, ambiorder) *
-        size_t{line_size}).swap(ALBuf->mData);
+    const uint framesize{FrameSizeFromFmt(*DstChannels, *DstType, ambiorder)};
+    ALBuf->mStream = nullptr;
+    if(CallbackStreamer *streamer{context->mALDevice->mCallbackStreamer.get()})
+    {
+        /* Read ahead twice the device's buffer length, and at least two
+         * mixer lines.
+         */
+        const ALCdevice *device{context->mALDevice.get()};
+        const uint64_t devframes{uint64_t{device->BufferSize} * static_cast<uint>(freq) /
+            device->Frequency};
+        const size_t frames{static_cast<size_t>(maxu64(devframes, line_size) * 2)};
+        ALBuf->mStream = streamer->createStream(callback, userptr, frames, framesize);
+        al::vector<al::byte,16>{}.swap(ALBuf->mData);
+    }
+    else
+        al::vector<al::byte,16>(framesize * size_t{line_size}).swap(ALBuf->mData);
 
 #ifdef ALSOFT_EAX
     eax_x_ram_clear(*context->mALDevice, *ALBuf);
@@ -725,8 +654,210 @@ void PrepareCallback(ALCcontext *context, ALbuffer *ALBuf, ALsizei freq,
     ALBuf->mAmbiOrder = ambiorder;
 
     ALBuf->mSampleLen = 0;
+    ALBuf->mBlockAlign = 1;
     ALBuf->mLoopStart = 0;
     ALBuf->mLoopEnd = ALBuf->mSampleLen;
+    return release;
+}
+
+
+/* Threads that copy asynchronously uploaded buffer data, shared by all
+ * devices. The buffer lock is only taken to swap in the finished storage.
+ */
+class BufferUploader {
+    struct Job {
+        ContextRef mContext;
+        ALuint mBufferId;
+        DataLayout mLayout;
+        ALsizei mFreq;
+        const al::byte *mData;
+    };
+
+    std::mutex mLock;
+    std::condition_variable mCond;
+    al::deque<Job> mJobs;
+    bool mQuitNow{false};
+
+    al::vector<std::thread> mThreads;
+
+    void threadProc();
+    static void finish(Job &job, al::vector<al::byte,16> storage);
+    static void cancel(Job &job);
+
+public:
+    BufferUploader(const uint numthreads);
+    ~BufferUploader();
+
+    void push(Job job);
+
+    static BufferUploader &Get();
+};
+
+BufferUploader::BufferUploader(const uint numthreads)
+{
+    mThreads.reserve(numthreads);
+    for(uint i{0u};i < numthreads;++i)
+    {
+        try {
+            mThreads.emplace_back(std::mem_fn(&BufferUploader::threadProc), this);
+        }
+        catch(std::exception& e) {
+            ERR("Failed to start %s thread: %s\n", UPLOAD_THREAD_NAME, e.what());
+            break;
+        }
+    }
+    TRACE("Started %zu %s thread%s\n", mThreads.size(), UPLOAD_THREAD_NAME,
+        (mThreads.size() == 1) ? "" : "s");
+}
+
+BufferUploader::~BufferUploader()
+{
+    {
+        std::lock_guard<std::mutex> _{mLock};
+        mQuitNow = true;
+    }
+    mCond.notify_all();
+    for(auto &thread : mThreads)
+    {
+        if(thread.joinable())
+            thread.join();
+    }
+
+    /* Uploads that didn't start are cancelled, so their buffers don't stay
+     * pending and referenced, and their contexts are released.
+     */
+    if(!mJobs.empty())
+        WARN("Cancelling %zu pending buffer upload%s\n", mJobs.size(),
+            (mJobs.size() == 1) ? "" : "s");
+    for(Job &job : mJobs)
+        cancel(job);
+    mJobs.clear();
+}
+
+void BufferUploader::push(Job job)
+{
+    /* Without any threads, just do the upload now. */
+    if UNLIKELY(mThreads.empty())
+    {
+        al::vector<al::byte,16> storage(RoundUp(job.mLayout.mDataSize, 16), al::byte{});
+        std::copy_n(job.mData, job.mLayout.mDataSize, storage.begin());
+        finish(job, std::move(storage));
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> _{mLock};
+        mJobs.emplace_back(std::move(job));
+    }
+    mCond.notify_one();
+}
+
+void BufferUploader::threadProc()
+{
+    althrd_setname(UPLOAD_THREAD_NAME);
+
+    std::unique_lock<std::mutex> lock{mLock};
+    while(true)
+    {
+        mCond.wait(lock, [this]() noexcept { return mQuitNow || !mJobs.empty(); });
+        if(mQuitNow) break;
+
+        Job job{std::move(mJobs.front())};
+        mJobs.pop_front();
+        lock.unlock();
+
+        /* Allocating and copying is the slow part, which doesn't need the
+         * buffer lock.
+         */
+        al::vector<al::byte,16> storage(RoundUp(job.mLayout.mDataSize, 16), al::byte{});
+        std::copy_n(job.mData, job.mLayout.mDataSize, storage.begin());
+        finish(job, std::move(storage));
+
+        lock.lock();
+    }
+}
+
+void BufferUploader::finish(Job &job, al::vector<al::byte,16> storage)
+{
+    ALCcontext *context{job.mContext.get()};
+    ALCdevice *device{context->mALDevice.get()};
+
+    std::unique_lock<std::mutex> buflock{device->BufferLock};
+    /* The buffer can't be deleted, modified, or mapped while its upload is
+     * pending, since it holds a reference. If it's somehow gone anyway, there's
+     * nothing to upload to.
+     */
+    ALbuffer *ALBuf{LookupBuffer(device, job.mBufferId)};
+    if UNLIKELY(!ALBuf || !ALBuf->mUploadPending)
+    {
+        buflock.unlock();
+        ERR("Buffer %u was deleted during its upload\n", job.mBufferId);
+        return;
+    }
+    ALBuf->mUploadPending = false;
+    DecrementRef(ALBuf->ref);
+
+    InvalidateResampled(device, ALBuf);
+    const ALbuffer::StaticRelease release{ALBuf->releaseStaticData()};
+    storage.swap(ALBuf->mData);
+#ifdef ALSOFT_EAX
+    eax_x_ram_clear(*device, *ALBuf);
+#endif
+    SetDataLayout(ALBuf, job.mLayout, job.mFreq, 0);
+#ifdef ALSOFT_EAX
+    if(eax_g_is_enabled && ALBuf->eax_x_ram_mode != AL_STORAGE_ACCESSIBLE)
+        eax_x_ram_apply(*device, *ALBuf);
+#endif
+    buflock.unlock();
+
+    /* Free the old storage, and release any static samples, without holding
+     * the lock.
+     */
+    al::vector<al::byte,16>{}.swap(storage);
+    release();
+
+    /* Send the event off to the context's event thread, like the mixer's. If
+     * the ring is full, the event is dropped, as with the mixer's events.
+     */
+    const uint enabledevts{context->mEnabledEvts.load(std::memory_order_acquire)};
+    if(!(enabledevts&AsyncEvent::BufferUploaded))
+        return;
+
+    std::lock_guard<std::mutex> _{context->mThreadEventLock};
+    RingBuffer *ring{context->mThreadEvents.get()};
+    auto evt_data = ring->getWriteVector().first;
+    if(evt_data.len > 0)
+    {
+        AsyncEvent *evt{al::construct_at(reinterpret_cast<AsyncEvent*>(evt_data.buf),
+            AsyncEvent::BufferUploaded)};
+        evt->u.bufupload.id = job.mBufferId;
+        ring->writeAdvance(1);
+        context->mEventSem.post();
+    }
+}
+
+void BufferUploader::cancel(Job &job)
+{
+    ALCdevice *device{job.mContext->mALDevice.get()};
+
+    std::lock_guard<std::mutex> _{device->BufferLock};
+    ALbuffer *ALBuf{LookupBuffer(device, job.mBufferId)};
+    if(ALBuf && ALBuf->mUploadPending)
+    {
+        ALBuf->mUploadPending = false;
+        DecrementRef(ALBuf->ref);
+    }
+}
+
+BufferUploader &BufferUploader::Get()
+{
+    static BufferUploader uploader{[]
+    {
+        const uint defthreads{clampu(std::thread::hardware_concurrency(), 1u, MaxUploadThreads)};
+        return minu(ConfigValueUInt(nullptr, nullptr, "upload-threads").value_or(defthreads),
+            MaxUploadThreads);
+    }()};
+    return uploader;
 }
 
 
@@ -738,7 +869,7 @@ al::optional<DecompResult> DecomposeUserFormat(ALenum format)
         UserFmtChannels channels;
         UserFmtType type;
     };
-    static const std::array<FormatMap,55> UserFmtList{{
+    static const std::array<FormatMap,63> UserFmtList{{
         { AL_FORMAT_MONO8,             UserFmtMono, UserFmtUByte   },
         { AL_FORMAT_MONO16,            UserFmtMono, UserFmtShort   },
         { AL_FORMAT_MONO_FLOAT32,      UserFmtMono, UserFmtFloat   },
@@ -747,6 +878,7 @@ al::optional<DecompResult> DecomposeUserFormat(ALenum format)
         { AL_FORMAT_MONO_MSADPCM_SOFT, UserFmtMono, UserFmtMSADPCM },
         { AL_FORMAT_MONO_MULAW,        UserFmtMono, UserFmtMulaw   },
         { AL_FORMAT_MONO_ALAW_EXT,     UserFmtMono, UserFmtAlaw    },
+        { AL_FORMAT_MONO_HALF_SOFT,    UserFmtMono, UserFmtHalf    },
 
         { AL_FORMAT_STEREO8,             UserFmtStereo, UserFmtUByte   },
         { AL_FORMAT_STEREO16,            UserFmtStereo, UserFmtShort   },
@@ -756,6 +888,7 @@ al::optional<DecompResult> DecomposeUserFormat(ALenum format)
         { AL_FORMAT_STEREO_MSADPCM_SOFT, UserFmtStereo, UserFmtMSADPCM },
         { AL_FORMAT_STEREO_MULAW,        UserFmtStereo, UserFmtMulaw   },
         { AL_FORMAT_STEREO_ALAW_EXT,     UserFmtStereo, UserFmtAlaw    },
+        { AL_FORMAT_STEREO_HALF_SOFT,    UserFmtStereo, UserFmtHalf    },
 
         { AL_FORMAT_REAR8,      UserFmtRear, UserFmtUByte },
         { AL_FORMAT_REAR16,     UserFmtRear, UserFmtShort },
@@ -769,31 +902,37 @@ al::optional<DecompResult> DecomposeUserFormat(ALenum format)
         { AL_FORMAT_QUAD16,     UserFmtQuad, UserFmtShort },
         { AL_FORMAT_QUAD32,     UserFmtQuad, UserFmtFloat },
         { AL_FORMAT_QUAD_MULAW, UserFmtQuad, UserFmtMulaw },
+        { AL_FORMAT_QUAD_HALF_SOFT, UserFmtQuad, UserFmtHalf },
 
         { AL_FORMAT_51CHN8,      UserFmtX51, UserFmtUByte },
         { AL_FORMAT_51CHN16,     UserFmtX51, UserFmtShort },
         { AL_FORMAT_51CHN32,     UserFmtX51, UserFmtFloat },
         { AL_FORMAT_51CHN_MULAW, UserFmtX51, UserFmtMulaw },
+        { AL_FORMAT_51CHN_HALF_SOFT, UserFmtX51, UserFmtHalf },
 
         { AL_FORMAT_61CHN8,      UserFmtX61, UserFmtUByte },
         { AL_FORMAT_61CHN16,     UserFmtX61, UserFmtShort },
         { AL_FORMAT_61CHN32,     UserFmtX61, UserFmtFloat },
         { AL_FORMAT_61CHN_MULAW, UserFmtX61, UserFmtMulaw },
+        { AL_FORMAT_61CHN_HALF_SOFT, UserFmtX61, UserFmtHalf },
 
         { AL_FORMAT_71CHN8,      UserFmtX71, UserFmtUByte },
         { AL_FORMAT_71CHN16,     UserFmtX71, UserFmtShort },
         { AL_FORMAT_71CHN32,     UserFmtX71, UserFmtFloat },
         { AL_FORMAT_71CHN_MULAW, UserFmtX71, UserFmtMulaw },
+        { AL_FORMAT_71CHN_HALF_SOFT, UserFmtX71, UserFmtHalf },
 
         { AL_FORMAT_BFORMAT2D_8,       UserFmtBFormat2D, UserFmtUByte },
         { AL_FORMAT_BFORMAT2D_16,      UserFmtBFormat2D, UserFmtShort },
         { AL_FORMAT_BFORMAT2D_FLOAT32, UserFmtBFormat2D, UserFmtFloat },
         { AL_FORMAT_BFORMAT2D_MULAW,   UserFmtBFormat2D, UserFmtMulaw },
+        { AL_FORMAT_BFORMAT2D_HALF_SOFT, UserFmtBFormat2D, UserFmtHalf },
 
         { AL_FORMAT_BFORMAT3D_8,       UserFmtBFormat3D, UserFmtUByte },
         { AL_FORMAT_BFORMAT3D_16,      UserFmtBFormat3D, UserFmtShort },
         { AL_FORMAT_BFORMAT3D_FLOAT32, UserFmtBFormat3D, UserFmtFloat },
         { AL_FORMAT_BFORMAT3D_MULAW,   UserFmtBFormat3D, UserFmtMulaw },
+        { AL_FORMAT_BFORMAT3D_HALF_SOFT, UserFmtBFormat3D, UserFmtHalf },
 
         { AL_FORMAT_UHJ2CHN8_SOFT,        UserFmtUHJ2, UserFmtUByte },
         { AL_FORMAT_UHJ2CHN16_SOFT,       UserFmtUHJ2, UserFmtShort },
@@ -870,7 +1009,7 @@ START_API_FUNC
     if UNLIKELY(n <= 0) return;
 
     ALCdevice *device{context->mALDevice.get()};
-    std::lock_guard<std::mutex> _{device->BufferLock};
+    std::unique_lock<std::mutex> buflock{device->BufferLock};
 
     /* First try to find any buffers that are invalid or in-use. */
     auto validate_buffer = [device, &context](const ALuint bid) -> bool
@@ -893,13 +1032,22 @@ START_API_FUNC
     auto invbuf = std::find_if_not(buffers, buffers_end, validate_buffer);
     if UNLIKELY(invbuf != buffers_end) return;
 
-    /* All good. Delete non-0 buffer IDs. */
-    auto delete_buffer = [device](const ALuint bid) -> void
+    /* All good. Delete non-0 buffer IDs, then call the release callbacks for
+     * any static samples once the lock is released.
+     */
+    al::vector<ALbuffer::StaticRelease> releases;
+    auto delete_buffer = [device,&releases](const ALuint bid) -> void
     {
         ALbuffer *buffer{bid ? LookupBuffer(device, bid) : nullptr};
-        if(buffer) FreeBuffer(device, buffer);
+        if(!buffer) return;
+        const ALbuffer::StaticRelease release{FreeBuffer(device, buffer)};
+        if(release.mCallback) releases.emplace_back(release);
     };
     std::for_each(buffers, buffers_end, delete_buffer);
+    buflock.unlock();
+
+    for(const ALbuffer::StaticRelease &release : releases)
+        release();
 }
 END_API_FUNC
 
@@ -931,7 +1079,7 @@ START_API_FUNC
     if UNLIKELY(!context) return;
 
     ALCdevice *device{context->mALDevice.get()};
-    std::lock_guard<std::mutex> _{device->BufferLock};
+    std::unique_lock<std::mutex> buflock{device->BufferLock};
 
     ALbuffer *albuf = LookupBuffer(device, buffer);
     if UNLIKELY(!albuf)
@@ -953,8 +1101,10 @@ START_API_FUNC
             context->setError(AL_INVALID_ENUM, "Invalid format 0x%04x", format);
         else
         {
-            LoadData(context.get(), albuf, freq, static_cast<ALuint>(size), usrfmt->channels,
-                usrfmt->type, static_cast<const al::byte*>(data), flags);
+            auto oldrelease = LoadData(context.get(), albuf, freq, static_cast<ALuint>(size),
+                usrfmt->channels, usrfmt->type, static_cast<const al::byte*>(data), flags);
+            buflock.unlock();
+            oldrelease();
         }
     }
 }
@@ -985,6 +1135,9 @@ START_API_FUNC
                 "Mapping in-use buffer %u without persistent mapping", buffer);
         else if UNLIKELY(albuf->MappedAccess != 0)
             context->setError(AL_INVALID_OPERATION, "Mapping already-mapped buffer %u", buffer);
+        else if UNLIKELY(albuf->mUploadPending)
+            context->setError(AL_INVALID_OPERATION, "Mapping buffer %u with a pending upload",
+                buffer);
         else if UNLIKELY((unavailable&AL_MAP_READ_BIT_SOFT))
             context->setError(AL_INVALID_VALUE,
                 "Mapping buffer %u for reading without read access", buffer);
@@ -1001,6 +1154,10 @@ START_API_FUNC
                 offset, length, buffer);
         else
         {
+            /* Resampled copies may not match what's written while mapped. */
+            if((access&AL_MAP_WRITE_BIT_SOFT))
+                InvalidateResampled(device, albuf);
+
             void *retval{albuf->mData.data() + offset};
             albuf->MappedAccess = access;
             albuf->MappedOffset = offset;
@@ -1064,6 +1221,7 @@ START_API_FUNC
          * OpenAL's reading, and hope for the best...
          */
         std::atomic_thread_fence(std::memory_order_seq_cst);
+        InvalidateResampled(device, albuf);
     }
 }
 END_API_FUNC
@@ -1106,15 +1264,18 @@ START_API_FUNC
         context->setError(AL_INVALID_VALUE, "Unpacking data with mismatched ambisonic order");
     else if UNLIKELY(albuf->MappedAccess != 0)
         context->setError(AL_INVALID_OPERATION, "Unpacking data into mapped buffer %u", buffer);
+    else if UNLIKELY(albuf->mStaticData.data())
+        context->setError(AL_INVALID_OPERATION, "Unpacking data into static buffer %u", buffer);
+    else if UNLIKELY(albuf->mUploadPending)
+        context->setError(AL_INVALID_OPERATION,
+            "Unpacking data into buffer %u with a pending upload", buffer);
     else
     {
-        ALuint num_chans{albuf->channelsFromFmt()};
-        ALuint frame_size{num_chans * albuf->bytesFromFmt()};
-        ALuint byte_align{
-            (albuf->OriginalType == UserFmtIMA4) ? ((align-1)/2 + 4) * num_chans :
-            (albuf->OriginalType == UserFmtMSADPCM) ? ((align-2)/2 + 7) * num_chans :
-            (align * frame_size)
-        };
+        /* ADPCM is kept compressed, so it's accessed in whole blocks. PCM
+         * still needs to be in whole unpack-aligned frames.
+         */
+        const ALuint byte_align{albuf->isAdpcm() ? albuf->blockSizeFromFmt() :
+            align * albuf->frameSizeFromFmt()};
 
         if UNLIKELY(offset < 0 || length < 0 || static_cast<ALuint>(offset) > albuf->OriginalSize
             || static_cast<ALuint>(length) > albuf->OriginalSize-static_cast<ALuint>(offset))
@@ -1130,22 +1291,151 @@ START_API_FUNC
                 length, byte_align, align);
         else
         {
-            /* offset -> byte offset, length -> sample count */
-            size_t byteoff{static_cast<ALuint>(offset)/byte_align * align * frame_size};
-            size_t samplen{static_cast<ALuint>(length)/byte_align * align};
-
-            void *dst = albuf->mData.data() + byteoff;
-            if(usrfmt->type == UserFmtIMA4 && albuf->mType == FmtShort)
-                Convert_int16_ima4(static_cast<int16_t*>(dst), static_cast<const al::byte*>(data),
-                    num_chans, samplen, align);
-            else if(usrfmt->type == UserFmtMSADPCM && albuf->mType == FmtShort)
-                Convert_int16_msadpcm(static_cast<int16_t*>(dst),
-                    static_cast<const al::byte*>(data), num_chans, samplen, align);
-            else
-            {
-                assert(long{usrfmt->type} == long{albuf->mType});
-                memcpy(dst, data, size_t{samplen} * frame_size);
-            }
+            /* The storage has the same layout as the unpacked data, including
+             * ADPCM which is kept compressed.
+             */
+            al::byte *dst{albuf->mData.data() + static_cast<ALuint>(offset)};
+            memcpy(dst, data, static_cast<ALuint>(length));
+            InvalidateResampled(device, albuf);
+        }
+    }
+}
+END_API_FUNC
+
+
+AL_API void AL_APIENTRY alBufferDataAsyncSOFT(ALuint buffer, ALenum format, const ALvoid *data,
+    ALsizei size, ALsizei freq)
+START_API_FUNC
+{
+    ContextRef context{GetContextRef()};
+    if UNLIKELY(!context) return;
+
+    ALCdevice *device{context->mALDevice.get()};
+    std::unique_lock<std::mutex> buflock{device->BufferLock};
+
+    ALbuffer *albuf = LookupBuffer(device, buffer);
+    if UNLIKELY(!albuf)
+        context->setError(AL_INVALID_NAME, "Invalid buffer ID %u", buffer);
+    else if UNLIKELY(!data)
+        context->setError(AL_INVALID_VALUE, "NULL data");
+    else if UNLIKELY(size < 0)
+        context->setError(AL_INVALID_VALUE, "Negative storage size %d", size);
+    else if UNLIKELY(freq < 1)
+        context->setError(AL_INVALID_VALUE, "Invalid sample rate %d", freq);
+    else
+    {
+        auto usrfmt = DecomposeUserFormat(format);
+        if UNLIKELY(!usrfmt)
+            context->setError(AL_INVALID_ENUM, "Invalid format 0x%04x", format);
+        else if(auto layout = GetDataLayout(context.get(), albuf, static_cast<ALuint>(size),
+            usrfmt->channels, usrfmt->type, 0))
+        {
+            /* Hold a reference until the upload finishes, which keeps the
+             * buffer from being deleted or modified in the mean time.
+             */
+            albuf->mUploadPending = true;
+            IncrementRef(albuf->ref);
+            buflock.unlock();
+
+            BufferUploader::Get().push({context, buffer, *layout, freq,
+                static_cast<const al::byte*>(data)});
+        }
+    }
+}
+END_API_FUNC
+
+AL_API void AL_APIENTRY alBufferRefillSOFT(ALuint buffer, ALenum format, const ALvoid *data,
+    ALsizei size, ALsizei freq)
+START_API_FUNC
+{
+    ContextRef context{GetContextRef()};
+    if UNLIKELY(!context) return;
+
+    ALCdevice *device{context->mALDevice.get()};
+    std::lock_guard<std::mutex> _{device->BufferLock};
+
+    ALbuffer *albuf = LookupBuffer(device, buffer);
+    if UNLIKELY(!albuf)
+    {
+        context->setError(AL_INVALID_NAME, "Invalid buffer ID %u", buffer);
+        return;
+    }
+    if UNLIKELY(size < 0)
+    {
+        context->setError(AL_INVALID_VALUE, "Negative storage size %d", size);
+        return;
+    }
+    if UNLIKELY(freq < 1)
+    {
+        context->setError(AL_INVALID_VALUE, "Invalid sample rate %d", freq);
+        return;
+    }
+
+    auto usrfmt = DecomposeUserFormat(format);
+    if UNLIKELY(!usrfmt)
+    {
+        context->setError(AL_INVALID_ENUM, "Invalid format 0x%04x", format);
+        return;
+    }
+
+    ALuint unpack_align{albuf->UnpackAlign};
+    ALuint align{SanitizeAlignment(usrfmt->type, unpack_align)};
+    const auto dstchannels = FmtFromUserFmt(usrfmt->channels);
+    if UNLIKELY(ReadRef(albuf->ref) != 0 || albuf->MappedAccess != 0)
+        context->setError(AL_INVALID_OPERATION, "Refilling in-use buffer %u", buffer);
+    else if UNLIKELY(albuf->mCallback || albuf->mStaticData.data())
+        context->setError(AL_INVALID_OPERATION, "Refilling %s buffer %u",
+            albuf->mCallback ? "callback" : "static", buffer);
+    else if UNLIKELY(align < 1)
+        context->setError(AL_INVALID_VALUE, "Invalid unpack alignment %u", unpack_align);
+    else if UNLIKELY(!dstchannels || *dstchannels != albuf->mChannels
+        || usrfmt->type != albuf->OriginalType)
+        context->setError(AL_INVALID_ENUM, "Refilling data with mismatched format");
+    else if UNLIKELY(align != albuf->OriginalAlign)
+        context->setError(AL_INVALID_VALUE,
+            "Refilling data with alignment %u does not match original alignment %u", align,
+            albuf->OriginalAlign);
+    else if UNLIKELY(albuf->isBFormat() && albuf->UnpackAmbiOrder != albuf->mAmbiOrder)
+        context->setError(AL_INVALID_VALUE, "Refilling data with mismatched ambisonic order");
+    else
+    {
+        /* As with alBufferSubDataSOFT, ADPCM is refilled in whole blocks, and
+         * PCM in whole unpack-aligned frames.
+         */
+        const ALuint byte_align{albuf->isAdpcm() ? albuf->blockSizeFromFmt() :
+            align * albuf->frameSizeFromFmt()};
+        const ALuint numbytes{static_cast<ALuint>(size)};
+
+        if UNLIKELY((numbytes%byte_align) != 0)
+            context->setError(AL_INVALID_VALUE,
+                "Data size %d is not a multiple of frame size %d (%d unpack alignment)", size,
+                byte_align, align);
+        else if UNLIKELY(numbytes > albuf->mData.size())
+            context->setError(AL_INVALID_VALUE,
+                "Refill size %d exceeds buffer %u's storage of %zu bytes", size, buffer,
+                albuf->mData.size());
+        else
+        {
+            /* The storage is kept as-is, and never reallocated, so a smaller
+             * refill just uses less of it. The storage has the same layout as
+             * the unpacked data, including ADPCM which is kept compressed.
+             */
+            if(data != nullptr)
+                memcpy(albuf->mData.data(), data, numbytes);
+#ifdef ALSOFT_EAX
+            const bool is_hardware{albuf->eax_x_ram_is_hardware};
+            eax_x_ram_clear(*device, *albuf);
+#endif
+            albuf->OriginalSize = numbytes;
+            albuf->mSampleRate = static_cast<ALuint>(freq);
+            albuf->mSampleLen = numbytes / albuf->blockSizeFromFmt() * albuf->mBlockAlign;
+            albuf->mLoopStart = 0;
+            albuf->mLoopEnd = albuf->mSampleLen;
+            InvalidateResampled(device, albuf);
+#ifdef ALSOFT_EAX
+            if(is_hardware)
+                eax_x_ram_apply(*device, *albuf);
+#endif
         }
     }
 }
@@ -1382,6 +1672,7 @@ START_API_FUNC
         {
             albuf->mLoopStart = static_cast<ALuint>(values[0]);
             albuf->mLoopEnd = static_cast<ALuint>(values[1]);
+            InvalidateResampled(device, albuf);
         }
         break;
 
@@ -1484,7 +1775,11 @@ START_API_FUNC
         break;
 
     case AL_BITS:
-        *value = static_cast<ALint>(albuf->bytesFromFmt() * 8);
+        /* ADPCM reports the bit depth it decodes to, like when it was stored
+         * decoded.
+         */
+        *value = static_cast<ALint>((albuf->isAdpcm() ? sizeof(int16_t) : albuf->bytesFromFmt())
+            * 8);
         break;
 
     case AL_CHANNELS:
@@ -1492,7 +1787,14 @@ START_API_FUNC
         break;
 
     case AL_SIZE:
-        *value = static_cast<ALint>(albuf->mSampleLen * albuf->frameSizeFromFmt());
+        /* Similarly, ADPCM reports the size of the decoded samples. Apps may
+         * use this to calculate the buffer length.
+         */
+        if(albuf->isAdpcm())
+            *value = static_cast<ALint>(albuf->mSampleLen * albuf->channelsFromFmt()
+                * sizeof(int16_t));
+        else
+            *value = static_cast<ALint>(albuf->mSampleLen * albuf->frameSizeFromFmt());
         break;
 
     case AL_UNPACK_BLOCK_ALIGNMENT_SOFT:
@@ -1515,6 +1817,15 @@ START_API_FUNC
         *value = static_cast<int>(albuf->UnpackAmbiOrder);
         break;
 
+    case AL_BUFFER_CALLBACK_UNDERRUNS_SOFT:
+        *value = albuf->mStream ? static_cast<int>(minu(std::numeric_limits<int>::max(),
+            albuf->mStream->mUnderruns.load(std::memory_order_relaxed))) : 0;
+        break;
+
+    case AL_BUFFER_UPLOAD_PENDING_SOFT:
+        *value = albuf->mUploadPending ? AL_TRUE : AL_FALSE;
+        break;
+
     default:
         context->setError(AL_INVALID_ENUM, "Invalid buffer integer property 0x%04x", param);
     }
@@ -1558,6 +1869,8 @@ START_API_FUNC
     case AL_AMBISONIC_LAYOUT_SOFT:
     case AL_AMBISONIC_SCALING_SOFT:
     case AL_UNPACK_AMBISONIC_ORDER_SOFT:
+    case AL_BUFFER_CALLBACK_UNDERRUNS_SOFT:
+    case AL_BUFFER_UPLOAD_PENDING_SOFT:
         alGetBufferi(buffer, param, values);
         return;
     }
@@ -1594,7 +1907,7 @@ START_API_FUNC
     if UNLIKELY(!context) return;
 
     ALCdevice *device{context->mALDevice.get()};
-    std::lock_guard<std::mutex> _{device->BufferLock};
+    std::unique_lock<std::mutex> buflock{device->BufferLock};
 
     ALbuffer *albuf = LookupBuffer(device, buffer);
     if UNLIKELY(!albuf)
@@ -1609,8 +1922,49 @@ START_API_FUNC
         if UNLIKELY(!usrfmt)
             context->setError(AL_INVALID_ENUM, "Invalid format 0x%04x", format);
         else
-            PrepareCallback(context.get(), albuf, freq, usrfmt->channels, usrfmt->type, callback,
-                userptr);
+        {
+            auto oldrelease = PrepareCallback(context.get(), albuf, freq, usrfmt->channels,
+                usrfmt->type, callback, userptr);
+            buflock.unlock();
+            oldrelease();
+        }
+    }
+}
+END_API_FUNC
+
+AL_API void AL_APIENTRY alBufferDataStaticSOFT(ALuint buffer, ALenum format, const ALvoid *data,
+    ALsizei size, ALsizei freq, ALBUFFERRELEASETYPESOFT release, ALvoid *userptr)
+START_API_FUNC
+{
+    ContextRef context{GetContextRef()};
+    if UNLIKELY(!context) return;
+
+    ALCdevice *device{context->mALDevice.get()};
+    std::unique_lock<std::mutex> buflock{device->BufferLock};
+
+    ALbuffer *albuf = LookupBuffer(device, buffer);
+    if UNLIKELY(!albuf)
+        context->setError(AL_INVALID_NAME, "Invalid buffer ID %u", buffer);
+    else if UNLIKELY(!data)
+        context->setError(AL_INVALID_VALUE, "NULL static data");
+    else if UNLIKELY(size < 0)
+        context->setError(AL_INVALID_VALUE, "Negative storage size %d", size);
+    else if UNLIKELY(freq < 1)
+        context->setError(AL_INVALID_VALUE, "Invalid sample rate %d", freq);
+    else
+    {
+        auto usrfmt = DecomposeUserFormat(format);
+        if UNLIKELY(!usrfmt)
+            context->setError(AL_INVALID_ENUM, "Invalid format 0x%04x", format);
+        else
+        {
+            const StaticData staticdata{release, userptr};
+            auto oldrelease = LoadData(context.get(), albuf, freq, static_cast<ALuint>(size),
+                usrfmt->channels, usrfmt->type, static_cast<const al::byte*>(data), 0,
+                &staticdata);
+            buflock.unlock();
+            oldrelease();
+        }
     }
 }
 END_API_FUNC
@@ -1636,6 +1990,12 @@ START_API_FUNC
     case AL_BUFFER_CALLBACK_USER_PARAM_SOFT:
         *value = albuf->mUserData;
         break;
+    case AL_BUFFER_RELEASE_FUNCTION_SOFT:
+        *value = reinterpret_cast<void*>(albuf->mStaticRelease);
+        break;
+    case AL_BUFFER_RELEASE_USER_PARAM_SOFT:
+        *value = albuf->mStaticUserData;
+        break;
 
     default:
         context->setError(AL_INVALID_ENUM, "Invalid buffer pointer property 0x%04x", param);
@@ -1670,6 +2030,8 @@ START_API_FUNC
     {
     case AL_BUFFER_CALLBACK_FUNCTION_SOFT:
     case AL_BUFFER_CALLBACK_USER_PARAM_SOFT:
+    case AL_BUFFER_RELEASE_FUNCTION_SOFT:
+    case AL_BUFFER_RELEASE_USER_PARAM_SOFT:
         alGetBufferPtrSOFT(buffer, param, values);
         return;
     }
@@ -1692,6 +2054,22 @@ START_API_FUNC
 END_API_FUNC
 
 
+ALbuffer::~ALbuffer()
+{ releaseStaticData()(); }
+
+auto ALbuffer::releaseStaticData() noexcept -> StaticRelease
+{
+    if(!mStaticData.data())
+        return {};
+
+    StaticRelease ret;
+    ret.mData = std::exchange(mStaticData, {}).data();
+    ret.mUserData = std::exchange(mStaticUserData, nullptr);
+    ret.mCallback = std::exchange(mStaticRelease, nullptr);
+    return ret;
+}
+
+
 BufferSubList::~BufferSubList()
 {
     uint64_t usemask{~FreeMask};
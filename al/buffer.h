@@ -2,14 +2,17 @@
 #define AL_BUFFER_H
 
 #include <atomic>
+#include <memory>
 
 #include "AL/al.h"
 
 #include "albyte.h"
 #include "alc/inprogext.h"
 #include "almalloc.h"
+#include "alspan.h"
 #include "atomic.h"
 #include "core/buffer_storage.h"
+#include "core/callback_stream.h"
 #include "vector.h"
 
 #ifdef ALSOFT_EAX
@@ -24,6 +27,7 @@ enum UserFmtType : unsigned char {
     UserFmtMulaw = FmtMulaw,
     UserFmtAlaw = FmtAlaw,
     UserFmtDouble = FmtDouble,
+    UserFmtHalf = FmtHalf,
 
     UserFmtIMA4 = 128,
     UserFmtMSADPCM,
@@ -45,10 +49,35 @@ enum UserFmtChannels : unsigned char {
 
 
 struct ALbuffer : public BufferStorage {
+    /* A release callback for static samples the buffer stopped referencing.
+     * It's called once the device's buffer lock is released, so the callback
+     * can make AL calls.
+     */
+    struct StaticRelease {
+        ALBUFFERRELEASETYPESOFT mCallback{nullptr};
+        void *mUserData{nullptr};
+        const al::byte *mData{nullptr};
+
+        void operator()() const { if(mCallback) mCallback(mUserData, mData); }
+    };
+
     ALbitfieldSOFT Access{0u};
 
     al::vector<al::byte,16> mData;
 
+    /* Application-owned samples set with alBufferDataStaticSOFT, used in place
+     * of mData. They're only read from, and the release callback is called
+     * once the buffer stops referencing them.
+     */
+    al::span<al::byte> mStaticData;
+    ALBUFFERRELEASETYPESOFT mStaticRelease{nullptr};
+    void *mStaticUserData{nullptr};
+
+    /* Reads ahead from the buffer callback on the device's callback threads,
+     * when it has them. Replaces mData as the callback's storage.
+     */
+    std::unique_ptr<CallbackStream> mStream;
+
     UserFmtType OriginalType{UserFmtShort};
     ALuint OriginalSize{0};
     ALuint OriginalAlign{0};
@@ -61,6 +90,9 @@ struct ALbuffer : public BufferStorage {
     ALsizei MappedOffset{0};
     ALsizei MappedSize{0};
 
+    /* Set while data from alBufferDataAsyncSOFT is being uploaded. */
+    bool mUploadPending{false};
+
     ALuint mLoopStart{0u};
     ALuint mLoopEnd{0u};
 
@@ -70,6 +102,20 @@ struct ALbuffer : public BufferStorage {
     /* Self ID */
     ALuint id{0};
 
+    ALbuffer() = default;
+    ALbuffer(const ALbuffer&) = delete;
+    ALbuffer& operator=(const ALbuffer&) = delete;
+    ~ALbuffer();
+
+    /* Returns the storage the buffer's samples are read from. */
+    al::span<al::byte> samples() noexcept
+    { return mStaticData.data() ? mStaticData : al::span<al::byte>{mData}; }
+
+    /* Stops referencing any application-owned samples, returning the release
+     * callback to call for them after unlocking the buffer lock.
+     */
+    StaticRelease releaseStaticData() noexcept;
+
     DISABLE_ALLOC()
 
 #ifdef ALSOFT_EAX
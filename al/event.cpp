@@ -33,12 +33,20 @@
 
 static int EventThread(ALCcontext *context)
 {
-    RingBuffer *ring{context->mAsyncEvents.get()};
     bool quitnow{false};
     while(likely(!quitnow))
     {
+        /* Events from the mixer take priority over those from other threads.
+         * Both rings post the same semaphore.
+         */
+        RingBuffer *ring{context->mAsyncEvents.get()};
         auto evt_data = ring->getReadVector().first;
         if(evt_data.len == 0)
+        {
+            ring = context->mThreadEvents.get();
+            evt_data = ring->getReadVector().first;
+        }
+        if(evt_data.len == 0)
         {
             context->mEventSem.wait();
             continue;
@@ -106,6 +114,16 @@ static int EventThread(ALCcontext *context)
                     evt.u.bufcomp.count, static_cast<ALsizei>(msg.length()), msg.c_str(),
                     context->mEventParam);
             }
+            else if(evt.EnumType == AsyncEvent::BufferUploaded)
+            {
+                if(!(enabledevts&AsyncEvent::BufferUploaded))
+                    continue;
+                const std::string msg{"Buffer ID " + std::to_string(evt.u.bufupload.id) +
+                    " uploaded"};
+                context->mEventCb(AL_EVENT_TYPE_BUFFER_UPLOADED_SOFT, evt.u.bufupload.id,
+                    AL_NO_ERROR, static_cast<ALsizei>(msg.length()), msg.c_str(),
+                    context->mEventParam);
+            }
             else if(evt.EnumType == AsyncEvent::Disconnected)
             {
                 if(!(enabledevts&AsyncEvent::Disconnected))
@@ -176,6 +194,8 @@ START_API_FUNC
                 flags |= AsyncEvent::SourceStateChange;
             else if(type == AL_EVENT_TYPE_DISCONNECTED_SOFT)
                 flags |= AsyncEvent::Disconnected;
+            else if(type == AL_EVENT_TYPE_BUFFER_UPLOADED_SOFT)
+                flags |= AsyncEvent::BufferUploaded;
             else
                 return false;
             return true;
@@ -65,6 +65,7 @@
 #include "core/filters/nfc.h"
 #include "core/filters/splitter.h"
 #include "core/logging.h"
+#include "core/polyphase_tables.h"
 #include "core/voice_change.h"
 #include "event.h"
 #include "filter.h"
@@ -151,6 +152,7 @@ void UpdateSourceProps(const ALsource *source, Voice *voice, ALCcontext *context
 
     props->Radius = source->Radius;
     props->EnhWidth = source->EnhWidth;
+    props->Priority = source->Priority;
 
     props->Direct.Gain = source->Direct.Gain;
     props->Direct.GainHF = source->Direct.GainHF;
@@ -184,6 +186,17 @@ void UpdateSourceProps(const ALsource *source, Voice *voice, ALCcontext *context
     }
 }
 
+/* Converts a fixed-point sample position from one sample rate to another.
+ * Voices playing a resampled copy of their buffer have their position in the
+ * copy's sample frames, rather than the buffer's.
+ */
+uint64_t ScalePosition(const uint64_t pos, const int fracbits, const uint from, const uint to)
+{
+    const uint64_t whole{(pos >> fracbits) * to};
+    const uint64_t frac{pos & ((uint64_t{1}<<fracbits) - 1)};
+    return (whole/from << fracbits) + ((whole%from << fracbits) + frac*to)/from;
+}
+
 /* GetSourceSampleOffset
  *
  * Gets the current read offset for the given Source, in 32.32 fixed-point
@@ -216,6 +229,9 @@ int64_t GetSourceSampleOffset(ALsource *Source, ALCcontext *context, nanoseconds
     if(!voice)
         return 0;
 
+    if(voice->mResampledItem)
+        readPos = ScalePosition(readPos, 32, voice->mFrequency,
+            Source->mQueue.front().mBuffer->mSampleRate);
     for(auto &item : Source->mQueue)
     {
         if(&item == Current) break;
@@ -254,6 +270,9 @@ double GetSourceSecOffset(ALsource *Source, ALCcontext *context, nanoseconds *cl
     if(!voice)
         return 0.0f;
 
+    if(voice->mResampledItem)
+        readPos = ScalePosition(readPos, MixerFracBits, voice->mFrequency,
+            Source->mQueue.front().mBuffer->mSampleRate);
     const ALbuffer *BufferFmt{nullptr};
     auto BufferList = Source->mQueue.cbegin();
     while(BufferList != Source->mQueue.cend() && std::addressof(*BufferList) != Current)
@@ -303,6 +322,13 @@ double GetSourceOffset(ALsource *Source, ALenum name, ALCcontext *context)
     if(!voice)
         return 0.0;
 
+    if(voice->mResampledItem)
+    {
+        const uint64_t pos{ScalePosition((uint64_t{readPos}<<MixerFracBits) | readPosFrac,
+            MixerFracBits, voice->mFrequency, Source->mQueue.front().mBuffer->mSampleRate)};
+        readPos = static_cast<ALuint>(pos >> MixerFracBits);
+        readPosFrac = static_cast<ALuint>(pos & MixerFracMask);
+    }
     const ALbuffer *BufferFmt{nullptr};
     auto BufferList = Source->mQueue.cbegin();
     while(BufferList != Source->mQueue.cend() && std::addressof(*BufferList) != Current)
@@ -513,6 +539,68 @@ void InitVoice(Voice *voice, ALsource *source, ALbufferQueueItem *BufferList, AL
     if(buffer->mCallback) voice->mFlags.set(VoiceIsCallback);
     else if(source->SourceType == AL_STATIC) voice->mFlags.set(VoiceIsStatic);
     voice->mNumCallbackSamples = 0;
+    voice->mStreamRing = nullptr;
+    if(CallbackStream *stream{BufferList->mStream})
+    {
+        voice->mStreamRing = stream->mStreamer.start(stream);
+        voice->mFlags.set(VoiceStreamStarting);
+    }
+
+    /* An unpitched, non-looping static source can play a copy of its buffer
+     * resampled to the device rate ahead of time, so the mixer just copies the
+     * samples. Looping sources resample as they go, so the loop stays seamless
+     * (a copy only approximates the loop points, if looping is enabled while
+     * playing it). A copy that no longer matches, because the resampler or
+     * device rate changed or the buffer's samples did, is replaced with a new
+     * one. The copy is built on the cache's thread the first time it's
+     * needed, and the source resamples as it plays until the copy is ready.
+     */
+    voice->mResampledItem = nullptr;
+    ResampleCache *cache{device->mResampleCache.get()};
+    if(cache && voice->mFlags.test(VoiceIsStatic) && source->Pitch == 1.0f && !source->Looping
+        && !(buffer->MappedAccess&AL_MAP_WRITE_BIT_SOFT))
+    {
+        ResampledBuffer *resampled{BufferList->mResampled.get()};
+        if(!resampled || resampled->mStale.load(std::memory_order_relaxed)
+            || resampled->mSampleRate != device->Frequency
+            || resampled->mResampler != source->mResampler)
+        {
+            ResampledBufferPtr newcopy{cache->get(buffer, *buffer, *BufferList,
+                device->Frequency, source->mResampler)};
+            if(BufferList->mResampled)
+                BufferList->mPrevResampled = std::move(BufferList->mResampled);
+            BufferList->mResampled = std::move(newcopy);
+            resampled = BufferList->mResampled.get();
+        }
+
+        if(resampled && resampled->mReady.load(std::memory_order_acquire))
+        {
+            uint64_t pos{uint64_t{voice->mPosition.load(std::memory_order_relaxed)}
+                << MixerFracBits};
+            pos |= voice->mPositionFrac.load(std::memory_order_relaxed);
+            pos = ScalePosition(pos, MixerFracBits, buffer->mSampleRate, device->Frequency);
+            voice->mPosition.store(static_cast<uint>(pos >> MixerFracBits),
+                std::memory_order_relaxed);
+            voice->mPositionFrac.store(static_cast<uint>(pos & MixerFracMask),
+                std::memory_order_relaxed);
+
+            voice->mResampledItem = &resampled->mItem;
+            voice->mFrequency = device->Frequency;
+            voice->mFmtType = FmtFloat;
+            voice->mFrameSize = voice->mFrameStep * static_cast<uint>(sizeof(float));
+        }
+    }
+
+    /* Sources usually play at a constant pitch, so the voice's step is likely
+     * to stay what it starts with. The voice is stopped, so it's done with the
+     * table it had.
+     */
+    const PolyphaseTable *oldtable{voice->mPolyphase};
+    voice->mPolyphase = GetPolyphaseTable(source->mResampler,
+        PitchToStep(static_cast<float>(voice->mFrequency) / static_cast<float>(device->Frequency)
+            * source->Pitch));
+    if(oldtable)
+        ReleasePolyphaseTable(oldtable);
 
     voice->prepare(device);
 
@@ -523,6 +611,18 @@ void InitVoice(Voice *voice, ALsource *source, ALbufferQueueItem *BufferList, AL
 }
 
 
+/* Lets the queue's callback streams reuse the rings their last start replaced,
+ * once the voice changes stopping any old voices reading them are sent.
+ */
+void QueueStreamChangesSent(const al::deque<ALbufferQueueItem> &queue)
+{
+    for(const ALbufferQueueItem &item : queue)
+    {
+        if(CallbackStream *stream{item.mStream})
+            stream->mStreamer.changesSent(stream);
+    }
+}
+
 VoiceChange *GetVoiceChanger(ALCcontext *ctx)
 {
     VoiceChange *vchg{ctx->mVoiceChangeTail};
@@ -637,6 +737,7 @@ bool SetVoiceOffset(Voice *oldvoice, const VoicePos &vpos, ALsource *source, ALC
     vchg->mSourceID = source->id;
     vchg->mState = VChangeState::Restart;
     SendVoiceChanges(context, vchg);
+    QueueStreamChangesSent(source->mQueue);
 
     /* If the old voice still has a sourceID, it's still active and the change-
      * over will work on the next update.
@@ -684,6 +785,18 @@ inline ALenum GetSourceState(ALsource *source, Voice *voice)
     return source->state;
 }
 
+/* Stops the callback threads reading ahead from the queue's buffer callbacks,
+ * so the app's callback isn't called for a source that's no longer playing.
+ */
+void StopQueueStreams(const al::deque<ALbufferQueueItem> &queue)
+{
+    for(const ALbufferQueueItem &item : queue)
+    {
+        if(CallbackStream *stream{item.mStream})
+            stream->mStreamer.stop(stream);
+    }
+}
+
 
 bool EnsureSources(ALCcontext *context, size_t needed)
 {
@@ -748,6 +861,7 @@ void FreeSource(ALCcontext *context, ALsource *source)
 
         SendVoiceChanges(context, vchg);
     }
+    StopQueueStreams(source->mQueue);
 
     al::destroy_at(source);
 
@@ -979,6 +1093,9 @@ enum SourceProp : ALenum {
     /* AL_SOFT_UHJ */
     srcStereoMode = AL_STEREO_MODE_SOFT,
     srcSuperStereoWidth = AL_SUPER_STEREO_WIDTH_SOFT,
+
+    /* AL_SOFT_source_priority */
+    srcPriority = AL_SOURCE_PRIORITY_SOFT,
 };
 
 
@@ -1026,6 +1143,7 @@ ALuint FloatValsByProp(ALenum prop)
     case AL_SEC_LENGTH_SOFT:
     case AL_STEREO_MODE_SOFT:
     case AL_SUPER_STEREO_WIDTH_SOFT:
+    case AL_SOURCE_PRIORITY_SOFT:
         return 1;
 
     case AL_STEREO_ANGLES:
@@ -1095,6 +1213,7 @@ ALuint DoubleValsByProp(ALenum prop)
     case AL_SEC_LENGTH_SOFT:
     case AL_STEREO_MODE_SOFT:
     case AL_SUPER_STEREO_WIDTH_SOFT:
+    case AL_SOURCE_PRIORITY_SOFT:
         return 1;
 
     case AL_SEC_OFFSET_LATENCY_SOFT:
@@ -1332,6 +1451,13 @@ void SetSourcefv(ALsource *Source, ALCcontext *Context, SourceProp prop,
         Source->EnhWidth = values[0];
         return UpdateSourceProps(Source, Context);
 
+    case AL_SOURCE_PRIORITY_SOFT:
+        CHECKSIZE(values, 1);
+        CHECKVAL(values[0] >= 0.0f && std::isfinite(values[0]));
+
+        Source->Priority = values[0];
+        return UpdateSourceProps(Source, Context);
+
     case AL_STEREO_ANGLES:
         CHECKSIZE(values, 2);
         CHECKVAL(std::isfinite(values[0]) && std::isfinite(values[1]));
@@ -1484,6 +1610,9 @@ void SetSourceiv(ALsource *Source, ALCcontext *Context, SourceProp prop,
             if(buffer->MappedAccess && !(buffer->MappedAccess&AL_MAP_PERSISTENT_BIT_SOFT))
                 SETERR_RETURN(Context, AL_INVALID_OPERATION,,
                     "Setting non-persistently mapped buffer %u", buffer->id);
+            if(buffer->mUploadPending)
+                SETERR_RETURN(Context, AL_INVALID_OPERATION,,
+                    "Setting buffer %u with a pending upload", buffer->id);
             if(buffer->mCallback && ReadRef(buffer->ref) != 0)
                 SETERR_RETURN(Context, AL_INVALID_OPERATION,,
                     "Setting already-set callback buffer %u", buffer->id);
@@ -1493,10 +1622,12 @@ void SetSourceiv(ALsource *Source, ALCcontext *Context, SourceProp prop,
             newlist.emplace_back();
             newlist.back().mCallback = buffer->mCallback;
             newlist.back().mUserData = buffer->mUserData;
+            newlist.back().mStream = buffer->mStream.get();
             newlist.back().mSampleLen = buffer->mSampleLen;
             newlist.back().mLoopStart = buffer->mLoopStart;
             newlist.back().mLoopEnd = buffer->mLoopEnd;
-            newlist.back().mSamples = buffer->mData.data();
+            newlist.back().mBlockAlign = buffer->mBlockAlign;
+            newlist.back().mSamples = buffer->samples().data();
             newlist.back().mBuffer = buffer;
             IncrementRef(buffer->ref);
 
@@ -1513,6 +1644,7 @@ void SetSourceiv(ALsource *Source, ALCcontext *Context, SourceProp prop,
         }
 
         /* Delete all elements in the previous queue */
+        StopQueueStreams(oldlist);
         for(auto &item : oldlist)
         {
             if(ALbuffer *buffer{item.mBuffer})
@@ -1721,6 +1853,7 @@ void SetSourceiv(ALsource *Source, ALCcontext *Context, SourceProp prop,
     case AL_SOURCE_RADIUS:
     case AL_SEC_LENGTH_SOFT:
     case AL_SUPER_STEREO_WIDTH_SOFT:
+    case AL_SOURCE_PRIORITY_SOFT:
         CHECKSIZE(values, 1);
         fvals[0] = static_cast<float>(values[0]);
         return SetSourcefv(Source, Context, prop, {fvals, 1u});
@@ -1839,6 +1972,7 @@ void SetSourcei64v(ALsource *Source, ALCcontext *Context, SourceProp prop,
     case AL_SOURCE_RADIUS:
     case AL_SEC_LENGTH_SOFT:
     case AL_SUPER_STEREO_WIDTH_SOFT:
+    case AL_SOURCE_PRIORITY_SOFT:
         CHECKSIZE(values, 1);
         fvals[0] = static_cast<float>(values[0]);
         return SetSourcefv(Source, Context, prop, {fvals, 1u});
@@ -1997,6 +2131,11 @@ bool GetSourcedv(ALsource *Source, ALCcontext *Context, SourceProp prop, const a
         values[0] = Source->EnhWidth;
         return true;
 
+    case AL_SOURCE_PRIORITY_SOFT:
+        CHECKSIZE(values, 1);
+        values[0] = Source->Priority;
+        return true;
+
     case AL_BYTE_LENGTH_SOFT:
     case AL_SAMPLE_LENGTH_SOFT:
     case AL_SEC_LENGTH_SOFT:
@@ -2243,6 +2382,7 @@ bool GetSourceiv(ALsource *Source, ALCcontext *Context, SourceProp prop, const a
     case AL_CONE_OUTER_GAINHF:
     case AL_SOURCE_RADIUS:
     case AL_SUPER_STEREO_WIDTH_SOFT:
+    case AL_SOURCE_PRIORITY_SOFT:
         CHECKSIZE(values, 1);
         if((err=GetSourcedv(Source, Context, prop, {dvals, 1u})) != false)
             values[0] = static_cast<int>(dvals[0]);
@@ -2362,6 +2502,7 @@ bool GetSourcei64v(ALsource *Source, ALCcontext *Context, SourceProp prop, const
     case AL_CONE_OUTER_GAINHF:
     case AL_SOURCE_RADIUS:
     case AL_SUPER_STEREO_WIDTH_SOFT:
+    case AL_SOURCE_PRIORITY_SOFT:
         CHECKSIZE(values, 1);
         if((err=GetSourcedv(Source, Context, prop, {dvals, 1u})) != false)
             values[0] = static_cast<int64_t>(dvals[0]);
@@ -3242,6 +3383,8 @@ START_API_FUNC
     }
     if LIKELY(tail)
         SendVoiceChanges(context.get(), tail);
+    for(ALsource *source : srchandles)
+        QueueStreamChangesSent(source->mQueue);
 }
 END_API_FUNC
 
@@ -3381,6 +3524,8 @@ START_API_FUNC
     }
     if LIKELY(tail)
         SendVoiceChanges(context.get(), tail);
+    for(ALsource *source : srchandles)
+        StopQueueStreams(source->mQueue);
 }
 END_API_FUNC
 
@@ -3446,6 +3591,8 @@ START_API_FUNC
     }
     if LIKELY(tail)
         SendVoiceChanges(context.get(), tail);
+    for(ALsource *source : srchandles)
+        StopQueueStreams(source->mQueue);
 }
 END_API_FUNC
 
@@ -3508,7 +3655,8 @@ START_API_FUNC
         if(!buffer) continue;
         BufferList->mSampleLen = buffer->mSampleLen;
         BufferList->mLoopEnd = buffer->mSampleLen;
-        BufferList->mSamples = buffer->mData.data();
+        BufferList->mBlockAlign = buffer->mBlockAlign;
+        BufferList->mSamples = buffer->samples().data();
         BufferList->mBuffer = buffer;
         IncrementRef(buffer->ref);
 
@@ -3518,6 +3666,12 @@ START_API_FUNC
                 buffer->id);
             goto buffer_error;
         }
+        if(buffer->mUploadPending)
+        {
+            context->setError(AL_INVALID_OPERATION, "Queueing buffer %u with a pending upload",
+                buffer->id);
+            goto buffer_error;
+        }
 
         if(BufferFmt == nullptr)
             BufferFmt = buffer;
@@ -18,6 +18,7 @@
 #include "almalloc.h"
 #include "alnumeric.h"
 #include "atomic.h"
+#include "core/resample_cache.h"
 #include "core/voice.h"
 #include "vector.h"
 
@@ -43,6 +44,14 @@ enum class SourceStereo : bool {
 
 struct ALbufferQueueItem : public VoiceBufferItem {
     ALbuffer *mBuffer{nullptr};
+    /* A resampled copy of a static source's buffer, kept for as long as the
+     * buffer is attached since a voice may still be playing it. The copy it
+     * replaced, if it stopped matching, is kept until it's replaced again,
+     * since the voice stopped for a restart plays it until the changes are
+     * sent.
+     */
+    ResampledBufferPtr mResampled;
+    ResampledBufferPtr mPrevResampled;
 
     DISABLE_ALLOC()
 };
@@ -104,6 +113,7 @@ struct ALsource {
 
     float Radius{0.0f};
     float EnhWidth{0.593f};
+    float Priority{1.0f};
 
     /** Direct filter and auxiliary send info. */
     struct {
@@ -79,6 +79,7 @@
 #include "core/ambidefs.h"
 #include "core/bformatdec.h"
 #include "core/bs2b.h"
+#include "core/callback_stream.h"
 #include "core/context.h"
 #include "core/cpu_caps.h"
 #include "core/devformat.h"
@@ -91,9 +92,11 @@
 #include "core/fpu_ctrl.h"
 #include "core/front_stablizer.h"
 #include "core/logging.h"
+#include "core/resample_cache.h"
 #include "core/uhjfilter.h"
 #include "core/voice.h"
 #include "core/voice_change.h"
+#include "core/worker_pool.h"
 #include "device.h"
 #include "effects/base.h"
 #include "inprogext.h"
@@ -465,6 +468,10 @@ const struct {
     DECL(alAuxiliaryEffectSlotPlayvSOFT),
     DECL(alAuxiliaryEffectSlotStopSOFT),
     DECL(alAuxiliaryEffectSlotStopvSOFT),
+
+    DECL(alBufferDataStaticSOFT),
+    DECL(alBufferRefillSOFT),
+    DECL(alBufferDataAsyncSOFT),
 #ifdef ALSOFT_EAX
 }, eaxFunctions[] = {
     DECL(EAXGet),
@@ -905,6 +912,36 @@ constexpr struct {
 
     DECL(AL_STOP_SOURCES_ON_DISCONNECT_SOFT),
 
+    DECL(AL_SOURCE_PRIORITY_SOFT),
+    DECL(ALC_MAX_REAL_VOICES_SOFT),
+    DECL(ALC_MAX_HRTF_VOICES_SOFT),
+
+    DECL(ALC_MIXER_STATS_PARAM_UPDATES_SOFT),
+    DECL(ALC_MIXER_STATS_VOICE_MIX_SOFT),
+    DECL(ALC_MIXER_STATS_EFFECTS_SOFT),
+    DECL(ALC_MIXER_STATS_POST_PROCESS_SOFT),
+    DECL(ALC_MIXER_STATS_LIMITER_SOFT),
+    DECL(ALC_MIXER_STATS_DISTANCE_COMP_SOFT),
+    DECL(ALC_MIXER_STATS_DITHER_SOFT),
+    DECL(ALC_MIXER_STATS_WRITE_SOFT),
+    DECL(ALC_MIXER_STATS_TOTAL_SOFT),
+
+    DECL(AL_FORMAT_MONO_HALF_SOFT),
+    DECL(AL_FORMAT_STEREO_HALF_SOFT),
+    DECL(AL_FORMAT_QUAD_HALF_SOFT),
+    DECL(AL_FORMAT_51CHN_HALF_SOFT),
+    DECL(AL_FORMAT_61CHN_HALF_SOFT),
+    DECL(AL_FORMAT_71CHN_HALF_SOFT),
+    DECL(AL_FORMAT_BFORMAT2D_HALF_SOFT),
+    DECL(AL_FORMAT_BFORMAT3D_HALF_SOFT),
+
+    DECL(AL_BUFFER_RELEASE_FUNCTION_SOFT),
+    DECL(AL_BUFFER_RELEASE_USER_PARAM_SOFT),
+
+    DECL(AL_BUFFER_CALLBACK_UNDERRUNS_SOFT),
+
+    DECL(AL_EVENT_TYPE_BUFFER_UPLOADED_SOFT),
+
 #ifdef ALSOFT_EAX
 }, eaxEnumerations[] = {
     DECL(AL_EAX_RAM_SIZE),
@@ -954,6 +991,12 @@ bool SuspendDefers{true};
 /* Initial seed for dithering. */
 constexpr uint DitherRNGSeed{22222u};
 
+/* Maximum number of extra threads to mix voices with. */
+constexpr uint MaxMixerWorkers{15u};
+
+/* Maximum number of threads to call buffer callbacks with. */
+constexpr uint MaxCallbackThreads{8u};
+
 
 /************************************************
  * ALC information
@@ -977,8 +1020,10 @@ constexpr ALCchar alcExtensionList[] =
     "ALC_EXT_thread_local_context "
     "ALC_SOFT_device_clock "
     "ALC_SOFT_HRTF "
+    "ALC_SOFTX_hrtf_voice_limit "
     "ALC_SOFT_loopback "
     "ALC_SOFT_loopback_bformat "
+    "ALC_SOFTX_mixer_stats "
     "ALC_SOFT_output_limiter "
     "ALC_SOFT_output_mode "
     "ALC_SOFT_pause_device "
@@ -1076,6 +1121,9 @@ void alc_initconfig(void)
 #elif defined(HAVE_SSE)
     capfilter |= CPU_CAP_SSE;
 #endif
+#ifdef HAVE_AVX2
+    capfilter |= CPU_CAP_AVX2;
+#endif
 #ifdef HAVE_NEON
     capfilter |= CPU_CAP_NEON;
 #endif
@@ -1107,6 +1155,8 @@ void alc_initconfig(void)
                     capfilter &= ~CPU_CAP_SSE3;
                 else if(len == 6 && al::strncasecmp(str, "sse4.1", len) == 0)
                     capfilter &= ~CPU_CAP_SSE4_1;
+                else if(len == 4 && al::strncasecmp(str, "avx2", len) == 0)
+                    capfilter &= ~CPU_CAP_AVX2;
                 else if(len == 4 && al::strncasecmp(str, "neon", len) == 0)
                     capfilter &= ~CPU_CAP_NEON;
                 else
@@ -1122,11 +1172,12 @@ void alc_initconfig(void)
             TRACE("Name: \"%s\"\n", cpuopt->mName.c_str());
         }
         const int caps{cpuopt->mCaps};
-        TRACE("Extensions:%s%s%s%s%s%s\n",
+        TRACE("Extensions:%s%s%s%s%s%s%s\n",
             ((capfilter&CPU_CAP_SSE)    ? ((caps&CPU_CAP_SSE)    ? " +SSE"    : " -SSE")    : ""),
             ((capfilter&CPU_CAP_SSE2)   ? ((caps&CPU_CAP_SSE2)   ? " +SSE2"   : " -SSE2")   : ""),
             ((capfilter&CPU_CAP_SSE3)   ? ((caps&CPU_CAP_SSE3)   ? " +SSE3"   : " -SSE3")   : ""),
             ((capfilter&CPU_CAP_SSE4_1) ? ((caps&CPU_CAP_SSE4_1) ? " +SSE4.1" : " -SSE4.1") : ""),
+            ((capfilter&CPU_CAP_AVX2)   ? ((caps&CPU_CAP_AVX2)   ? " +AVX2"   : " -AVX2")   : ""),
             ((capfilter&CPU_CAP_NEON)   ? ((caps&CPU_CAP_NEON)   ? " +NEON"   : " -NEON")   : ""),
             ((!capfilter) ? " -none-" : ""));
         CPUCapFlags = caps & capfilter;
@@ -1520,6 +1571,23 @@ ALCenum EnumFromDevAmbi(DevAmbiScaling scaling)
     throw std::runtime_error{"Invalid DevAmbiScaling: "+std::to_string(int(scaling))};
 }
 
+MixerStats::Stage StatsStageFromEnum(ALCenum stage)
+{
+    switch(stage)
+    {
+    case ALC_MIXER_STATS_PARAM_UPDATES_SOFT: return MixerStats::ParamUpdates;
+    case ALC_MIXER_STATS_VOICE_MIX_SOFT: return MixerStats::VoiceMix;
+    case ALC_MIXER_STATS_EFFECTS_SOFT: return MixerStats::Effects;
+    case ALC_MIXER_STATS_POST_PROCESS_SOFT: return MixerStats::PostProcess;
+    case ALC_MIXER_STATS_LIMITER_SOFT: return MixerStats::Limiter;
+    case ALC_MIXER_STATS_DISTANCE_COMP_SOFT: return MixerStats::DistanceComp;
+    case ALC_MIXER_STATS_DITHER_SOFT: return MixerStats::Dither;
+    case ALC_MIXER_STATS_WRITE_SOFT: return MixerStats::Write;
+    case ALC_MIXER_STATS_TOTAL_SOFT: return MixerStats::Total;
+    }
+    throw std::runtime_error{"Invalid mixer stats enum: "+std::to_string(stage)};
+}
+
 
 /* Downmixing channel arrays, to map the given format's missing channels to
  * existing ones. Based on Wine's DSound downmix values, which are based on
@@ -1880,7 +1948,8 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
     device->Limiter = nullptr;
     device->ChannelDelays = nullptr;
 
-    std::fill(std::begin(device->HrtfAccumData), std::end(device->HrtfAccumData), float2{});
+    std::fill(std::begin(device->mMixerScratch.HrtfAccumData),
+        std::end(device->mMixerScratch.HrtfAccumData), float2{});
 
     device->Dry.AmbiMap.fill(BFChannelConfig{});
     device->Dry.Buffer = {};
@@ -2229,6 +2298,68 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
     device->FixedLatency += nanoseconds{seconds{sample_delay}} / device->Frequency;
     TRACE("Fixed device latency: %" PRId64 "ns\n", int64_t{device->FixedLatency.count()});
 
+    device->mVirtualVoiceGain = 0.0f;
+    if(auto virtopt = device->configValue<float>(nullptr, "virtual-voice-threshold"))
+    {
+        const float thrshld_dB{clampf(*virtopt, -144.0f, 0.0f)};
+        device->mVirtualVoiceGain = std::pow(10.0f, thrshld_dB / 20.0f);
+        TRACE("Virtualizing voices below %.2fdB\n", thrshld_dB);
+    }
+
+    /* Start (or stop) any extra threads for mixing voices, each needing their
+     * own temp storage and mixing buffer.
+     */
+    const uint numworkers{minu(device->configValue<uint>(nullptr, "mixer-threads").value_or(0u),
+        MaxMixerWorkers)};
+    if(!device->mMixerPool || device->mMixerPool->numWorkers() != numworkers)
+    {
+        device->mMixerPool = nullptr;
+        if(numworkers > 0)
+            device->mMixerPool = WorkerPool::Create(numworkers, MIXER_WORKER_THREAD_NAME);
+    }
+    device->mWorkerScratch.clear();
+    if(WorkerPool *pool{device->mMixerPool.get()})
+    {
+        device->mWorkerScratch.reserve(pool->numWorkers());
+        for(size_t i{0};i < pool->numWorkers();++i)
+        {
+            auto scratch = std::make_unique<MixerScratch>();
+            scratch->mWorkerIdx = static_cast<uint>(i+1);
+            scratch->mMixBuffer.resize(device->MixBuffer.size());
+            device->mWorkerScratch.emplace_back(std::move(scratch));
+        }
+        TRACE("Mixing voices with %zu extra thread%s\n", pool->numWorkers(),
+            (pool->numWorkers() == 1) ? "" : "s");
+    }
+
+    /* Start the threads for calling buffer callbacks ahead of the mixer, if
+     * requested. Callback buffers hold onto the streamer, so it stays for the
+     * life of the device.
+     */
+    if(!device->mCallbackStreamer)
+    {
+        const uint numthreads{minu(device->configValue<uint>(nullptr, "callback-threads")
+            .value_or(0u), MaxCallbackThreads)};
+        if(numthreads > 0)
+            device->mCallbackStreamer = CallbackStreamer::Create(*device, numthreads);
+    }
+
+    /* Create the cache for resampled static buffers, if requested. Cached
+     * copies are made for a particular device rate, so ones made before the
+     * rate changed are just left to be dropped as the cache fills.
+     */
+    if(!device->mResampleCache)
+    {
+        const uint cachesize{device->configValue<uint>(nullptr, "resample-cache-size")
+            .value_or(0u)};
+        if(cachesize > 0)
+        {
+            device->mResampleCache = std::make_unique<ResampleCache>(*device,
+                size_t{cachesize} << 20);
+            TRACE("Caching up to %uMB of resampled buffers\n", cachesize);
+        }
+    }
+
     FPUCtl mixer_mode{};
     for(ContextBase *ctxbase : *device->mContexts.load())
     {
@@ -2237,7 +2368,7 @@ ALCenum UpdateDeviceParams(ALCdevice *device, const int *attrList)
         auto GetEffectBuffer = [](ALbuffer *buffer) noexcept -> EffectState::Buffer
         {
             if(!buffer) return EffectState::Buffer{};
-            return EffectState::Buffer{buffer, buffer->mData};
+            return EffectState::Buffer{buffer, buffer->samples()};
         };
         std::unique_lock<std::mutex> proplock{context->mPropLock};
         std::unique_lock<std::mutex> slotlock{context->mEffectSlotLock};
@@ -3112,6 +3243,27 @@ START_API_FUNC
         }
         break;
 
+    case ALC_MIXER_STATS_PARAM_UPDATES_SOFT:
+    case ALC_MIXER_STATS_VOICE_MIX_SOFT:
+    case ALC_MIXER_STATS_EFFECTS_SOFT:
+    case ALC_MIXER_STATS_POST_PROCESS_SOFT:
+    case ALC_MIXER_STATS_LIMITER_SOFT:
+    case ALC_MIXER_STATS_DISTANCE_COMP_SOFT:
+    case ALC_MIXER_STATS_DITHER_SOFT:
+    case ALC_MIXER_STATS_WRITE_SOFT:
+    case ALC_MIXER_STATS_TOTAL_SOFT:
+        if(size < 4)
+            alcSetError(dev.get(), ALC_INVALID_VALUE);
+        else
+        {
+            const MixerStats::Summary stats{dev->mMixerStats.get(StatsStageFromEnum(pname))};
+            values[0] = stats.Min.count();
+            values[1] = stats.Avg.count();
+            values[2] = stats.Max.count();
+            values[3] = stats.P99.count();
+        }
+        break;
+
     default:
         auto ivals = al::vector<int>(static_cast<uint>(size));
         if(size_t got{GetIntegerv(dev.get(), pname, ivals)})
@@ -3254,6 +3406,25 @@ START_API_FUNC
         }
     }
 
+    if(auto voicesopt = dev->configValue<uint>(nullptr, "real-voices"))
+        context->mMaxRealVoices = *voicesopt;
+    if(auto voicesopt = dev->configValue<uint>(nullptr, "hrtf-voices"))
+        context->mMaxHrtfVoices = *voicesopt;
+    if(attrList)
+    {
+        for(size_t i{0};attrList[i];i += 2)
+        {
+            if(attrList[i] == ALC_MAX_REAL_VOICES_SOFT)
+                context->mMaxRealVoices = static_cast<uint>(maxi(attrList[i+1], 0));
+            else if(attrList[i] == ALC_MAX_HRTF_VOICES_SOFT)
+                context->mMaxHrtfVoices = static_cast<uint>(maxi(attrList[i+1], 0));
+        }
+    }
+    if(context->mMaxRealVoices > 0)
+        TRACE("Max real voices: %u\n", context->mMaxRealVoices);
+    if(context->mMaxHrtfVoices > 0)
+        TRACE("Max HRTF voices: %u\n", context->mMaxHrtfVoices);
+
     {
         using ContextArray = al::FlexArray<ContextBase*>;
 
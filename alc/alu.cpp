@@ -39,6 +39,10 @@
 #include <stdint.h>
 #include <utility>
 
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#endif
+
 #include "almalloc.h"
 #include "alnumbers.h"
 #include "alnumeric.h"
@@ -62,15 +66,18 @@
 #include "core/filters/biquad.h"
 #include "core/filters/nfc.h"
 #include "core/fpu_ctrl.h"
+#include "core/hrir_cache.h"
 #include "core/hrtf.h"
 #include "core/mastering.h"
 #include "core/mixer.h"
 #include "core/mixer/defs.h"
 #include "core/mixer/hrtfdefs.h"
+#include "core/polyphase_tables.h"
 #include "core/resampler_limits.h"
 #include "core/uhjfilter.h"
 #include "core/voice.h"
 #include "core/voice_change.h"
+#include "core/worker_pool.h"
 #include "intrusive_ptr.h"
 #include "opthelpers.h"
 #include "ringbuffer.h"
@@ -89,6 +96,9 @@ struct SSE2Tag;
 #ifdef HAVE_SSE4_1
 struct SSE4Tag;
 #endif
+#ifdef HAVE_AVX2
+struct AVX2Tag;
+#endif
 #ifdef HAVE_NEON
 struct NEONTag;
 #endif
@@ -97,6 +107,7 @@ struct LerpTag;
 struct CubicTag;
 struct BSincTag;
 struct FastBSincTag;
+struct PolyphaseTag;
 
 
 static_assert(!(MaxResamplerPadding&1), "MaxResamplerPadding is not a multiple of two");
@@ -106,8 +117,6 @@ namespace {
 
 using uint = unsigned int;
 
-constexpr uint MaxPitch{10};
-
 static_assert((BufferLineSize-1)/MaxPitch > 0, "MaxPitch is too large for BufferLineSize!");
 static_assert((INT_MAX>>MixerFracBits)/MaxPitch > BufferLineSize,
     "MaxPitch and/or BufferLineSize are too large for MixerFracBits!");
@@ -147,7 +156,8 @@ struct ChanMap {
 
 using HrtfDirectMixerFunc = void(*)(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
     const al::span<const FloatBufferLine> InSamples, float2 *AccumSamples, float *TempBuf,
-    HrtfChannelState *ChanState, const size_t IrSize, const size_t BufferSize);
+    HrtfChannelState *ChanState, HrtfTailConvolver *TailConv, const size_t IrSize,
+    const size_t BufferSize);
 
 HrtfDirectMixerFunc MixDirectHrtf{MixDirectHrtf_<CTag>};
 
@@ -157,6 +167,10 @@ inline HrtfDirectMixerFunc SelectHrtfMixer(void)
     if((CPUCapFlags&CPU_CAP_NEON))
         return MixDirectHrtf_<NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&CPU_CAP_AVX2))
+        return MixDirectHrtf_<AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
     if((CPUCapFlags&CPU_CAP_SSE))
         return MixDirectHrtf_<SSETag>;
@@ -200,6 +214,10 @@ inline ResamplerFunc SelectResampler(Resampler resampler, uint increment)
         if((CPUCapFlags&CPU_CAP_NEON))
             return Resample_<LerpTag,NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+        if((CPUCapFlags&CPU_CAP_AVX2))
+            return Resample_<LerpTag,AVX2Tag>;
+#endif
 #ifdef HAVE_SSE4_1
         if((CPUCapFlags&CPU_CAP_SSE4_1))
             return Resample_<LerpTag,SSE4Tag>;
@@ -210,6 +228,22 @@ inline ResamplerFunc SelectResampler(Resampler resampler, uint increment)
 #endif
         return Resample_<LerpTag,CTag>;
     case Resampler::Cubic:
+#ifdef HAVE_NEON
+        if((CPUCapFlags&CPU_CAP_NEON))
+            return Resample_<CubicTag,NEONTag>;
+#endif
+#ifdef HAVE_AVX2
+        if((CPUCapFlags&CPU_CAP_AVX2))
+            return Resample_<CubicTag,AVX2Tag>;
+#endif
+#ifdef HAVE_SSE4_1
+        if((CPUCapFlags&CPU_CAP_SSE4_1))
+            return Resample_<CubicTag,SSE4Tag>;
+#endif
+#ifdef HAVE_SSE2
+        if((CPUCapFlags&CPU_CAP_SSE2))
+            return Resample_<CubicTag,SSE2Tag>;
+#endif
         return Resample_<CubicTag,CTag>;
     case Resampler::BSinc12:
     case Resampler::BSinc24:
@@ -219,6 +253,10 @@ inline ResamplerFunc SelectResampler(Resampler resampler, uint increment)
             if((CPUCapFlags&CPU_CAP_NEON))
                 return Resample_<BSincTag,NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+            if((CPUCapFlags&CPU_CAP_AVX2))
+                return Resample_<BSincTag,AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
             if((CPUCapFlags&CPU_CAP_SSE))
                 return Resample_<BSincTag,SSETag>;
@@ -232,6 +270,10 @@ inline ResamplerFunc SelectResampler(Resampler resampler, uint increment)
         if((CPUCapFlags&CPU_CAP_NEON))
             return Resample_<FastBSincTag,NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+        if((CPUCapFlags&CPU_CAP_AVX2))
+            return Resample_<FastBSincTag,AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
         if((CPUCapFlags&CPU_CAP_SSE))
             return Resample_<FastBSincTag,SSETag>;
@@ -242,6 +284,121 @@ inline ResamplerFunc SelectResampler(Resampler resampler, uint increment)
     return Resample_<PointTag,CTag>;
 }
 
+inline ResamplerFunc SelectPolyphaseResampler()
+{
+#ifdef HAVE_NEON
+    if((CPUCapFlags&CPU_CAP_NEON))
+        return Resample_<PolyphaseTag,NEONTag>;
+#endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&CPU_CAP_AVX2))
+        return Resample_<PolyphaseTag,AVX2Tag>;
+#endif
+#ifdef HAVE_SSE
+    if((CPUCapFlags&CPU_CAP_SSE))
+        return Resample_<PolyphaseTag,SSETag>;
+#endif
+    return Resample_<PolyphaseTag,CTag>;
+}
+
+/* Returns the multi-channel version of the resampler SelectResampler picks,
+ * or null if there isn't one.
+ */
+inline ResamplerMultiFunc SelectMultiResampler(Resampler resampler, uint increment)
+{
+    switch(resampler)
+    {
+    case Resampler::Point:
+    case Resampler::Linear:
+    case Resampler::Cubic:
+        break;
+    case Resampler::BSinc12:
+    case Resampler::BSinc24:
+        if(increment > MixerFracOne)
+        {
+#ifdef HAVE_NEON
+            if((CPUCapFlags&CPU_CAP_NEON))
+                return ResampleMulti_<BSincTag,NEONTag>;
+#endif
+#ifdef HAVE_AVX2
+            if((CPUCapFlags&CPU_CAP_AVX2))
+                return ResampleMulti_<BSincTag,AVX2Tag>;
+#endif
+#ifdef HAVE_SSE
+            if((CPUCapFlags&CPU_CAP_SSE))
+                return ResampleMulti_<BSincTag,SSETag>;
+#endif
+            return ResampleMulti_<BSincTag,CTag>;
+        }
+        /* fall-through */
+    case Resampler::FastBSinc12:
+    case Resampler::FastBSinc24:
+#ifdef HAVE_NEON
+        if((CPUCapFlags&CPU_CAP_NEON))
+            return ResampleMulti_<FastBSincTag,NEONTag>;
+#endif
+#ifdef HAVE_AVX2
+        if((CPUCapFlags&CPU_CAP_AVX2))
+            return ResampleMulti_<FastBSincTag,AVX2Tag>;
+#endif
+#ifdef HAVE_SSE
+        if((CPUCapFlags&CPU_CAP_SSE))
+            return ResampleMulti_<FastBSincTag,SSETag>;
+#endif
+        return ResampleMulti_<FastBSincTag,CTag>;
+    }
+
+    return nullptr;
+}
+
+inline ResamplerMultiFunc SelectMultiPolyphase()
+{
+#ifdef HAVE_NEON
+    if((CPUCapFlags&CPU_CAP_NEON))
+        return ResampleMulti_<PolyphaseTag,NEONTag>;
+#endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&CPU_CAP_AVX2))
+        return ResampleMulti_<PolyphaseTag,AVX2Tag>;
+#endif
+#ifdef HAVE_SSE
+    if((CPUCapFlags&CPU_CAP_SSE))
+        return ResampleMulti_<PolyphaseTag,SSETag>;
+#endif
+    return ResampleMulti_<PolyphaseTag,CTag>;
+}
+
+/* Prepares the voice's resampler for its current step. If the step is what
+ * the voice's polyphase table was made for, and the voice's position is on
+ * one of the table's phases, it's used instead of interpolating the bsinc
+ * filters for each sample. A position between phases (from starting at a
+ * fractional offset, or an earlier change in pitch) needs the bsinc filters,
+ * as does a table that isn't built yet, which the voice switches to once it
+ * is.
+ */
+void PrepareVoiceResampler(Voice *voice, const Resampler resampler)
+{
+    const PolyphaseTable *table{voice->mPolyphase};
+    const bool usetable{table && table->mResampler == resampler
+        && table->mIncrement == voice->mStep
+        && !(voice->mPositionFrac.load(std::memory_order_relaxed)
+            & ((1u<<table->mPhaseShift) - 1))};
+    if(usetable && table->mReady.load(std::memory_order_acquire))
+    {
+        voice->mResampler = PreparePolyphase(*table, &voice->mResampleState);
+        voice->mResamplerMulti = SelectMultiPolyphase();
+        voice->mFlags.set(VoiceUsesPolyphase);
+        voice->mFlags.reset(VoicePolyphasePending);
+    }
+    else
+    {
+        voice->mResampler = PrepareResampler(resampler, voice->mStep, &voice->mResampleState);
+        voice->mResamplerMulti = SelectMultiResampler(resampler, voice->mStep);
+        voice->mFlags.reset(VoiceUsesPolyphase);
+        voice->mFlags.set(VoicePolyphasePending, usetable);
+    }
+}
+
 } // namespace
 
 void aluInit(CompatFlagBitset flags, const float nfcscale)
@@ -275,6 +432,18 @@ ResamplerFunc PrepareResampler(Resampler resampler, uint increment, InterpState
     return SelectResampler(resampler, increment);
 }
 
+ResamplerFunc PreparePolyphase(const PolyphaseTable &table, InterpState *state)
+{
+    state->polyphase.m = table.mFilterLength;
+    state->polyphase.l = (table.mFilterLength/2) - 1;
+    state->polyphase.shift = table.mPhaseShift;
+    state->polyphase.filter = table.mFilter.data();
+    return SelectPolyphaseResampler();
+}
+
+ResamplerMultiFunc PreparePolyphaseMulti()
+{ return SelectMultiPolyphase(); }
+
 
 void DeviceBase::ProcessHrtf(const size_t SamplesToDo)
 {
@@ -282,8 +451,12 @@ void DeviceBase::ProcessHrtf(const size_t SamplesToDo)
     const uint lidx{RealOut.ChannelIndex[FrontLeft]};
     const uint ridx{RealOut.ChannelIndex[FrontRight]};
 
-    MixDirectHrtf(RealOut.Buffer[lidx], RealOut.Buffer[ridx], Dry.Buffer, HrtfAccumData,
-        mHrtfState->mTemp.data(), mHrtfState->mChannels.data(), mHrtfState->mIrSize, SamplesToDo);
+    /* With a tail convolver, the mixer only applies the head of the HRIRs. */
+    HrtfTailConvolver *tailconv{mHrtfState->mTailConv.get()};
+    const size_t irsize{tailconv ? tailconv->getHeadSize() : mHrtfState->mIrSize};
+    MixDirectHrtf(RealOut.Buffer[lidx], RealOut.Buffer[ridx], Dry.Buffer,
+        mMixerScratch.HrtfAccumData, mHrtfState->mTemp.data(), mHrtfState->mChannels.data(),
+        tailconv, irsize, SamplesToDo);
 }
 
 void DeviceBase::ProcessAmbiDec(const size_t SamplesToDo)
@@ -461,13 +634,26 @@ inline auto& GetAmbi2DLayout(AmbiLayout layouttype) noexcept
 }
 
 
-bool CalcContextParams(ContextBase *ctx)
+/* Flags for which of the context's and effect slots' parameters changed in an
+ * update, so voices that don't depend on them can skip recalculating.
+ */
+enum ParamChange : uint {
+    ListenerTransformChanged = 1u<<0, /* Listener position or orientation. */
+    ListenerVelocityChanged  = 1u<<1,
+    ContextGainChanged       = 1u<<2,
+    /* Units, air absorption, doppler, and distance model. */
+    ContextEnvironmentChanged = 1u<<3,
+    /* At least one effect slot has its mSendParamsChanged flag set. */
+    EffectSlotChanged        = 1u<<4,
+};
+
+uint CalcContextParams(ContextBase *ctx)
 {
     ContextProps *props{ctx->mParams.ContextUpdate.exchange(nullptr, std::memory_order_acq_rel)};
-    if(!props) return false;
+    if(!props) return 0u;
 
+    ContextParams &params = ctx->mParams;
     const alu::Vector pos{props->Position[0], props->Position[1], props->Position[2], 1.0f};
-    ctx->mParams.Position = pos;
 
     /* AT then UP */
     alu::Vector N{props->OrientAt[0], props->OrientAt[1], props->OrientAt[2], 0.0f};
@@ -485,25 +671,48 @@ bool CalcContextParams(ContextBase *ctx)
          0.0,  0.0,   0.0, 1.0};
     const alu::Vector vel{props->Velocity[0], props->Velocity[1], props->Velocity[2], 0.0};
 
-    ctx->mParams.Matrix = rot;
-    ctx->mParams.Velocity = rot * vel;
-
-    ctx->mParams.Gain = props->Gain * ctx->mGainBoost;
-    ctx->mParams.MetersPerUnit = props->MetersPerUnit;
-    ctx->mParams.AirAbsorptionGainHF = props->AirAbsorptionGainHF;
+    const alu::Vector relvel{rot * vel};
+    const float gain{props->Gain * ctx->mGainBoost};
+    const float speedofsound{props->SpeedOfSound * props->DopplerVelocity};
 
-    ctx->mParams.DopplerFactor = props->DopplerFactor;
-    ctx->mParams.SpeedOfSound = props->SpeedOfSound * props->DopplerVelocity;
-
-    ctx->mParams.SourceDistanceModel = props->SourceDistanceModel;
-    ctx->mParams.mDistanceModel = props->mDistanceModel;
+    /* Note what actually changed, since an update for one listener property
+     * carries all of them.
+     */
+    uint changes{0u};
+    if(params.Position != pos || params.Matrix != rot)
+        changes |= ListenerTransformChanged;
+    if(params.Velocity != relvel)
+        changes |= ListenerVelocityChanged;
+    if(params.Gain != gain)
+        changes |= ContextGainChanged;
+    if(params.MetersPerUnit != props->MetersPerUnit
+        || params.AirAbsorptionGainHF != props->AirAbsorptionGainHF
+        || params.DopplerFactor != props->DopplerFactor || params.SpeedOfSound != speedofsound
+        || params.SourceDistanceModel != props->SourceDistanceModel
+        || params.mDistanceModel != props->mDistanceModel)
+        changes |= ContextEnvironmentChanged;
+
+    params.Position = pos;
+    params.Matrix = rot;
+    params.Velocity = relvel;
+
+    params.Gain = gain;
+    params.MetersPerUnit = props->MetersPerUnit;
+    params.AirAbsorptionGainHF = props->AirAbsorptionGainHF;
+
+    params.DopplerFactor = props->DopplerFactor;
+    params.SpeedOfSound = speedofsound;
+
+    params.SourceDistanceModel = props->SourceDistanceModel;
+    params.mDistanceModel = props->mDistanceModel;
 
     AtomicReplaceHead(ctx->mFreeContextProps, props);
-    return true;
+    return changes;
 }
 
 bool CalcEffectSlotParams(EffectSlot *slot, EffectSlot **sorted_slots, ContextBase *context)
 {
+    slot->mSendParamsChanged = false;
     EffectSlotProps *props{slot->Update.exchange(nullptr, std::memory_order_acq_rel)};
     if(!props) return false;
 
@@ -512,6 +721,18 @@ bool CalcEffectSlotParams(EffectSlot *slot, EffectSlot **sorted_slots, ContextBa
      */
     if(slot->Target != props->Target)
         *sorted_slots = nullptr;
+
+    /* Sources sending to this slot only need to be recalculated if a property
+     * they use changes. The slot's gain and target, and most effect
+     * properties, are only used when processing the effect.
+     */
+    const EffectSlotType oldtype{slot->EffectType};
+    const bool oldauxsend{slot->AuxSendAuto};
+    const float oldrolloff{slot->RoomRolloff};
+    const float olddecay[3]{slot->DecayTime, slot->DecayLFRatio, slot->DecayHFRatio};
+    const bool olddecaylimit{slot->DecayHFLimit};
+    const float oldairabsorb{slot->AirAbsorptionGainHF};
+
     slot->Gain = props->Gain;
     slot->AuxSendAuto = props->AuxSendAuto;
     slot->Target = props->Target;
@@ -535,6 +756,12 @@ bool CalcEffectSlotParams(EffectSlot *slot, EffectSlot **sorted_slots, ContextBa
         slot->DecayHFLimit = false;
         slot->AirAbsorptionGainHF = 1.0f;
     }
+    slot->mSendParamsChanged = (oldtype == EffectSlotType::None)
+        != (slot->EffectType == EffectSlotType::None)
+        || oldauxsend != slot->AuxSendAuto || oldrolloff != slot->RoomRolloff
+        || olddecay[0] != slot->DecayTime || olddecay[1] != slot->DecayLFRatio
+        || olddecay[2] != slot->DecayHFRatio || olddecaylimit != slot->DecayHFLimit
+        || oldairabsorb != slot->AirAbsorptionGainHF;
 
     EffectState *state{props->State.release()};
     EffectState *oldstate{slot->mEffectState.release()};
@@ -577,7 +804,7 @@ bool CalcEffectSlotParams(EffectSlot *slot, EffectSlot **sorted_slots, ContextBa
         output = EffectTarget{&device->Dry, &device->RealOut};
     }
     state->update(context, slot, &slot->mEffectProps, output);
-    return true;
+    return slot->mSendParamsChanged;
 }
 
 
@@ -763,6 +990,20 @@ constexpr float Deg2Rad(float x) noexcept
 
 struct GainTriplet { float Base, HF, LF; };
 
+/* Gets the HRIR coefficients and delays for a direction, through the device's
+ * cache if it has one.
+ */
+void CalcHrtfCoeffs(DeviceBase *Device, float elevation, float azimuth, float distance,
+    float spread, HrirArray &coeffs, const al::span<uint,2> delays)
+{
+    if(HrirCache *cache{Device->mHrirCache.get()})
+        cache->getCoeffs(Device->mHrtf.get(), elevation, azimuth, distance, spread, coeffs,
+            delays);
+    else
+        GetHrtfCoeffs(Device->mHrtf.get(), elevation, azimuth, distance, spread, coeffs,
+            delays);
+}
+
 void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, const float zpos,
     const float Distance, const float Spread, const GainTriplet &DryGain,
     const al::span<const GainTriplet,MAX_SENDS> WetGain, EffectSlot *(&SendSlots)[MAX_SENDS],
@@ -871,7 +1112,21 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
         break;
     }
 
-    voice->mFlags.reset(VoiceHasHrtf).reset(VoiceHasNfc);
+    /* Find the loudest the voice can be on any output, so it can be
+     * virtualized when it's too quiet to hear.
+     */
+    auto peak_gain = [](const GainTriplet &gain) noexcept -> float
+    { return gain.Base * maxf(gain.HF, gain.LF); };
+    float audibility{peak_gain(DryGain)};
+    for(uint i{0};i < Device->NumAuxSends;++i)
+    {
+        if(SendSlots[i])
+            audibility = maxf(audibility, peak_gain(WetGain[i]));
+    }
+    voice->mAudibility = audibility;
+    voice->mFlags.set(VoiceIsInaudible, audibility < Device->mVirtualVoiceGain);
+
+    voice->mFlags.reset(VoiceHasHrtf).reset(VoiceWantsHrtf).reset(VoiceHasNfc);
     if(auto *decoder{voice->mDecoder.get()})
         decoder->mWidthControl = minf(props->EnhWidth, 0.7f);
 
@@ -1064,13 +1319,12 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
             }
         }
     }
-    else if(Device->mRenderMode == RenderMode::Hrtf)
+    else if(Device->mRenderMode == RenderMode::Hrtf && !voice->mFlags.test(VoiceHrtfLowDetail))
     {
-        /* Full HRTF rendering. Skip the virtual channels and render to the
-         * real outputs.
+        /* Full HRTF rendering. The HRIRs are applied directly to the real
+         * outputs, so the dry buffer (the ambisonic mix) is only used to fade
+         * out after being limited to it.
          */
-        voice->mDirect.Buffer = Device->RealOut.Buffer;
-
         if(Distance > std::numeric_limits<float>::epsilon())
         {
             const float src_ev{std::asin(clampf(ypos, -1.0f, 1.0f))};
@@ -1078,7 +1332,7 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
 
             if(voice->mFmtChannels == FmtMono)
             {
-                GetHrtfCoeffs(Device->mHrtf.get(), src_ev, src_az, Distance*NfcScale, Spread,
+                CalcHrtfCoeffs(Device, src_ev, src_az, Distance*NfcScale, Spread,
                     voice->mChans[0].mDryParams.Hrtf.Target.Coeffs,
                     voice->mChans[0].mDryParams.Hrtf.Target.Delay);
                 voice->mChans[0].mDryParams.Hrtf.Target.Gain = DryGain.Base;
@@ -1115,7 +1369,7 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
                 if(az < -pi_v<float>) az += pi_v<float>*2.0f;
                 else if(az > pi_v<float>) az -= pi_v<float>*2.0f;
 
-                GetHrtfCoeffs(Device->mHrtf.get(), ev, az, Distance*NfcScale, 0.0f,
+                CalcHrtfCoeffs(Device, ev, az, Distance*NfcScale, 0.0f,
                     voice->mChans[c].mDryParams.Hrtf.Target.Coeffs,
                     voice->mChans[c].mDryParams.Hrtf.Target.Delay);
                 voice->mChans[c].mDryParams.Hrtf.Target.Gain = DryGain.Base*Balance[c];
@@ -1150,7 +1404,7 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
                 /* Get the HRIR coefficients and delays for this channel
                  * position.
                  */
-                GetHrtfCoeffs(Device->mHrtf.get(), chans[c].elevation, chans[c].angle,
+                CalcHrtfCoeffs(Device, chans[c].elevation, chans[c].angle,
                     std::numeric_limits<float>::infinity(), spread,
                     voice->mChans[c].mDryParams.Hrtf.Target.Coeffs,
                     voice->mChans[c].mDryParams.Hrtf.Target.Delay);
@@ -1168,11 +1422,15 @@ void CalcPanningAndFilters(Voice *voice, const float xpos, const float ypos, con
             }
         }
 
-        voice->mFlags.set(VoiceHasHrtf);
+        voice->mFlags.set(VoiceHasHrtf).set(VoiceWantsHrtf);
     }
     else
     {
-        /* Non-HRTF rendering. Use normal panning to the output. */
+        /* Non-HRTF rendering, or HRTF rendering limited to the ambisonic mix.
+         * Use normal panning to the output.
+         */
+        if(Device->mRenderMode == RenderMode::Hrtf)
+            voice->mFlags.set(VoiceWantsHrtf);
 
         if(Distance > std::numeric_limits<float>::epsilon())
         {
@@ -1376,11 +1634,8 @@ void CalcNonAttnSourceParams(Voice *voice, const VoiceProps *props, const Contex
     /* Calculate the stepping value */
     const auto Pitch = static_cast<float>(voice->mFrequency) /
         static_cast<float>(Device->Frequency) * props->Pitch;
-    if(Pitch > float{MaxPitch})
-        voice->mStep = MaxPitch<<MixerFracBits;
-    else
-        voice->mStep = maxu(fastf2u(Pitch * MixerFracOne), 1);
-    voice->mResampler = PrepareResampler(props->mResampler, voice->mStep, &voice->mResampleState);
+    voice->mStep = PitchToStep(Pitch);
+    PrepareVoiceResampler(voice, props->mResampler);
 
     /* Calculate gains */
     GainTriplet DryGain;
@@ -1401,7 +1656,213 @@ void CalcNonAttnSourceParams(Voice *voice, const VoiceProps *props, const Contex
         context->mParams, Device);
 }
 
-void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBase *context)
+/* Listener-relative source vectors for a batch of voices, stored as
+ * structure-of-arrays so they can be calculated four voices at a time. The
+ * position, velocity, and direction arrays hold the source properties on
+ * input. CalcSourceGeometry replaces them with the normalized listener-
+ * relative direction to the source, the listener-relative velocity, and the
+ * normalized listener-relative source direction, and fills in the rest.
+ */
+struct SourceGeometryBatch {
+    static constexpr size_t MaxVoices{64};
+
+    size_t mCount{0u};
+    std::array<Voice*,MaxVoices> mVoices;
+
+    alignas(16) std::array<float,MaxVoices> mPosX, mPosY, mPosZ;
+    alignas(16) std::array<float,MaxVoices> mVelX, mVelY, mVelZ;
+    alignas(16) std::array<float,MaxVoices> mDirX, mDirY, mDirZ;
+    /* Non-zero for head-relative sources. */
+    alignas(16) std::array<float,MaxVoices> mHeadRelative;
+
+    /* Distance to the source, and the dot products of the normalized
+     * direction to the source with the source direction (only valid if the
+     * direction length is non-0), the source velocity, and the listener
+     * velocity.
+     */
+    alignas(16) std::array<float,MaxVoices> mDistance;
+    alignas(16) std::array<float,MaxVoices> mDirLength;
+    alignas(16) std::array<float,MaxVoices> mDirDot, mVelDot, mListenerVelDot;
+
+    void add(Voice *voice)
+    {
+        const VoiceProps &props = voice->mProps;
+        const size_t i{mCount++};
+        mVoices[i] = voice;
+        mPosX[i] = props.Position[0];
+        mPosY[i] = props.Position[1];
+        mPosZ[i] = props.Position[2];
+        mVelX[i] = props.Velocity[0];
+        mVelY[i] = props.Velocity[1];
+        mVelZ[i] = props.Velocity[2];
+        mDirX[i] = props.Direction[0];
+        mDirY[i] = props.Direction[1];
+        mDirZ[i] = props.Direction[2];
+        mHeadRelative[i] = props.HeadRelative ? 1.0f : 0.0f;
+    }
+    bool full() const noexcept { return mCount == MaxVoices; }
+};
+
+/* Calculates the listener-relative vectors of a batch of sources. This does
+ * the same operations, in the same order, as transforming and normalizing
+ * each source's alu::Vectors individually, so the results are identical.
+ */
+void CalcSourceGeometry(SourceGeometryBatch &batch, const ContextBase *context)
+{
+    const alu::Matrix &mtx = context->mParams.Matrix;
+    const alu::Vector &lpos = context->mParams.Position;
+    const alu::Vector &lvel = context->mParams.Velocity;
+    constexpr float eps2{std::numeric_limits<float>::epsilon() *
+        std::numeric_limits<float>::epsilon()};
+
+    size_t i{0u};
+#ifdef HAVE_SSE_INTRINSICS
+    /* Pad the batch to a multiple of 4 with zeros, so the last group of four
+     * can be done with the rest.
+     */
+    const size_t count4{(batch.mCount+3) & ~size_t{3}};
+    for(size_t j{batch.mCount};j < count4;++j)
+    {
+        batch.mPosX[j] = batch.mPosY[j] = batch.mPosZ[j] = 0.0f;
+        batch.mVelX[j] = batch.mVelY[j] = batch.mVelZ[j] = 0.0f;
+        batch.mDirX[j] = batch.mDirY[j] = batch.mDirZ[j] = 0.0f;
+        batch.mHeadRelative[j] = 0.0f;
+    }
+
+    auto transform4 = [&mtx](const __m128 x, const __m128 y, const __m128 z, const __m128 w,
+        const size_t col) noexcept -> __m128
+    {
+        __m128 ret{_mm_mul_ps(x, _mm_set1_ps(mtx[0][col]))};
+        ret = _mm_add_ps(ret, _mm_mul_ps(y, _mm_set1_ps(mtx[1][col])));
+        ret = _mm_add_ps(ret, _mm_mul_ps(z, _mm_set1_ps(mtx[2][col])));
+        return _mm_add_ps(ret, _mm_mul_ps(w, _mm_set1_ps(mtx[3][col])));
+    };
+    auto select4 = [](const __m128 mask, const __m128 a, const __m128 b) noexcept -> __m128
+    { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); };
+    auto dot4 = [](const __m128 x0, const __m128 y0, const __m128 z0, const __m128 x1,
+        const __m128 y1, const __m128 z1) noexcept -> __m128
+    {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x0, x1), _mm_mul_ps(y0, y1)),
+            _mm_mul_ps(z0, z1));
+    };
+
+    const __m128 zero4{_mm_setzero_ps()};
+    const __m128 one4{_mm_set1_ps(1.0f)};
+    const __m128 eps2_4{_mm_set1_ps(eps2)};
+    for(;i < count4;i += 4)
+    {
+        const __m128 headrel{_mm_cmpneq_ps(_mm_load_ps(&batch.mHeadRelative[i]), zero4)};
+
+        /* Position = Matrix * (Position - ListenerPosition) */
+        __m128 x{_mm_load_ps(&batch.mPosX[i])};
+        __m128 y{_mm_load_ps(&batch.mPosY[i])};
+        __m128 z{_mm_load_ps(&batch.mPosZ[i])};
+        {
+            const __m128 rx{_mm_sub_ps(x, _mm_set1_ps(lpos[0]))};
+            const __m128 ry{_mm_sub_ps(y, _mm_set1_ps(lpos[1]))};
+            const __m128 rz{_mm_sub_ps(z, _mm_set1_ps(lpos[2]))};
+            const __m128 rw{_mm_sub_ps(one4, _mm_set1_ps(lpos[3]))};
+            x = select4(headrel, x, transform4(rx, ry, rz, rw, 0));
+            y = select4(headrel, y, transform4(rx, ry, rz, rw, 1));
+            z = select4(headrel, z, transform4(rx, ry, rz, rw, 2));
+        }
+
+        /* Velocity = Matrix * Velocity, or offset by the listener velocity
+         * for head-relative sources.
+         */
+        __m128 vx{_mm_load_ps(&batch.mVelX[i])};
+        __m128 vy{_mm_load_ps(&batch.mVelY[i])};
+        __m128 vz{_mm_load_ps(&batch.mVelZ[i])};
+        {
+            const __m128 xvx{transform4(vx, vy, vz, zero4, 0)};
+            const __m128 xvy{transform4(vx, vy, vz, zero4, 1)};
+            const __m128 xvz{transform4(vx, vy, vz, zero4, 2)};
+            vx = select4(headrel, _mm_add_ps(vx, _mm_set1_ps(lvel[0])), xvx);
+            vy = select4(headrel, _mm_add_ps(vy, _mm_set1_ps(lvel[1])), xvy);
+            vz = select4(headrel, _mm_add_ps(vz, _mm_set1_ps(lvel[2])), xvz);
+        }
+
+        /* Direction = Matrix * Direction */
+        __m128 dx{_mm_load_ps(&batch.mDirX[i])};
+        __m128 dy{_mm_load_ps(&batch.mDirY[i])};
+        __m128 dz{_mm_load_ps(&batch.mDirZ[i])};
+        {
+            const __m128 xdx{transform4(dx, dy, dz, zero4, 0)};
+            const __m128 xdy{transform4(dx, dy, dz, zero4, 1)};
+            const __m128 xdz{transform4(dx, dy, dz, zero4, 2)};
+            dx = select4(headrel, dx, xdx);
+            dy = select4(headrel, dy, xdy);
+            dz = select4(headrel, dz, xdz);
+        }
+
+        /* Normalize the direction and position, getting their lengths. */
+        auto normalize4 = [eps2_4,one4,zero4,select4](__m128 &vx_, __m128 &vy_,
+            __m128 &vz_) noexcept -> __m128
+        {
+            const __m128 len2{_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx_, vx_), _mm_mul_ps(vy_, vy_)),
+                _mm_mul_ps(vz_, vz_))};
+            const __m128 valid{_mm_cmpgt_ps(len2, eps2_4)};
+            const __m128 len{_mm_sqrt_ps(len2)};
+            const __m128 invlen{_mm_div_ps(one4, len)};
+            vx_ = _mm_and_ps(valid, _mm_mul_ps(vx_, invlen));
+            vy_ = _mm_and_ps(valid, _mm_mul_ps(vy_, invlen));
+            vz_ = _mm_and_ps(valid, _mm_mul_ps(vz_, invlen));
+            return select4(valid, len, zero4);
+        };
+        _mm_store_ps(&batch.mDirLength[i], normalize4(dx, dy, dz));
+        _mm_store_ps(&batch.mDistance[i], normalize4(x, y, z));
+
+        _mm_store_ps(&batch.mDirDot[i], dot4(dx, dy, dz, x, y, z));
+        _mm_store_ps(&batch.mVelDot[i], dot4(vx, vy, vz, x, y, z));
+        _mm_store_ps(&batch.mListenerVelDot[i], dot4(_mm_set1_ps(lvel[0]),
+            _mm_set1_ps(lvel[1]), _mm_set1_ps(lvel[2]), x, y, z));
+
+        _mm_store_ps(&batch.mPosX[i], x);
+        _mm_store_ps(&batch.mPosY[i], y);
+        _mm_store_ps(&batch.mPosZ[i], z);
+        _mm_store_ps(&batch.mVelX[i], vx);
+        _mm_store_ps(&batch.mVelY[i], vy);
+        _mm_store_ps(&batch.mVelZ[i], vz);
+        _mm_store_ps(&batch.mDirX[i], dx);
+        _mm_store_ps(&batch.mDirY[i], dy);
+        _mm_store_ps(&batch.mDirZ[i], dz);
+    }
+#endif
+    for(;i < batch.mCount;++i)
+    {
+        alu::Vector Position{batch.mPosX[i], batch.mPosY[i], batch.mPosZ[i], 1.0f};
+        alu::Vector Velocity{batch.mVelX[i], batch.mVelY[i], batch.mVelZ[i], 0.0f};
+        alu::Vector Direction{batch.mDirX[i], batch.mDirY[i], batch.mDirZ[i], 0.0f};
+        if(batch.mHeadRelative[i] == 0.0f)
+        {
+            Position = mtx * (Position - lpos);
+            Velocity = mtx * Velocity;
+            Direction = mtx * Direction;
+        }
+        else
+            Velocity += lvel;
+
+        batch.mDirLength[i] = Direction.normalize();
+        batch.mDistance[i] = Position.normalize();
+
+        batch.mDirDot[i] = Direction.dot_product(Position);
+        batch.mVelDot[i] = Velocity.dot_product(Position);
+        batch.mListenerVelDot[i] = lvel.dot_product(Position);
+
+        batch.mPosX[i] = Position[0];
+        batch.mPosY[i] = Position[1];
+        batch.mPosZ[i] = Position[2];
+        batch.mVelX[i] = Velocity[0];
+        batch.mVelY[i] = Velocity[1];
+        batch.mVelZ[i] = Velocity[2];
+        batch.mDirX[i] = Direction[0];
+        batch.mDirY[i] = Direction[1];
+        batch.mDirZ[i] = Direction[2];
+    }
+}
+
+void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBase *context,
+    const SourceGeometryBatch &geom, const size_t gidx)
 {
     DeviceBase *Device{context->mDevice};
     const uint NumSends{Device->NumAuxSends};
@@ -1429,26 +1890,12 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
             voice->mSend[i].Buffer = SendSlots[i]->Wet.Buffer;
     }
 
-    /* Transform source to listener space (convert to head relative) */
-    alu::Vector Position{props->Position[0], props->Position[1], props->Position[2], 1.0f};
-    alu::Vector Velocity{props->Velocity[0], props->Velocity[1], props->Velocity[2], 0.0f};
-    alu::Vector Direction{props->Direction[0], props->Direction[1], props->Direction[2], 0.0f};
-    if(!props->HeadRelative)
-    {
-        /* Transform source vectors */
-        Position = context->mParams.Matrix * (Position - context->mParams.Position);
-        Velocity = context->mParams.Matrix * Velocity;
-        Direction = context->mParams.Matrix * Direction;
-    }
-    else
-    {
-        /* Offset the source velocity to be relative of the listener velocity */
-        Velocity += context->mParams.Velocity;
-    }
-
-    const bool directional{Direction.normalize() > 0.0f};
-    alu::Vector ToSource{Position[0], Position[1], Position[2], 0.0f};
-    const float Distance{ToSource.normalize()};
+    /* The source vectors were already transformed to listener space (i.e.
+     * converted to head relative) with the rest of the batch.
+     */
+    const bool directional{geom.mDirLength[gidx] > 0.0f};
+    const alu::Vector ToSource{geom.mPosX[gidx], geom.mPosY[gidx], geom.mPosZ[gidx], 0.0f};
+    const float Distance{geom.mDistance[gidx]};
 
     /* Calculate distance attenuation */
     float ClampedDist{Distance};
@@ -1512,7 +1959,7 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
     if(directional && props->InnerAngle < 360.0f)
     {
         static constexpr float Rad2Deg{static_cast<float>(180.0 / al::numbers::pi)};
-        const float Angle{Rad2Deg*2.0f * std::acos(-Direction.dot_product(ToSource)) * ConeScale};
+        const float Angle{Rad2Deg*2.0f * std::acos(-geom.mDirDot[gidx]) * ConeScale};
 
         float ConeGain{1.0f};
         if(Angle >= props->OuterAngle)
@@ -1650,9 +2097,8 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
     float DopplerFactor{props->DopplerFactor * context->mParams.DopplerFactor};
     if(DopplerFactor > 0.0f)
     {
-        const alu::Vector &lvelocity = context->mParams.Velocity;
-        float vss{Velocity.dot_product(ToSource) * -DopplerFactor};
-        float vls{lvelocity.dot_product(ToSource) * -DopplerFactor};
+        const float vss{geom.mVelDot[gidx] * -DopplerFactor};
+        const float vls{geom.mListenerVelDot[gidx] * -DopplerFactor};
 
         const float SpeedOfSound{context->mParams.SpeedOfSound};
         if(!(vls < SpeedOfSound))
@@ -1682,11 +2128,8 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
      * fixed-point stepping value.
      */
     Pitch *= static_cast<float>(voice->mFrequency) / static_cast<float>(Device->Frequency);
-    if(Pitch > float{MaxPitch})
-        voice->mStep = MaxPitch<<MixerFracBits;
-    else
-        voice->mStep = maxu(fastf2u(Pitch * MixerFracOne), 1);
-    voice->mResampler = PrepareResampler(props->mResampler, voice->mStep, &voice->mResampleState);
+    voice->mStep = PitchToStep(Pitch);
+    PrepareVoiceResampler(voice, props->mResampler);
 
     float spread{0.0f};
     if(props->Radius > Distance)
@@ -1698,25 +2141,79 @@ void CalcAttnSourceParams(Voice *voice, const VoiceProps *props, const ContextBa
         Distance, spread, DryGain, WetGain, SendSlots, props, context->mParams, Device);
 }
 
-void CalcSourceParams(Voice *voice, ContextBase *context, bool force)
+/* Returns whether the voice's source is positioned (attenuated and panned
+ * according to its position relative to the listener).
+ */
+bool IsAttnSource(const Voice *voice)
 {
-    VoicePropsItem *props{voice->mUpdate.exchange(nullptr, std::memory_order_acq_rel)};
-    if(!props && !force) return;
+    return !((voice->mProps.DirectChannels != DirectMode::Off && voice->mFmtChannels != FmtMono
+            && !IsAmbisonic(voice->mFmtChannels))
+        || voice->mProps.mSpatializeMode == SpatializeMode::Off
+        || (voice->mProps.mSpatializeMode==SpatializeMode::Auto && voice->mFmtChannels != FmtMono));
+}
 
-    if(props)
+/* Returns whether the voice's parameters depend on any of the given context
+ * and effect slot changes.
+ */
+bool DependsOnChanges(const Voice *voice, const ContextBase *context, const uint changes)
+{
+    const VoiceProps &props = voice->mProps;
+    if((changes&EffectSlotChanged))
     {
-        voice->mProps = *props;
+        const uint numsends{context->mDevice->NumAuxSends};
+        for(uint i{0};i < numsends;++i)
+        {
+            const EffectSlot *slot{props.Send[i].Slot};
+            if(slot && slot->mSendParamsChanged)
+                return true;
+        }
+    }
+    if((changes&ContextGainChanged))
+        return true;
 
-        AtomicReplaceHead(context->mFreeVoiceProps, props);
+    if(!IsAttnSource(voice))
+    {
+        /* Non-positioned sources only use the listener's orientation, to
+         * rotate world-relative B-Format sources.
+         */
+        return (changes&ListenerTransformChanged) && !props.HeadRelative
+            && IsAmbisonic(voice->mFmtChannels);
     }
 
-    if((voice->mProps.DirectChannels != DirectMode::Off && voice->mFmtChannels != FmtMono
-            && !IsAmbisonic(voice->mFmtChannels))
-        || voice->mProps.mSpatializeMode == SpatializeMode::Off
-        || (voice->mProps.mSpatializeMode==SpatializeMode::Auto && voice->mFmtChannels != FmtMono))
-        CalcNonAttnSourceParams(voice, &voice->mProps, context);
-    else
-        CalcAttnSourceParams(voice, &voice->mProps, context);
+    if((changes&ContextEnvironmentChanged))
+        return true;
+    /* Head-relative sources don't move with the listener. */
+    if((changes&ListenerTransformChanged) && !props.HeadRelative)
+        return true;
+    /* The listener's velocity is only used for the doppler shift. */
+    return (changes&ListenerVelocityChanged)
+        && props.DopplerFactor*context->mParams.DopplerFactor > 0.0f;
+}
+
+/* Updates the voice's properties if there's an update, and returns whether
+ * its parameters need to be recalculated.
+ */
+bool UpdateSourceProps(Voice *voice, ContextBase *context, const uint changes)
+{
+    VoicePropsItem *props{voice->mUpdate.exchange(nullptr, std::memory_order_acq_rel)};
+    if(!props)
+        return changes != 0 && DependsOnChanges(voice, context, changes);
+
+    voice->mProps = *props;
+
+    AtomicReplaceHead(context->mFreeVoiceProps, props);
+    return true;
+}
+
+void CalcAttnSourceBatch(SourceGeometryBatch &batch, const ContextBase *context)
+{
+    CalcSourceGeometry(batch, context);
+    for(size_t i{0u};i < batch.mCount;++i)
+    {
+        Voice *voice{batch.mVoices[i]};
+        CalcAttnSourceParams(voice, &voice->mProps, context, batch, i);
+    }
+    batch.mCount = 0;
 }
 
 
@@ -1775,6 +2272,11 @@ void ProcessVoiceChanges(ContextBase *ctx)
                 Voice::State oldvstate{Voice::Playing};
                 voice->mPlayState.compare_exchange_strong(oldvstate, Voice::Stopping,
                     std::memory_order_relaxed, std::memory_order_acquire);
+                /* A playing voice gives up its table when it finishes stopping,
+                 * but a paused one is already stopped.
+                 */
+                if(oldvstate == Voice::Stopped)
+                    voice->releasePolyphase();
                 voice->mPendingChange.store(false, std::memory_order_release);
             }
             /* Reset state change events are always sent, even if the voice is
@@ -1805,6 +2307,8 @@ void ProcessVoiceChanges(ContextBase *ctx)
                 Voice::State oldvstate{Voice::Playing};
                 sendevt = !oldvoice->mPlayState.compare_exchange_strong(oldvstate, Voice::Stopping,
                     std::memory_order_relaxed, std::memory_order_acquire);
+                if(oldvstate == Voice::Stopped)
+                    oldvoice->releasePolyphase();
                 oldvoice->mPendingChange.store(false, std::memory_order_release);
             }
             else
@@ -1831,6 +2335,8 @@ void ProcessVoiceChanges(ContextBase *ctx)
                 Voice::State oldvstate{Voice::Playing};
                 oldvoice->mPlayState.compare_exchange_strong(oldvstate, Voice::Stopping,
                     std::memory_order_relaxed, std::memory_order_acquire);
+                if(oldvstate == Voice::Stopped)
+                    oldvoice->releasePolyphase();
 
                 Voice *voice{cur->mVoice};
                 voice->mPlayState.store((oldvstate == Voice::Playing) ? Voice::Playing
@@ -1854,47 +2360,438 @@ void ProcessParamUpdates(ContextBase *ctx, const EffectSlotArray &slots,
     IncrementRef(ctx->mUpdateCount);
     if LIKELY(!ctx->mHoldUpdates.load(std::memory_order_acquire))
     {
-        bool force{CalcContextParams(ctx)};
+        /* Only the voices that depend on something that changed need to be
+         * recalculated, along with those that have their own update.
+         */
+        uint changes{CalcContextParams(ctx)};
         auto sorted_slots = const_cast<EffectSlot**>(slots.data() + slots.size());
         for(EffectSlot *slot : slots)
-            force |= CalcEffectSlotParams(slot, sorted_slots, ctx);
+        {
+            if(CalcEffectSlotParams(slot, sorted_slots, ctx))
+                changes |= EffectSlotChanged;
+        }
 
+        /* Positioned sources have their listener-relative vectors calculated
+         * in batches, before the rest of their parameters.
+         */
+        SourceGeometryBatch batch;
         for(Voice *voice : voices)
         {
             /* Only update voices that have a source. */
-            if(voice->mSourceID.load(std::memory_order_relaxed) != 0)
-                CalcSourceParams(voice, ctx, force);
+            if(voice->mSourceID.load(std::memory_order_relaxed) == 0
+                || !UpdateSourceProps(voice, ctx, changes))
+                continue;
+
+            if(!IsAttnSource(voice))
+                CalcNonAttnSourceParams(voice, &voice->mProps, ctx);
+            else
+            {
+                batch.add(voice);
+                if(batch.full())
+                    CalcAttnSourceBatch(batch, ctx);
+            }
         }
+        if(batch.mCount > 0)
+            CalcAttnSourceBatch(batch, ctx);
     }
     IncrementRef(ctx->mUpdateCount);
 }
 
-void ProcessContexts(DeviceBase *device, const uint SamplesToDo)
+/* The minimum number of voices to give each mixer task, so the overhead of
+ * waking the mixer workers is worth it.
+ */
+constexpr size_t MinVoicesPerTask{4};
+
+/* Marks all but the given number of playing voices as culled, keeping the
+ * ones with the highest priority scaled by audibility. Stopping voices finish
+ * fading out this mix, so they don't take up a spot. Returns true if the list
+ * was reordered.
+ */
+bool CullVoices(const al::span<Voice*> voices, const size_t maxvoices)
+{
+    auto is_playing = [](const Voice *voice) noexcept -> bool
+    { return voice->mPlayState.load(std::memory_order_relaxed) == Voice::Playing; };
+    if(static_cast<size_t>(std::count_if(voices.begin(), voices.end(), is_playing)) <= maxvoices)
+    {
+        for(Voice *voice : voices)
+        {
+            if(is_playing(voice))
+                voice->mFlags.reset(VoiceIsCulled);
+        }
+        return false;
+    }
+    const al::span<Voice*> playing{voices.begin(),
+        std::partition(voices.begin(), voices.end(), is_playing)};
+
+    auto higher_score = [](const Voice *lhs, const Voice *rhs) noexcept -> bool
+    {
+        const float lscore{lhs->mProps.Priority * lhs->mAudibility};
+        const float rscore{rhs->mProps.Priority * rhs->mAudibility};
+        if(lscore != rscore)
+            return lscore > rscore;
+        /* Break ties consistently so equal voices don't trade places. */
+        return std::less<const Voice*>{}(lhs, rhs);
+    };
+    const auto split = playing.begin() + maxvoices;
+    std::nth_element(playing.begin(), split, playing.end(), higher_score);
+
+    std::for_each(playing.begin(), split,
+        [](Voice *voice) noexcept { voice->mFlags.reset(VoiceIsCulled); });
+    std::for_each(split, playing.end(),
+        [](Voice *voice) noexcept { voice->mFlags.set(VoiceIsCulled); });
+    return true;
+}
+
+/* Voices using their own HRIRs have their score scaled by this much when
+ * ranked against those that aren't, so voices near the cut don't keep
+ * switching back and forth.
+ */
+constexpr float HrtfVoiceHysteresis{1.25f};
+
+/* Limits how many voices use their own HRIRs, keeping them for the ones with
+ * the highest priority scaled by audibility and panning the rest to the
+ * ambisonic mix. Voices that switch get their parameters recalculated, and
+ * crossfade between the two as they mix. This reorders the list.
+ */
+void LimitHrtfVoices(ContextBase *ctx, const al::span<Voice*> voices, const size_t maxvoices)
+{
+    /* Culled voices are silent, and stopping voices won't be around to
+     * switch, so neither take up a spot.
+     */
+    auto wants_hrtf = [](const Voice *voice) noexcept -> bool
+    {
+        return voice->mFlags.test(VoiceWantsHrtf) && !voice->mFlags.test(VoiceIsCulled)
+            && voice->mSourceID.load(std::memory_order_relaxed) != 0;
+    };
+    const al::span<Voice*> hrtfvoices{voices.begin(),
+        std::partition(voices.begin(), voices.end(), wants_hrtf)};
+
+    if(hrtfvoices.size() > maxvoices)
+    {
+        auto calc_score = [](const Voice *voice) noexcept -> float
+        {
+            const float score{voice->mProps.Priority * voice->mAudibility};
+            return voice->mFlags.test(VoiceHrtfLowDetail) ? score : score*HrtfVoiceHysteresis;
+        };
+        auto higher_score = [calc_score](const Voice *lhs, const Voice *rhs) noexcept -> bool
+        {
+            const float lscore{calc_score(lhs)};
+            const float rscore{calc_score(rhs)};
+            if(lscore != rscore)
+                return lscore > rscore;
+            return std::less<const Voice*>{}(lhs, rhs);
+        };
+        const auto split = hrtfvoices.begin() + maxvoices;
+        std::nth_element(hrtfvoices.begin(), split, hrtfvoices.end(), higher_score);
+
+        std::for_each(hrtfvoices.begin(), split,
+            [](Voice *voice) noexcept { voice->mFlags.reset(VoiceHrtfLowDetail); });
+        std::for_each(split, hrtfvoices.end(),
+            [](Voice *voice) noexcept { voice->mFlags.set(VoiceHrtfLowDetail); });
+    }
+    else
+    {
+        for(Voice *voice : hrtfvoices)
+            voice->mFlags.reset(VoiceHrtfLowDetail);
+    }
+
+    SourceGeometryBatch batch;
+    for(Voice *voice : hrtfvoices)
+    {
+        if(voice->mFlags.test(VoiceHasHrtf) != voice->mFlags.test(VoiceHrtfLowDetail))
+            continue;
+
+        if(!IsAttnSource(voice))
+            CalcNonAttnSourceParams(voice, &voice->mProps, ctx);
+        else
+        {
+            batch.add(voice);
+            if(batch.full())
+                CalcAttnSourceBatch(batch, ctx);
+        }
+    }
+    if(batch.mCount > 0)
+        CalcAttnSourceBatch(batch, ctx);
+}
+
+struct VoiceMixTask {
+    ContextBase *mContext;
+    al::span<Voice*> mVoices;
+    size_t mNumTasks;
+    uint mSamplesToDo;
+};
+
+void MixVoicesTask(void *userdata, const size_t task)
+{
+    const VoiceMixTask &mixtask = *static_cast<VoiceMixTask*>(userdata);
+    ContextBase *ctx{mixtask.mContext};
+    DeviceBase *device{ctx->mDevice};
+    const uint SamplesToDo{mixtask.mSamplesToDo};
+
+    MixerScratch &scratch = task ? *device->mWorkerScratch[task-1] : device->mMixerScratch;
+
+    /* Each task mixes a fixed range of the voice list with its own scratch
+     * storage, so the output doesn't depend on which thread runs which task.
+     */
+    const size_t count{mixtask.mVoices.size()};
+    auto voice_iter = mixtask.mVoices.begin() + count*task/mixtask.mNumTasks;
+    const auto voice_end = mixtask.mVoices.begin() + count*(task+1)/mixtask.mNumTasks;
+    for(;voice_iter != voice_end;++voice_iter)
+    {
+        Voice *voice{*voice_iter};
+        const Voice::State vstate{voice->mPlayState.load(std::memory_order_acquire)};
+        voice->mix(vstate, ctx, SamplesToDo, scratch);
+    }
+}
+
+/* Adds the worker's copy of the output into the given buffer, and clears the
+ * copy for the next time it's used.
+ */
+void AddWorkerLines(const al::span<FloatBufferLine> dst, FloatBufferLine *src,
+    const uint SamplesToDo)
+{
+    for(FloatBufferLine &dstline : dst)
+    {
+        std::transform(src->cbegin(), src->cbegin()+SamplesToDo, dstline.cbegin(),
+            dstline.begin(), std::plus<float>{});
+        std::fill_n(src->begin(), SamplesToDo, 0.0f);
+        ++src;
+    }
+}
+
+void AddWorkerOutput(DeviceBase *device, const EffectSlotArray &slots, const size_t numtasks,
+    const uint SamplesToDo)
+{
+    /* Add in each worker's output in a fixed order, to keep the result
+     * deterministic.
+     */
+    for(size_t task{1};task < numtasks;++task)
+    {
+        MixerScratch &scratch = *device->mWorkerScratch[task-1];
+
+        AddWorkerLines(device->MixBuffer, scratch.mMixBuffer.data(), SamplesToDo);
+
+        for(EffectSlot *slot : slots)
+        {
+            const size_t numchans{slot->Wet.Buffer.size()};
+            AddWorkerLines(slot->Wet.Buffer, slot->mWetBuffer.data() + numchans*task,
+                SamplesToDo);
+        }
+
+        if(device->mHrtfState)
+        {
+            float2 *accum{device->mMixerScratch.HrtfAccumData};
+            for(size_t i{0};i < SamplesToDo+HrirLength;++i)
+            {
+                accum[i][0] += scratch.HrtfAccumData[i][0];
+                accum[i][1] += scratch.HrtfAccumData[i][1];
+            }
+            std::fill_n(std::begin(scratch.HrtfAccumData), SamplesToDo+HrirLength, float2{});
+        }
+    }
+}
+
+
+struct EffectMixTask {
+    DeviceBase *mDevice;
+    al::span<EffectSlot*> mSlots;
+    size_t mNumTasks;
+    uint mSamplesToDo;
+};
+
+/* Gets the worker's copy of the effect slot's output, which is either the
+ * target slot's wet buffer or part of the device's mixing buffer.
+ */
+al::span<FloatBufferLine> GetWorkerTarget(DeviceBase *device, const EffectSlot *slot,
+    const al::span<FloatBufferLine> target, MixerScratch &scratch)
+{
+    const uint widx{scratch.mWorkerIdx};
+    if(!widx || target.empty())
+        return target;
+
+    if(EffectSlot *targetslot{slot->Target})
+    {
+        if(target.data() == targetslot->Wet.Buffer.data())
+            return {targetslot->mWetBuffer.data() + target.size()*widx, target.size()};
+    }
+    const auto offset = target.data() - device->MixBuffer.data();
+    return {scratch.mMixBuffer.data() + offset, target.size()};
+}
+
+void ProcessEffectsTask(void *userdata, const size_t task)
+{
+    const EffectMixTask &fxtask = *static_cast<EffectMixTask*>(userdata);
+    DeviceBase *device{fxtask.mDevice};
+
+    MixerScratch &scratch = task ? *device->mWorkerScratch[task-1] : device->mMixerScratch;
+
+    const size_t count{fxtask.mSlots.size()};
+    auto slot_iter = fxtask.mSlots.begin() + count*task/fxtask.mNumTasks;
+    const auto slot_end = fxtask.mSlots.begin() + count*(task+1)/fxtask.mNumTasks;
+    for(;slot_iter != slot_end;++slot_iter)
+    {
+        const EffectSlot *slot{*slot_iter};
+        EffectState *state{slot->mEffectState.get()};
+        state->process(fxtask.mSamplesToDo, slot->Wet.Buffer,
+            GetWorkerTarget(device, slot, state->mOutTarget, scratch));
+    }
+}
+
+void AddEffectOutput(const EffectMixTask &fxtask)
+{
+    DeviceBase *device{fxtask.mDevice};
+    const size_t count{fxtask.mSlots.size()};
+    for(size_t task{1};task < fxtask.mNumTasks;++task)
+    {
+        MixerScratch &scratch = *device->mWorkerScratch[task-1];
+
+        auto slot_iter = fxtask.mSlots.begin() + count*task/fxtask.mNumTasks;
+        const auto slot_end = fxtask.mSlots.begin() + count*(task+1)/fxtask.mNumTasks;
+        for(;slot_iter != slot_end;++slot_iter)
+        {
+            const EffectSlot *slot{*slot_iter};
+            const al::span<FloatBufferLine> target{slot->mEffectState->mOutTarget};
+            AddWorkerLines(target, GetWorkerTarget(device, slot, target, scratch).data(),
+                fxtask.mSamplesToDo);
+        }
+    }
+}
+
+void ProcessEffects(DeviceBase *device, const al::span<EffectSlot*> sorted_slots,
+    const uint SamplesToDo)
+{
+    WorkerPool *pool{device->mMixerPool.get()};
+    if(!pool || sorted_slots.size() < 2)
+    {
+        for(const EffectSlot *slot : sorted_slots)
+        {
+            EffectState *state{slot->mEffectState.get()};
+            state->process(SamplesToDo, slot->Wet.Buffer, state->mOutTarget);
+        }
+        return;
+    }
+
+    /* Split the sorted slots into batches where no slot targets another in
+     * the same batch. The slots in a batch can then be processed at the same
+     * time, with each batch finishing before the next one starts.
+     */
+    auto batch_begin = sorted_slots.begin();
+    while(batch_begin != sorted_slots.end())
+    {
+        auto batch_end = batch_begin + 1;
+        while(batch_end != sorted_slots.end())
+        {
+            const EffectSlot *next{*batch_end};
+            auto targets_next = [next](const EffectSlot *slot) noexcept -> bool
+            { return slot->Target == next; };
+            if(std::any_of(batch_begin, batch_end, targets_next))
+                break;
+            ++batch_end;
+        }
+
+        const al::span<EffectSlot*> batch{batch_begin, batch_end};
+        EffectMixTask fxtask{device, batch, minz(batch.size(), pool->numWorkers()+1),
+            SamplesToDo};
+        if(fxtask.mNumTasks > 1)
+        {
+            pool->run(ProcessEffectsTask, &fxtask, fxtask.mNumTasks);
+            AddEffectOutput(fxtask);
+        }
+        else
+            ProcessEffectsTask(&fxtask, 0);
+
+        batch_begin = batch_end;
+    }
+}
+
+void ProcessContexts(DeviceBase *device, const uint SamplesToDo, MixerStats::Timer &timer)
 {
     ASSUME(SamplesToDo > 0);
 
+    WorkerPool *pool{device->mMixerPool.get()};
     for(ContextBase *ctx : *device->mContexts.load(std::memory_order_acquire))
     {
         const EffectSlotArray &auxslots = *ctx->mActiveAuxSlots.load(std::memory_order_acquire);
-        const al::span<Voice*> voices{ctx->getVoicesSpanAcquired()};
+        ContextBase::VoiceArray &allvoices = *ctx->mVoices.load(std::memory_order_acquire);
+        const al::span<Voice*> voices{allvoices.data(),
+            ctx->mActiveVoiceCount.load(std::memory_order_acquire)};
 
         /* Process pending propery updates for objects on the context. */
         ProcessParamUpdates(ctx, auxslots, voices);
+        timer.mark(MixerStats::ParamUpdates);
 
-        /* Clear auxiliary effect slot mixing buffers. */
+        /* Clear auxiliary effect slot mixing buffers, including any copies
+         * for the mixer workers.
+         */
         for(EffectSlot *slot : auxslots)
         {
-            for(auto &buffer : slot->Wet.Buffer)
+            for(auto &buffer : slot->mWetBuffer)
                 buffer.fill(0.0f);
         }
 
         /* Process voices that have a playing source. */
-        for(Voice *voice : voices)
+        if(!pool && !ctx->mMaxRealVoices && !ctx->mMaxHrtfVoices)
         {
-            const Voice::State vstate{voice->mPlayState.load(std::memory_order_acquire)};
-            if(vstate != Voice::Stopped && vstate != Voice::Pending)
-                voice->mix(vstate, ctx, SamplesToDo);
+            for(Voice *voice : voices)
+            {
+                const Voice::State vstate{voice->mPlayState.load(std::memory_order_acquire)};
+                if(vstate != Voice::Stopped && vstate != Voice::Pending)
+                {
+                    voice->mix(vstate, ctx, SamplesToDo, device->mMixerScratch);
+                    voice->sendEvents(ctx);
+                }
+            }
         }
+        else
+        {
+            /* Gather the voices to mix into the extra storage after the voice
+             * array.
+             */
+            auto is_playing = [](const Voice *voice) noexcept -> bool
+            {
+                const Voice::State vstate{voice->mPlayState.load(std::memory_order_acquire)};
+                return vstate != Voice::Stopped && vstate != Voice::Pending;
+            };
+            Voice **mixlist{allvoices.data() + allvoices.size()};
+            const al::span<Voice*> mixvoices{mixlist,
+                std::copy_if(voices.begin(), voices.end(), mixlist, is_playing)};
+
+            /* Cull the voices over the context's limit. This reorders the
+             * list, so gather it again after to keep the mixing order.
+             */
+            if(ctx->mMaxRealVoices > 0 && CullVoices(mixvoices, ctx->mMaxRealVoices))
+                std::copy_if(voices.begin(), voices.end(), mixlist, is_playing);
+
+            /* Limit the voices using their own HRIRs, which also reorders the
+             * list. This recalculates the parameters of voices that switch,
+             * so count it as part of the parameter updates.
+             */
+            if(ctx->mMaxHrtfVoices > 0 && device->mRenderMode == RenderMode::Hrtf)
+            {
+                timer.mark(MixerStats::VoiceMix);
+                LimitHrtfVoices(ctx, mixvoices, ctx->mMaxHrtfVoices);
+                timer.mark(MixerStats::ParamUpdates);
+                std::copy_if(voices.begin(), voices.end(), mixlist, is_playing);
+            }
+
+            /* Split the voices between the mixer workers. */
+            VoiceMixTask mixtask{ctx, mixvoices, 1, SamplesToDo};
+            if(pool)
+                mixtask.mNumTasks = clampz(mixvoices.size()/MinVoicesPerTask, 1,
+                    pool->numWorkers()+1);
+            if(mixtask.mNumTasks > 1)
+            {
+                pool->run(MixVoicesTask, &mixtask, mixtask.mNumTasks);
+                AddWorkerOutput(device, auxslots, mixtask.mNumTasks, SamplesToDo);
+            }
+            else
+                MixVoicesTask(&mixtask, 0);
+
+            /* Events can only be written by this thread. */
+            for(Voice *voice : mixvoices)
+                voice->sendEvents(ctx);
+        }
+        timer.mark(MixerStats::VoiceMix);
 
         /* Process effects. */
         if(const size_t num_slots{auxslots.size()})
@@ -1952,17 +2849,14 @@ void ProcessContexts(DeviceBase *device, const uint SamplesToDo)
                 }
             }
 
-            for(const EffectSlot *slot : sorted_slots)
-            {
-                EffectState *state{slot->mEffectState.get()};
-                state->process(SamplesToDo, slot->Wet.Buffer, state->mOutTarget);
-            }
+            ProcessEffects(device, sorted_slots, SamplesToDo);
         }
 
         /* Signal the event handler if there are any events to read. */
         RingBuffer *ring{ctx->mAsyncEvents.get()};
         if(ring->readSpace() > 0)
             ctx->mEventSem.post();
+        timer.mark(MixerStats::Effects);
     }
 }
 
@@ -2086,19 +2980,20 @@ void Write(const al::span<const FloatBufferLine> InBuffer, void *OutBuffer, cons
 
 } // namespace
 
-uint DeviceBase::renderSamples(const uint numSamples)
+uint DeviceBase::renderSamples(const uint numSamples, MixerStats::Timer &timer)
 {
     const uint samplesToDo{minu(numSamples, BufferLineSize)};
 
     /* Clear main mixing buffers. */
     for(FloatBufferLine &buffer : MixBuffer)
         buffer.fill(0.0f);
+    timer.mark(MixerStats::VoiceMix);
 
     /* Increment the mix count at the start (lsb should now be 1). */
     IncrementRef(MixCount);
 
     /* Process and mix each context's sources and effects. */
-    ProcessContexts(this, samplesToDo);
+    ProcessContexts(this, samplesToDo, timer);
 
     /* Increment the clock time. Every second's worth of samples is converted
      * and added to clock base so that large sample counts don't overflow
@@ -2110,24 +3005,36 @@ uint DeviceBase::renderSamples(const uint numSamples)
 
     /* Increment the mix count at the end (lsb should now be 0). */
     IncrementRef(MixCount);
+    timer.skip();
 
     /* Apply any needed post-process for finalizing the Dry mix to the RealOut
      * (Ambisonic decode, UHJ encode, etc).
      */
     postProcess(samplesToDo);
+    timer.mark(MixerStats::PostProcess);
 
     /* Apply compression, limiting sample amplitude if needed or desired. */
-    if(Limiter) Limiter->process(samplesToDo, RealOut.Buffer.data());
+    if(Limiter)
+    {
+        Limiter->process(samplesToDo, RealOut.Buffer.data());
+        timer.mark(MixerStats::Limiter);
+    }
 
     /* Apply delays and attenuation for mismatched speaker distances. */
     if(ChannelDelays)
+    {
         ApplyDistanceComp(RealOut.Buffer, samplesToDo, ChannelDelays->mChannels.data());
+        timer.mark(MixerStats::DistanceComp);
+    }
 
     /* Apply dithering. The compressor should have left enough headroom for the
      * dither noise to not saturate.
      */
     if(DitherDepth > 0.0f)
+    {
         ApplyDither(RealOut.Buffer, &DitherSeed, DitherDepth, samplesToDo);
+        timer.mark(MixerStats::Dither);
+    }
 
     return samplesToDo;
 }
@@ -2138,7 +3045,8 @@ void DeviceBase::renderSamples(const al::span<float*> outBuffers, const uint num
     uint total{0};
     while(const uint todo{numSamples - total})
     {
-        const uint samplesToDo{renderSamples(todo)};
+        MixerStats::Timer timer;
+        const uint samplesToDo{renderSamples(todo, timer)};
 
         auto *srcbuf = RealOut.Buffer.data();
         for(auto *dstbuf : outBuffers)
@@ -2146,6 +3054,8 @@ void DeviceBase::renderSamples(const al::span<float*> outBuffers, const uint num
             std::copy_n(srcbuf->data(), samplesToDo, dstbuf + total);
             ++srcbuf;
         }
+        timer.mark(MixerStats::Write);
+        mMixerStats.commit(timer);
 
         total += samplesToDo;
     }
@@ -2157,7 +3067,8 @@ void DeviceBase::renderSamples(void *outBuffer, const uint numSamples, const siz
     uint total{0};
     while(const uint todo{numSamples - total})
     {
-        const uint samplesToDo{renderSamples(todo)};
+        MixerStats::Timer timer;
+        const uint samplesToDo{renderSamples(todo, timer)};
 
         if LIKELY(outBuffer)
         {
@@ -2177,7 +3088,9 @@ void DeviceBase::renderSamples(void *outBuffer, const uint numSamples, const siz
             HANDLE_WRITE(DevFmtFloat)
 #undef HANDLE_WRITE
             }
+            timer.mark(MixerStats::Write);
         }
+        mMixerStats.commit(timer);
 
         total += samplesToDo;
     }
@@ -2225,6 +3138,7 @@ void DeviceBase::handleDisconnect(const char *msg, ...)
                 voice->mCurrentBuffer.store(nullptr, std::memory_order_relaxed);
                 voice->mLoopBuffer.store(nullptr, std::memory_order_relaxed);
                 voice->mSourceID.store(0u, std::memory_order_relaxed);
+                voice->releasePolyphase();
                 voice->mPlayState.store(Voice::Stopped, std::memory_order_release);
             };
             std::for_each(voicelist.begin(), voicelist.end(), stop_voice);
@@ -62,7 +62,11 @@ constexpr ALchar alExtList[] =
     "AL_SOFT_bformat_ex "
     "AL_SOFTX_bformat_hoa "
     "AL_SOFT_block_alignment "
+    "AL_SOFTX_buffer_data_async "
+    "AL_SOFTX_buffer_data_static "
+    "AL_SOFTX_buffer_refill "
     "AL_SOFT_callback_buffer "
+    "AL_SOFTX_callback_buffer_threads "
     "AL_SOFTX_convolution_reverb "
     "AL_SOFT_deferred_updates "
     "AL_SOFT_direct_channels "
@@ -70,12 +74,14 @@ constexpr ALchar alExtList[] =
     "AL_SOFT_effect_target "
     "AL_SOFT_events "
     "AL_SOFT_gain_clamp_ex "
+    "AL_SOFTX_half_float "
     "AL_SOFTX_hold_on_disconnect "
     "AL_SOFT_loop_points "
     "AL_SOFTX_map_buffer "
     "AL_SOFT_MSADPCM "
     "AL_SOFT_source_latency "
     "AL_SOFT_source_length "
+    "AL_SOFTX_source_priority "
     "AL_SOFT_source_resampler "
     "AL_SOFT_source_spatialize "
     "AL_SOFT_UHJ";
@@ -189,6 +195,7 @@ void ALCcontext::init()
 
 
     mAsyncEvents = RingBuffer::Create(511, sizeof(AsyncEvent), false);
+    mThreadEvents = RingBuffer::Create(63, sizeof(AsyncEvent), false);
     StartEventThrd(this);
 
 
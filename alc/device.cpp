@@ -15,6 +15,7 @@
 #include "core/hrtf.h"
 #include "core/logging.h"
 #include "core/mastering.h"
+#include "core/resample_cache.h"
 #include "core/uhjfilter.h"
 
 
@@ -33,6 +34,8 @@ ALCdevice::~ALCdevice()
     TRACE("Freeing device %p\n", voidp{this});
 
     Backend = nullptr;
+    /* Stop building resampled copies before the buffers they read go away. */
+    mResampleCache = nullptr;
 
     size_t count{std::accumulate(BufferList.cbegin(), BufferList.cend(), size_t{0u},
         [](size_t cur, const BufferSubList &sublist) noexcept -> size_t
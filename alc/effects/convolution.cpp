@@ -72,10 +72,13 @@ namespace {
  */
 
 
-void LoadSamples(double *RESTRICT dst, const al::byte *src, const size_t srcstep, FmtType srctype,
-    const size_t samples) noexcept
+void LoadSamples(double *RESTRICT dst, const al::byte *src, const size_t srcchan,
+    const size_t srcstep, FmtType srctype, const size_t blockalign, const size_t samples) noexcept
 {
-#define HANDLE_FMT(T)  case T: al::LoadSampleArray<T>(dst, src, srcstep, samples); break
+#define HANDLE_FMT(T)  case T:                                                \
+    al::LoadSampleArray<T>(dst, src + srcchan*sizeof(al::FmtTypeTraits<T>::Type), srcstep, \
+        samples);                                                             \
+    break
     switch(srctype)
     {
     HANDLE_FMT(FmtUByte);
@@ -84,6 +87,15 @@ void LoadSamples(double *RESTRICT dst, const al::byte *src, const size_t srcstep
     HANDLE_FMT(FmtDouble);
     HANDLE_FMT(FmtMulaw);
     HANDLE_FMT(FmtAlaw);
+    HANDLE_FMT(FmtHalf);
+    case FmtIMA4:
+    case FmtMSADPCM:
+        {
+            al::AdpcmState state{};
+            al::LoadAdpcmChannel(dst, src, srctype, srcchan, srcstep, blockalign, 0, samples,
+                state);
+        }
+        break;
     }
 #undef HANDLE_FMT
 }
@@ -261,7 +273,6 @@ void ConvolutionState::deviceUpdate(const DeviceBase *device, const Buffer &buff
     if(!buffer.storage || buffer.storage->mSampleLen < 1) return;
 
     constexpr size_t m{ConvolveUpdateSize/2 + 1};
-    auto bytesPerSample = BytesFromFmt(buffer.storage->mType);
     auto realChannels = ChannelsFromFmt(buffer.storage->mChannels, buffer.storage->mAmbiOrder);
     auto numChannels = ChannelsFromFmt(buffer.storage->mChannels,
         minu(buffer.storage->mAmbiOrder, MaxConvolveAmbiOrder));
@@ -309,8 +320,8 @@ void ConvolutionState::deviceUpdate(const DeviceBase *device, const Buffer &buff
     for(size_t c{0};c < numChannels;++c)
     {
         /* Load the samples from the buffer, and resample to match the device. */
-        LoadSamples(srcsamples.get(), buffer.samples.data() + bytesPerSample*c, realChannels,
-            buffer.storage->mType, buffer.storage->mSampleLen);
+        LoadSamples(srcsamples.get(), buffer.samples.data(), c, realChannels,
+            buffer.storage->mType, buffer.storage->mBlockAlign, buffer.storage->mSampleLen);
         if(device->Frequency != buffer.storage->mSampleRate)
             resampler.process(buffer.storage->mSampleLen, srcsamples.get(), resampledCount,
                 srcsamples.get());
@@ -54,6 +54,97 @@ AL_API void AL_APIENTRY alAuxiliaryEffectSlotStopvSOFT(ALsizei n, const ALuint *
 #define AL_STOP_SOURCES_ON_DISCONNECT_SOFT       0x19AB
 #endif
 
+#ifndef AL_SOFT_source_priority
+#define AL_SOFT_source_priority
+#define AL_SOURCE_PRIORITY_SOFT                  0x19B3
+#define ALC_MAX_REAL_VOICES_SOFT                 0x19B4
+#endif
+
+#ifndef ALC_SOFT_hrtf_voice_limit
+#define ALC_SOFT_hrtf_voice_limit
+#define ALC_MAX_HRTF_VOICES_SOFT                 0x19CA
+#endif
+
+#ifndef ALC_SOFT_mixer_stats
+#define ALC_SOFT_mixer_stats
+/* Each query returns 4 values: the minimum, average, maximum, and 99th
+ * percentile time in nanoseconds, over the device's most recent renders.
+ */
+#define ALC_MIXER_STATS_PARAM_UPDATES_SOFT       0x19B5
+#define ALC_MIXER_STATS_VOICE_MIX_SOFT           0x19B6
+#define ALC_MIXER_STATS_EFFECTS_SOFT             0x19B7
+#define ALC_MIXER_STATS_POST_PROCESS_SOFT        0x19B8
+#define ALC_MIXER_STATS_LIMITER_SOFT             0x19B9
+#define ALC_MIXER_STATS_DISTANCE_COMP_SOFT       0x19BA
+#define ALC_MIXER_STATS_DITHER_SOFT              0x19BB
+#define ALC_MIXER_STATS_WRITE_SOFT               0x19BC
+#define ALC_MIXER_STATS_TOTAL_SOFT               0x19BD
+#endif
+
+#ifndef AL_SOFT_half_float
+#define AL_SOFT_half_float
+#define AL_FORMAT_MONO_HALF_SOFT                 0x19BE
+#define AL_FORMAT_STEREO_HALF_SOFT               0x19BF
+#define AL_FORMAT_QUAD_HALF_SOFT                 0x19C0
+#define AL_FORMAT_51CHN_HALF_SOFT                0x19C1
+#define AL_FORMAT_61CHN_HALF_SOFT                0x19C2
+#define AL_FORMAT_71CHN_HALF_SOFT                0x19C3
+#define AL_FORMAT_BFORMAT2D_HALF_SOFT            0x19C4
+#define AL_FORMAT_BFORMAT3D_HALF_SOFT            0x19C5
+#endif
+
+#ifndef AL_SOFT_buffer_data_static
+#define AL_SOFT_buffer_data_static
+#define AL_BUFFER_RELEASE_FUNCTION_SOFT          0x19C6
+#define AL_BUFFER_RELEASE_USER_PARAM_SOFT        0x19C7
+/* Called once the buffer no longer references the given sample memory, when
+ * it's deleted or given new data. It's called after the AL call that released
+ * the data has unlocked its buffers, so it may make AL calls itself, but it
+ * may be called from an internal thread after alBufferDataAsyncSOFT.
+ */
+typedef void (AL_APIENTRY*ALBUFFERRELEASETYPESOFT)(ALvoid *userptr, const ALvoid *data);
+typedef void (AL_APIENTRY*LPALBUFFERDATASTATICSOFT)(ALuint buffer, ALenum format, const ALvoid *data, ALsizei size, ALsizei freq, ALBUFFERRELEASETYPESOFT release, ALvoid *userptr);
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alBufferDataStaticSOFT(ALuint buffer, ALenum format, const ALvoid *data, ALsizei size, ALsizei freq, ALBUFFERRELEASETYPESOFT release, ALvoid *userptr);
+#endif
+#endif
+
+#ifndef AL_SOFT_callback_buffer_threads
+#define AL_SOFT_callback_buffer_threads
+/* The number of times the mixer ran out of samples read ahead from the
+ * buffer's callback, when callbacks are called from separate threads.
+ */
+#define AL_BUFFER_CALLBACK_UNDERRUNS_SOFT        0x19C8
+#endif
+
+#ifndef AL_SOFT_buffer_refill
+#define AL_SOFT_buffer_refill
+/* Replaces the samples of an unused buffer with new ones of the same format,
+ * in its existing storage. The size may be smaller than the storage, but not
+ * larger, so it never allocates.
+ */
+typedef void (AL_APIENTRY*LPALBUFFERREFILLSOFT)(ALuint buffer, ALenum format, const ALvoid *data, ALsizei size, ALsizei freq);
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alBufferRefillSOFT(ALuint buffer, ALenum format, const ALvoid *data, ALsizei size, ALsizei freq);
+#endif
+#endif
+
+#ifndef AL_SOFT_buffer_data_async
+#define AL_SOFT_buffer_data_async
+/* alBufferDataAsyncSOFT reads the given data after it returns, so the app
+ * must keep it alive and unmodified until the upload finishes. That's when
+ * the buffer's AL_BUFFER_UPLOAD_PENDING_SOFT property reads AL_FALSE, or when
+ * the AL_EVENT_TYPE_BUFFER_UPLOADED_SOFT event is sent. Like other events,
+ * it's delivered from the context's event thread.
+ */
+#define AL_EVENT_TYPE_BUFFER_UPLOADED_SOFT       0x19C9
+#define AL_BUFFER_UPLOAD_PENDING_SOFT            0x19CB
+typedef void (AL_APIENTRY*LPALBUFFERDATAASYNCSOFT)(ALuint buffer, ALenum format, const ALvoid *data, ALsizei size, ALsizei freq);
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alBufferDataAsyncSOFT(ALuint buffer, ALenum format, const ALvoid *data, ALsizei size, ALsizei freq);
+#endif
+#endif
+
 
 /* Non-standard export. Not part of any extension. */
 AL_API const ALchar* AL_APIENTRY alsoft_get_version(void);
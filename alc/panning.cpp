@@ -54,7 +54,9 @@
 #include "core/bs2b.h"
 #include "core/devformat.h"
 #include "core/front_stablizer.h"
+#include "core/hrir_cache.h"
 #include "core/hrtf.h"
+#include "core/hrtf_cache.h"
 #include "core/logging.h"
 #include "core/uhjfilter.h"
 #include "device.h"
@@ -919,6 +921,28 @@ void InitHrtfPanning(ALCdevice *device)
         AmbiOrderHFGain);
     device->mHrtfState = std::move(hrtfstate);
 
+    /* Sources only get their own HRIRs with full HRTF rendering, which can
+     * optionally cache them for nearby directions.
+     */
+    if(device->mRenderMode == RenderMode::Hrtf)
+    {
+        /* Each filter takes about 1KB, and the cache is allocated up front. */
+        constexpr uint MaxHrirCacheSize{16384u};
+        uint cachesize{device->configValue<uint>(nullptr, "hrtf-filter-cache").value_or(0u)};
+        if(cachesize > MaxHrirCacheSize)
+        {
+            WARN("hrtf-filter-cache clamped: %u, max: %u\n", cachesize, MaxHrirCacheSize);
+            cachesize = MaxHrirCacheSize;
+        }
+        if(cachesize > 0)
+        {
+            const float resolution{clampf(device->configValue<float>(nullptr,
+                "hrtf-filter-resolution").value_or(1.0f), 0.1f, 15.0f)};
+            device->mHrirCache = std::make_unique<HrirCache>(cachesize,
+                resolution * (al::numbers::pi_v<float>/180.0f));
+        }
+    }
+
     InitNearFieldCtrl(device, Hrtf->field[0].distance, ambi_order, true);
 }
 
@@ -944,6 +968,7 @@ void aluInitRenderer(ALCdevice *device, int hrtf_id, al::optional<StereoEncoding
     HrtfStorePtr old_hrtf{std::move(device->mHrtf)};
 
     device->mHrtfState = nullptr;
+    device->mHrirCache = nullptr;
     device->mHrtf = nullptr;
     device->mIrSize = 0;
     device->mHrtfName.clear();
@@ -1050,10 +1075,14 @@ void aluInitRenderer(ALCdevice *device, int hrtf_id, al::optional<StereoEncoding
         if(device->mHrtfList.empty())
             device->enumerateHrtfs();
 
+        std::string hrtfcache;
+        if(device->configValue<bool>(nullptr, "hrtf-cache").value_or(false))
+            hrtfcache = device->configValue<std::string>(nullptr, "hrtf-cache-path")
+                .value_or(GetDefaultHrtfCachePath());
         if(hrtf_id >= 0 && static_cast<uint>(hrtf_id) < device->mHrtfList.size())
         {
             const std::string &hrtfname = device->mHrtfList[static_cast<uint>(hrtf_id)];
-            if(HrtfStorePtr hrtf{GetLoadedHrtf(hrtfname, device->Frequency)})
+            if(HrtfStorePtr hrtf{GetLoadedHrtf(hrtfname, device->Frequency, hrtfcache)})
             {
                 device->mHrtf = std::move(hrtf);
                 device->mHrtfName = hrtfname;
@@ -1064,7 +1093,7 @@ void aluInitRenderer(ALCdevice *device, int hrtf_id, al::optional<StereoEncoding
         {
             for(const auto &hrtfname : device->mHrtfList)
             {
-                if(HrtfStorePtr hrtf{GetLoadedHrtf(hrtfname, device->Frequency)})
+                if(HrtfStorePtr hrtf{GetLoadedHrtf(hrtfname, device->Frequency, hrtfcache)})
                 {
                     device->mHrtf = std::move(hrtf);
                     device->mHrtfName = hrtfname;
@@ -1134,12 +1163,15 @@ void aluInitEffectPanning(EffectSlot *slot, ALCcontext *context)
     DeviceBase *device{context->mDevice};
     const size_t count{AmbiChannelsFromOrder(device->mAmbiOrder)};
 
-    slot->mWetBuffer.resize(count);
+    /* Mixer workers each get their own copy of the wet buffer after the main
+     * one, which are added together before the effect is processed.
+     */
+    slot->mWetBuffer.resize(count * (device->mWorkerScratch.size()+1));
 
     auto acnmap_begin = AmbiIndex::FromACN().begin();
     auto iter = std::transform(acnmap_begin, acnmap_begin + count, slot->Wet.AmbiMap.begin(),
         [](const uint8_t &acn) noexcept -> BFChannelConfig
         { return BFChannelConfig{1.0f, acn}; });
     std::fill(iter, slot->Wet.AmbiMap.end(), BFChannelConfig{});
-    slot->Wet.Buffer = slot->mWetBuffer;
+    slot->Wet.Buffer = {slot->mWetBuffer.data(), count};
 }
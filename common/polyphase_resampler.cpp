@@ -169,7 +169,8 @@ void PPhaseResampler::init(const uint srcRate, const uint dstRate)
 
 // Perform the upsample-filter-downsample resampling operation using a
 // polyphase filter implementation.
-void PPhaseResampler::process(const uint inN, const double *in, const uint outN, double *out)
+void PPhaseResampler::process(const uint inN, const double *in, const uint outN,
+    double *out) const
 {
     if UNLIKELY(outN == 0)
         return;
@@ -35,7 +35,7 @@ using uint = unsigned int;
 
 struct PPhaseResampler {
     void init(const uint srcRate, const uint dstRate);
-    void process(const uint inN, const double *in, const uint outN, double *out);
+    void process(const uint inN, const double *in, const uint outN, double *out) const;
 
 private:
     uint mP, mQ, mM, mL;
@@ -41,6 +41,13 @@ public:
             mVals[2] - rhs.mVals[2], mVals[3] - rhs.mVals[3]};
     }
 
+    constexpr bool operator==(const VectorR &rhs) const noexcept
+    {
+        return mVals[0] == rhs.mVals[0] && mVals[1] == rhs.mVals[1]
+            && mVals[2] == rhs.mVals[2] && mVals[3] == rhs.mVals[3];
+    }
+    constexpr bool operator!=(const VectorR &rhs) const noexcept { return !(*this == rhs); }
+
     constexpr T normalize(T limit = std::numeric_limits<T>::epsilon())
     {
         limit = std::max(limit, std::numeric_limits<T>::epsilon());
@@ -94,6 +101,17 @@ public:
     constexpr auto operator[](size_t idx) const noexcept
     { return al::span<const T,4>{&mVals[idx*4], 4}; }
 
+    constexpr bool operator==(const MatrixR &rhs) const noexcept
+    {
+        for(size_t i{0};i < 16;++i)
+        {
+            if(mVals[i] != rhs.mVals[i])
+                return false;
+        }
+        return true;
+    }
+    constexpr bool operator!=(const MatrixR &rhs) const noexcept { return !(*this == rhs); }
+
     static constexpr MatrixR Identity() noexcept
     {
         return MatrixR{
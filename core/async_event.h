@@ -17,6 +17,7 @@ struct AsyncEvent {
         SourceStateChange = 1<<0,
         BufferCompleted   = 1<<1,
         Disconnected      = 1<<2,
+        BufferUploaded    = 1<<3,
 
         /* Internal events. */
         ReleaseEffectState = 65536,
@@ -40,6 +41,9 @@ struct AsyncEvent {
             uint id;
             uint count;
         } bufcomp;
+        struct {
+            uint id;
+        } bufupload;
         struct {
             char msg[244];
         } disconnect;
@@ -16,10 +16,20 @@ uint BytesFromFmt(FmtType type) noexcept
     case FmtDouble: return sizeof(double);
     case FmtMulaw: return sizeof(uint8_t);
     case FmtAlaw: return sizeof(uint8_t);
+    case FmtHalf: return sizeof(uint16_t);
+    case FmtIMA4: break;
+    case FmtMSADPCM: break;
     }
     return 0;
 }
 
+uint BlockSizeFromFmt(FmtType type, uint blockalign, uint channels) noexcept
+{
+    if(type == FmtIMA4) return ((blockalign-1)/2 + 4) * channels;
+    if(type == FmtMSADPCM) return ((blockalign-2)/2 + 7) * channels;
+    return blockalign * BytesFromFmt(type) * channels;
+}
+
 uint ChannelsFromFmt(FmtChannels chans, uint ambiorder) noexcept
 {
     switch(chans)
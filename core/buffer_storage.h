@@ -18,6 +18,9 @@ enum FmtType : unsigned char {
     FmtDouble,
     FmtMulaw,
     FmtAlaw,
+    FmtHalf,
+    FmtIMA4,
+    FmtMSADPCM,
 };
 enum FmtChannels : unsigned char {
     FmtMono,
@@ -51,6 +54,19 @@ uint ChannelsFromFmt(FmtChannels chans, uint ambiorder) noexcept;
 inline uint FrameSizeFromFmt(FmtChannels chans, FmtType type, uint ambiorder) noexcept
 { return ChannelsFromFmt(chans, ambiorder) * BytesFromFmt(type); }
 
+/* ADPCM formats are stored as compressed blocks, which get decoded as they're
+ * used. They don't have a per-sample size.
+ */
+constexpr bool IsAdpcm(FmtType type) noexcept
+{ return type == FmtIMA4 || type == FmtMSADPCM; }
+
+/**
+ * Returns the size in bytes of a block of the given number of sample frames.
+ * For ADPCM formats, the block alignment is the number of sample frames in
+ * each compressed block.
+ */
+uint BlockSizeFromFmt(FmtType type, uint blockalign, uint channels) noexcept;
+
 constexpr bool IsBFormat(FmtChannels chans) noexcept
 { return chans == FmtBFormat2D || chans == FmtBFormat3D; }
 
@@ -83,6 +99,8 @@ struct BufferStorage {
     FmtChannels mChannels{FmtMono};
     FmtType mType{FmtShort};
     uint mSampleLen{0u};
+    /* Sample frames per block. Only ADPCM formats have more than 1. */
+    uint mBlockAlign{1u};
 
     AmbiLayout mAmbiLayout{AmbiLayout::FuMa};
     AmbiScaling mAmbiScaling{AmbiScaling::FuMa};
@@ -92,8 +110,11 @@ struct BufferStorage {
     inline uint channelsFromFmt() const noexcept
     { return ChannelsFromFmt(mChannels, mAmbiOrder); }
     inline uint frameSizeFromFmt() const noexcept { return channelsFromFmt() * bytesFromFmt(); }
+    inline uint blockSizeFromFmt() const noexcept
+    { return BlockSizeFromFmt(mType, mBlockAlign, channelsFromFmt()); }
 
     inline bool isBFormat() const noexcept { return IsBFormat(mChannels); }
+    inline bool isAdpcm() const noexcept { return IsAdpcm(mType); }
 };
 
 #endif /* CORE_BUFFER_STORAGE_H */
@@ -0,0 +1,244 @@
+#include "config.h"
+
+#include "callback_stream.h"
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+
+#include "device.h"
+#include "logging.h"
+
+
+namespace {
+
+/* How far the device's mix count needs to get past the count taken once the
+ * voice changes for a stream's start were sent, before a voice stopped by
+ * them is done reading the ring it had. The count is odd while mixing. From
+ * an even count, the next mix (+1 to +2) handles the changes, and the old
+ * voice fades out during it. From an odd count, the mix in progress may have
+ * handled changes before they were sent, so it's the one after (+2 to +3).
+ */
+constexpr uint RetiredRingMixes{3u};
+
+} // namespace
+
+
+CallbackStream::CallbackStream(CallbackStreamer &streamer, CallbackType callback, void *userdata,
+    size_t frames, size_t framesize, size_t refillsize)
+    : mStreamer{streamer}, mCallback{callback}, mUserData{userdata}, mRingFrames{frames}
+    , mFrameSize{framesize}, mRefillSize{refillsize}
+{ }
+
+CallbackStream::~CallbackStream()
+{ mStreamer.remove(this); }
+
+void CallbackStream::consumed(const RingBuffer *ring) noexcept
+{
+    if(!mEnded.load(std::memory_order_relaxed) && ring->writeSpace() >= mRefillSize)
+        mStreamer.wake();
+}
+
+
+CallbackStreamer::~CallbackStreamer()
+{
+    mKillNow.store(true, std::memory_order_release);
+    for(size_t i{0};i < mThreads.size();++i)
+        mSem.post();
+    for(auto &thread : mThreads)
+    {
+        if(thread.joinable())
+            thread.join();
+    }
+}
+
+
+bool CallbackStreamer::fill(CallbackStream *stream, RingBuffer *ring)
+{
+    const size_t framesize{ring->getElemSize()};
+
+    const auto data = ring->getWriteVector();
+    for(const auto &segment : {data.first, data.second})
+    {
+        if(segment.len == 0)
+            break;
+
+        const size_t needBytes{segment.len * framesize};
+        const int gotBytes{stream->mCallback(stream->mUserData, segment.buf,
+            static_cast<int>(needBytes))};
+        if(gotBytes < 0)
+            return true;
+
+        ring->writeAdvance(static_cast<uint>(gotBytes) / framesize);
+        if(static_cast<uint>(gotBytes) < needBytes)
+            return true;
+    }
+    return false;
+}
+
+CallbackStream *CallbackStreamer::getRefillStream() noexcept
+{
+    auto needs_refill = [](CallbackStream *stream) noexcept -> bool
+    {
+        return !stream->mFillRing && !stream->mEnded.load(std::memory_order_acquire)
+            && stream->mRing->writeSpace() >= stream->mRefillSize;
+    };
+    auto iter = std::find_if(mStreams.begin(), mStreams.end(), needs_refill);
+    return (iter != mStreams.end()) ? *iter : nullptr;
+}
+
+void CallbackStreamer::threadProc()
+{
+    althrd_setname(CALLBACK_THREAD_NAME);
+
+    while(true)
+    {
+        mSem.wait();
+        if(mKillNow.load(std::memory_order_acquire))
+            break;
+
+        std::unique_lock<std::mutex> lock{mLock};
+        while(CallbackStream *stream{getRefillStream()})
+        {
+            RingBuffer *ring{stream->mRing.get()};
+            stream->mFillRing = ring;
+            lock.unlock();
+
+            const bool ended{fill(stream, ring)};
+
+            lock.lock();
+            stream->mFillRing = nullptr;
+            mFilledCond.notify_all();
+
+            /* The end is flagged after writing the last samples, so the mixer
+             * sees all of them once it sees the end. If the stream restarted
+             * while this was filling, the end was for the replaced ring.
+             */
+            if(ended && stream->mRing.get() == ring)
+                stream->mEnded.store(true, std::memory_order_release);
+
+            const uint underruns{stream->mUnderruns.load(std::memory_order_relaxed)};
+            if(underruns != stream->mReportedUnderruns)
+            {
+                WARN("Buffer callback %p fell behind the mixer (%u underrun%s)\n",
+                    reinterpret_cast<void*>(stream->mCallback), underruns,
+                    (underruns == 1) ? "" : "s");
+                stream->mReportedUnderruns = underruns;
+            }
+        }
+    }
+}
+
+
+std::unique_ptr<CallbackStream> CallbackStreamer::createStream(CallbackType callback,
+    void *userdata, const size_t frames, const size_t framesize)
+{
+    /* Refill once half the requested frames are free, so each callback gets a
+     * reasonably sized chunk to fill.
+     */
+    return std::make_unique<CallbackStream>(*this, callback, userdata, frames, framesize,
+        frames/2);
+}
+
+RingBuffer *CallbackStreamer::start(CallbackStream *stream)
+{
+    std::lock_guard<std::mutex> _{mLock};
+
+    /* A voice that played the stream may still be reading the current ring,
+     * so set it aside and fill another. Retired rings can be reused once the
+     * device has mixed past the changes stopping their voices, and no callback
+     * thread is still finishing a fill of them.
+     */
+    if(stream->mRing)
+        stream->mRetiredRings.emplace_back(
+            CallbackStream::RetiredRing{std::move(stream->mRing), 0u, false});
+    const uint mixcount{mDevice.MixCount.load(std::memory_order_acquire)};
+    auto is_unused = [stream,mixcount](const CallbackStream::RetiredRing &retired) noexcept
+    {
+        return retired.mChangesSent && mixcount-retired.mMixCount >= RetiredRingMixes
+            && retired.mRing.get() != stream->mFillRing;
+    };
+    auto unused = std::find_if(stream->mRetiredRings.begin(), stream->mRetiredRings.end(),
+        is_unused);
+    if(unused != stream->mRetiredRings.end())
+    {
+        stream->mRing = std::move(unused->mRing);
+        stream->mRing->reset();
+    }
+    else
+        stream->mRing = RingBuffer::Create(stream->mRingFrames, stream->mFrameSize, false);
+    stream->mRetiredRings.erase(std::remove_if(stream->mRetiredRings.begin(),
+        stream->mRetiredRings.end(), is_unused), stream->mRetiredRings.end());
+
+    stream->mEnded.store(false, std::memory_order_relaxed);
+    if(!stream->mActive)
+    {
+        mStreams.emplace_back(stream);
+        stream->mActive = true;
+    }
+    /* The voice waits for a callback thread to fill the new ring. */
+    mSem.post();
+
+    return stream->mRing.get();
+}
+
+void CallbackStreamer::changesSent(CallbackStream *stream)
+{
+    std::lock_guard<std::mutex> _{mLock};
+    const uint mixcount{mDevice.MixCount.load(std::memory_order_acquire)};
+    for(CallbackStream::RetiredRing &retired : stream->mRetiredRings)
+    {
+        if(!retired.mChangesSent)
+        {
+            retired.mMixCount = mixcount;
+            retired.mChangesSent = true;
+        }
+    }
+}
+
+void CallbackStreamer::stop(CallbackStream *stream)
+{
+    std::lock_guard<std::mutex> _{mLock};
+    if(stream->mActive)
+    {
+        mStreams.erase(std::find(mStreams.begin(), mStreams.end(), stream));
+        stream->mActive = false;
+    }
+}
+
+void CallbackStreamer::remove(CallbackStream *stream)
+{
+    std::unique_lock<std::mutex> lock{mLock};
+    mFilledCond.wait(lock, [stream]() noexcept { return !stream->mFillRing; });
+
+    if(stream->mActive)
+    {
+        mStreams.erase(std::find(mStreams.begin(), mStreams.end(), stream));
+        stream->mActive = false;
+    }
+}
+
+
+std::unique_ptr<CallbackStreamer> CallbackStreamer::Create(const DeviceBase &device,
+    const uint numthreads)
+{
+    std::unique_ptr<CallbackStreamer> streamer{new CallbackStreamer{device}};
+    streamer->mThreads.reserve(numthreads);
+    for(uint i{0u};i < numthreads;++i)
+    {
+        try {
+            streamer->mThreads.emplace_back(std::mem_fn(&CallbackStreamer::threadProc),
+                streamer.get());
+        }
+        catch(std::exception& e) {
+            ERR("Failed to start %s thread: %s\n", CALLBACK_THREAD_NAME, e.what());
+            break;
+        }
+    }
+    if(streamer->mThreads.empty())
+        return nullptr;
+
+    TRACE("Started %zu %s thread%s\n", streamer->mThreads.size(), CALLBACK_THREAD_NAME,
+        (streamer->mThreads.size() == 1) ? "" : "s");
+    return streamer;
+}
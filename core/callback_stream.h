@@ -0,0 +1,167 @@
+#ifndef CORE_CALLBACK_STREAM_H
+#define CORE_CALLBACK_STREAM_H
+
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "almalloc.h"
+#include "buffer_storage.h"
+#include "ringbuffer.h"
+#include "threads.h"
+#include "vector.h"
+
+using uint = unsigned int;
+
+class CallbackStreamer;
+struct DeviceBase;
+
+
+/* Sample frames read ahead from a buffer callback by the device's callback
+ * threads, so a slow callback can't hold up the mixer. The mixer reads the
+ * frames straight out of a ring buffer, and wakes the threads to refill it as
+ * it's consumed. Each start fills a different ring than the one a previous
+ * voice may still be reading. The callback is only ever called from the
+ * callback threads.
+ */
+struct CallbackStream {
+    CallbackStreamer &mStreamer;
+
+    const CallbackType mCallback;
+    void *const mUserData;
+
+    const size_t mRingFrames;
+    const size_t mFrameSize;
+    /* How much space needs to be free in the ring before refilling it. */
+    const size_t mRefillSize;
+
+    /* Set once the callback stops providing samples. */
+    std::atomic<bool> mEnded{false};
+    /* Counts each mix that ran short of samples while the callback was still
+     * providing them.
+     */
+    std::atomic<uint> mUnderruns{0u};
+
+    /* A ring filled before the stream last started. A voice stopping from
+     * before then may still be reading it, until the device has mixed past
+     * the voice changes for the start.
+     */
+    struct RetiredRing {
+        RingBufferPtr mRing;
+        /* The device's mix count once the voice changes were sent. */
+        uint mMixCount;
+        bool mChangesSent;
+    };
+
+    /* Accessed by the streamer, with its lock held. The ring being filled is
+     * also written by the callback thread filling it.
+     */
+    RingBufferPtr mRing;
+    RingBuffer *mFillRing{nullptr};
+    bool mActive{false};
+    uint mReportedUnderruns{0u};
+    al::vector<RetiredRing> mRetiredRings;
+
+    CallbackStream(CallbackStreamer &streamer, CallbackType callback, void *userdata,
+        size_t frames, size_t framesize, size_t refillsize);
+    CallbackStream(const CallbackStream&) = delete;
+    CallbackStream& operator=(const CallbackStream&) = delete;
+    ~CallbackStream();
+
+    /**
+     * Wakes the streamer if the voice's ring has room to refill. Mixer-safe.
+     */
+    void consumed(const RingBuffer *ring) noexcept;
+
+    DEF_NEWDEL(CallbackStream)
+};
+
+
+/* A set of threads that keep the active callback streams filled. */
+class CallbackStreamer {
+    const DeviceBase &mDevice;
+    al::vector<std::thread> mThreads;
+
+    al::semaphore mSem;
+    std::mutex mLock;
+    std::condition_variable mFilledCond;
+    al::vector<CallbackStream*> mStreams;
+    std::atomic<bool> mKillNow{false};
+
+    void threadProc();
+
+    /* Fills the given ring buffer from the stream's callback. Returns true if
+     * the callback ended.
+     */
+    static bool fill(CallbackStream *stream, RingBuffer *ring);
+
+    /* Returns an active stream that needs refilling and isn't being refilled
+     * by another thread. The lock must be held.
+     */
+    CallbackStream *getRefillStream() noexcept;
+
+    CallbackStreamer(const DeviceBase &device) : mDevice{device} { }
+
+    friend CallbackStream;
+
+public:
+    ~CallbackStreamer();
+
+    CallbackStreamer(const CallbackStreamer&) = delete;
+    CallbackStreamer& operator=(const CallbackStreamer&) = delete;
+
+    /**
+     * Creates an inactive stream for the given callback, able to read ahead
+     * the given number of sample frames.
+     */
+    std::unique_ptr<CallbackStream> createStream(CallbackType callback, void *userdata,
+        const size_t frames, const size_t framesize);
+
+    /**
+     * Discards anything read ahead by the stream, and wakes the callback
+     * threads to fill it and keep it filled. Returns the ring the new voice
+     * should read, which is empty until a callback thread first fills it. A
+     * voice that was reading from the stream may keep reading its ring until
+     * the voice changes stopping it are sent and mixed; the ring isn't
+     * touched until then. Doesn't wait on the callback.
+     */
+    RingBuffer *start(CallbackStream *stream);
+
+    /**
+     * Marks the voice changes for the stream's last start as sent to the
+     * mixer, so the rings the start replaced can be reused once the device
+     * has mixed past them.
+     */
+    void changesSent(CallbackStream *stream);
+
+    /**
+     * Stops refilling the stream. The callback won't be called for the stream
+     * again until it's restarted, except by a refill already in progress.
+     */
+    void stop(CallbackStream *stream);
+
+    /**
+     * Stops refilling the stream, waiting for any refill in progress, before
+     * it's destroyed.
+     */
+    void remove(CallbackStream *stream);
+
+    /** Wakes a callback thread to refill streams. Mixer-safe. */
+    void wake() noexcept { mSem.post(); }
+
+    /**
+     * Creates a streamer with the given number of threads. Returns null if no
+     * threads could be started.
+     */
+    static std::unique_ptr<CallbackStreamer> Create(const DeviceBase &device,
+        const uint numthreads);
+
+    DEF_NEWDEL(CallbackStreamer)
+};
+
+#endif /* CORE_CALLBACK_STREAM_H */
@@ -3,6 +3,7 @@
 
 #include <memory>
 
+#include "almalloc.h"
 #include "async_event.h"
 #include "context.h"
 #include "device.h"
@@ -52,10 +53,12 @@ ContextBase::~ContextBase()
 
     delete mVoices.exchange(nullptr, std::memory_order_relaxed);
 
-    if(mAsyncEvents)
+    for(RingBuffer *ring : {mAsyncEvents.get(), mThreadEvents.get()})
     {
+        if(!ring) continue;
+
         count = 0;
-        auto evt_vec = mAsyncEvents->getReadVector();
+        auto evt_vec = ring->getReadVector();
         if(evt_vec.first.len > 0)
         {
             al::destroy_n(reinterpret_cast<AsyncEvent*>(evt_vec.first.buf), evt_vec.first.len);
@@ -68,7 +71,7 @@ ContextBase::~ContextBase()
         }
         if(count > 0)
             TRACE("Destructed %zu orphaned event%s\n", count, (count==1)?"":"s");
-        mAsyncEvents->readAdvance(count);
+        ring->readAdvance(count);
     }
 }
 
@@ -116,7 +119,12 @@ void ContextBase::allocVoices(size_t addcount)
     const size_t totalcount{(mVoiceClusters.size()+addcount) * clustersize};
     TRACE("Increasing allocated voices to %zu\n", totalcount);
 
-    auto newarray = VoiceArray::Create(totalcount);
+    /* Allocate space for twice as many pointers, so the mixer has scratch
+     * space to store the list of voices to mix.
+     */
+    void *ptr{al_calloc(alignof(VoiceArray), VoiceArray::Sizeof(totalcount*2))};
+    std::unique_ptr<VoiceArray> newarray{al::construct_at(static_cast<VoiceArray*>(ptr),
+        totalcount)};
     while(addcount)
     {
         mVoiceClusters.emplace_back(std::make_unique<Voice[]>(clustersize));
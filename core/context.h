@@ -5,6 +5,7 @@
 #include <atomic>
 #include <cstddef>
 #include <memory>
+#include <mutex>
 #include <thread>
 
 #include "almalloc.h"
@@ -91,6 +92,19 @@ struct ContextBase {
 
     float mGainBoost{1.0f};
 
+    /* The maximum number of voices to mix at once, or 0 for no limit. Beyond
+     * this, the voices with the lowest priority and audibility are
+     * virtualized.
+     */
+    uint mMaxRealVoices{0u};
+
+    /* The maximum number of voices to render with their own HRIRs, or 0 for
+     * no limit. Beyond this, the voices with the lowest priority and
+     * audibility are panned to the ambisonic mix, which has its HRTF applied
+     * once for all of them.
+     */
+    uint mMaxHrtfVoices{0u};
+
     /* Linked lists of unused property containers, free to use for future
      * updates.
      */
@@ -112,6 +126,9 @@ struct ContextBase {
 
     ContextParams mParams;
 
+    /* The voice array has extra storage after the end, which the mixer uses
+     * to hold the list of voices it's mixing.
+     */
     using VoiceArray = al::FlexArray<Voice*>;
     std::atomic<VoiceArray*> mVoices{};
     std::atomic<size_t> mActiveVoiceCount{};
@@ -135,6 +152,11 @@ struct ContextBase {
     std::thread mEventThread;
     al::semaphore mEventSem;
     std::unique_ptr<RingBuffer> mAsyncEvents;
+    /* Events from threads other than the mixer, such as buffer uploads. The
+     * writers hold the lock, so the ring has one writer at a time.
+     */
+    std::mutex mThreadEventLock;
+    std::unique_ptr<RingBuffer> mThreadEvents;
     std::atomic<uint> mEnabledEvts{0u};
 
     /* Asynchronous voice change actions are processed as a linked list of
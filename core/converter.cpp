@@ -20,8 +20,6 @@ struct CopyTag;
 
 namespace {
 
-constexpr uint MaxPitch{10};
-
 static_assert((BufferLineSize-1)/MaxPitch > 0, "MaxPitch is too large for BufferLineSize!");
 static_assert((INT_MAX>>MixerFracBits)/MaxPitch > BufferLineSize,
     "MaxPitch and/or BufferLineSize are too large for MixerFracBits!");
@@ -35,6 +35,19 @@ inline std::array<reg_type,4> get_cpuid(unsigned int f)
     __get_cpuid(f, &ret[0], &ret[1], &ret[2], &ret[3]);
     return ret;
 }
+inline std::array<reg_type,4> get_cpuid_count(unsigned int f, unsigned int sub)
+{
+    std::array<reg_type,4> ret{};
+    __cpuid_count(f, sub, ret[0], ret[1], ret[2], ret[3]);
+    return ret;
+}
+inline unsigned long long get_xcr0()
+{
+    /* xgetbv, encoded directly for assemblers that don't know it. */
+    unsigned int eax, edx;
+    __asm__ volatile(".byte 0x0f, 0x01, 0xd0" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx)<<32) | eax;
+}
 #define CAN_GET_CPUID
 #elif defined(HAVE_CPUID_INTRINSIC) \
     && (defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64))
@@ -45,6 +58,14 @@ inline std::array<reg_type,4> get_cpuid(unsigned int f)
     (__cpuid)(ret.data(), f);
     return ret;
 }
+inline std::array<reg_type,4> get_cpuid_count(unsigned int f, unsigned int sub)
+{
+    std::array<reg_type,4> ret{};
+    (__cpuidex)(ret.data(), static_cast<int>(f), static_cast<int>(sub));
+    return ret;
+}
+inline unsigned long long get_xcr0()
+{ return _xgetbv(0); }
 #define CAN_GET_CPUID
 #endif
 
@@ -105,12 +126,31 @@ al::optional<CPUInfo> GetCPUInfo()
             ret.mCaps |= CPU_CAP_SSE3;
         if((ret.mCaps&CPU_CAP_SSE3) && (cpuregs[2]&(1<<19)))
             ret.mCaps |= CPU_CAP_SSE4_1;
+
+        /* AVX2 needs the CPU to support AVX, FMA, and F16C (every AVX2 CPU
+         * has them), and the OS to save the YMM registers on context switches
+         * (OSXSAVE set, with the SSE and AVX state bits enabled in XCR0).
+         */
+        const bool has_fma{(cpuregs[2]&(1<<12)) != 0};
+        const bool has_osxsave{(cpuregs[2]&(1<<27)) != 0};
+        const bool has_avx{(cpuregs[2]&(1<<28)) != 0};
+        const bool has_f16c{(cpuregs[2]&(1<<29)) != 0};
+        if((ret.mCaps&CPU_CAP_SSE4_1) && has_fma && has_osxsave && has_avx && has_f16c
+            && (get_xcr0()&0x6) == 0x6 && maxfunc >= 7)
+        {
+            cpuregs = get_cpuid_count(7, 0);
+            if((cpuregs[1]&(1<<5)))
+                ret.mCaps |= CPU_CAP_AVX2;
+        }
     }
 
 #else
 
     /* Assume support for whatever's supported if we can't check for it */
-#if defined(HAVE_SSE4_1)
+#if defined(HAVE_AVX2) && defined(__AVX2__) && defined(__FMA__) && defined(__F16C__)
+    /* Only assume AVX2 if the compiler is already allowed to use it. */
+    ret.mCaps |= CPU_CAP_SSE | CPU_CAP_SSE2 | CPU_CAP_SSE3 | CPU_CAP_SSE4_1 | CPU_CAP_AVX2;
+#elif defined(HAVE_SSE4_1)
 #warning "Assuming SSE 4.1 run-time support!"
     ret.mCaps |= CPU_CAP_SSE | CPU_CAP_SSE2 | CPU_CAP_SSE3 | CPU_CAP_SSE4_1;
 #elif defined(HAVE_SSE3)
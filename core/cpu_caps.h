@@ -13,6 +13,7 @@ enum {
     CPU_CAP_SSE3   = 1<<2,
     CPU_CAP_SSE4_1 = 1<<3,
     CPU_CAP_NEON   = 1<<4,
+    CPU_CAP_AVX2   = 1<<5, /* Also implies FMA and F16C support. */
 };
 
 struct CPUInfo {
@@ -3,10 +3,14 @@
 
 #include "bformatdec.h"
 #include "bs2b.h"
+#include "callback_stream.h"
 #include "device.h"
 #include "front_stablizer.h"
+#include "hrir_cache.h"
 #include "hrtf.h"
 #include "mastering.h"
+#include "resample_cache.h"
+#include "worker_pool.h"
 
 
 al::FlexArray<ContextBase*> DeviceBase::sEmptyContextArray{0u};
@@ -18,6 +18,7 @@
 #include "bufferline.h"
 #include "devformat.h"
 #include "filters/nfc.h"
+#include "mixer_stats.h"
 #include "intrusive_ptr.h"
 #include "mixer/hrtfdefs.h"
 #include "opthelpers.h"
@@ -27,10 +28,14 @@
 
 class BFormatDec;
 struct bs2b;
+class CallbackStreamer;
+class ResampleCache;
 struct Compressor;
 struct ContextBase;
 struct DirectHrtfState;
+class HrirCache;
 struct HrtfStore;
+class WorkerPool;
 
 using uint = unsigned int;
 
@@ -42,6 +47,8 @@ using uint = unsigned int;
 #define DEFAULT_UPDATE_SIZE  960 /* 20ms */
 #define DEFAULT_NUM_UPDATES  3
 
+#define MAX_SENDS  6
+
 
 enum class DeviceType : unsigned char {
     Playback,
@@ -136,6 +143,44 @@ enum {
     DeviceFlagsCount
 };
 
+/* Temp storage used by a thread to mix voices. */
+struct MixerScratch {
+    static constexpr size_t MixerLineSize{BufferLineSize + MaxResamplerPadding +
+        DecoderBase::sMaxDelay};
+    static constexpr size_t MixerChannelsMax{16};
+    using MixerBufferLine = std::array<float,MixerLineSize>;
+    alignas(16) std::array<MixerBufferLine,MixerChannelsMax> mSampleData;
+
+    /* Voice channels are resampled and filtered in groups, so the filters
+     * for each group's dry and send paths can be processed together. There's
+     * a filter line for the dry path and each send (up to MAX_SENDS) of each
+     * channel in a group.
+     */
+    static constexpr size_t MixerChannelGroupSize{2};
+    static constexpr size_t MixerFilterLinesMax{MixerChannelGroupSize * (1+MAX_SENDS)};
+    alignas(16) std::array<FloatBufferLine,MixerChannelGroupSize> ResampledData;
+    alignas(16) std::array<FloatBufferLine,MixerFilterLinesMax> FilteredData;
+    union {
+        alignas(16) float HrtfSourceData[BufferLineSize + HrtfHistoryLength];
+        alignas(16) float NfcSampleData[BufferLineSize];
+    };
+
+    /* Storage for HRTF mixing. This is persistent for the device's own
+     * scratch, while mixer workers accumulate each update into their own and
+     * add it to the device's.
+     */
+    alignas(16) float2 HrtfAccumData[BufferLineSize + HrirLength];
+
+    /* Index of the mixer worker using this storage, with 0 being the device's
+     * own. Workers other than 0 mix into mMixBuffer instead of the device's
+     * MixBuffer, and into their own copy of each effect slot's wet buffer.
+     */
+    uint mWorkerIdx{0u};
+    al::vector<FloatBufferLine, 16> mMixBuffer;
+
+    DEF_NEWDEL(MixerScratch)
+};
+
 struct DeviceBase {
     /* To avoid extraneous allocations, a 0-sized FlexArray<ContextBase*> is
      * defined globally as a sharable object.
@@ -179,6 +224,11 @@ struct DeviceBase {
      */
     NfcFilter mNFCtrlFilter{};
 
+    /* Voices with gains below this on every output are virtualized, skipping
+     * mixing and only advancing their playback position. 0 disables it.
+     */
+    float mVirtualVoiceGain{0.0f};
+
     uint SamplesDone{0u};
     std::chrono::nanoseconds ClockBase{0};
     std::chrono::nanoseconds FixedLatency{0};
@@ -186,21 +236,19 @@ struct DeviceBase {
     AmbiRotateMatrix mAmbiRotateMatrix{};
 
     /* Temp storage used for mixer processing. */
-    static constexpr size_t MixerLineSize{BufferLineSize + MaxResamplerPadding +
-        DecoderBase::sMaxDelay};
-    static constexpr size_t MixerChannelsMax{16};
-    using MixerBufferLine = std::array<float,MixerLineSize>;
-    alignas(16) std::array<MixerBufferLine,MixerChannelsMax> mSampleData;
+    MixerScratch mMixerScratch;
 
-    alignas(16) float ResampledData[BufferLineSize];
-    alignas(16) float FilteredData[BufferLineSize];
-    union {
-        alignas(16) float HrtfSourceData[BufferLineSize + HrtfHistoryLength];
-        alignas(16) float NfcSampleData[BufferLineSize];
-    };
+    /* Optional threads to mix voices with, along with a separate set of temp
+     * storage for each extra thread.
+     */
+    std::unique_ptr<WorkerPool> mMixerPool;
+    al::vector<std::unique_ptr<MixerScratch>> mWorkerScratch;
 
-    /* Persistent storage for HRTF mixing. */
-    alignas(16) float2 HrtfAccumData[BufferLineSize + HrirLength];
+    /* Optional threads to call buffer callbacks ahead of the mixer. */
+    std::unique_ptr<CallbackStreamer> mCallbackStreamer;
+
+    /* Optional cache of static buffers resampled to the device rate. */
+    std::unique_ptr<ResampleCache> mResampleCache;
 
     /* Mixing buffer used by the Dry mix and Real output. */
     al::vector<FloatBufferLine, 16> MixBuffer;
@@ -219,6 +267,9 @@ struct DeviceBase {
     al::intrusive_ptr<HrtfStore> mHrtf;
     uint mIrSize{0};
 
+    /* Optional cache of HRIRs blended for the mixer's recent directions. */
+    std::unique_ptr<HrirCache> mHrirCache;
+
     /* Ambisonic-to-UHJ encoder */
     std::unique_ptr<UhjEncoderBase> mUhjEncoder;
 
@@ -247,6 +298,9 @@ struct DeviceBase {
      */
     RefCount MixCount{0u};
 
+    /* Rolling timing statistics for the mixer's render stages. */
+    MixerStats mMixerStats;
+
     // Contexts created on this device
     std::atomic<al::FlexArray<ContextBase*>*> mContexts{nullptr};
 
@@ -298,13 +352,18 @@ struct DeviceBase {
     DISABLE_ALLOC()
 
 private:
-    uint renderSamples(const uint numSamples);
+    uint renderSamples(const uint numSamples, MixerStats::Timer &timer);
 };
 
 
 /* Must be less than 15 characters (16 including terminating null) for
  * compatibility with pthread_setname_np limitations. */
 #define MIXER_THREAD_NAME "alsoft-mixer"
+#define MIXER_WORKER_THREAD_NAME "alsoft-mixwork"
+#define CALLBACK_THREAD_NAME "alsoft-callback"
+#define UPLOAD_THREAD_NAME "alsoft-upload"
+#define RESAMPLE_THREAD_NAME "alsoft-resamp"
+#define POLYPHASE_THREAD_NAME "alsoft-polytab"
 
 #define RECORD_THREAD_NAME "alsoft-record"
 
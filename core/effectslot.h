@@ -77,7 +77,15 @@ struct EffectSlot {
     bool DecayHFLimit{false};
     float AirAbsorptionGainHF{1.0f};
 
-    /* Mixing buffer used by the Wet mix. */
+    /* Set by the mixer when the last update changed something the sources
+     * sending to this slot depend on (its type, auto-send flag, or the reverb
+     * properties above), so only those sources get recalculated.
+     */
+    bool mSendParamsChanged{false};
+
+    /* Mixing buffer used by the Wet mix. Wet.Buffer references the start of
+     * it, and it holds an extra copy of the same size for each mixer worker.
+     */
     al::vector<FloatBufferLine,16> mWetBuffer;
 
 
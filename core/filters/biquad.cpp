@@ -160,5 +160,45 @@ void BiquadFilterR<Real>::dualProcess(BiquadFilterR &other, const al::span<const
     other.mZ2 = z12;
 }
 
+template<typename Real>
+void BiquadFilterR<Real>::parallelProcess(BiquadFilterR &other, const al::span<const Real> src,
+    Real *dst, const Real *othersrc, Real *otherdst)
+{
+    const Real b00{mB0};
+    const Real b01{mB1};
+    const Real b02{mB2};
+    const Real a01{mA1};
+    const Real a02{mA2};
+    const Real b10{other.mB0};
+    const Real b11{other.mB1};
+    const Real b12{other.mB2};
+    const Real a11{other.mA1};
+    const Real a12{other.mA2};
+    Real z01{mZ1};
+    Real z02{mZ2};
+    Real z11{other.mZ1};
+    Real z12{other.mZ2};
+
+    for(const Real input0 : src)
+    {
+        const Real input1{*(othersrc++)};
+
+        const Real output0{input0*b00 + z01};
+        const Real output1{input1*b10 + z11};
+        z01 = input0*b01 - output0*a01 + z02;
+        z11 = input1*b11 - output1*a11 + z12;
+        z02 = input0*b02 - output0*a02;
+        z12 = input1*b12 - output1*a12;
+
+        *(dst++) = output0;
+        *(otherdst++) = output1;
+    }
+
+    mZ1 = z01;
+    mZ2 = z02;
+    other.mZ1 = z11;
+    other.mZ2 = z12;
+}
+
 template class BiquadFilterR<float>;
 template class BiquadFilterR<double>;
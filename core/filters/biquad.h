@@ -126,6 +126,14 @@ public:
     void process(const al::span<const Real> src, Real *dst);
     /** Processes this filter and the other at the same time. */
     void dualProcess(BiquadFilterR &other, const al::span<const Real> src, Real *dst);
+    /**
+     * Processes this filter and the other side by side, each with their own
+     * input and output. Each output sample depends on the previous one, so
+     * running two independent filters together lets their calculations
+     * overlap, taking about as long as one filter alone.
+     */
+    void parallelProcess(BiquadFilterR &other, const al::span<const Real> src, Real *dst,
+        const Real *othersrc, Real *otherdst);
 
     /* Rather hacky. It's just here to support "manual" processing. */
     std::pair<Real,Real> getComponents() const noexcept { return {mZ1, mZ2}; }
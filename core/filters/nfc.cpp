@@ -4,6 +4,7 @@
 #include "nfc.h"
 
 #include <algorithm>
+#include <iterator>
 
 #include "opthelpers.h"
 
@@ -261,6 +262,14 @@ void NfcFilter::adjust(const float w0) noexcept
     NfcFilterAdjust4(&fourth, w0);
 }
 
+void NfcFilter::clear() noexcept
+{
+    std::fill(std::begin(first.z), std::end(first.z), 0.0f);
+    std::fill(std::begin(second.z), std::end(second.z), 0.0f);
+    std::fill(std::begin(third.z), std::end(third.z), 0.0f);
+    std::fill(std::begin(fourth.z), std::end(fourth.z), 0.0f);
+}
+
 
 void NfcFilter::process1(const al::span<const float> src, float *RESTRICT dst)
 {
@@ -46,6 +46,8 @@ public:
 
     void init(const float w1) noexcept;
     void adjust(const float w0) noexcept;
+    /* Clears the filter history, keeping the coefficients. */
+    void clear() noexcept;
 
     /* Near-field control filter for first-order ambisonic channels (1-3). */
     void process1(const al::span<const float> src, float *RESTRICT dst);
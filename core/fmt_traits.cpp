@@ -3,6 +3,8 @@
 
 #include "fmt_traits.h"
 
+#include "alnumeric.h"
+
 
 namespace al {
 
@@ -76,4 +78,212 @@ const int16_t aLawDecompressionTable[256] = {
        944,   912,  1008,   976,   816,   784,   880,   848
 };
 
+/* IMA ADPCM Stepsize table */
+const int IMAStep_size[89] = {
+       7,    8,    9,   10,   11,   12,   13,   14,   16,   17,   19,
+      21,   23,   25,   28,   31,   34,   37,   41,   45,   50,   55,
+      60,   66,   73,   80,   88,   97,  107,  118,  130,  143,  157,
+     173,  190,  209,  230,  253,  279,  307,  337,  371,  408,  449,
+     494,  544,  598,  658,  724,  796,  876,  963, 1060, 1166, 1282,
+    1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660,
+    4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493,10442,
+   11487,12635,13899,15289,16818,18500,20350,22358,24633,27086,29794,
+   32767
+};
+
+/* IMA4 ADPCM Codeword decode table */
+const int IMA4Codeword[16] = {
+    1, 3, 5, 7, 9, 11, 13, 15,
+   -1,-3,-5,-7,-9,-11,-13,-15,
+};
+
+/* IMA4 ADPCM Step index adjust decode table */
+const int IMA4Index_adjust[16] = {
+   -1,-1,-1,-1, 2, 4, 6, 8,
+   -1,-1,-1,-1, 2, 4, 6, 8
+};
+
+
+/* MSADPCM Adaption table */
+const int MSADPCMAdaption[16] = {
+    230, 230, 230, 230, 307, 409, 512, 614,
+    768, 614, 512, 409, 307, 230, 230, 230
+};
+
+/* MSADPCM Adaption Coefficient tables */
+const int MSADPCMAdaptionCoeff[7][2] = {
+    { 256,    0 },
+    { 512, -256 },
+    {   0,    0 },
+    { 192,   64 },
+    { 240,    0 },
+    { 460, -208 },
+    { 392, -232 }
+};
+
+
+namespace {
+
+template<typename DstT>
+void DecodeIMA4Channel(DstT *RESTRICT dst, const al::byte *src, const size_t chan,
+    const size_t numchans, const size_t blockalign, const size_t srcOffset, const size_t samples,
+    AdpcmState &state) noexcept
+{
+    const size_t blockbytes{((blockalign-1)/2 + 4) * numchans};
+    const size_t srcEnd{srcOffset + samples};
+
+    /* Start from the given state if it's partway into the same block, or else
+     * at the start of the block.
+     */
+    size_t pos{srcOffset - srcOffset%blockalign};
+    if(state.mData == src && state.mPos > pos && state.mPos <= srcOffset)
+        pos = state.mPos;
+    int sample{state.mSample[0]};
+    int index{state.mStep};
+
+    while(pos < srcEnd)
+    {
+        const al::byte *block{src + pos/blockalign*blockbytes};
+        size_t k{pos % blockalign};
+        if(k == 0)
+        {
+            const al::byte *header{block + chan*4};
+            sample = header[0] | (header[1]<<8);
+            sample = (sample^0x8000) - 32768;
+            index = header[2] | (header[3]<<8);
+            index = clampi((index^0x8000) - 32768, 0, 88);
+
+            if(pos >= srcOffset)
+                dst[pos-srcOffset] = FmtTypeTraits<FmtShort>::to<DstT>(
+                    static_cast<int16_t>(sample));
+            ++pos;
+            ++k;
+        }
+
+        /* Each channel has 4 bytes (8 samples) of nibbles at a time, lowest
+         * nibble first.
+         */
+        const al::byte *codes{block + (numchans + chan)*4};
+        const size_t blockend{minz(blockalign, k + (srcEnd-pos))};
+        for(;k < blockend;++k,++pos)
+        {
+            const size_t j{k - 1};
+            const al::byte code{codes[(j>>3)*numchans*4 + ((j&7)>>1)]};
+            const uint nibble{(j&1) ? uint{code}>>4 : uint{code}&0x0f};
+
+            sample += IMA4Codeword[nibble] * IMAStep_size[index] / 8;
+            sample = clampi(sample, -32768, 32767);
+
+            index += IMA4Index_adjust[nibble];
+            index = clampi(index, 0, 88);
+
+            if(pos >= srcOffset)
+                dst[pos-srcOffset] = FmtTypeTraits<FmtShort>::to<DstT>(
+                    static_cast<int16_t>(sample));
+        }
+    }
+
+    state.mData = src;
+    state.mPos = pos;
+    state.mSample[0] = sample;
+    state.mStep = index;
+}
+
+template<typename DstT>
+void DecodeMSADPCMChannel(DstT *RESTRICT dst, const al::byte *src, const size_t chan,
+    const size_t numchans, const size_t blockalign, const size_t srcOffset, const size_t samples,
+    AdpcmState &state) noexcept
+{
+    const size_t blockbytes{((blockalign-2)/2 + 7) * numchans};
+    const size_t srcEnd{srcOffset + samples};
+
+    size_t pos{srcOffset - srcOffset%blockalign};
+    if(state.mData == src && state.mPos > pos && state.mPos <= srcOffset)
+        pos = state.mPos;
+    int sample0{state.mSample[0]}, sample1{state.mSample[1]};
+    int delta{state.mStep};
+    int coeff{state.mCoeff};
+
+    auto store_sample = [dst,srcOffset](const size_t dstpos, const int value) noexcept
+    {
+        if(dstpos >= srcOffset)
+            dst[dstpos-srcOffset] = FmtTypeTraits<FmtShort>::to<DstT>(
+                static_cast<int16_t>(value));
+    };
+    while(pos < srcEnd)
+    {
+        const al::byte *block{src + pos/blockalign*blockbytes};
+        size_t k{pos % blockalign};
+        if(k == 0)
+        {
+            coeff = minu(block[chan], 6);
+            const al::byte *header{block + numchans + chan*2};
+            delta = header[0] | (header[1]<<8);
+            delta = (delta^0x8000) - 32768;
+            header += numchans*2;
+            sample0 = static_cast<int16_t>(header[0] | (header[1]<<8));
+            header += numchans*2;
+            sample1 = static_cast<int16_t>(header[0] | (header[1]<<8));
+
+            /* Second sample is played first. */
+            store_sample(pos, sample1);
+            ++pos;
+            ++k;
+            if(pos == srcEnd) break;
+        }
+        if(k == 1)
+        {
+            store_sample(pos, sample0);
+            ++pos;
+            ++k;
+        }
+
+        /* Nibbles are interleaved between channels, upper nibble first. */
+        const al::byte *codes{block + numchans*7};
+        const size_t blockend{minz(blockalign, k + (srcEnd-pos))};
+        for(;k < blockend;++k,++pos)
+        {
+            const size_t n{(k-2)*numchans + chan};
+            const uint nibble{(n&1) ? uint{codes[n>>1]}&0x0f : uint{codes[n>>1]}>>4};
+
+            int pred{(sample0*MSADPCMAdaptionCoeff[coeff][0] +
+                sample1*MSADPCMAdaptionCoeff[coeff][1]) / 256};
+            pred += ((nibble^0x08) - 0x08) * delta;
+            pred  = clampi(pred, -32768, 32767);
+
+            sample1 = sample0;
+            sample0 = pred;
+
+            delta = (MSADPCMAdaption[nibble] * delta) / 256;
+            delta = maxi(16, delta);
+
+            store_sample(pos, pred);
+        }
+    }
+
+    state.mData = src;
+    state.mPos = pos;
+    state.mSample[0] = sample0;
+    state.mSample[1] = sample1;
+    state.mStep = delta;
+    state.mCoeff = coeff;
+}
+
+} // namespace
+
+template<typename DstT>
+void LoadAdpcmChannel(DstT *RESTRICT dst, const al::byte *src, const FmtType srctype,
+    const size_t chan, const size_t numchans, const size_t blockalign, const size_t srcOffset,
+    const size_t samples, AdpcmState &state) noexcept
+{
+    if(srctype == FmtIMA4)
+        DecodeIMA4Channel(dst, src, chan, numchans, blockalign, srcOffset, samples, state);
+    else if(srctype == FmtMSADPCM)
+        DecodeMSADPCMChannel(dst, src, chan, numchans, blockalign, srcOffset, samples, state);
+}
+template void LoadAdpcmChannel<float>(float*RESTRICT, const al::byte*, const FmtType,
+    const size_t, const size_t, const size_t, const size_t, const size_t, AdpcmState&) noexcept;
+template void LoadAdpcmChannel<double>(double*RESTRICT, const al::byte*, const FmtType,
+    const size_t, const size_t, const size_t, const size_t, const size_t, AdpcmState&) noexcept;
+
 } // namespace al
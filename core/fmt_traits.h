@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "albyte.h"
 #include "buffer_storage.h"
@@ -13,6 +14,39 @@ namespace al {
 extern const int16_t muLawDecompressionTable[256];
 extern const int16_t aLawDecompressionTable[256];
 
+extern const int IMAStep_size[89];
+extern const int IMA4Codeword[16];
+extern const int IMA4Index_adjust[16];
+extern const int MSADPCMAdaption[16];
+extern const int MSADPCMAdaptionCoeff[7][2];
+
+
+/* Converts an IEEE half-precision float to single-precision. Denormals are
+ * converted through an integer, so they aren't flushed to 0 by the mixer's
+ * FPU mode.
+ */
+inline float HalfToFloat(const uint16_t val) noexcept
+{
+    const uint32_t expmant{val & 0x7fffu};
+    uint32_t bits;
+    if(expmant > 0x7c00u) /* NaN, quieted like hardware conversions do */
+        bits = 0x7fc00000u | ((expmant&0x3ffu) << 13);
+    else if(expmant == 0x7c00u) /* Infinity */
+        bits = 0x7f800000u;
+    else if(expmant >= 0x0400u) /* Normal, rebias the exponent from 15 to 127. */
+        bits = (expmant << 13) + ((127u-15u) << 23);
+    else /* Denormal, or 0 */
+    {
+        const float f{static_cast<float>(expmant) * (1.0f/16777216.0f)};
+        memcpy(&bits, &f, sizeof(bits));
+    }
+    bits |= uint32_t{val&0x8000u} << 16;
+
+    float ret;
+    memcpy(&ret, &bits, sizeof(ret));
+    return ret;
+}
+
 
 template<FmtType T>
 struct FmtTypeTraits { };
@@ -62,6 +96,13 @@ struct FmtTypeTraits<FmtAlaw> {
     static constexpr inline OutT to(const Type val) noexcept
     { return aLawDecompressionTable[val] * OutT{1.0/32768.0}; }
 };
+template<>
+struct FmtTypeTraits<FmtHalf> {
+    using Type = uint16_t;
+
+    template<typename OutT>
+    static inline OutT to(const Type val) noexcept { return static_cast<OutT>(HalfToFloat(val)); }
+};
 
 
 template<FmtType SrcType, typename DstT>
@@ -76,6 +117,34 @@ inline void LoadSampleArray(DstT *RESTRICT dst, const al::byte *src, const size_
         dst[i] = TypeTraits::template to<DstT>(ssrc[i*srcstep]);
 }
 
+
+/* ADPCM formats only support mono and stereo. */
+constexpr size_t MaxAdpcmChannels{2};
+
+/* Decoder state for one channel of IMA4 or MSADPCM samples, as of the given
+ * sample frame. Decoding from that frame onward (in the same block) can pick
+ * up from here instead of redecoding from the start of the block.
+ */
+struct AdpcmState {
+    const al::byte *mData{nullptr};
+    size_t mPos{0u};
+
+    int mSample[2]{}; /* Last two decoded samples (IMA4 only uses the first). */
+    int mStep{0}; /* IMA4 step index, or MSADPCM delta. */
+    int mCoeff{0}; /* MSADPCM predictor coefficient index. */
+};
+
+/**
+ * Decodes sample frames [srcOffset, srcOffset+samples) of the given channel
+ * from a buffer of IMA4 or MSADPCM blocks, each with blockalign frames. The
+ * state is continued from if it's for the same data and block, and is left
+ * at the end of the decoded samples.
+ */
+template<typename DstT>
+void LoadAdpcmChannel(DstT *RESTRICT dst, const al::byte *src, const FmtType srctype,
+    const size_t chan, const size_t numchans, const size_t blockalign, const size_t srcOffset,
+    const size_t samples, AdpcmState &state) noexcept;
+
 } // namespace al
 
 #endif /* CORE_FMT_TRAITS_H */
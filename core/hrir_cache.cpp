@@ -0,0 +1,66 @@
+#include "config.h"
+
+#include "hrir_cache.h"
+
+#include <algorithm>
+
+#include "alnumbers.h"
+#include "alnumeric.h"
+#include "logging.h"
+
+
+HrirCache::HrirCache(const size_t numentries, const float step)
+    : mStep{step}, mInvStep{1.0f / step}
+{
+    const size_t numsets{NextPowerOf2(static_cast<uint32_t>(
+        maxz((numentries+NumWays-1) / NumWays, 1)))};
+    mEntries.resize(numsets * NumWays);
+    mSetMask = numsets - 1;
+
+    TRACE("Caching up to %zu HRIRs, %.2f degree resolution (%zu bytes)\n", mEntries.size(),
+        static_cast<double>(step) * (180.0*al::numbers::inv_pi),
+        mEntries.size()*sizeof(Entry));
+}
+
+void HrirCache::getCoeffs(const HrtfStore *Hrtf, float elevation, float azimuth, float distance,
+    float spread, HrirArray &coeffs, const al::span<uint,2> delays)
+{
+    /* The distance only selects which field to use, the same as
+     * GetHrtfCoeffs.
+     */
+    uint fdidx{0};
+    while(fdidx < Hrtf->fdCount-1 && distance < Hrtf->field[fdidx].distance)
+        ++fdidx;
+
+    const int evq{fastf2i(elevation * mInvStep)};
+    const int azq{fastf2i(azimuth * mInvStep)};
+    const int spq{fastf2i(spread * mInvStep)};
+    const uint64_t key{(uint64_t{fdidx} << 48)
+        | (uint64_t{static_cast<uint16_t>(spq)} << 32)
+        | (uint64_t{static_cast<uint16_t>(evq)} << 16)
+        | uint64_t{static_cast<uint16_t>(azq)}};
+
+    const size_t set{static_cast<size_t>((key * 0x9e3779b97f4a7c15_u64) >> 32) & mSetMask};
+    const auto ways = mEntries.begin() + static_cast<ptrdiff_t>(set*NumWays);
+
+    auto match = std::find_if(ways, ways+NumWays,
+        [key](const Entry &entry) noexcept { return entry.mLastUse && entry.mKey == key; });
+    if(match == ways+NumWays)
+    {
+        /* Unused entries have the lowest use count, so they get replaced
+         * first.
+         */
+        match = std::min_element(ways, ways+NumWays,
+            [](const Entry &lhs, const Entry &rhs) noexcept
+            { return lhs.mLastUse < rhs.mLastUse; });
+
+        GetHrtfCoeffs(Hrtf, static_cast<float>(evq)*mStep, static_cast<float>(azq)*mStep,
+            distance, static_cast<float>(spq)*mStep, match->mCoeffs, match->mDelays);
+        match->mKey = key;
+    }
+    match->mLastUse = ++mUseCount;
+
+    coeffs = match->mCoeffs;
+    delays[0] = match->mDelays[0];
+    delays[1] = match->mDelays[1];
+}
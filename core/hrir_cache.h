@@ -0,0 +1,65 @@
+#ifndef CORE_HRIR_CACHE_H
+#define CORE_HRIR_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+
+#include "almalloc.h"
+#include "alspan.h"
+#include "hrtf.h"
+#include "mixer/hrtfdefs.h"
+#include "vector.h"
+
+using uint = unsigned int;
+
+
+/* Holds blended HRIRs for recently used directions, so sources near each
+ * other don't each need to blend them from the data set. Directions and
+ * spreads are quantized to the cache's resolution, and the HRIRs are always
+ * calculated for the quantized values, so the result doesn't depend on what
+ * was cached before. Entries are grouped into small sets by their key, with
+ * the least recently used entry of a set replaced when it's full.
+ *
+ * Only the mixer thread may use it, since it updates the entries as it looks
+ * them up.
+ */
+class HrirCache {
+    static constexpr size_t NumWays{8};
+
+    struct Entry {
+        alignas(16) HrirArray mCoeffs;
+        std::array<uint,2> mDelays;
+        uint64_t mKey;
+        /* 0 for an unused entry. */
+        uint64_t mLastUse;
+    };
+    al::vector<Entry,16> mEntries;
+    size_t mSetMask;
+    uint64_t mUseCount{0u};
+
+    const float mStep;
+    const float mInvStep;
+
+public:
+    /**
+     * Creates a cache with room for (at least) the given number of entries,
+     * quantizing angles to the given step, in radians.
+     */
+    HrirCache(const size_t numentries, const float step);
+    HrirCache(const HrirCache&) = delete;
+    HrirCache& operator=(const HrirCache&) = delete;
+
+    /**
+     * Same as GetHrtfCoeffs, except the elevation, azimuth, and spread are
+     * rounded to the cache's resolution, and the result is looked up in or
+     * added to the cache. The data set must be the same for every call.
+     */
+    void getCoeffs(const HrtfStore *Hrtf, float elevation, float azimuth, float distance,
+        float spread, HrirArray &coeffs, const al::span<uint,2> delays);
+
+    DEF_NEWDEL(HrirCache)
+};
+
+#endif /* CORE_HRIR_CACHE_H */
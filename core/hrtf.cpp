@@ -16,6 +16,7 @@
 #include <memory>
 #include <mutex>
 #include <numeric>
+#include <thread>
 #include <type_traits>
 #include <utility>
 
@@ -30,11 +31,13 @@
 #include "ambidefs.h"
 #include "filters/splitter.h"
 #include "helpers.h"
+#include "hrtf_cache.h"
 #include "logging.h"
 #include "mixer/hrtfdefs.h"
 #include "opthelpers.h"
 #include "polyphase_resampler.h"
 #include "vector.h"
+#include "worker_pool.h"
 
 
 namespace {
@@ -51,7 +54,19 @@ HrtfEntry::~HrtfEntry() = default;
 struct LoadedHrtf {
     std::string mFilename;
     std::unique_ptr<HrtfStore> mEntry;
+    /* Holds the store's data, if it was loaded from the cache. */
+    std::unique_ptr<HrtfCacheMapping> mMapping;
+
+    LoadedHrtf(std::string filename, std::unique_ptr<HrtfStore> entry,
+        std::unique_ptr<HrtfCacheMapping> mapping)
+        : mFilename{std::move(filename)}, mEntry{std::move(entry)}, mMapping{std::move(mapping)}
+    { }
+    LoadedHrtf(LoadedHrtf&&) = default;
+    LoadedHrtf& operator=(LoadedHrtf&&) = default;
+    /* GCC warns when it tries to inline this. */
+    ~LoadedHrtf();
 };
+LoadedHrtf::~LoadedHrtf() = default;
 
 /* Data set limits must be the same as or more flexible than those defined in
  * the makemhr utility.
@@ -76,6 +91,16 @@ constexpr uint HrirDelayFracHalf{HrirDelayFracOne >> 1};
 
 static_assert(MaxHrirDelay*HrirDelayFracOne < 256, "MAX_HRIR_DELAY or DELAY_FRAC too large");
 
+/* Data sets needing to be resampled have their IRs split into batches of this
+ * many, to be processed by up to this many threads (including the loading
+ * thread).
+ */
+constexpr size_t HrirResampleBatchSize{64};
+constexpr uint MaxHrtfLoadThreads{4};
+
+/* Must be less than 15 characters, like the device thread names. */
+#define HRTF_LOAD_THREAD_NAME "alsoft-hrtf"
+
 constexpr char magicMarker00[8]{'M','i','n','P','H','R','0','0'};
 constexpr char magicMarker01[8]{'M','i','n','P','H','R','0','1'};
 constexpr char magicMarker02[8]{'M','i','n','P','H','R','0','2'};
@@ -356,6 +381,15 @@ void DirectHrtfState::build(const HrtfStore *Hrtf, const uint irSize,
     TRACE("New max delay: %.2f, FIR length: %u\n", max_delay/double{HrirDelayFracOne},
         max_length);
     mIrSize = max_length;
+
+    const uint partsize{HrtfTailConvolver::ChoosePartitionSize(mIrSize, mChannels.size())};
+    if(partsize > 0)
+    {
+        mTailConv = HrtfTailConvolver::Create(mIrSize, partsize, mChannels.size());
+        for(size_t i{0u};i < mChannels.size();++i)
+            mTailConv->setFilter(i, mChannels[i].mCoeffs, mIrSize);
+        TRACE("Using partitioned convolution, %u sample partitions\n", partsize);
+    }
 }
 
 
@@ -1205,6 +1239,70 @@ al::span<const char> GetResource(int name)
 }
 #endif
 
+/* A cache file's layout is checked when it's loaded, but its fields,
+ * elevations, and delays need the same limits the data set loaders apply, or
+ * the mixer could index outside of them.
+ */
+bool CheckCachedHrtf(const HrtfStore &hrtf, const std::string &name)
+{
+    if(hrtf.fdCount < MinFdCount || hrtf.fdCount > MaxFdCount)
+    {
+        WARN("Ignoring cached %s with unsupported field count (%u)\n", name.c_str(),
+            hrtf.fdCount);
+        return false;
+    }
+
+    size_t evCount{0};
+    for(size_t f{0};f < hrtf.fdCount;++f)
+    {
+        const HrtfStore::Field &field = hrtf.field[f];
+        if(!(field.distance >= static_cast<float>(MinFdDistance)/1000.0f
+            && field.distance <= static_cast<float>(MaxFdDistance)/1000.0f))
+        {
+            WARN("Ignoring cached %s with unsupported field distance[%zu]=%f\n", name.c_str(),
+                f, field.distance);
+            return false;
+        }
+        if(field.evCount < MinEvCount || field.evCount > MaxEvCount)
+        {
+            WARN("Ignoring cached %s with unsupported evCount[%zu]=%d\n", name.c_str(), f,
+                field.evCount);
+            return false;
+        }
+        /* Fields are stored farthest first. */
+        if(f > 0 && field.distance > hrtf.field[f-1].distance)
+        {
+            WARN("Ignoring cached %s with field distance[%zu] after previous (%f > %f)\n",
+                name.c_str(), f, field.distance, hrtf.field[f-1].distance);
+            return false;
+        }
+        evCount += field.evCount;
+    }
+
+    for(size_t e{0};e < evCount;++e)
+    {
+        if(hrtf.elev[e].azCount < MinAzCount || hrtf.elev[e].azCount > MaxAzCount)
+        {
+            WARN("Ignoring cached %s with unsupported azCount[%zu]=%d\n", name.c_str(), e,
+                hrtf.elev[e].azCount);
+            return false;
+        }
+    }
+
+    const size_t irCount{size_t{hrtf.elev[evCount-1].irOffset} + hrtf.elev[evCount-1].azCount};
+    auto delay_valid = [](const ubyte2 &delays) noexcept -> bool
+    {
+        return delays[0] <= MaxHrirDelay*HrirDelayFracOne
+            && delays[1] <= MaxHrirDelay*HrirDelayFracOne;
+    };
+    if(!std::all_of(hrtf.delays, hrtf.delays+irCount, delay_valid))
+    {
+        WARN("Ignoring cached %s with invalid delays\n", name.c_str());
+        return false;
+    }
+    return true;
+}
+
 } // namespace
 
 
@@ -1265,7 +1363,8 @@ al::vector<std::string> EnumerateHrtf(al::optional<std::string> pathopt)
     return list;
 }
 
-HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
+HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate,
+    const std::string &cachepath)
 {
     std::lock_guard<std::mutex> _{EnumeratedHrtfLock};
     auto entry_iter = std::find_if(EnumeratedHrtfs.cbegin(), EnumeratedHrtfs.cend(),
@@ -1289,7 +1388,12 @@ HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
         ++handle;
     }
 
+    /* With the cache enabled, built-in data sets are identified by their
+     * contents, which are already in memory, and files by their path, size,
+     * and modification time, so they don't need to be read to be found.
+     */
     std::unique_ptr<std::istream> stream;
+    al::optional<uint64_t> hash;
     int residx{};
     char ch{};
     if(sscanf(fname.c_str(), "!%d%c", &residx, &ch) == 2 && ch == '_')
@@ -1301,11 +1405,15 @@ HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
             ERR("Could not get resource %u, %s\n", residx, name.c_str());
             return nullptr;
         }
+        if(!cachepath.empty())
+            hash = HashHrtfData(res);
         stream = std::make_unique<idstream>(res.begin(), res.end());
     }
     else
     {
         TRACE("Loading %s...\n", fname.c_str());
+        if(!cachepath.empty())
+            hash = HashHrtfFile(fname);
         auto fstr = std::make_unique<al::ifstream>(fname.c_str(), std::ios::binary);
         if(!fstr->is_open())
         {
@@ -1315,6 +1423,20 @@ HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
         stream = std::move(fstr);
     }
 
+    if(hash)
+    {
+        auto cached = LoadCachedHrtf(cachepath, *hash, devrate);
+        if(cached && CheckCachedHrtf(*cached->mStore, name))
+        {
+            HrtfStore *store{cached->mStore.get()};
+            TRACE("Loaded HRTF %s for sample rate %uhz from cache, %u-sample filter\n",
+                name.c_str(), store->sampleRate, store->irSize);
+            handle = LoadedHrtfs.emplace(handle, fname, std::move(cached->mStore),
+                std::move(cached->mMapping));
+            return HrtfStorePtr{handle->mEntry.get()};
+        }
+    }
+
     std::unique_ptr<HrtfStore> hrtf;
     char magic[sizeof(magicMarker03)];
     stream->read(magic, sizeof(magic));
@@ -1361,38 +1483,73 @@ HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
         ) - 1};
         const size_t irCount{size_t{hrtf->elev[lastEv].irOffset} + hrtf->elev[lastEv].azCount};
 
-        /* Resample all the IRs. */
-        std::array<std::array<double,HrirLength>,2> inout;
-        PPhaseResampler rs;
-        rs.init(hrtf->sampleRate, devrate);
-        for(size_t i{0};i < irCount;++i)
+        /* Resample all the IRs and scale their delays for the new sample rate,
+         * in batches spread over a few temporary threads. The resampler is
+         * only read from once initialized, so it's shared by all the threads.
+         * Each IR is processed the same as it would be serially, so the result
+         * doesn't depend on the thread count.
+         */
+        struct ResampleJob {
+            const PPhaseResampler *mResampler;
+            HrtfStore *mHrtf;
+            size_t mIrCount;
+            float mRateScale;
+            al::span<float2> mNewDelays;
+            al::span<float> mMaxDelays;
+        };
+        auto resample_irs = [](void *userdata, const size_t task) -> void
         {
-            HrirArray &coeffs = const_cast<HrirArray&>(hrtf->coeffs[i]);
-            for(size_t j{0};j < 2;++j)
+            auto &job = *static_cast<ResampleJob*>(userdata);
+            const size_t start{task * HrirResampleBatchSize};
+            const size_t end{minz(start+HrirResampleBatchSize, job.mIrCount)};
+
+            std::array<std::array<double,HrirLength>,2> inout;
+            float max_delay{0.0f};
+            for(size_t i{start};i < end;++i)
             {
-                std::transform(coeffs.cbegin(), coeffs.cend(), inout[0].begin(),
-                    [j](const float2 &in) noexcept -> double { return in[j]; });
-                rs.process(HrirLength, inout[0].data(), HrirLength, inout[1].data());
-                for(size_t k{0};k < HrirLength;++k)
-                    coeffs[k][j] = static_cast<float>(inout[1][k]);
+                HrirArray &coeffs = const_cast<HrirArray&>(job.mHrtf->coeffs[i]);
+                for(size_t j{0};j < 2;++j)
+                {
+                    std::transform(coeffs.cbegin(), coeffs.cend(), inout[0].begin(),
+                        [j](const float2 &in) noexcept -> double { return in[j]; });
+                    job.mResampler->process(HrirLength, inout[0].data(), HrirLength,
+                        inout[1].data());
+                    for(size_t k{0};k < HrirLength;++k)
+                        coeffs[k][j] = static_cast<float>(inout[1][k]);
+
+                    const float new_delay{std::round(job.mHrtf->delays[i][j]*job.mRateScale) /
+                        float{HrirDelayFracOne}};
+                    max_delay = maxf(max_delay, new_delay);
+                    job.mNewDelays[i][j] = new_delay;
+                }
             }
-        }
-        rs = {};
+            job.mMaxDelays[task] = max_delay;
+        };
+
+        PPhaseResampler rs;
+        rs.init(hrtf->sampleRate, devrate);
 
-        /* Scale the delays for the new sample rate. */
-        float max_delay{0.0f};
+        const size_t numtasks{(irCount+HrirResampleBatchSize-1) / HrirResampleBatchSize};
         auto new_delays = al::vector<float2>(irCount);
+        auto max_delays = al::vector<float>(numtasks);
         const float rate_scale{static_cast<float>(devrate)/static_cast<float>(hrtf->sampleRate)};
-        for(size_t i{0};i < irCount;++i)
+        ResampleJob job{&rs, hrtf.get(), irCount, rate_scale, new_delays, max_delays};
+
+        const uint numthreads{minu(std::thread::hardware_concurrency(), MaxHrtfLoadThreads)};
+        std::unique_ptr<WorkerPool> pool;
+        if(numthreads > 1 && numtasks > 1)
+            pool = WorkerPool::Create(numthreads-1, HRTF_LOAD_THREAD_NAME, false);
+        if(pool)
+            pool->run(resample_irs, &job, numtasks);
+        else
         {
-            for(size_t j{0};j < 2;++j)
-            {
-                const float new_delay{std::round(hrtf->delays[i][j] * rate_scale) /
-                    float{HrirDelayFracOne}};
-                max_delay = maxf(max_delay, new_delay);
-                new_delays[i][j] = new_delay;
-            }
+            for(size_t task{0};task < numtasks;++task)
+                resample_irs(&job, task);
         }
+        pool = nullptr;
+        rs = {};
+
+        const float max_delay{*std::max_element(max_delays.cbegin(), max_delays.cend())};
 
         /* If the new delays exceed the max, scale it down to fit (essentially
          * shrinking the head radius; not ideal but better than a per-delay
@@ -1418,11 +1575,17 @@ HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate)
         const float newIrSize{std::round(static_cast<float>(hrtf->irSize) * rate_scale)};
         hrtf->irSize = static_cast<uint>(minf(HrirLength, newIrSize));
         hrtf->sampleRate = devrate;
+
+        /* Only a resampled data set is worth caching. One already at the
+         * device rate loads just as fast from the data set itself.
+         */
+        if(hash)
+            StoreCachedHrtf(cachepath, *hash, *hrtf);
     }
 
     TRACE("Loaded HRTF %s for sample rate %uhz, %u-sample filter\n", name.c_str(),
         hrtf->sampleRate, hrtf->irSize);
-    handle = LoadedHrtfs.emplace(handle, LoadedHrtf{fname, std::move(hrtf)});
+    handle = LoadedHrtfs.emplace(handle, fname, std::move(hrtf), nullptr);
 
     return HrtfStorePtr{handle->mEntry.get()};
 }
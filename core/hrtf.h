@@ -12,6 +12,7 @@
 #include "atomic.h"
 #include "ambidefs.h"
 #include "bufferline.h"
+#include "hrtf_convolver.h"
 #include "mixer/hrtfdefs.h"
 #include "intrusive_ptr.h"
 #include "vector.h"
@@ -37,7 +38,7 @@ struct HrtfStore {
         ushort azCount;
         ushort irOffset;
     };
-    Elevation *elev;
+    const Elevation *elev;
     const HrirArray *coeffs;
     const ubyte2 *delays;
 
@@ -62,6 +63,10 @@ struct DirectHrtfState {
 
     /* HRTF filter state for dry buffer content */
     uint mIrSize{0};
+    /* Applies the HRIRs past the head in the frequency domain, when they're
+     * long enough for that to be cheaper.
+     */
+    std::unique_ptr<HrtfTailConvolver> mTailConv;
     al::FlexArray<HrtfChannelState> mChannels;
 
     DirectHrtfState(size_t numchans) : mChannels{numchans} { }
@@ -82,7 +87,13 @@ struct DirectHrtfState {
 
 
 al::vector<std::string> EnumerateHrtf(al::optional<std::string> pathopt);
-HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate);
+/**
+ * Returns the named HRTF at the given sample rate, loading it if needed. If
+ * cachepath isn't empty, it's used to store and load copies already converted
+ * for the sample rate, to avoid parsing and resampling the data set again.
+ */
+HrtfStorePtr GetLoadedHrtf(const std::string &name, const uint devrate,
+    const std::string &cachepath);
 
 void GetHrtfCoeffs(const HrtfStore *Hrtf, float elevation, float azimuth, float distance,
     float spread, HrirArray &coeffs, const al::span<uint,2> delays);
@@ -0,0 +1,485 @@
+#include "config.h"
+
+#include "hrtf_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <new>
+
+#include "alnumeric.h"
+#include "logging.h"
+#include "strutils.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <shlobj.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+/* Cache files hold the HrtfStore layout directly, in native byte order, so
+ * they're only valid for the build that made them. The version needs to be
+ * bumped whenever the layout or the loading and resampling process changes.
+ */
+constexpr char CacheMagic[8]{'A','L','H','R','T','F','C','$'};
+constexpr uint32_t CacheVersion{1};
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t hrirLength;
+    uint64_t hash;
+
+    uint32_t sampleRate;
+    uint32_t irSize;
+    uint32_t fdCount;
+    uint32_t evCount;
+    uint32_t irCount;
+
+    /* Byte offsets from the start of the file. The coefficients are aligned
+     * to 16 bytes for SIMD.
+     */
+    uint32_t fieldOffset;
+    uint32_t elevOffset;
+    uint32_t coeffsOffset;
+    uint32_t delaysOffset;
+    uint32_t totalSize;
+};
+
+struct CacheLayout {
+    size_t fieldOffset, elevOffset, coeffsOffset, delaysOffset, totalSize;
+};
+
+CacheLayout CalcLayout(const size_t fdCount, const size_t evCount, const size_t irCount)
+{
+    CacheLayout layout{};
+    size_t offset{sizeof(CacheHeader)};
+    offset = RoundUp(offset, alignof(HrtfStore::Field));
+    layout.fieldOffset = offset;
+    offset += sizeof(HrtfStore::Field)*fdCount;
+    offset = RoundUp(offset, alignof(HrtfStore::Elevation));
+    layout.elevOffset = offset;
+    offset += sizeof(HrtfStore::Elevation)*evCount;
+    offset = RoundUp(offset, 16);
+    layout.coeffsOffset = offset;
+    offset += sizeof(HrirArray)*irCount;
+    layout.delaysOffset = offset;
+    offset += sizeof(ubyte2)*irCount;
+    layout.totalSize = offset;
+    return layout;
+}
+
+/* What identifies a data set file without reading it. The modification time
+ * only has a second's precision on some systems, so the file ID (inode) is
+ * included too, which changes when the file is replaced.
+ */
+struct FileStamp {
+    uint64_t size;
+    uint64_t mtime;
+    uint64_t id;
+};
+
+/* 64-bit FNV-1a. */
+constexpr uint64_t FnvBasis{0xcbf29ce484222325_u64};
+uint64_t FnvHash(uint64_t hash, const al::span<const char> data)
+{
+    for(const char ch : data)
+    {
+        hash ^= static_cast<unsigned char>(ch);
+        hash *= 0x100000001b3_u64;
+    }
+    return hash;
+}
+
+uint64_t FnvHash(uint64_t hash, const uint64_t value)
+{
+    for(size_t i{0};i < sizeof(value);++i)
+    {
+        hash ^= (value >> (i*8)) & 0xff;
+        hash *= 0x100000001b3_u64;
+    }
+    return hash;
+}
+
+std::string GetCacheFilename(const std::string &cachepath, const uint64_t hash,
+    const uint samplerate)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx-%u-%u.bin", static_cast<unsigned long long>(hash),
+        samplerate, HrirLength);
+
+    std::string fname{cachepath};
+#ifdef _WIN32
+    if(!fname.empty() && fname.back() != '\\' && fname.back() != '/')
+        fname += '\\';
+#else
+    if(!fname.empty() && fname.back() != '/')
+        fname += '/';
+#endif
+    fname += name;
+    return fname;
+}
+
+
+#ifdef _WIN32
+
+std::unique_ptr<HrtfCacheMapping> MapCacheFile(const std::string &fname)
+{
+    HANDLE file{CreateFileW(utf8_to_wstr(fname.c_str()).c_str(), GENERIC_READ, FILE_SHARE_READ,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr)};
+    if(file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    LARGE_INTEGER fsize{};
+    if(!GetFileSizeEx(file, &fsize) || fsize.QuadPart <= 0
+        || static_cast<uint64_t>(fsize.QuadPart) > std::numeric_limits<uint32_t>::max())
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    HANDLE fmap{CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr)};
+    CloseHandle(file);
+    if(!fmap)
+        return nullptr;
+
+    void *ptr{MapViewOfFile(fmap, FILE_MAP_READ, 0, 0, 0)};
+    CloseHandle(fmap);
+    if(!ptr)
+        return nullptr;
+
+    return std::make_unique<HrtfCacheMapping>(ptr, static_cast<size_t>(fsize.QuadPart));
+}
+
+bool MakeDirectories(const std::string &path)
+{
+    std::wstring wpath{utf8_to_wstr(path.c_str())};
+    std::replace(wpath.begin(), wpath.end(), L'/', L'\\');
+    const int res{SHCreateDirectoryExW(nullptr, wpath.c_str(), nullptr)};
+    return res == ERROR_SUCCESS || res == ERROR_ALREADY_EXISTS || res == ERROR_FILE_EXISTS;
+}
+
+bool GetFileStamp(const std::string &fname, FileStamp &stamp)
+{
+    WIN32_FILE_ATTRIBUTE_DATA attrs{};
+    if(!GetFileAttributesExW(utf8_to_wstr(fname.c_str()).c_str(), GetFileExInfoStandard, &attrs))
+        return false;
+
+    stamp.size = (uint64_t{attrs.nFileSizeHigh}<<32) | attrs.nFileSizeLow;
+    stamp.mtime = (uint64_t{attrs.ftLastWriteTime.dwHighDateTime}<<32)
+        | attrs.ftLastWriteTime.dwLowDateTime;
+    stamp.id = 0;
+    return true;
+}
+
+bool WriteCacheFile(const std::string &fname, const al::span<const char> data)
+{
+    const std::wstring wfname{utf8_to_wstr(fname.c_str())};
+    std::wstring tmpname{wfname};
+    tmpname += L".tmp";
+    tmpname += std::to_wstring(GetCurrentProcessId());
+
+    HANDLE file{CreateFileW(tmpname.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL, nullptr)};
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+
+    DWORD written{};
+    const bool ok{::WriteFile(file, data.data(), static_cast<DWORD>(data.size()), &written,
+        nullptr) && written == data.size()};
+    CloseHandle(file);
+
+    if(!ok || !MoveFileExW(tmpname.c_str(), wfname.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        DeleteFileW(tmpname.c_str());
+        return false;
+    }
+    return true;
+}
+
+#else
+
+std::unique_ptr<HrtfCacheMapping> MapCacheFile(const std::string &fname)
+{
+    const int fd{open(fname.c_str(), O_RDONLY)};
+    if(fd < 0)
+        return nullptr;
+
+    struct stat st{};
+    if(fstat(fd, &st) != 0 || st.st_size <= 0
+        || static_cast<uint64_t>(st.st_size) > std::numeric_limits<uint32_t>::max())
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    const size_t size{static_cast<size_t>(st.st_size)};
+    void *ptr{mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)};
+    close(fd);
+    if(ptr == MAP_FAILED)
+        return nullptr;
+
+    return std::make_unique<HrtfCacheMapping>(ptr, size);
+}
+
+bool MakeDirectories(const std::string &path)
+{
+    size_t pos{0};
+    do {
+        pos = path.find('/', pos+1);
+        const std::string dir{path.substr(0, pos)};
+        if(mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+            return false;
+    } while(pos != std::string::npos);
+    return true;
+}
+
+bool GetFileStamp(const std::string &fname, FileStamp &stamp)
+{
+    struct stat st{};
+    if(stat(fname.c_str(), &st) != 0)
+        return false;
+
+    stamp.size = static_cast<uint64_t>(st.st_size);
+    stamp.mtime = static_cast<uint64_t>(st.st_mtime);
+    stamp.id = static_cast<uint64_t>(st.st_ino);
+    return true;
+}
+
+bool WriteCacheFile(const std::string &fname, const al::span<const char> data)
+{
+    /* Write to a temporary file first, so another process never sees a
+     * partially written cache file.
+     */
+    std::string tmpname{fname};
+    tmpname += ".tmp";
+    tmpname += std::to_string(getpid());
+
+    const int fd{open(tmpname.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644)};
+    if(fd < 0)
+        return false;
+
+    bool ok{true};
+    size_t done{0};
+    while(ok && done < data.size())
+    {
+        const ssize_t res{write(fd, data.data()+done, data.size()-done)};
+        if(res > 0)
+            done += static_cast<size_t>(res);
+        else if(res < 0 && errno == EINTR)
+            continue;
+        else
+            ok = false;
+    }
+    if(close(fd) != 0)
+        ok = false;
+
+    if(!ok || rename(tmpname.c_str(), fname.c_str()) != 0)
+    {
+        unlink(tmpname.c_str());
+        return false;
+    }
+    return true;
+}
+
+#endif
+
+} // namespace
+
+
+HrtfCacheMapping::~HrtfCacheMapping()
+{
+#ifdef _WIN32
+    UnmapViewOfFile(mData);
+#else
+    munmap(mData, mSize);
+#endif
+}
+
+
+std::string GetDefaultHrtfCachePath()
+{
+#ifdef _WIN32
+#if WINAPI_FAMILY == WINAPI_FAMILY_DESKTOP_APP
+    WCHAR buffer[MAX_PATH];
+    if(SHGetSpecialFolderPathW(nullptr, buffer, CSIDL_LOCAL_APPDATA, FALSE) != FALSE)
+    {
+        std::string path{wstr_to_utf8(buffer)};
+        if(path.back() != '\\' && path.back() != '/')
+            path += '\\';
+        path += "openal\\hrtf-cache";
+        return path;
+    }
+#endif
+#else
+    if(auto cachepath = al::getenv("XDG_CACHE_HOME"))
+    {
+        std::string &path = *cachepath;
+        if(!path.empty() && path[0] == '/')
+        {
+            if(path.back() != '/')
+                path += '/';
+            path += "openal/hrtf";
+            return path;
+        }
+    }
+    if(auto homepath = al::getenv("HOME"))
+    {
+        std::string &path = *homepath;
+        if(!path.empty())
+        {
+            if(path.back() == '/')
+                path.pop_back();
+            path += "/.cache/openal/hrtf";
+            return path;
+        }
+    }
+#endif
+    return std::string{};
+}
+
+uint64_t HashHrtfData(const al::span<const char> data)
+{
+    /* The size is mixed in after the contents. */
+    return FnvHash(FnvHash(FnvBasis, data), uint64_t{data.size()});
+}
+
+al::optional<uint64_t> HashHrtfFile(const std::string &fname)
+{
+    FileStamp stamp{};
+    if(!GetFileStamp(fname, stamp))
+        return al::nullopt;
+
+    uint64_t hash{FnvHash(FnvBasis, {fname.data(), fname.size()})};
+    hash = FnvHash(hash, stamp.size);
+    hash = FnvHash(hash, stamp.mtime);
+    return FnvHash(hash, stamp.id);
+}
+
+al::optional<CachedHrtf> LoadCachedHrtf(const std::string &cachepath, const uint64_t hash,
+    const uint samplerate)
+{
+    const std::string fname{GetCacheFilename(cachepath, hash, samplerate)};
+    std::unique_ptr<HrtfCacheMapping> mapping{MapCacheFile(fname)};
+    if(!mapping)
+        return al::nullopt;
+
+    /* Check that the file is for this data set and build, and that the
+     * layout is self-consistent, since the mixer indexes the coefficients
+     * directly with the elevation and azimuth info.
+     */
+    CacheHeader header{};
+    if(mapping->size() < sizeof(header))
+    {
+        WARN("Ignoring truncated HRTF cache file %s\n", fname.c_str());
+        return al::nullopt;
+    }
+    std::memcpy(&header, mapping->data(), sizeof(header));
+    if(std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0
+        || header.version != CacheVersion || header.hrirLength != HrirLength
+        || header.hash != hash || header.sampleRate != samplerate)
+    {
+        WARN("Ignoring mismatched HRTF cache file %s\n", fname.c_str());
+        return al::nullopt;
+    }
+
+    const CacheLayout layout{CalcLayout(header.fdCount, header.evCount, header.irCount)};
+    if(header.irSize < 1 || header.irSize > HrirLength || header.fdCount < 1
+        || header.evCount < 1 || header.irCount < 1
+        || header.fieldOffset != layout.fieldOffset || header.elevOffset != layout.elevOffset
+        || header.coeffsOffset != layout.coeffsOffset
+        || header.delaysOffset != layout.delaysOffset || header.totalSize != layout.totalSize
+        || mapping->size() != layout.totalSize)
+    {
+        WARN("Ignoring invalid HRTF cache file %s\n", fname.c_str());
+        return al::nullopt;
+    }
+
+    const char *base{mapping->data()};
+    auto fields = reinterpret_cast<const HrtfStore::Field*>(base + layout.fieldOffset);
+    auto elevs = reinterpret_cast<const HrtfStore::Elevation*>(base + layout.elevOffset);
+    auto coeffs = reinterpret_cast<const HrirArray*>(base + layout.coeffsOffset);
+    auto delays = reinterpret_cast<const ubyte2*>(base + layout.delaysOffset);
+
+    size_t evtotal{0};
+    for(size_t i{0};i < header.fdCount;++i)
+        evtotal += fields[i].evCount;
+    size_t irtotal{0};
+    for(size_t i{0};i < header.evCount;++i)
+    {
+        if(elevs[i].irOffset != irtotal || elevs[i].azCount < 1)
+            break;
+        irtotal += elevs[i].azCount;
+    }
+    if(evtotal != header.evCount || irtotal != header.irCount)
+    {
+        WARN("Ignoring invalid HRTF cache file %s\n", fname.c_str());
+        return al::nullopt;
+    }
+
+    void *ptr{al_calloc(alignof(HrtfStore), sizeof(HrtfStore))};
+    if(!ptr) throw std::bad_alloc{};
+    std::unique_ptr<HrtfStore> hrtf{al::construct_at(static_cast<HrtfStore*>(ptr))};
+    InitRef(hrtf->mRef, 1u);
+    hrtf->sampleRate = header.sampleRate;
+    hrtf->irSize = header.irSize;
+    hrtf->fdCount = header.fdCount;
+    hrtf->field = fields;
+    hrtf->elev = elevs;
+    hrtf->coeffs = coeffs;
+    hrtf->delays = delays;
+
+    return al::make_optional<CachedHrtf>(CachedHrtf{std::move(hrtf), std::move(mapping)});
+}
+
+void StoreCachedHrtf(const std::string &cachepath, const uint64_t hash, const HrtfStore &hrtf)
+{
+    size_t evCount{0};
+    for(size_t i{0};i < hrtf.fdCount;++i)
+        evCount += hrtf.field[i].evCount;
+    const size_t irCount{size_t{hrtf.elev[evCount-1].irOffset} + hrtf.elev[evCount-1].azCount};
+
+    const CacheLayout layout{CalcLayout(hrtf.fdCount, evCount, irCount)};
+
+    CacheHeader header{};
+    std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    header.version = CacheVersion;
+    header.hrirLength = HrirLength;
+    header.hash = hash;
+    header.sampleRate = hrtf.sampleRate;
+    header.irSize = hrtf.irSize;
+    header.fdCount = hrtf.fdCount;
+    header.evCount = static_cast<uint32_t>(evCount);
+    header.irCount = static_cast<uint32_t>(irCount);
+    header.fieldOffset = static_cast<uint32_t>(layout.fieldOffset);
+    header.elevOffset = static_cast<uint32_t>(layout.elevOffset);
+    header.coeffsOffset = static_cast<uint32_t>(layout.coeffsOffset);
+    header.delaysOffset = static_cast<uint32_t>(layout.delaysOffset);
+    header.totalSize = static_cast<uint32_t>(layout.totalSize);
+
+    /* Padding between sections is left zeroed. */
+    al::vector<char> data(layout.totalSize, '\0');
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::memcpy(data.data()+layout.fieldOffset, hrtf.field,
+        sizeof(HrtfStore::Field)*hrtf.fdCount);
+    std::memcpy(data.data()+layout.elevOffset, hrtf.elev, sizeof(HrtfStore::Elevation)*evCount);
+    std::memcpy(data.data()+layout.coeffsOffset, hrtf.coeffs, sizeof(HrirArray)*irCount);
+    std::memcpy(data.data()+layout.delaysOffset, hrtf.delays, sizeof(ubyte2)*irCount);
+
+    const std::string fname{GetCacheFilename(cachepath, hash, hrtf.sampleRate)};
+    if(!MakeDirectories(cachepath) || !WriteCacheFile(fname, data))
+        WARN("Failed to write HRTF cache file %s\n", fname.c_str());
+    else
+        TRACE("Wrote HRTF cache file %s\n", fname.c_str());
+}
@@ -0,0 +1,74 @@
+#ifndef CORE_HRTF_CACHE_H
+#define CORE_HRTF_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "aloptional.h"
+#include "alspan.h"
+#include "hrtf.h"
+
+using uint = unsigned int;
+
+
+/* A read-only view of a cache file mapped into memory. */
+class HrtfCacheMapping {
+    void *mData{nullptr};
+    size_t mSize{0u};
+
+public:
+    HrtfCacheMapping(void *data, size_t size) noexcept : mData{data}, mSize{size} { }
+    HrtfCacheMapping(const HrtfCacheMapping&) = delete;
+    HrtfCacheMapping& operator=(const HrtfCacheMapping&) = delete;
+    ~HrtfCacheMapping();
+
+    const char *data() const noexcept { return static_cast<const char*>(mData); }
+    size_t size() const noexcept { return mSize; }
+};
+
+/* An HRTF store loaded from the cache. The store's fields, elevations,
+ * coefficients, and delays point into the mapping, so the mapping must be
+ * kept for as long as the store is.
+ */
+struct CachedHrtf {
+    std::unique_ptr<HrtfStore> mStore;
+    std::unique_ptr<HrtfCacheMapping> mMapping;
+};
+
+
+/**
+ * Returns the directory cached HRTFs are stored in by default, or an empty
+ * string if there isn't a suitable one.
+ */
+std::string GetDefaultHrtfCachePath();
+
+/**
+ * Hashes the contents of an HRTF data set, to identify it in the cache. Meant
+ * for data sets already in memory, like the built-in one.
+ */
+uint64_t HashHrtfData(const al::span<const char> data);
+
+/**
+ * Identifies an HRTF data set file in the cache by its path, size, and
+ * modification time, without reading it. Returns nothing if the file can't
+ * be found.
+ */
+al::optional<uint64_t> HashHrtfFile(const std::string &fname);
+
+/**
+ * Maps the cached store for the data set with the given hash at the given
+ * sample rate, if it's in the cache directory and matches this build.
+ */
+al::optional<CachedHrtf> LoadCachedHrtf(const std::string &cachepath, const uint64_t hash,
+    const uint samplerate);
+
+/**
+ * Writes the store to the cache directory, for the data set with the given
+ * hash. The store's sample rate is used as the key's sample rate.
+ */
+void StoreCachedHrtf(const std::string &cachepath, const uint64_t hash, const HrtfStore &hrtf);
+
+#endif /* CORE_HRTF_CACHE_H */
@@ -0,0 +1,436 @@
+#include "config.h"
+
+#include "hrtf_convolver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <array>
+
+#ifdef HAVE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "alnumbers.h"
+#include "alnumeric.h"
+#include "bufferline.h"
+
+
+namespace {
+
+/* Partition sizes to consider. The FFTs are twice the partition size, and the
+ * largest needs its output to fit in the HRIR-length accumulation tail.
+ */
+constexpr uint PartitionSizes[]{16, 32, 64};
+static_assert(64*2 <= HrirLength, "Partition size too large for the accumulation buffer");
+
+/* Rough costs of the frequency-domain work, relative to applying one
+ * coefficient pair to a sample in the time domain: the cost of an FFT of N
+ * points (including preparing its input and separating its output) is about
+ * FftCost*N*(log2(N)+4), and the cost of accumulating the product of an input
+ * and filter bin for one ear is about MacCost.
+ */
+constexpr float FftCost{1.75f};
+constexpr float MacCost{3.5f};
+/* The estimate is rough, so partitioned convolution needs to be clearly
+ * cheaper than the time domain to be used.
+ */
+constexpr float MinSavings{0.8f};
+
+
+/* Does one radix-2 stage of the FFT, combining pairs of transforms of size n
+ * (a multiple of 4) using the given twiddle factors.
+ */
+void FftStage(float *RESTRICT re, float *RESTRICT im, const size_t fftsize, const size_t n,
+    const float *RESTRICT twr, const float *RESTRICT twi)
+{
+    for(size_t base{0};base < fftsize;base += n*2)
+    {
+        float *RESTRICT re0{re + base}, *RESTRICT re1{re + base + n};
+        float *RESTRICT im0{im + base}, *RESTRICT im1{im + base + n};
+#ifdef HAVE_SSE_INTRINSICS
+        for(size_t i{0};i < n;i += 4)
+        {
+            const __m128 wr{_mm_load_ps(&twr[i])}, wi{_mm_load_ps(&twi[i])};
+            const __m128 r1{_mm_load_ps(&re1[i])}, i1{_mm_load_ps(&im1[i])};
+            const __m128 tr{_mm_sub_ps(_mm_mul_ps(r1, wr), _mm_mul_ps(i1, wi))};
+            const __m128 ti{_mm_add_ps(_mm_mul_ps(r1, wi), _mm_mul_ps(i1, wr))};
+            const __m128 r0{_mm_load_ps(&re0[i])}, i0{_mm_load_ps(&im0[i])};
+            _mm_store_ps(&re1[i], _mm_sub_ps(r0, tr));
+            _mm_store_ps(&im1[i], _mm_sub_ps(i0, ti));
+            _mm_store_ps(&re0[i], _mm_add_ps(r0, tr));
+            _mm_store_ps(&im0[i], _mm_add_ps(i0, ti));
+        }
+#elif defined(HAVE_NEON)
+        for(size_t i{0};i < n;i += 4)
+        {
+            const float32x4_t wr{vld1q_f32(&twr[i])}, wi{vld1q_f32(&twi[i])};
+            const float32x4_t r1{vld1q_f32(&re1[i])}, i1{vld1q_f32(&im1[i])};
+            const float32x4_t tr{vmlsq_f32(vmulq_f32(r1, wr), i1, wi)};
+            const float32x4_t ti{vmlaq_f32(vmulq_f32(r1, wi), i1, wr)};
+            const float32x4_t r0{vld1q_f32(&re0[i])}, i0{vld1q_f32(&im0[i])};
+            vst1q_f32(&re1[i], vsubq_f32(r0, tr));
+            vst1q_f32(&im1[i], vsubq_f32(i0, ti));
+            vst1q_f32(&re0[i], vaddq_f32(r0, tr));
+            vst1q_f32(&im0[i], vaddq_f32(i0, ti));
+        }
+#else
+        for(size_t i{0};i < n;++i)
+        {
+            const float tr{re1[i]*twr[i] - im1[i]*twi[i]};
+            const float ti{re1[i]*twi[i] + im1[i]*twr[i]};
+            re1[i] = re0[i] - tr; im1[i] = im0[i] - ti;
+            re0[i] += tr; im0[i] += ti;
+        }
+#endif
+    }
+}
+
+/* Sums the products of each channel's recent input spectra with the matching
+ * filter partitions (aligned in time), for both ears. The spectra for each
+ * group of 4 bins are accumulated across all channels and partitions at once.
+ */
+void AccumulateSpectra(float *RESTRICT output, const float *RESTRICT spectra,
+    const float *RESTRICT filters, const size_t numchans, const size_t numparts,
+    const size_t curpart, const size_t binstride)
+{
+    for(size_t i{0};i < binstride;i += 4)
+    {
+        const float *RESTRICT filter{filters + i};
+#ifdef HAVE_SSE_INTRINSICS
+        __m128 lr{_mm_setzero_ps()}, li{_mm_setzero_ps()};
+        __m128 rr{_mm_setzero_ps()}, ri{_mm_setzero_ps()};
+#elif defined(HAVE_NEON)
+        float32x4_t lr{vdupq_n_f32(0.0f)}, li{vdupq_n_f32(0.0f)};
+        float32x4_t rr{vdupq_n_f32(0.0f)}, ri{vdupq_n_f32(0.0f)};
+#else
+        std::array<float,4> lr{}, li{}, rr{}, ri{};
+#endif
+        for(size_t c{0};c < numchans;++c)
+        {
+            const float *RESTRICT chanspectra{spectra + c*numparts*2*binstride + i};
+            for(size_t p{0};p < numparts;++p)
+            {
+                size_t part{curpart + p};
+                if(part >= numparts) part -= numparts;
+                const float *RESTRICT input{chanspectra + part*2*binstride};
+
+#ifdef HAVE_SSE_INTRINSICS
+                const __m128 xr{_mm_load_ps(input)}, xi{_mm_load_ps(input + binstride)};
+                __m128 hr{_mm_load_ps(filter)}, hi{_mm_load_ps(filter + binstride)};
+                lr = _mm_add_ps(lr, _mm_sub_ps(_mm_mul_ps(xr, hr), _mm_mul_ps(xi, hi)));
+                li = _mm_add_ps(li, _mm_add_ps(_mm_mul_ps(xr, hi), _mm_mul_ps(xi, hr)));
+                hr = _mm_load_ps(filter + binstride*2); hi = _mm_load_ps(filter + binstride*3);
+                rr = _mm_add_ps(rr, _mm_sub_ps(_mm_mul_ps(xr, hr), _mm_mul_ps(xi, hi)));
+                ri = _mm_add_ps(ri, _mm_add_ps(_mm_mul_ps(xr, hi), _mm_mul_ps(xi, hr)));
+#elif defined(HAVE_NEON)
+                const float32x4_t xr{vld1q_f32(input)}, xi{vld1q_f32(input + binstride)};
+                float32x4_t hr{vld1q_f32(filter)}, hi{vld1q_f32(filter + binstride)};
+                lr = vmlsq_f32(vmlaq_f32(lr, xr, hr), xi, hi);
+                li = vmlaq_f32(vmlaq_f32(li, xr, hi), xi, hr);
+                hr = vld1q_f32(filter + binstride*2); hi = vld1q_f32(filter + binstride*3);
+                rr = vmlsq_f32(vmlaq_f32(rr, xr, hr), xi, hi);
+                ri = vmlaq_f32(vmlaq_f32(ri, xr, hi), xi, hr);
+#else
+                for(size_t j{0};j < 4;++j)
+                {
+                    const float xr{input[j]}, xi{input[binstride + j]};
+                    lr[j] += xr*filter[j] - xi*filter[binstride + j];
+                    li[j] += xr*filter[binstride + j] + xi*filter[j];
+                    rr[j] += xr*filter[binstride*2 + j] - xi*filter[binstride*3 + j];
+                    ri[j] += xr*filter[binstride*3 + j] + xi*filter[binstride*2 + j];
+                }
+#endif
+                filter += binstride*4;
+            }
+        }
+#ifdef HAVE_SSE_INTRINSICS
+        _mm_store_ps(output + i, lr);
+        _mm_store_ps(output + binstride + i, li);
+        _mm_store_ps(output + binstride*2 + i, rr);
+        _mm_store_ps(output + binstride*3 + i, ri);
+#elif defined(HAVE_NEON)
+        vst1q_f32(output + i, lr);
+        vst1q_f32(output + binstride + i, li);
+        vst1q_f32(output + binstride*2 + i, rr);
+        vst1q_f32(output + binstride*3 + i, ri);
+#else
+        std::copy(lr.cbegin(), lr.cend(), output + i);
+        std::copy(li.cbegin(), li.cend(), output + binstride + i);
+        std::copy(rr.cbegin(), rr.cend(), output + binstride*2 + i);
+        std::copy(ri.cbegin(), ri.cend(), output + binstride*3 + i);
+#endif
+    }
+}
+
+/* Separates the spectra of two real signals from the FFT of the first plus
+ * the second times i, for the non-negative frequency bins. The outputs are
+ * the real parts followed by the imaginary parts, each stride bins long.
+ */
+void SplitSpectra(const float *RESTRICT fftreal, const float *RESTRICT fftimag,
+    const size_t fftsize, float *RESTRICT out0, float *RESTRICT out1, const size_t stride,
+    const float scale)
+{
+    const size_t fftmask{fftsize - 1};
+    const float halfscale{0.5f * scale};
+    for(size_t i{0};i <= fftsize/2;++i)
+    {
+        const size_t j{(fftsize-i) & fftmask};
+        out0[i]        = (fftreal[i] + fftreal[j]) * halfscale;
+        out0[stride+i] = (fftimag[i] - fftimag[j]) * halfscale;
+        out1[i]        = (fftimag[i] + fftimag[j]) * halfscale;
+        out1[stride+i] = (fftreal[j] - fftreal[i]) * halfscale;
+    }
+}
+
+} // namespace
+
+
+HrtfTailConvolver::HrtfTailConvolver(const size_t partsize, const size_t numparts,
+    const size_t numchans)
+    : mPartSize{partsize}, mNumParts{numparts}, mNumChans{numchans}
+    , mBinStride{RoundUp(partsize+1, 4)}
+{
+    const size_t fftsize{partsize * 2};
+
+    /* Padding bins are left zeroed. */
+    mInput.resize(numchans * (BufferLineSize+partsize));
+    mInputSpectra.resize(numchans * numparts * 2*mBinStride);
+    mFilters.resize(numchans * numparts * 2 * 2*mBinStride);
+    mOutput.resize(2 * 2*mBinStride);
+
+    mFftReal.resize(fftsize);
+    mFftImag.resize(fftsize);
+    mTwiddleReal.resize(fftsize);
+    mTwiddleImag.resize(fftsize);
+    for(size_t n{1};n < fftsize;n <<= 1)
+    {
+        for(size_t i{0};i < n;++i)
+        {
+            const double arg{-al::numbers::pi * static_cast<double>(i) / static_cast<double>(n)};
+            mTwiddleReal[n+i] = static_cast<float>(std::cos(arg));
+            mTwiddleImag[n+i] = static_cast<float>(std::sin(arg));
+        }
+    }
+
+    size_t log2_size{0};
+    while((size_t{1}<<log2_size) < fftsize)
+        ++log2_size;
+    mBitReverse.resize(fftsize);
+    for(size_t idx{0};idx < fftsize;++idx)
+    {
+        size_t revidx{0}, imask{idx};
+        for(size_t i{0};i < log2_size;++i)
+        {
+            revidx = (revidx<<1) | (imask&1);
+            imask >>= 1;
+        }
+        mBitReverse[idx] = static_cast<ushort>(revidx);
+    }
+}
+
+void HrtfTailConvolver::transformReversed() noexcept
+{
+    const size_t fftsize{mFftReal.size()};
+    float *RESTRICT re{mFftReal.data()};
+    float *RESTRICT im{mFftImag.data()};
+
+    /* The first two stages only need trivial twiddle factors (1 and -i). */
+    for(size_t i{0};i < fftsize;i += 4)
+    {
+        const float r0{re[i] + re[i+1]}, i0{im[i] + im[i+1]};
+        const float r1{re[i] - re[i+1]}, i1{im[i] - im[i+1]};
+        const float r2{re[i+2] + re[i+3]}, i2{im[i+2] + im[i+3]};
+        const float r3{re[i+2] - re[i+3]}, i3{im[i+2] - im[i+3]};
+        re[i]   = r0 + r2; im[i]   = i0 + i2;
+        re[i+2] = r0 - r2; im[i+2] = i0 - i2;
+        re[i+1] = r1 + i3; im[i+1] = i1 - r3;
+        re[i+3] = r1 - i3; im[i+3] = i1 + r3;
+    }
+    for(size_t n{4};n < fftsize;n <<= 1)
+        FftStage(re, im, fftsize, n, &mTwiddleReal[n], &mTwiddleImag[n]);
+}
+
+void HrtfTailConvolver::transformPadded(const float *in0, const float *in1) noexcept
+{
+    const size_t fftsize{mFftReal.size()};
+    float *RESTRICT re{mFftReal.data()};
+    float *RESTRICT im{mFftImag.data()};
+
+    /* With the second half of the input being zeros, every odd element is
+     * zero after bit-reversal, which simplifies the first two stages to
+     * combining pairs of input samples.
+     */
+    for(size_t i{0};i < fftsize;i += 4)
+    {
+        const size_t idx0{mBitReverse[i]}, idx1{mBitReverse[i+2]};
+        const float ur{in0[idx0]}, ui{in1 ? in1[idx0] : 0.0f};
+        const float vr{in0[idx1]}, vi{in1 ? in1[idx1] : 0.0f};
+        re[i]   = ur + vr; im[i]   = ui + vi;
+        re[i+2] = ur - vr; im[i+2] = ui - vi;
+        re[i+1] = ur + vi; im[i+1] = ui - vr;
+        re[i+3] = ur - vi; im[i+3] = ui + vr;
+    }
+    for(size_t n{4};n < fftsize;n <<= 1)
+        FftStage(re, im, fftsize, n, &mTwiddleReal[n], &mTwiddleImag[n]);
+}
+
+uint HrtfTailConvolver::ChoosePartitionSize(const uint irSize, const size_t numchans)
+{
+    /* The time-domain cost is one coefficient pair per sample for each
+     * channel. Partitioned convolution still applies the head in the time
+     * domain, and for each block, transforms every channel's input (two
+     * channels per FFT), accumulates each channel's spectrum with each tail
+     * partition for both ears, and does one inverse transform for the lot.
+     */
+    const float nchans{static_cast<float>(numchans)};
+    float bestcost{static_cast<float>(irSize) * MinSavings};
+    uint bestsize{0};
+    for(const uint partsize : PartitionSizes)
+    {
+        if(irSize <= partsize)
+            break;
+
+        const size_t numparts{(irSize - partsize + partsize-1) / partsize};
+        const float fftsize{static_cast<float>(partsize * 2)};
+        const float fftcost{FftCost * fftsize * (std::log2(fftsize) + 4.0f)};
+        const float blockcost{fftcost*(0.5f + 1.0f/nchans)
+            + MacCost*static_cast<float>(numparts*2*(partsize+1))};
+        const float cost{static_cast<float>(partsize) + blockcost/static_cast<float>(partsize)};
+        if(cost < bestcost)
+        {
+            bestcost = cost;
+            bestsize = partsize;
+        }
+    }
+    return bestsize;
+}
+
+void HrtfTailConvolver::setFilter(const size_t chan, const ConstHrirSpan coeffs,
+    const uint irSize)
+{
+    const size_t fftsize{mFftReal.size()};
+    /* The inverse FFT's scaling is applied to the filter ahead of time. */
+    const float scale{1.0f / static_cast<float>(fftsize)};
+    for(size_t p{0};p < mNumParts;++p)
+    {
+        const size_t offset{mPartSize * (p+1)};
+        const size_t count{(offset < irSize) ? minz(mPartSize, irSize-offset) : 0};
+
+        std::fill(mFftReal.begin(), mFftReal.end(), 0.0f);
+        std::fill(mFftImag.begin(), mFftImag.end(), 0.0f);
+        for(size_t i{0};i < count;++i)
+        {
+            mFftReal[mBitReverse[i]] = coeffs[offset+i][0];
+            mFftImag[mBitReverse[i]] = coeffs[offset+i][1];
+        }
+        transformReversed();
+
+        float *filter{&mFilters[(chan*mNumParts + p) * 2*2*mBinStride]};
+        SplitSpectra(mFftReal.data(), mFftImag.data(), fftsize, filter, filter + 2*mBinStride,
+            mBinStride, scale);
+    }
+}
+
+void HrtfTailConvolver::writeInput(const size_t chan, const al::span<const float> input)
+{
+    std::copy(input.begin(), input.end(),
+        mInput.begin() + static_cast<ptrdiff_t>(chan*(BufferLineSize+mPartSize) + mFifoPos));
+}
+
+void HrtfTailConvolver::process(float2 *RESTRICT AccumSamples, const size_t todo)
+{
+    const size_t fftsize{mFftReal.size()};
+    const size_t numbins{mPartSize + 1};
+    const size_t binstride{mBinStride};
+    const size_t stride{BufferLineSize + mPartSize};
+    const size_t total{mFifoPos + todo};
+
+    size_t base{0};
+    for(;total-base >= mPartSize;base += mPartSize)
+    {
+        /* The newest input spectra replace the oldest in the ring. */
+        mCurrentPart = mCurrentPart ? (mCurrentPart-1) : (mNumParts-1);
+
+        /* Transform the completed block of two channels at a time, with one
+         * as the real part and the other as the imaginary part.
+         */
+        for(size_t c{0};c < mNumChans;c += 2)
+        {
+            const float *input0{&mInput[c*stride + base]};
+            float *spectrum0{&mInputSpectra[(c*mNumParts + mCurrentPart) * 2*binstride]};
+            if(c+1 < mNumChans)
+            {
+                transformPadded(input0, &mInput[(c+1)*stride + base]);
+
+                float *spectrum1{&mInputSpectra[((c+1)*mNumParts + mCurrentPart) * 2*binstride]};
+                SplitSpectra(mFftReal.data(), mFftImag.data(), fftsize, spectrum0, spectrum1,
+                    binstride, 1.0f);
+            }
+            else
+            {
+                transformPadded(input0, nullptr);
+
+                std::copy_n(mFftReal.cbegin(), numbins, spectrum0);
+                std::copy_n(mFftImag.cbegin(), numbins, spectrum0+binstride);
+            }
+        }
+
+        AccumulateSpectra(mOutput.data(), mInputSpectra.data(), mFilters.data(), mNumChans,
+            mNumParts, mCurrentPart, binstride);
+
+        /* Combine the ears into one inverse FFT, with the left output as the
+         * real part and the right as the imaginary part. The negative
+         * frequencies are reconstructed from the positive ones, and the
+         * inverse is done as a forward transform of the conjugate.
+         */
+        const float *RESTRICT leftre{mOutput.data()};
+        const float *RESTRICT leftim{leftre + binstride};
+        const float *RESTRICT rightre{leftim + binstride};
+        const float *RESTRICT rightim{rightre + binstride};
+        for(size_t i{0};i < numbins;++i)
+        {
+            mFftReal[mBitReverse[i]] = leftre[i] - rightim[i];
+            mFftImag[mBitReverse[i]] = -(leftim[i] + rightre[i]);
+        }
+        for(size_t i{numbins};i < fftsize;++i)
+        {
+            const size_t j{fftsize - i};
+            mFftReal[mBitReverse[i]] = leftre[j] + rightim[j];
+            mFftImag[mBitReverse[i]] = leftim[j] - rightre[j];
+        }
+        transformReversed();
+
+        /* The tail response starts right after the block it's for, which the
+         * head covers in the meantime.
+         */
+        float2 *accum{AccumSamples + (base + mPartSize - mFifoPos)};
+        for(size_t i{0};i < fftsize;++i)
+        {
+            accum[i][0] += mFftReal[i];
+            accum[i][1] -= mFftImag[i];
+        }
+    }
+
+    /* Move any samples of the incomplete block to the front for next time. */
+    const size_t remaining{total - base};
+    if(base > 0 && remaining > 0)
+    {
+        for(size_t c{0};c < mNumChans;++c)
+        {
+            auto input = mInput.begin() + static_cast<ptrdiff_t>(c*stride);
+            std::copy(input+static_cast<ptrdiff_t>(base), input+static_cast<ptrdiff_t>(total),
+                input);
+        }
+    }
+    mFifoPos = remaining;
+}
+
+
+std::unique_ptr<HrtfTailConvolver> HrtfTailConvolver::Create(const uint irSize,
+    const uint partsize, const size_t numchans)
+{
+    const size_t numparts{(irSize - partsize + partsize-1) / partsize};
+    return std::make_unique<HrtfTailConvolver>(partsize, numparts, numchans);
+}
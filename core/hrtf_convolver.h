@@ -0,0 +1,105 @@
+#ifndef CORE_HRTF_CONVOLVER_H
+#define CORE_HRTF_CONVOLVER_H
+
+#include <stddef.h>
+
+#include <memory>
+
+#include "almalloc.h"
+#include "alspan.h"
+#include "mixer/hrtfdefs.h"
+#include "opthelpers.h"
+#include "vector.h"
+
+using ushort = unsigned short;
+using uint = unsigned int;
+
+
+/* Applies the tail of fixed, per-channel HRIRs in the frequency domain, using
+ * uniformly partitioned convolution. The first partition's worth of each HRIR
+ * (the head) is left for the time-domain mixer, which makes up for the block
+ * of latency the FFTs need, so the combined result has no added latency. Each
+ * completed input block is transformed once, and its spectrum is reused for
+ * every partition of the tail, while the output of all channels is summed in
+ * the frequency domain so only one inverse transform is needed per block.
+ */
+class HrtfTailConvolver {
+    const size_t mPartSize;
+    const size_t mNumParts;
+    const size_t mNumChans;
+    /* The number of frequency bins kept for a real signal, padded to a
+     * multiple of 4 for SIMD.
+     */
+    const size_t mBinStride;
+
+    /* Samples of the current, incomplete block, held between calls. */
+    size_t mFifoPos{0};
+    /* The ring position of the newest input spectrum. */
+    size_t mCurrentPart{0};
+
+    /* Spectra are stored as the real parts of the bins, followed by the
+     * imaginary parts. The filters and output have the left ear's spectrum
+     * followed by the right ear's.
+     */
+    al::vector<float,16> mInput;
+    al::vector<float,16> mInputSpectra;
+    al::vector<float,16> mFilters;
+    al::vector<float,16> mOutput;
+
+    /* Work buffers for a complex FFT of twice the partition size, with the
+     * bit-reversed indices and twiddle factors precomputed. The twiddle
+     * factors for the stage combining transforms of size n start at index n.
+     */
+    al::vector<float,16> mFftReal;
+    al::vector<float,16> mFftImag;
+    al::vector<float,16> mTwiddleReal;
+    al::vector<float,16> mTwiddleImag;
+    al::vector<ushort> mBitReverse;
+
+    /* Transforms the work buffers, which must be in bit-reversed order. */
+    void transformReversed() noexcept;
+    /**
+     * Transforms a block of input with an implicit block of zeros after it,
+     * taking the real part from in0 and the imaginary part from in1 (if not
+     * null).
+     */
+    void transformPadded(const float *in0, const float *in1) noexcept;
+
+public:
+    HrtfTailConvolver(const size_t partsize, const size_t numparts, const size_t numchans);
+    HrtfTailConvolver(const HrtfTailConvolver&) = delete;
+    HrtfTailConvolver& operator=(const HrtfTailConvolver&) = delete;
+
+    /**
+     * Returns the partition size that makes frequency-domain convolution of
+     * HRIRs with the given length cheapest, or 0 if convolving them directly
+     * in the time domain would be cheaper.
+     */
+    static uint ChoosePartitionSize(const uint irSize, const size_t numchans);
+
+    /** The number of leading coefficients the time-domain mixer applies. */
+    size_t getHeadSize() const noexcept { return mPartSize; }
+
+    /**
+     * Sets the channel's HRIR, of which the coefficients from the end of the
+     * head up to irSize are applied here.
+     */
+    void setFilter(const size_t chan, const ConstHrirSpan coeffs, const uint irSize);
+
+    /** Provides the next input samples for the channel. */
+    void writeInput(const size_t chan, const al::span<const float> input);
+
+    /**
+     * Adds the tail response of the samples written since the last call to
+     * the HRTF accumulation buffer. Each channel must have been given todo
+     * samples.
+     */
+    void process(float2 *RESTRICT AccumSamples, const size_t todo);
+
+    static std::unique_ptr<HrtfTailConvolver> Create(const uint irSize, const uint partsize,
+        const size_t numchans);
+
+    DEF_NEWDEL(HrtfTailConvolver)
+};
+
+#endif /* CORE_HRTF_CONVOLVER_H */
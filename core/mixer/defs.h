@@ -2,15 +2,26 @@
 #define CORE_MIXER_DEFS_H
 
 #include <array>
+#include <stdint.h>
 #include <stdlib.h>
 
+#include "albyte.h"
+#include "alnumeric.h"
 #include "alspan.h"
 #include "core/bufferline.h"
 #include "core/resampler_limits.h"
 
 struct HrtfChannelState;
 struct HrtfFilter;
+class HrtfTailConvolver;
 struct MixHrtfFilter;
+struct PolyphaseTable;
+
+struct UByteTag;
+struct ShortTag;
+struct FloatTag;
+struct MulawTag;
+struct AlawTag;
 
 using uint = unsigned int;
 using float2 = std::array<float,2>;
@@ -20,6 +31,9 @@ constexpr int MixerFracBits{12};
 constexpr int MixerFracOne{1 << MixerFracBits};
 constexpr int MixerFracMask{MixerFracOne - 1};
 
+/* Maximum source samples stepped over per output sample. */
+constexpr uint MaxPitch{10};
+
 constexpr float GainSilenceThreshold{0.00001f}; /* -100dB */
 
 
@@ -50,19 +64,51 @@ struct BsincState {
     const float *filter;
 };
 
+/* Filters for a fixed step, one for each phase the step lands on, so they can
+ * be applied without interpolating.
+ */
+struct PolyphaseState {
+    uint m; /* Coefficient count. */
+    uint l; /* Left coefficient offset. */
+    uint shift; /* Fractional position to phase index shift. */
+    const float *filter; /* m coefficients per phase, contiguously. */
+};
+
 union InterpState {
     BsincState bsinc;
+    PolyphaseState polyphase;
 };
 
 using ResamplerFunc = float*(*)(const InterpState *state, float *RESTRICT src, uint frac,
     uint increment, const al::span<float> dst);
+/* Resamples each src channel to the matching dst line, all from the same
+ * position with the same step, so the filter for each output sample only
+ * needs to be found once for all of them.
+ */
+using ResamplerMultiFunc = void(*)(const InterpState *state, const al::span<float*const> src,
+    uint frac, uint increment, const al::span<float*const> dst, const size_t dstlen);
 
 ResamplerFunc PrepareResampler(Resampler resampler, uint increment, InterpState *state);
+ResamplerFunc PreparePolyphase(const PolyphaseTable &table, InterpState *state);
+ResamplerMultiFunc PreparePolyphaseMulti();
+
+/* Returns the fixed-point step through the source samples for the given pitch
+ * (including the source-to-output rate ratio).
+ */
+inline uint PitchToStep(const float pitch) noexcept
+{
+    if(pitch > float{MaxPitch})
+        return MaxPitch<<MixerFracBits;
+    return maxu(fastf2u(pitch * MixerFracOne), 1);
+}
 
 
 template<typename TypeTag, typename InstTag>
 float *Resample_(const InterpState *state, float *RESTRICT src, uint frac, uint increment,
     const al::span<float> dst);
+template<typename TypeTag, typename InstTag>
+void ResampleMulti_(const InterpState *state, const al::span<float*const> src, uint frac,
+    uint increment, const al::span<float*const> dst, const size_t dstlen);
 
 template<typename InstTag>
 void Mix_(const al::span<const float> InSamples, const al::span<FloatBufferLine> OutBuffer,
@@ -77,7 +123,20 @@ void MixHrtfBlend_(const float *InSamples, float2 *AccumSamples, const uint IrSi
 template<typename InstTag>
 void MixDirectHrtf_(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
     const al::span<const FloatBufferLine> InSamples, float2 *AccumSamples,
-    float *TempBuf, HrtfChannelState *ChanState, const size_t IrSize, const size_t BufferSize);
+    float *TempBuf, HrtfChannelState *ChanState, HrtfTailConvolver *TailConv, const size_t IrSize,
+    const size_t BufferSize);
+
+/* Converts frames of interleaved samples to float, de-interleaving them into
+ * each dst line. Supports mono, or an even number of channels.
+ */
+template<typename TypeTag, typename InstTag>
+void LoadInterleaved_(const al::span<float*> dst, const size_t dstOffset, const al::byte *src,
+    const size_t frames);
+
+/* Converts half-float samples, srcstep values apart, to float. */
+template<typename InstTag>
+void LoadHalf_(float *RESTRICT dst, const uint16_t *src, const size_t srcstep,
+    const size_t samples);
 
 /* Vectorized resampler helpers */
 template<size_t N>
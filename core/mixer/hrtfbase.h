@@ -5,6 +5,7 @@
 #include <cmath>
 
 #include "almalloc.h"
+#include "core/hrtf_convolver.h"
 #include "hrtfdefs.h"
 #include "opthelpers.h"
 
@@ -86,20 +87,24 @@ inline void MixHrtfBlendBase(const float *InSamples, float2 *RESTRICT AccumSampl
 template<ApplyCoeffsT ApplyCoeffs>
 inline void MixDirectHrtfBase(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
     const al::span<const FloatBufferLine> InSamples, float2 *RESTRICT AccumSamples,
-    float *TempBuf, HrtfChannelState *ChanState, const size_t IrSize, const size_t BufferSize)
+    float *TempBuf, HrtfChannelState *ChanState, HrtfTailConvolver *TailConv, const size_t IrSize,
+    const size_t BufferSize)
 {
     ASSUME(BufferSize > 0);
 
-    for(const FloatBufferLine &input : InSamples)
+    for(size_t c{0};c < InSamples.size();++c)
     {
         /* For dual-band processing, the signal needs extra scaling applied to
          * the high frequency response. The band-splitter applies this scaling
          * with a consistent phase shift regardless of the scale amount.
          */
-        ChanState->mSplitter.processHfScale({input.data(), BufferSize}, TempBuf,
+        ChanState->mSplitter.processHfScale({InSamples[c].data(), BufferSize}, TempBuf,
             ChanState->mHfScale);
 
-        /* Now apply the HRIR coefficients to this channel. */
+        /* Now apply the HRIR coefficients to this channel. With a tail
+         * convolver, IrSize only covers the head of the HRIRs, and the rest
+         * is applied from the same input below.
+         */
         const float *RESTRICT tempbuf{al::assume_aligned<16>(TempBuf)};
         const ConstHrirSpan Coeffs{ChanState->mCoeffs};
         for(size_t i{0u};i < BufferSize;++i)
@@ -107,9 +112,13 @@ inline void MixDirectHrtfBase(const FloatBufferSpan LeftOut, const FloatBufferSp
             const float insample{tempbuf[i]};
             ApplyCoeffs(AccumSamples+i, IrSize, Coeffs, insample, insample);
         }
+        if(TailConv)
+            TailConv->writeInput(c, {tempbuf, BufferSize});
 
         ++ChanState;
     }
+    if(TailConv)
+        TailConv->process(AccumSamples, BufferSize);
 
     /* Add the HRTF signal to the existing "direct" signal. */
     float *RESTRICT left{al::assume_aligned<16>(LeftOut.data())};
@@ -0,0 +1,99 @@
+#ifndef CORE_MIXER_LOADBASE_H
+#define CORE_MIXER_LOADBASE_H
+
+#include <algorithm>
+#include <assert.h>
+
+#include "albyte.h"
+#include "alnumeric.h"
+#include "alspan.h"
+#include "core/buffer_storage.h"
+#include "core/fmt_traits.h"
+#include "defs.h"
+#include "opthelpers.h"
+
+
+template<typename TypeTag>
+struct LoadTypeTraits { };
+
+template<>
+struct LoadTypeTraits<UByteTag> { static constexpr FmtType Type{FmtUByte}; };
+template<>
+struct LoadTypeTraits<ShortTag> { static constexpr FmtType Type{FmtShort}; };
+template<>
+struct LoadTypeTraits<FloatTag> { static constexpr FmtType Type{FmtFloat}; };
+template<>
+struct LoadTypeTraits<MulawTag> { static constexpr FmtType Type{FmtMulaw}; };
+template<>
+struct LoadTypeTraits<AlawTag> { static constexpr FmtType Type{FmtAlaw}; };
+
+
+/* Converts count contiguous samples to float. */
+using LoadConvertT = void(&)(float *RESTRICT dst, const al::byte *src, const size_t count);
+/* De-interleaves frames of float samples into each dst line. */
+using DeinterleaveT = void(&)(const al::span<float*> dst, const size_t dstOffset,
+    const float *RESTRICT src, const size_t frames);
+
+/* The functions here get built for each mixer's instruction set, so they're
+ * kept local to each translation unit. Otherwise the linker could pick an
+ * AVX2 build of them for the other mixers.
+ */
+namespace {
+
+template<typename TypeTag>
+inline void ConvertSamplesBase(float *RESTRICT dst, const al::byte *src, const size_t count)
+{ al::LoadSampleArray<LoadTypeTraits<TypeTag>::Type>(dst, src, 1, count); }
+
+/* Float samples are already converted, so they just need copying. */
+template<>
+inline void ConvertSamplesBase<FloatTag>(float *RESTRICT dst, const al::byte *src,
+    const size_t count)
+{ std::copy_n(reinterpret_cast<const float*>(src), count, dst); }
+
+/* Handles the frames left over after de-interleaving in groups. */
+inline void DeinterleaveRemainder(const al::span<float*> dst, const size_t dstOffset,
+    const float *RESTRICT src, const size_t start, const size_t frames)
+{
+    const size_t numchans{dst.size()};
+    for(size_t c{0};c < numchans;++c)
+    {
+        float *RESTRICT out{dst[c] + dstOffset};
+        for(size_t i{start};i < frames;++i)
+            out[i] = src[i*numchans + c];
+    }
+}
+
+/* Converts the source samples in chunks small enough to stay in the cache,
+ * then de-interleaves each chunk into the channel lines. Mono samples just
+ * need converting.
+ */
+template<typename TypeTag, LoadConvertT Convert, DeinterleaveT Deinterleave>
+void LoadInterleavedBase(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{
+    using SampleType = typename al::FmtTypeTraits<LoadTypeTraits<TypeTag>::Type>::Type;
+    constexpr size_t ChunkSize{1024};
+
+    const size_t numchans{dst.size()};
+    if(numchans == 1)
+    {
+        Convert(dst[0]+dstOffset, src, frames);
+        return;
+    }
+
+    assert(numchans <= ChunkSize/4);
+    const size_t chunkframes{(ChunkSize/numchans) & ~size_t{3}};
+
+    alignas(16) float tmp[ChunkSize];
+    for(size_t done{0};done < frames;)
+    {
+        const size_t todo{minz(frames-done, chunkframes)};
+        Convert(tmp, src + done*numchans*sizeof(SampleType), todo*numchans);
+        Deinterleave(dst, dstOffset+done, tmp, todo);
+        done += todo;
+    }
+}
+
+} // namespace
+
+#endif /* CORE_MIXER_LOADBASE_H */
@@ -0,0 +1,788 @@
+#include "config.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "almalloc.h"
+#include "alnumeric.h"
+#include "core/bsinc_defs.h"
+#include "core/buffer_storage.h"
+#include "core/fmt_traits.h"
+#include "core/hrtf_convolver.h"
+#include "defs.h"
+#include "hrtfdefs.h"
+#include "opthelpers.h"
+
+struct AVX2Tag;
+struct LerpTag;
+struct CubicTag;
+struct BSincTag;
+struct FastBSincTag;
+struct PolyphaseTag;
+
+
+#if defined(__GNUC__) && !defined(__clang__) \
+    && !(defined(__AVX2__) && defined(__FMA__) && defined(__F16C__))
+#pragma GCC target("avx2,fma,f16c")
+#elif defined(__clang__) && !(defined(__AVX2__) && defined(__FMA__) && defined(__F16C__))
+#pragma clang attribute push(__attribute__((target("avx2,fma,f16c"))), apply_to=function)
+#define AVX2_CLANG_ATTRIBUTE_PUSHED
+#endif
+
+/* Included after setting the target so the HRTF mixing and sample loading
+ * loops are built for AVX2 too, letting ApplyCoeffs and the converters inline
+ * into them. Their own dependencies are included above to keep them built for
+ * the default target.
+ */
+#include "hrtfbase.h"
+#include "loadbase.h"
+
+namespace {
+
+constexpr uint FracPhaseBitDiff{MixerFracBits - BSincPhaseBits};
+constexpr uint FracPhaseDiffOne{1 << FracPhaseBitDiff};
+
+inline float reduce_add(const __m256 r8)
+{
+    __m128 r4{_mm_add_ps(_mm256_castps256_ps128(r8), _mm256_extractf128_ps(r8, 1))};
+    r4 = _mm_add_ps(r4, _mm_movehl_ps(r4, r4));
+    r4 = _mm_add_ss(r4, _mm_shuffle_ps(r4, r4, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(r4);
+}
+
+/* The cubic resampler keeps the C version's order of operations, without
+ * fused multiply-adds, so it gives the exact same results. GCC would otherwise
+ * fuse the multiplies and adds itself.
+ */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
+inline __m256 cubic8(const __m256 val1, const __m256 val2, const __m256 val3, const __m256 val4,
+    const __m256 mu)
+{
+    const __m256 mu2{_mm256_mul_ps(mu, mu)}, mu3{_mm256_mul_ps(mu2, mu)};
+    const __m256 a0{_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(-0.5f), mu3), mu2),
+        _mm256_mul_ps(_mm256_set1_ps(-0.5f), mu))};
+    const __m256 a1{_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(1.5f), mu3),
+        _mm256_mul_ps(_mm256_set1_ps(-2.5f), mu2)), _mm256_set1_ps(1.0f))};
+    const __m256 a2{_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(-1.5f), mu3),
+        _mm256_mul_ps(_mm256_set1_ps(2.0f), mu2)), _mm256_mul_ps(_mm256_set1_ps(0.5f), mu))};
+    const __m256 a3{_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), mu3),
+        _mm256_mul_ps(_mm256_set1_ps(-0.5f), mu2))};
+    return _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(val1, a0),
+        _mm256_mul_ps(val2, a1)), _mm256_mul_ps(val3, a2)), _mm256_mul_ps(val4, a3));
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC pop_options
+#endif
+
+inline void ApplyCoeffs(float2 *RESTRICT Values, const size_t IrSize, const ConstHrirSpan Coeffs,
+    const float left, const float right)
+{
+    ASSUME(IrSize >= MinIrLength);
+
+    /* Values alternates between 8- and 16-byte alignment, so unaligned loads
+     * and stores are used throughout. Four left/right pairs are handled per
+     * iteration, with any remaining pairs done two and one at a time.
+     */
+    const __m256 lrlr8{_mm256_setr_ps(left, right, left, right, left, right, left, right)};
+    size_t i{0};
+    for(;IrSize-i >= 4;i += 4)
+    {
+        const __m256 coeffs{_mm256_loadu_ps(&Coeffs[i][0])};
+        const __m256 vals{_mm256_loadu_ps(&Values[i][0])};
+        _mm256_storeu_ps(&Values[i][0], _mm256_fmadd_ps(lrlr8, coeffs, vals));
+    }
+    if(IrSize-i >= 2)
+    {
+        const __m128 coeffs{_mm_loadu_ps(&Coeffs[i][0])};
+        const __m128 vals{_mm_loadu_ps(&Values[i][0])};
+        _mm_storeu_ps(&Values[i][0], _mm_fmadd_ps(_mm256_castps256_ps128(lrlr8), coeffs, vals));
+        i += 2;
+    }
+    if(i < IrSize)
+    {
+        Values[i][0] += Coeffs[i][0]*left;
+        Values[i][1] += Coeffs[i][1]*right;
+    }
+}
+
+/* The multi-channel resamplers find the filter for each output sample once
+ * per pair of channels, applying each group of coefficients to both channels
+ * as it's made. The coefficient count is a multiple of 4, so they're made 8
+ * at a time with a possible final group of 4.
+ */
+struct BSincCoeffs {
+    const float *RESTRICT fil, *RESTRICT phd, *RESTRICT scd, *RESTRICT spd;
+    __m256 sf8, pf8;
+
+    BSincCoeffs(const InterpState &istate, const uint frac)
+    {
+        const size_t m{istate.bsinc.m};
+        const uint pi{frac >> FracPhaseBitDiff};
+        const float pf{static_cast<float>(frac & (FracPhaseDiffOne-1)) *
+            (1.0f/FracPhaseDiffOne)};
+
+        fil = istate.bsinc.filter + m*pi*2;
+        phd = fil + m;
+        scd = fil + BSincPhaseCount*2*m;
+        spd = scd + m;
+        sf8 = _mm256_set1_ps(istate.bsinc.sf);
+        pf8 = _mm256_set1_ps(pf);
+    }
+
+    /* f = ((fil + sf*scd) + pf*(phd + sf*spd)) */
+    __m256 operator()(const size_t j) const
+    {
+        return _mm256_fmadd_ps(pf8,
+            _mm256_fmadd_ps(sf8, _mm256_loadu_ps(&spd[j]), _mm256_loadu_ps(&phd[j])),
+            _mm256_fmadd_ps(sf8, _mm256_loadu_ps(&scd[j]), _mm256_loadu_ps(&fil[j])));
+    }
+    __m128 last4(const size_t j) const
+    {
+        const __m128 sf4{_mm256_castps256_ps128(sf8)};
+        return _mm_fmadd_ps(_mm256_castps256_ps128(pf8),
+            _mm_fmadd_ps(sf4, _mm_load_ps(&spd[j]), _mm_load_ps(&phd[j])),
+            _mm_fmadd_ps(sf4, _mm_load_ps(&scd[j]), _mm_load_ps(&fil[j])));
+    }
+};
+
+struct FastBSincCoeffs {
+    const float *RESTRICT fil, *RESTRICT phd;
+    __m256 pf8;
+
+    FastBSincCoeffs(const InterpState &istate, const uint frac)
+    {
+        const size_t m{istate.bsinc.m};
+        const uint pi{frac >> FracPhaseBitDiff};
+        const float pf{static_cast<float>(frac & (FracPhaseDiffOne-1)) *
+            (1.0f/FracPhaseDiffOne)};
+
+        fil = istate.bsinc.filter + m*pi*2;
+        phd = fil + m;
+        pf8 = _mm256_set1_ps(pf);
+    }
+
+    /* f = fil + pf*phd */
+    __m256 operator()(const size_t j) const
+    { return _mm256_fmadd_ps(pf8, _mm256_loadu_ps(&phd[j]), _mm256_loadu_ps(&fil[j])); }
+    __m128 last4(const size_t j) const
+    {
+        return _mm_fmadd_ps(_mm256_castps256_ps128(pf8), _mm_load_ps(&phd[j]),
+            _mm_load_ps(&fil[j]));
+    }
+};
+
+struct PolyphaseCoeffs {
+    const float *RESTRICT fil;
+
+    PolyphaseCoeffs(const InterpState &istate, const uint frac)
+      : fil{istate.polyphase.filter + istate.polyphase.m*(frac>>istate.polyphase.shift)}
+    { }
+
+    __m256 operator()(const size_t j) const { return _mm256_loadu_ps(&fil[j]); }
+    __m128 last4(const size_t j) const { return _mm_load_ps(&fil[j]); }
+};
+
+template<typename CoeffsT>
+void DoResampleMulti(const InterpState *state, const size_t m, const size_t l,
+    const al::span<float*const> src, uint frac, uint increment, const al::span<float*const> dst,
+    const size_t dstlen)
+{
+    ASSUME(m > 0);
+    const InterpState istate{*state};
+
+    size_t pos{0};
+    for(size_t i{0};i < dstlen;++i)
+    {
+        const CoeffsT coeffs{istate, frac};
+        size_t c{0};
+        for(;src.size()-c > 1;c += 2)
+        {
+            const float *RESTRICT vals0{src[c] - l + pos};
+            const float *RESTRICT vals1{src[c+1] - l + pos};
+            __m256 r0{_mm256_setzero_ps()}, r1{_mm256_setzero_ps()};
+            size_t j{0u};
+            for(size_t td{m >> 3};td;--td)
+            {
+                /* r += f*src */
+                const __m256 f8{coeffs(j)};
+                r0 = _mm256_fmadd_ps(f8, _mm256_loadu_ps(&vals0[j]), r0);
+                r1 = _mm256_fmadd_ps(f8, _mm256_loadu_ps(&vals1[j]), r1);
+                j += 8;
+            }
+            if((m&4))
+            {
+                const __m128 f4{coeffs.last4(j)};
+                r0 = _mm256_add_ps(r0, _mm256_set_m128(_mm_setzero_ps(),
+                    _mm_mul_ps(f4, _mm_loadu_ps(&vals0[j]))));
+                r1 = _mm256_add_ps(r1, _mm256_set_m128(_mm_setzero_ps(),
+                    _mm_mul_ps(f4, _mm_loadu_ps(&vals1[j]))));
+            }
+            dst[c][i] = reduce_add(r0);
+            dst[c+1][i] = reduce_add(r1);
+        }
+        if(c < src.size())
+        {
+            const float *RESTRICT vals{src[c] - l + pos};
+            __m256 r8{_mm256_setzero_ps()};
+            size_t j{0u};
+            for(size_t td{m >> 3};td;--td)
+            {
+                r8 = _mm256_fmadd_ps(coeffs(j), _mm256_loadu_ps(&vals[j]), r8);
+                j += 8;
+            }
+            if((m&4))
+                r8 = _mm256_add_ps(r8, _mm256_set_m128(_mm_setzero_ps(),
+                    _mm_mul_ps(coeffs.last4(j), _mm_loadu_ps(&vals[j]))));
+            dst[c][i] = reduce_add(r8);
+        }
+
+        frac += increment;
+        pos  += frac>>MixerFracBits;
+        frac &= MixerFracMask;
+    }
+}
+
+} // namespace
+
+template<>
+float *Resample_<LerpTag,AVX2Tag>(const InterpState*, float *RESTRICT src, uint frac,
+    uint increment, const al::span<float> dst)
+{
+    const __m256i increment8{_mm256_set1_epi32(static_cast<int>(increment*8))};
+    const __m256 fracOne8{_mm256_set1_ps(1.0f/MixerFracOne)};
+    const __m256i fracMask8{_mm256_set1_epi32(MixerFracMask)};
+
+    alignas(32) uint pos_[8], frac_[8];
+    InitPosArrays(frac, increment, frac_, pos_);
+    __m256i frac8{_mm256_load_si256(reinterpret_cast<const __m256i*>(frac_))};
+    __m256i pos8{_mm256_load_si256(reinterpret_cast<const __m256i*>(pos_))};
+
+    auto dst_iter = dst.begin();
+    for(size_t todo{dst.size()>>3};todo;--todo)
+    {
+        const __m256 val1{_mm256_i32gather_ps(src, pos8, 4)};
+        const __m256 val2{_mm256_i32gather_ps(src+1, pos8, 4)};
+
+        /* val1 + (val2-val1)*mu */
+        const __m256 r0{_mm256_sub_ps(val2, val1)};
+        const __m256 mu{_mm256_mul_ps(_mm256_cvtepi32_ps(frac8), fracOne8)};
+        const __m256 out{_mm256_fmadd_ps(mu, r0, val1)};
+
+        _mm256_storeu_ps(dst_iter, out);
+        dst_iter += 8;
+
+        frac8 = _mm256_add_epi32(frac8, increment8);
+        pos8 = _mm256_add_epi32(pos8, _mm256_srli_epi32(frac8, MixerFracBits));
+        frac8 = _mm256_and_si256(frac8, fracMask8);
+    }
+
+    if(size_t todo{dst.size()&7})
+    {
+        src += static_cast<uint>(_mm_cvtsi128_si32(_mm256_castsi256_si128(pos8)));
+        frac = static_cast<uint>(_mm_cvtsi128_si32(_mm256_castsi256_si128(frac8)));
+
+        do {
+            *(dst_iter++) = lerpf(src[0], src[1], static_cast<float>(frac) * (1.0f/MixerFracOne));
+
+            frac += increment;
+            src  += frac>>MixerFracBits;
+            frac &= MixerFracMask;
+        } while(--todo);
+    }
+    return dst.data();
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
+template<>
+float *Resample_<CubicTag,AVX2Tag>(const InterpState*, float *RESTRICT src, uint frac,
+    uint increment, const al::span<float> dst)
+{
+    const __m256i increment8{_mm256_set1_epi32(static_cast<int>(increment*8))};
+    const __m256 fracOne8{_mm256_set1_ps(1.0f/MixerFracOne)};
+    const __m256i fracMask8{_mm256_set1_epi32(MixerFracMask)};
+
+    src -= 1;
+    alignas(32) uint pos_[8], frac_[8];
+    InitPosArrays(frac, increment, frac_, pos_);
+    __m256i frac8{_mm256_load_si256(reinterpret_cast<const __m256i*>(frac_))};
+    __m256i pos8{_mm256_load_si256(reinterpret_cast<const __m256i*>(pos_))};
+
+    auto dst_iter = dst.begin();
+    for(size_t todo{dst.size()>>3};todo;--todo)
+    {
+        const __m256 val1{_mm256_i32gather_ps(src, pos8, 4)};
+        const __m256 val2{_mm256_i32gather_ps(src+1, pos8, 4)};
+        const __m256 val3{_mm256_i32gather_ps(src+2, pos8, 4)};
+        const __m256 val4{_mm256_i32gather_ps(src+3, pos8, 4)};
+
+        const __m256 mu{_mm256_mul_ps(_mm256_cvtepi32_ps(frac8), fracOne8)};
+        _mm256_storeu_ps(dst_iter, cubic8(val1, val2, val3, val4, mu));
+        dst_iter += 8;
+
+        frac8 = _mm256_add_epi32(frac8, increment8);
+        pos8 = _mm256_add_epi32(pos8, _mm256_srli_epi32(frac8, MixerFracBits));
+        frac8 = _mm256_and_si256(frac8, fracMask8);
+    }
+
+    /* The last few samples are done the same way, only gathering for the
+     * lanes still needed, rather than calling the scalar version that a
+     * compiler may contract into fused multiply-adds.
+     */
+    if(const size_t todo{dst.size()&7})
+    {
+        const __m256 mask{_mm256_castsi256_ps(_mm256_cmpgt_epi32(
+            _mm256_set1_epi32(static_cast<int>(todo)), _mm256_setr_epi32(0,1,2,3,4,5,6,7)))};
+        const __m256 zero{_mm256_setzero_ps()};
+        const __m256 val1{_mm256_mask_i32gather_ps(zero, src, pos8, mask, 4)};
+        const __m256 val2{_mm256_mask_i32gather_ps(zero, src+1, pos8, mask, 4)};
+        const __m256 val3{_mm256_mask_i32gather_ps(zero, src+2, pos8, mask, 4)};
+        const __m256 val4{_mm256_mask_i32gather_ps(zero, src+3, pos8, mask, 4)};
+
+        const __m256 mu{_mm256_mul_ps(_mm256_cvtepi32_ps(frac8), fracOne8)};
+        alignas(32) float out[8];
+        _mm256_store_ps(out, cubic8(val1, val2, val3, val4, mu));
+        std::copy_n(out, todo, dst_iter);
+    }
+    return dst.data();
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC pop_options
+#endif
+
+template<>
+float *Resample_<BSincTag,AVX2Tag>(const InterpState *state, float *RESTRICT src, uint frac,
+    uint increment, const al::span<float> dst)
+{
+    const float *const filter{state->bsinc.filter};
+    const __m256 sf8{_mm256_set1_ps(state->bsinc.sf)};
+    const size_t m{state->bsinc.m};
+    ASSUME(m > 0);
+
+    src -= state->bsinc.l;
+    for(float &out_sample : dst)
+    {
+        // Calculate the phase index and factor.
+        const uint pi{frac >> FracPhaseBitDiff};
+        const float pf{static_cast<float>(frac & (FracPhaseDiffOne-1)) * (1.0f/FracPhaseDiffOne)};
+
+        // Apply the scale and phase interpolated filter.
+        __m256 r8{_mm256_setzero_ps()};
+        {
+            const __m256 pf8{_mm256_set1_ps(pf)};
+            const float *RESTRICT fil{filter + m*pi*2};
+            const float *RESTRICT phd{fil + m};
+            const float *RESTRICT scd{fil + BSincPhaseCount*2*m};
+            const float *RESTRICT spd{scd + m};
+            size_t j{0u};
+
+            /* The coefficient count is a multiple of 4, so do 8 at a time
+             * with a possible final group of 4.
+             */
+            for(size_t td{m >> 3};td;--td)
+            {
+                /* f = ((fil + sf*scd) + pf*(phd + sf*spd)) */
+                const __m256 f8{_mm256_fmadd_ps(pf8,
+                    _mm256_fmadd_ps(sf8, _mm256_loadu_ps(&spd[j]), _mm256_loadu_ps(&phd[j])),
+                    _mm256_fmadd_ps(sf8, _mm256_loadu_ps(&scd[j]), _mm256_loadu_ps(&fil[j])))};
+                /* r += f*src */
+                r8 = _mm256_fmadd_ps(f8, _mm256_loadu_ps(&src[j]), r8);
+                j += 8;
+            }
+            if((m&4))
+            {
+                const __m128 sf4{_mm256_castps256_ps128(sf8)};
+                const __m128 f4{_mm_fmadd_ps(_mm256_castps256_ps128(pf8),
+                    _mm_fmadd_ps(sf4, _mm_load_ps(&spd[j]), _mm_load_ps(&phd[j])),
+                    _mm_fmadd_ps(sf4, _mm_load_ps(&scd[j]), _mm_load_ps(&fil[j])))};
+                const __m128 r4{_mm_mul_ps(f4, _mm_loadu_ps(&src[j]))};
+                r8 = _mm256_add_ps(r8, _mm256_castps128_ps256(r4));
+            }
+        }
+        out_sample = reduce_add(r8);
+
+        frac += increment;
+        src  += frac>>MixerFracBits;
+        frac &= MixerFracMask;
+    }
+    return dst.data();
+}
+
+template<>
+float *Resample_<FastBSincTag,AVX2Tag>(const InterpState *state, float *RESTRICT src, uint frac,
+    uint increment, const al::span<float> dst)
+{
+    const float *const filter{state->bsinc.filter};
+    const size_t m{state->bsinc.m};
+    ASSUME(m > 0);
+
+    src -= state->bsinc.l;
+    for(float &out_sample : dst)
+    {
+        // Calculate the phase index and factor.
+        const uint pi{frac >> FracPhaseBitDiff};
+        const float pf{static_cast<float>(frac & (FracPhaseDiffOne-1)) * (1.0f/FracPhaseDiffOne)};
+
+        // Apply the phase interpolated filter.
+        __m256 r8{_mm256_setzero_ps()};
+        {
+            const __m256 pf8{_mm256_set1_ps(pf)};
+            const float *RESTRICT fil{filter + m*pi*2};
+            const float *RESTRICT phd{fil + m};
+            size_t j{0u};
+
+            for(size_t td{m >> 3};td;--td)
+            {
+                /* f = fil + pf*phd */
+                const __m256 f8{_mm256_fmadd_ps(pf8, _mm256_loadu_ps(&phd[j]),
+                    _mm256_loadu_ps(&fil[j]))};
+                /* r += f*src */
+                r8 = _mm256_fmadd_ps(f8, _mm256_loadu_ps(&src[j]), r8);
+                j += 8;
+            }
+            if((m&4))
+            {
+                const __m128 f4{_mm_fmadd_ps(_mm256_castps256_ps128(pf8), _mm_load_ps(&phd[j]),
+                    _mm_load_ps(&fil[j]))};
+                const __m128 r4{_mm_mul_ps(f4, _mm_loadu_ps(&src[j]))};
+                r8 = _mm256_add_ps(r8, _mm256_castps128_ps256(r4));
+            }
+        }
+        out_sample = reduce_add(r8);
+
+        frac += increment;
+        src  += frac>>MixerFracBits;
+        frac &= MixerFracMask;
+    }
+    return dst.data();
+}
+
+
+template<>
+float *Resample_<PolyphaseTag,AVX2Tag>(const InterpState *state, float *RESTRICT src, uint frac,
+    uint increment, const al::span<float> dst)
+{
+    const float *const filter{state->polyphase.filter};
+    const uint shift{state->polyphase.shift};
+    const size_t m{state->polyphase.m};
+    ASSUME(m > 0);
+
+    src -= state->polyphase.l;
+    for(float &out_sample : dst)
+    {
+        // Apply the phase's filter.
+        __m256 r8{_mm256_setzero_ps()};
+        {
+            const float *RESTRICT fil{filter + m*(frac>>shift)};
+            size_t j{0u};
+
+            for(size_t td{m >> 3};td;--td)
+            {
+                /* r += fil*src */
+                r8 = _mm256_fmadd_ps(_mm256_loadu_ps(&fil[j]), _mm256_loadu_ps(&src[j]), r8);
+                j += 8;
+            }
+            if((m&4))
+            {
+                const __m128 r4{_mm_mul_ps(_mm_load_ps(&fil[j]), _mm_loadu_ps(&src[j]))};
+                r8 = _mm256_add_ps(r8, _mm256_castps128_ps256(r4));
+            }
+        }
+        out_sample = reduce_add(r8);
+
+        frac += increment;
+        src  += frac>>MixerFracBits;
+        frac &= MixerFracMask;
+    }
+    return dst.data();
+}
+
+template<>
+void ResampleMulti_<BSincTag,AVX2Tag>(const InterpState *state, const al::span<float*const> src,
+    uint frac, uint increment, const al::span<float*const> dst, const size_t dstlen)
+{
+    DoResampleMulti<BSincCoeffs>(state, state->bsinc.m, state->bsinc.l, src, frac, increment,
+        dst, dstlen);
+}
+
+template<>
+void ResampleMulti_<FastBSincTag,AVX2Tag>(const InterpState *state,
+    const al::span<float*const> src, uint frac, uint increment, const al::span<float*const> dst,
+    const size_t dstlen)
+{
+    DoResampleMulti<FastBSincCoeffs>(state, state->bsinc.m, state->bsinc.l, src, frac,
+        increment, dst, dstlen);
+}
+
+template<>
+void ResampleMulti_<PolyphaseTag,AVX2Tag>(const InterpState *state,
+    const al::span<float*const> src, uint frac, uint increment, const al::span<float*const> dst,
+    const size_t dstlen)
+{
+    DoResampleMulti<PolyphaseCoeffs>(state, state->polyphase.m, state->polyphase.l, src, frac,
+        increment, dst, dstlen);
+}
+
+template<>
+void MixHrtf_<AVX2Tag>(const float *InSamples, float2 *AccumSamples, const uint IrSize,
+    const MixHrtfFilter *hrtfparams, const size_t BufferSize)
+{ MixHrtfBase<ApplyCoeffs>(InSamples, AccumSamples, IrSize, hrtfparams, BufferSize); }
+
+template<>
+void MixHrtfBlend_<AVX2Tag>(const float *InSamples, float2 *AccumSamples, const uint IrSize,
+    const HrtfFilter *oldparams, const MixHrtfFilter *newparams, const size_t BufferSize)
+{
+    MixHrtfBlendBase<ApplyCoeffs>(InSamples, AccumSamples, IrSize, oldparams, newparams,
+        BufferSize);
+}
+
+template<>
+void MixDirectHrtf_<AVX2Tag>(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
+    const al::span<const FloatBufferLine> InSamples, float2 *AccumSamples,
+    float *TempBuf, HrtfChannelState *ChanState, HrtfTailConvolver *TailConv, const size_t IrSize,
+    const size_t BufferSize)
+{
+    MixDirectHrtfBase<ApplyCoeffs>(LeftOut, RightOut, InSamples, AccumSamples, TempBuf, ChanState,
+        TailConv, IrSize, BufferSize);
+}
+
+
+template<>
+void Mix_<AVX2Tag>(const al::span<const float> InSamples, const al::span<FloatBufferLine> OutBuffer,
+    float *CurrentGains, const float *TargetGains, const size_t Counter, const size_t OutPos)
+{
+    const float delta{(Counter > 0) ? 1.0f / static_cast<float>(Counter) : 0.0f};
+    const auto min_len = minz(Counter, InSamples.size());
+    const auto aligned_len = minz((min_len+7) & ~size_t{7}, InSamples.size()) - min_len;
+
+    for(FloatBufferLine &output : OutBuffer)
+    {
+        float *RESTRICT dst{al::assume_aligned<16>(output.data()+OutPos)};
+        float gain{*CurrentGains};
+        const float step{(*TargetGains-gain) * delta};
+
+        size_t pos{0};
+        if(!(std::abs(step) > std::numeric_limits<float>::epsilon()))
+            gain = *TargetGains;
+        else
+        {
+            float step_count{0.0f};
+            /* Mix with applying gain steps in multiples of 8. */
+            if(size_t todo{min_len >> 3})
+            {
+                const __m256 eight8{_mm256_set1_ps(8.0f)};
+                const __m256 step8{_mm256_set1_ps(step)};
+                const __m256 gain8{_mm256_set1_ps(gain)};
+                __m256 step_count8{_mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f,
+                    7.0f)};
+                do {
+                    const __m256 val8{_mm256_loadu_ps(&InSamples[pos])};
+                    const __m256 dry8{_mm256_loadu_ps(&dst[pos])};
+
+                    /* dry += val * (gain + step*step_count) */
+                    const __m256 gains8{_mm256_fmadd_ps(step8, step_count8, gain8)};
+                    _mm256_storeu_ps(&dst[pos], _mm256_fmadd_ps(val8, gains8, dry8));
+
+                    step_count8 = _mm256_add_ps(step_count8, eight8);
+                    pos += 8;
+                } while(--todo);
+                /* NOTE: step_count8 now represents the next eight counts after
+                 * the last eight mixed samples, so the lowest element
+                 * represents the next step count to apply.
+                 */
+                step_count = _mm_cvtss_f32(_mm256_castps256_ps128(step_count8));
+            }
+            /* Mix with applying left over gain steps that aren't multiples of 8. */
+            for(size_t leftover{min_len&7};leftover;++pos,--leftover)
+            {
+                dst[pos] += InSamples[pos] * (gain + step*step_count);
+                step_count += 1.0f;
+            }
+            if(pos == Counter)
+                gain = *TargetGains;
+            else
+                gain += step*step_count;
+
+            /* Mix until pos is a multiple of 8 or the mix is done. */
+            for(size_t leftover{aligned_len&7};leftover;++pos,--leftover)
+                dst[pos] += InSamples[pos] * gain;
+        }
+        *CurrentGains = gain;
+        ++CurrentGains;
+        ++TargetGains;
+
+        if(!(std::abs(gain) > GainSilenceThreshold))
+            continue;
+        if(size_t todo{(InSamples.size()-pos) >> 3})
+        {
+            const __m256 gain8{_mm256_set1_ps(gain)};
+            do {
+                const __m256 val8{_mm256_loadu_ps(&InSamples[pos])};
+                const __m256 dry8{_mm256_loadu_ps(&dst[pos])};
+                _mm256_storeu_ps(&dst[pos], _mm256_fmadd_ps(val8, gain8, dry8));
+                pos += 8;
+            } while(--todo);
+        }
+        for(size_t leftover{(InSamples.size()-pos)&7};leftover;++pos,--leftover)
+            dst[pos] += InSamples[pos] * gain;
+    }
+}
+
+template<>
+void LoadHalf_<AVX2Tag>(float *RESTRICT dst, const uint16_t *src, const size_t srcstep,
+    const size_t samples)
+{
+    size_t i{0};
+    if(srcstep == 1)
+    {
+        for(;samples-i >= 8;i += 8)
+        {
+            const __m128i halves{_mm_loadu_si128(reinterpret_cast<const __m128i*>(src+i))};
+            _mm256_storeu_ps(dst+i, _mm256_cvtph_ps(halves));
+        }
+    }
+    else
+    {
+        /* Gather every srcstep value for interleaved channels. */
+        for(;samples-i >= 8;i += 8)
+        {
+            const uint16_t *s{src + i*srcstep};
+            const __m128i halves{_mm_setr_epi16(static_cast<short>(s[0]),
+                static_cast<short>(s[srcstep]), static_cast<short>(s[srcstep*2]),
+                static_cast<short>(s[srcstep*3]), static_cast<short>(s[srcstep*4]),
+                static_cast<short>(s[srcstep*5]), static_cast<short>(s[srcstep*6]),
+                static_cast<short>(s[srcstep*7]))};
+            _mm256_storeu_ps(dst+i, _mm256_cvtph_ps(halves));
+        }
+    }
+    for(;i < samples;++i)
+        dst[i] = al::HalfToFloat(src[i*srcstep]);
+}
+
+namespace {
+
+/* Loads a pair of samples from frames 0 and 1 into the low lanes, and from
+ * frames 4 and 5 into the high lanes.
+ */
+inline __m256 LoadPairs(const float *in, const size_t stride)
+{
+    __m128 lo{_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(in))};
+    lo = _mm_loadh_pi(lo, reinterpret_cast<const __m64*>(in + stride));
+    __m128 hi{_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(in + stride*4))};
+    hi = _mm_loadh_pi(hi, reinterpret_cast<const __m64*>(in + stride*5));
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+
+/* De-interleaves 8 frames at a time. Each pair of channels is loaded 64 bits
+ * at a time from 8 consecutive frames, with frames 0-3 going to the low lanes
+ * and 4-7 to the high lanes, then shuffled apart in each lane.
+ */
+inline void DeinterleaveAVX2(const al::span<float*> dst, const size_t dstOffset,
+    const float *RESTRICT src, const size_t frames)
+{
+    const size_t numchans{dst.size()};
+    const size_t todo{frames & ~size_t{7}};
+    for(size_t c{0};c < numchans;c += 2)
+    {
+        float *RESTRICT out0{dst[c] + dstOffset};
+        float *RESTRICT out1{dst[c+1] + dstOffset};
+        const float *in{src + c};
+        for(size_t i{0};i < todo;i += 8)
+        {
+            /* Frames 0,1,4,5 and 2,3,6,7. */
+            const __m256 abef{LoadPairs(in, numchans)};
+            const __m256 cdgh{LoadPairs(in + numchans*2, numchans)};
+            _mm256_storeu_ps(out0+i, _mm256_shuffle_ps(abef, cdgh, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm256_storeu_ps(out1+i, _mm256_shuffle_ps(abef, cdgh, _MM_SHUFFLE(3, 1, 3, 1)));
+            in += numchans*8;
+        }
+    }
+    DeinterleaveRemainder(dst, dstOffset, src, todo, frames);
+}
+
+inline void ConvertUByte(float *RESTRICT dst, const al::byte *src, const size_t count)
+{
+    const auto *bsrc = reinterpret_cast<const uint8_t*>(src);
+    const __m256 scale8{_mm256_set1_ps(1.0f/128.0f)};
+    const __m256 one8{_mm256_set1_ps(1.0f)};
+
+    size_t i{0};
+    for(;count-i >= 8;i += 8)
+    {
+        const __m128i b8{_mm_loadl_epi64(reinterpret_cast<const __m128i*>(bsrc+i))};
+        const __m256 f8{_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(b8))};
+        /* Not fused, to match the rounding of the C conversion. */
+        _mm256_storeu_ps(dst+i, _mm256_sub_ps(_mm256_mul_ps(f8, scale8), one8));
+    }
+    for(;i < count;++i)
+        dst[i] = al::FmtTypeTraits<FmtUByte>::to<float>(bsrc[i]);
+}
+
+inline void ConvertShort(float *RESTRICT dst, const al::byte *src, const size_t count)
+{
+    const auto *ssrc = reinterpret_cast<const int16_t*>(src);
+    const __m256 scale8{_mm256_set1_ps(1.0f/32768.0f)};
+
+    size_t i{0};
+    for(;count-i >= 8;i += 8)
+    {
+        const __m128i s8{_mm_loadu_si128(reinterpret_cast<const __m128i*>(ssrc+i))};
+        const __m256 f8{_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(s8))};
+        _mm256_storeu_ps(dst+i, _mm256_mul_ps(f8, scale8));
+    }
+    for(;i < count;++i)
+        dst[i] = al::FmtTypeTraits<FmtShort>::to<float>(ssrc[i]);
+}
+
+} // namespace
+
+template<>
+void LoadInterleaved_<UByteTag,AVX2Tag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{
+    LoadInterleavedBase<UByteTag,ConvertUByte,DeinterleaveAVX2>(dst, dstOffset, src, frames);
+}
+
+template<>
+void LoadInterleaved_<ShortTag,AVX2Tag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{
+    LoadInterleavedBase<ShortTag,ConvertShort,DeinterleaveAVX2>(dst, dstOffset, src, frames);
+}
+
+template<>
+void LoadInterleaved_<FloatTag,AVX2Tag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{
+    LoadInterleavedBase<FloatTag,ConvertSamplesBase<FloatTag>,DeinterleaveAVX2>(dst, dstOffset,
+        src, frames);
+}
+
+template<>
+void LoadInterleaved_<MulawTag,AVX2Tag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{
+    LoadInterleavedBase<MulawTag,ConvertSamplesBase<MulawTag>,DeinterleaveAVX2>(dst, dstOffset,
+        src, frames);
+}
+
+template<>
+void LoadInterleaved_<AlawTag,AVX2Tag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{
+    LoadInterleavedBase<AlawTag,ConvertSamplesBase<AlawTag>,DeinterleaveAVX2>(dst, dstOffset,
+        src, frames);
+}
+
+#ifdef AVX2_CLANG_ATTRIBUTE_PUSHED
+#pragma clang attribute pop
+#undef AVX2_CLANG_ATTRIBUTE_PUSHED
+#endif
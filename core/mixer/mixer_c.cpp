@@ -6,8 +6,10 @@
 
 #include "alnumeric.h"
 #include "core/bsinc_tables.h"
+#include "core/fmt_traits.h"
 #include "defs.h"
 #include "hrtfbase.h"
+#include "loadbase.h"
 
 struct CTag;
 struct CopyTag;
@@ -16,6 +18,7 @@ struct LerpTag;
 struct CubicTag;
 struct BSincTag;
 struct FastBSincTag;
+struct PolyphaseTag;
 
 
 namespace {
@@ -68,6 +71,20 @@ inline float do_fastbsinc(const InterpState &istate, const float *RESTRICT vals,
     return r;
 }
 
+inline float do_polyphase(const InterpState &istate, const float *RESTRICT vals, const uint frac)
+{
+    const size_t m{istate.polyphase.m};
+    ASSUME(m > 0);
+
+    const float *RESTRICT fil{istate.polyphase.filter + m*(frac>>istate.polyphase.shift)};
+
+    // Apply the phase's filter.
+    float r{0.0f};
+    for(size_t j_f{0};j_f < m;j_f++)
+        r += fil[j_f] * vals[j_f];
+    return r;
+}
+
 using SamplerT = float(&)(const InterpState&, const float*RESTRICT, const uint);
 template<SamplerT Sampler>
 float *DoResample(const InterpState *state, float *RESTRICT src, uint frac, uint increment,
@@ -85,6 +102,74 @@ float *DoResample(const InterpState *state, float *RESTRICT src, uint frac, uint
     return dst.data();
 }
 
+/* The multi-channel resamplers get the filter for each output sample once,
+ * interpolating it into coeffs if needed, then apply it to each channel.
+ */
+inline const float *bsinc_coeffs(const InterpState &istate, float *RESTRICT coeffs,
+    const uint frac)
+{
+    const size_t m{istate.bsinc.m};
+    ASSUME(m > 0);
+
+    const uint pi{frac >> FracPhaseBitDiff};
+    const float pf{static_cast<float>(frac & (FracPhaseDiffOne-1)) * (1.0f/FracPhaseDiffOne)};
+
+    const float *RESTRICT fil{istate.bsinc.filter + m*pi*2};
+    const float *RESTRICT phd{fil + m};
+    const float *RESTRICT scd{fil + BSincPhaseCount*2*m};
+    const float *RESTRICT spd{scd + m};
+    const float sf{istate.bsinc.sf};
+    for(size_t j_f{0};j_f < m;j_f++)
+        coeffs[j_f] = fil[j_f] + sf*scd[j_f] + pf*(phd[j_f] + sf*spd[j_f]);
+    return coeffs;
+}
+inline const float *fastbsinc_coeffs(const InterpState &istate, float *RESTRICT coeffs,
+    const uint frac)
+{
+    const size_t m{istate.bsinc.m};
+    ASSUME(m > 0);
+
+    const uint pi{frac >> FracPhaseBitDiff};
+    const float pf{static_cast<float>(frac & (FracPhaseDiffOne-1)) * (1.0f/FracPhaseDiffOne)};
+
+    const float *RESTRICT fil{istate.bsinc.filter + m*pi*2};
+    const float *RESTRICT phd{fil + m};
+    for(size_t j_f{0};j_f < m;j_f++)
+        coeffs[j_f] = fil[j_f] + pf*phd[j_f];
+    return coeffs;
+}
+inline const float *polyphase_coeffs(const InterpState &istate, float*, const uint frac)
+{ return istate.polyphase.filter + istate.polyphase.m*(frac>>istate.polyphase.shift); }
+
+using CoeffsT = const float*(&)(const InterpState&, float*RESTRICT, const uint);
+template<CoeffsT Coeffs>
+void DoResampleMulti(const InterpState *state, const size_t m, const size_t l,
+    const al::span<float*const> src, uint frac, uint increment, const al::span<float*const> dst,
+    const size_t dstlen)
+{
+    ASSUME(m > 0);
+    const InterpState istate{*state};
+    alignas(16) std::array<float,MaxResamplerPadding> coeffs;
+
+    size_t pos{0};
+    for(size_t i{0};i < dstlen;++i)
+    {
+        const float *RESTRICT fil{Coeffs(istate, coeffs.data(), frac)};
+        for(size_t c{0};c < src.size();++c)
+        {
+            const float *RESTRICT vals{src[c] - l + pos};
+            float r{0.0f};
+            for(size_t j_f{0};j_f < m;j_f++)
+                r += fil[j_f] * vals[j_f];
+            dst[c][i] = r;
+        }
+
+        frac += increment;
+        pos  += frac>>MixerFracBits;
+        frac &= MixerFracMask;
+    }
+}
+
 inline void ApplyCoeffs(float2 *RESTRICT Values, const size_t IrSize, const ConstHrirSpan Coeffs,
     const float left, const float right)
 {
@@ -136,6 +221,35 @@ float *Resample_<FastBSincTag,CTag>(const InterpState *state, float *RESTRICT sr
     uint increment, const al::span<float> dst)
 { return DoResample<do_fastbsinc>(state, src-state->bsinc.l, frac, increment, dst); }
 
+template<>
+float *Resample_<PolyphaseTag,CTag>(const InterpState *state, float *RESTRICT src, uint frac,
+    uint increment, const al::span<float> dst)
+{ return DoResample<do_polyphase>(state, src-state->polyphase.l, frac, increment, dst); }
+
+template<>
+void ResampleMulti_<BSincTag,CTag>(const InterpState *state, const al::span<float*const> src,
+    uint frac, uint increment, const al::span<float*const> dst, const size_t dstlen)
+{
+    DoResampleMulti<bsinc_coeffs>(state, state->bsinc.m, state->bsinc.l, src, frac, increment,
+        dst, dstlen);
+}
+
+template<>
+void ResampleMulti_<FastBSincTag,CTag>(const InterpState *state, const al::span<float*const> src,
+    uint frac, uint increment, const al::span<float*const> dst, const size_t dstlen)
+{
+    DoResampleMulti<fastbsinc_coeffs>(state, state->bsinc.m, state->bsinc.l, src, frac,
+        increment, dst, dstlen);
+}
+
+template<>
+void ResampleMulti_<PolyphaseTag,CTag>(const InterpState *state, const al::span<float*const> src,
+    uint frac, uint increment, const al::span<float*const> dst, const size_t dstlen)
+{
+    DoResampleMulti<polyphase_coeffs>(state, state->polyphase.m, state->polyphase.l, src, frac,
+        increment, dst, dstlen);
+}
+
 
 template<>
 void MixHrtf_<CTag>(const float *InSamples, float2 *AccumSamples, const uint IrSize,
@@ -153,10 +267,11 @@ void MixHrtfBlend_<CTag>(const float *InSamples, float2 *AccumSamples, const uin
 template<>
 void MixDirectHrtf_<CTag>(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
     const al::span<const FloatBufferLine> InSamples, float2 *AccumSamples,
-    float *TempBuf, HrtfChannelState *ChanState, const size_t IrSize, const size_t BufferSize)
+    float *TempBuf, HrtfChannelState *ChanState, HrtfTailConvolver *TailConv, const size_t IrSize,
+    const size_t BufferSize)
 {
     MixDirectHrtfBase<ApplyCoeffs>(LeftOut, RightOut, InSamples, AccumSamples, TempBuf, ChanState,
-        IrSize, BufferSize);
+        TailConv, IrSize, BufferSize);
 }
 
 
@@ -198,3 +313,53 @@ void Mix_<CTag>(const al::span<const float> InSamples, const al::span<FloatBuffe
             dst[pos] += InSamples[pos] * gain;
     }
 }
+
+template<>
+void LoadHalf_<CTag>(float *RESTRICT dst, const uint16_t *src, const size_t srcstep,
+    const size_t samples)
+{
+    for(size_t i{0};i < samples;++i)
+        dst[i] = al::HalfToFloat(src[i*srcstep]);
+}
+
+
+namespace {
+
+template<typename TypeTag>
+inline void LoadInterleavedC(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{
+    constexpr FmtType Type{LoadTypeTraits<TypeTag>::Type};
+    constexpr size_t SampleSize{sizeof(typename al::FmtTypeTraits<Type>::Type)};
+
+    const size_t numchans{dst.size()};
+    for(size_t c{0};c < numchans;++c)
+        al::LoadSampleArray<Type>(dst[c]+dstOffset, src + c*SampleSize, numchans, frames);
+}
+
+} // namespace
+
+template<>
+void LoadInterleaved_<UByteTag,CTag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{ LoadInterleavedC<UByteTag>(dst, dstOffset, src, frames); }
+
+template<>
+void LoadInterleaved_<ShortTag,CTag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{ LoadInterleavedC<ShortTag>(dst, dstOffset, src, frames); }
+
+template<>
+void LoadInterleaved_<FloatTag,CTag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{ LoadInterleavedC<FloatTag>(dst, dstOffset, src, frames); }
+
+template<>
+void LoadInterleaved_<MulawTag,CTag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{ LoadInterleavedC<MulawTag>(dst, dstOffset, src, frames); }
+
+template<>
+void LoadInterleaved_<AlawTag,CTag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{ LoadInterleavedC<AlawTag>(dst, dstOffset, src, frames); }
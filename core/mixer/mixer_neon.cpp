@@ -7,13 +7,17 @@
 
 #include "alnumeric.h"
 #include "core/bsinc_defs.h"
+#include "core/fmt_traits.h"
 #include "defs.h"
 #include "hrtfbase.h"
+#include "loadbase.h"
 
 struct NEONTag;
 struct LerpTag;
+struct CubicTag;
 struct BSincTag;
 struct FastBSincTag;
+struct PolyphaseTag;
 
 
 #if defined(__GNUC__) && !defined(__clang__) && !defined(__ARM_NEON)
@@ -31,6 +35,24 @@ inline float32x4_t set_f4(float l0, float l1, float l2, float l3)
     return ret;
 }
 
+/* Calculates the cubic interpolation of four sample sets, using the same
+ * operation order as the scalar cubic() so the results match it exactly.
+ */
+inline float32x4_t cubic4(const float32x4_t val1, const float32x4_t val2, const float32x4_t val3,
+    const float32x4_t val4, const float32x4_t mu)
+{
+    const float32x4_t mu2{vmulq_f32(mu, mu)}, mu3{vmulq_f32(mu2, mu)};
+    const float32x4_t a0{vaddq_f32(vaddq_f32(vmulq_n_f32(mu3, -0.5f), mu2),
+        vmulq_n_f32(mu, -0.5f))};
+    const float32x4_t a1{vaddq_f32(vaddq_f32(vmulq_n_f32(mu3, 1.5f), vmulq_n_f32(mu2, -2.5f)),
+        vdupq_n_f32(1.0f))};
+    const float32x4_t a2{vaddq_f32(vaddq_f32(vmulq_n_f32(mu3, -1.5f), vmulq_n_f32(mu2, 2.0f)),
+        vmulq_n_f32(mu, 0.5f))};
+    const float32x4_t a3{vaddq_f32(vmulq_n_f32(mu3, 0.5f), vmulq_n_f32(mu2, -0.5f))};
+    return vaddq_f32(vaddq_f32(vaddq_f32(vmulq_f32(val1, a0), vmulq_f32(val2, a1)),
+        vmulq_f32(val3, a2)), vmulq_f32(val4, a3));
+}
+
 constexpr uint FracPhaseBitDiff{MixerFracBits - BSincPhaseBits};
 constexpr uint FracPhaseDiffOne{1 << FracPhaseBitDiff};
 
@@ -56,6 +78,117 @@ inline void ApplyCoeffs(float2 *RESTRICT Values, const size_t IrSize, const Cons
     }
 }
 
+/* The multi-channel resamplers find the filter for each output sample once
+ * per pair of channels, applying each group of coefficients to both channels
+ * as it's made.
+ */
+struct BSincCoeffs {
+    const float *RESTRICT fil, *RESTRICT phd, *RESTRICT scd, *RESTRICT spd;
+    float32x4_t sf4, pf4;
+
+    BSincCoeffs(const InterpState &istate, const uint frac)
+    {
+        const size_t m{istate.bsinc.m};
+        const uint pi{frac >> FracPhaseBitDiff};
+        const float pf{static_cast<float>(frac & (FracPhaseDiffOne-1)) *
+            (1.0f/FracPhaseDiffOne)};
+
+        fil = istate.bsinc.filter + m*pi*2;
+        phd = fil + m;
+        scd = fil + BSincPhaseCount*2*m;
+        spd = scd + m;
+        sf4 = vdupq_n_f32(istate.bsinc.sf);
+        pf4 = vdupq_n_f32(pf);
+    }
+
+    /* f = ((fil + sf*scd) + pf*(phd + sf*spd)) */
+    float32x4_t operator()(const size_t j) const
+    {
+        return vmlaq_f32(vmlaq_f32(vld1q_f32(&fil[j]), sf4, vld1q_f32(&scd[j])),
+            pf4, vmlaq_f32(vld1q_f32(&phd[j]), sf4, vld1q_f32(&spd[j])));
+    }
+};
+
+struct FastBSincCoeffs {
+    const float *RESTRICT fil, *RESTRICT phd;
+    float32x4_t pf4;
+
+    FastBSincCoeffs(const InterpState &istate, const uint frac)
+    {
+        const size_t m{istate.bsinc.m};
+        const uint pi{frac >> FracPhaseBitDiff};
+        const float pf{static_cast<float>(frac & (FracPhaseDiffOne-1)) *
+            (1.0f/FracPhaseDiffOne)};
+
+        fil = istate.bsinc.filter + m*pi*2;
+        phd = fil + m;
+        pf4 = vdupq_n_f32(pf);
+    }
+
+    /* f = fil + pf*phd */
+    float32x4_t operator()(const size_t j) const
+    { return vmlaq_f32(vld1q_f32(&fil[j]), pf4, vld1q_f32(&phd[j])); }
+};
+
+struct PolyphaseCoeffs {
+    const float *RESTRICT fil;
+
+    PolyphaseCoeffs(const InterpState &istate, const uint frac)
+      : fil{istate.polyphase.filter + istate.polyphase.m*(frac>>istate.polyphase.shift)}
+    { }
+
+    float32x4_t operator()(const size_t j) const { return vld1q_f32(&fil[j]); }
+};
+
+inline float reduce_add(float32x4_t r4)
+{
+    r4 = vaddq_f32(r4, vrev64q_f32(r4));
+    return vget_lane_f32(vadd_f32(vget_low_f32(r4), vget_high_f32(r4)), 0);
+}
+
+template<typename CoeffsT>
+void DoResampleMulti(const InterpState *state, const size_t m, const size_t l,
+    const al::span<float*const> src, uint frac, uint increment, const al::span<float*const> dst,
+    const size_t dstlen)
+{
+    ASSUME(m > 0);
+    const InterpState istate{*state};
+
+    size_t pos{0};
+    for(size_t i{0};i < dstlen;++i)
+    {
+        const CoeffsT coeffs{istate, frac};
+        size_t c{0};
+        for(;src.size()-c > 1;c += 2)
+        {
+            const float *RESTRICT vals0{src[c] - l + pos};
+            const float *RESTRICT vals1{src[c+1] - l + pos};
+            float32x4_t r0{vdupq_n_f32(0.0f)}, r1{vdupq_n_f32(0.0f)};
+            for(size_t j{0u};j < m;j += 4)
+            {
+                /* r += f*src */
+                const float32x4_t f4{coeffs(j)};
+                r0 = vmlaq_f32(r0, f4, vld1q_f32(&vals0[j]));
+                r1 = vmlaq_f32(r1, f4, vld1q_f32(&vals1[j]));
+            }
+            dst[c][i] = reduce_add(r0);
+            dst[c+1][i] = reduce_add(r1);
+        }
+        if(c < src.size())
+        {
+            const float *RESTRICT vals{src[c] - l + pos};
+            float32x4_t r4{vdupq_n_f32(0.0f)};
+            for(size_t j{0u};j < m;j += 4)
+                r4 = vmlaq_f32(r4, coeffs(j), vld1q_f32(&vals[j]));
+            dst[c][i] = reduce_add(r4);
+        }
+
+        frac += increment;
+        pos  += frac>>MixerFracBits;
+        frac &= MixerFracMask;
+    }
+}
+
 } // namespace
 
 template<>
@@ -111,6 +244,66 @@ float *Resample_<LerpTag,NEONTag>(const InterpState*, float *RESTRICT src, uint
     return dst.data();
 }
 
+template<>
+float *Resample_<CubicTag,NEONTag>(const InterpState*, float *RESTRICT src, uint frac,
+    uint increment, const al::span<float> dst)
+{
+    const int32x4_t increment4 = vdupq_n_s32(static_cast<int>(increment*4));
+    const float32x4_t fracOne4 = vdupq_n_f32(1.0f/MixerFracOne);
+    const int32x4_t fracMask4 = vdupq_n_s32(MixerFracMask);
+    alignas(16) uint pos_[4], frac_[4];
+    int32x4_t pos4, frac4;
+
+    src -= 1;
+    InitPosArrays(frac, increment, frac_, pos_);
+    frac4 = vld1q_s32(reinterpret_cast<int*>(frac_));
+    pos4 = vld1q_s32(reinterpret_cast<int*>(pos_));
+
+    auto dst_iter = dst.begin();
+    for(size_t todo{dst.size()>>2};todo;--todo)
+    {
+        const int pos0{vgetq_lane_s32(pos4, 0)};
+        const int pos1{vgetq_lane_s32(pos4, 1)};
+        const int pos2{vgetq_lane_s32(pos4, 2)};
+        const int pos3{vgetq_lane_s32(pos4, 3)};
+        /* Load the four input samples for each output, and transpose them so
+         * each vector holds the same tap for all four outputs.
+         */
+        const float32x4x2_t t01{vtrnq_f32(vld1q_f32(&src[pos0]), vld1q_f32(&src[pos1]))};
+        const float32x4x2_t t23{vtrnq_f32(vld1q_f32(&src[pos2]), vld1q_f32(&src[pos3]))};
+        const float32x4_t val1{vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]))};
+        const float32x4_t val2{vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]))};
+        const float32x4_t val3{vcombine_f32(vget_high_f32(t01.val[0]),
+            vget_high_f32(t23.val[0]))};
+        const float32x4_t val4{vcombine_f32(vget_high_f32(t01.val[1]),
+            vget_high_f32(t23.val[1]))};
+
+        const float32x4_t mu{vmulq_f32(vcvtq_f32_s32(frac4), fracOne4)};
+        vst1q_f32(dst_iter, cubic4(val1, val2, val3, val4, mu));
+        dst_iter += 4;
+
+        frac4 = vaddq_s32(frac4, increment4);
+        pos4 = vaddq_s32(pos4, vshrq_n_s32(frac4, MixerFracBits));
+        frac4 = vandq_s32(frac4, fracMask4);
+    }
+
+    if(size_t todo{dst.size()&3})
+    {
+        src += static_cast<uint>(vgetq_lane_s32(pos4, 0));
+        frac = static_cast<uint>(vgetq_lane_s32(frac4, 0));
+
+        do {
+            *(dst_iter++) = cubic(src[0], src[1], src[2], src[3],
+                static_cast<float>(frac) * (1.0f/MixerFracOne));
+
+            frac += increment;
+            src  += frac>>MixerFracBits;
+            frac &= MixerFracMask;
+        } while(--todo);
+    }
+    return dst.data();
+}
+
 template<>
 float *Resample_<BSincTag,NEONTag>(const InterpState *state, float *RESTRICT src, uint frac,
     uint increment, const al::span<float> dst)
@@ -201,6 +394,67 @@ float *Resample_<FastBSincTag,NEONTag>(const InterpState *state, float *RESTRICT
 }
 
 
+template<>
+float *Resample_<PolyphaseTag,NEONTag>(const InterpState *state, float *RESTRICT src, uint frac,
+    uint increment, const al::span<float> dst)
+{
+    const float *const filter{state->polyphase.filter};
+    const uint shift{state->polyphase.shift};
+    const size_t m{state->polyphase.m};
+    ASSUME(m > 0);
+
+    src -= state->polyphase.l;
+    for(float &out_sample : dst)
+    {
+        // Apply the phase's filter.
+        float32x4_t r4{vdupq_n_f32(0.0f)};
+        {
+            const float *RESTRICT fil{filter + m*(frac>>shift)};
+            size_t td{m >> 2};
+            size_t j{0u};
+
+            do {
+                /* r += fil*src */
+                r4 = vmlaq_f32(r4, vld1q_f32(&fil[j]), vld1q_f32(&src[j]));
+                j += 4;
+            } while(--td);
+        }
+        r4 = vaddq_f32(r4, vrev64q_f32(r4));
+        out_sample = vget_lane_f32(vadd_f32(vget_low_f32(r4), vget_high_f32(r4)), 0);
+
+        frac += increment;
+        src  += frac>>MixerFracBits;
+        frac &= MixerFracMask;
+    }
+    return dst.data();
+}
+
+template<>
+void ResampleMulti_<BSincTag,NEONTag>(const InterpState *state, const al::span<float*const> src,
+    uint frac, uint increment, const al::span<float*const> dst, const size_t dstlen)
+{
+    DoResampleMulti<BSincCoeffs>(state, state->bsinc.m, state->bsinc.l, src, frac, increment,
+        dst, dstlen);
+}
+
+template<>
+void ResampleMulti_<FastBSincTag,NEONTag>(const InterpState *state,
+    const al::span<float*const> src, uint frac, uint increment, const al::span<float*const> dst,
+    const size_t dstlen)
+{
+    DoResampleMulti<FastBSincCoeffs>(state, state->bsinc.m, state->bsinc.l, src, frac,
+        increment, dst, dstlen);
+}
+
+template<>
+void ResampleMulti_<PolyphaseTag,NEONTag>(const InterpState *state,
+    const al::span<float*const> src, uint frac, uint increment, const al::span<float*const> dst,
+    const size_t dstlen)
+{
+    DoResampleMulti<PolyphaseCoeffs>(state, state->polyphase.m, state->polyphase.l, src, frac,
+        increment, dst, dstlen);
+}
+
 template<>
 void MixHrtf_<NEONTag>(const float *InSamples, float2 *AccumSamples, const uint IrSize,
     const MixHrtfFilter *hrtfparams, const size_t BufferSize)
@@ -217,10 +471,11 @@ void MixHrtfBlend_<NEONTag>(const float *InSamples, float2 *AccumSamples, const
 template<>
 void MixDirectHrtf_<NEONTag>(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
     const al::span<const FloatBufferLine> InSamples, float2 *AccumSamples,
-    float *TempBuf, HrtfChannelState *ChanState, const size_t IrSize, const size_t BufferSize)
+    float *TempBuf, HrtfChannelState *ChanState, HrtfTailConvolver *TailConv, const size_t IrSize,
+    const size_t BufferSize)
 {
     MixDirectHrtfBase<ApplyCoeffs>(LeftOut, RightOut, InSamples, AccumSamples, TempBuf, ChanState,
-        IrSize, BufferSize);
+        TailConv, IrSize, BufferSize);
 }
 
 
@@ -305,3 +560,139 @@ void Mix_<NEONTag>(const al::span<const float> InSamples, const al::span<FloatBu
             dst[pos] += InSamples[pos] * gain;
     }
 }
+
+template<>
+void LoadHalf_<NEONTag>(float *RESTRICT dst, const uint16_t *src, const size_t srcstep,
+    const size_t samples)
+{
+    size_t i{0};
+    /* 32-bit ARM needs the half-float conversion extension for this. */
+#if defined(__aarch64__) || (defined(__ARM_FP) && (__ARM_FP&2))
+    if(srcstep == 1)
+    {
+        for(;samples-i >= 4;i += 4)
+            vst1q_f32(dst+i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src+i))));
+    }
+    else
+    {
+        /* Gather every srcstep value for interleaved channels. */
+        for(;samples-i >= 4;i += 4)
+        {
+            const uint16_t *s{src + i*srcstep};
+            uint16x4_t halves{vdup_n_u16(s[0])};
+            halves = vset_lane_u16(s[srcstep], halves, 1);
+            halves = vset_lane_u16(s[srcstep*2], halves, 2);
+            halves = vset_lane_u16(s[srcstep*3], halves, 3);
+            vst1q_f32(dst+i, vcvt_f32_f16(vreinterpret_f16_u16(halves)));
+        }
+    }
+#endif
+    for(;i < samples;++i)
+        dst[i] = al::HalfToFloat(src[i*srcstep]);
+}
+
+
+namespace {
+
+/* De-interleaves 4 frames at a time. Each pair of channels is loaded 64 bits
+ * at a time from 4 consecutive frames, then unzipped.
+ */
+inline void DeinterleaveNEON(const al::span<float*> dst, const size_t dstOffset,
+    const float *RESTRICT src, const size_t frames)
+{
+    const size_t numchans{dst.size()};
+    const size_t todo{frames & ~size_t{3}};
+    for(size_t c{0};c < numchans;c += 2)
+    {
+        float *RESTRICT out0{dst[c] + dstOffset};
+        float *RESTRICT out1{dst[c+1] + dstOffset};
+        const float *in{src + c};
+        for(size_t i{0};i < todo;i += 4)
+        {
+            const float32x4_t ab{vcombine_f32(vld1_f32(in), vld1_f32(in + numchans))};
+            const float32x4_t cd{vcombine_f32(vld1_f32(in + numchans*2),
+                vld1_f32(in + numchans*3))};
+            const float32x4x2_t chans{vuzpq_f32(ab, cd)};
+            vst1q_f32(out0+i, chans.val[0]);
+            vst1q_f32(out1+i, chans.val[1]);
+            in += numchans*4;
+        }
+    }
+    DeinterleaveRemainder(dst, dstOffset, src, todo, frames);
+}
+
+inline void ConvertUByte(float *RESTRICT dst, const al::byte *src, const size_t count)
+{
+    const auto *bsrc = reinterpret_cast<const uint8_t*>(src);
+    const float32x4_t scale4{vdupq_n_f32(1.0f/128.0f)};
+    const float32x4_t one4{vdupq_n_f32(1.0f)};
+    /* Not fused, to match the rounding of the C conversion. */
+    auto convert4 = [scale4,one4](const uint16x4_t u4) -> float32x4_t
+    { return vsubq_f32(vmulq_f32(vcvtq_f32_u32(vmovl_u16(u4)), scale4), one4); };
+
+    size_t i{0};
+    for(;count-i >= 8;i += 8)
+    {
+        const uint16x8_t u8{vmovl_u8(vld1_u8(bsrc+i))};
+        vst1q_f32(dst+i,   convert4(vget_low_u16(u8)));
+        vst1q_f32(dst+i+4, convert4(vget_high_u16(u8)));
+    }
+    for(;i < count;++i)
+        dst[i] = al::FmtTypeTraits<FmtUByte>::to<float>(bsrc[i]);
+}
+
+inline void ConvertShort(float *RESTRICT dst, const al::byte *src, const size_t count)
+{
+    const auto *ssrc = reinterpret_cast<const int16_t*>(src);
+    const float32x4_t scale4{vdupq_n_f32(1.0f/32768.0f)};
+
+    size_t i{0};
+    for(;count-i >= 8;i += 8)
+    {
+        const int16x8_t s8{vld1q_s16(ssrc+i)};
+        vst1q_f32(dst+i,   vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s8))), scale4));
+        vst1q_f32(dst+i+4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s8))), scale4));
+    }
+    for(;i < count;++i)
+        dst[i] = al::FmtTypeTraits<FmtShort>::to<float>(ssrc[i]);
+}
+
+} // namespace
+
+template<>
+void LoadInterleaved_<UByteTag,NEONTag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{
+    LoadInterleavedBase<UByteTag,ConvertUByte,DeinterleaveNEON>(dst, dstOffset, src, frames);
+}
+
+template<>
+void LoadInterleaved_<ShortTag,NEONTag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{
+    LoadInterleavedBase<ShortTag,ConvertShort,DeinterleaveNEON>(dst, dstOffset, src, frames);
+}
+
+template<>
+void LoadInterleaved_<FloatTag,NEONTag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{
+    LoadInterleavedBase<FloatTag,ConvertSamplesBase<FloatTag>,DeinterleaveNEON>(dst, dstOffset,
+        src, frames);
+}
+
+template<>
+void LoadInterleaved_<MulawTag,NEONTag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{
+    LoadInterleavedBase<MulawTag,ConvertSamplesBase<MulawTag>,DeinterleaveNEON>(dst, dstOffset,
+        src, frames);
+}
+
+template<>
+void LoadInterleaved_<AlawTag,NEONTag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{
+    LoadInterleavedBase<AlawTag,ConvertSamplesBase<AlawTag>,DeinterleaveNEON>(dst, dstOffset,
+        src, frames);
+}
@@ -13,6 +13,7 @@
 struct SSETag;
 struct BSincTag;
 struct FastBSincTag;
+struct PolyphaseTag;
 
 
 #if defined(__GNUC__) && !defined(__clang__) && !defined(__SSE__)
@@ -73,6 +74,118 @@ inline void ApplyCoeffs(float2 *RESTRICT Values, const size_t IrSize, const Cons
     }
 }
 
+/* The multi-channel resamplers find the filter for each output sample once
+ * per pair of channels, applying each group of coefficients to both channels
+ * as it's made.
+ */
+struct BSincCoeffs {
+    const float *RESTRICT fil, *RESTRICT phd, *RESTRICT scd, *RESTRICT spd;
+    __m128 sf4, pf4;
+
+    BSincCoeffs(const InterpState &istate, const uint frac)
+    {
+        const size_t m{istate.bsinc.m};
+        const uint pi{frac >> FracPhaseBitDiff};
+        const float pf{static_cast<float>(frac & (FracPhaseDiffOne-1)) *
+            (1.0f/FracPhaseDiffOne)};
+
+        fil = istate.bsinc.filter + m*pi*2;
+        phd = fil + m;
+        scd = fil + BSincPhaseCount*2*m;
+        spd = scd + m;
+        sf4 = _mm_set1_ps(istate.bsinc.sf);
+        pf4 = _mm_set1_ps(pf);
+    }
+
+    /* f = ((fil + sf*scd) + pf*(phd + sf*spd)) */
+    __m128 operator()(const size_t j) const
+    {
+        return MLA4(MLA4(_mm_load_ps(&fil[j]), sf4, _mm_load_ps(&scd[j])),
+            pf4, MLA4(_mm_load_ps(&phd[j]), sf4, _mm_load_ps(&spd[j])));
+    }
+};
+
+struct FastBSincCoeffs {
+    const float *RESTRICT fil, *RESTRICT phd;
+    __m128 pf4;
+
+    FastBSincCoeffs(const InterpState &istate, const uint frac)
+    {
+        const size_t m{istate.bsinc.m};
+        const uint pi{frac >> FracPhaseBitDiff};
+        const float pf{static_cast<float>(frac & (FracPhaseDiffOne-1)) *
+            (1.0f/FracPhaseDiffOne)};
+
+        fil = istate.bsinc.filter + m*pi*2;
+        phd = fil + m;
+        pf4 = _mm_set1_ps(pf);
+    }
+
+    /* f = fil + pf*phd */
+    __m128 operator()(const size_t j) const
+    { return MLA4(_mm_load_ps(&fil[j]), pf4, _mm_load_ps(&phd[j])); }
+};
+
+struct PolyphaseCoeffs {
+    const float *RESTRICT fil;
+
+    PolyphaseCoeffs(const InterpState &istate, const uint frac)
+      : fil{istate.polyphase.filter + istate.polyphase.m*(frac>>istate.polyphase.shift)}
+    { }
+
+    __m128 operator()(const size_t j) const { return _mm_load_ps(&fil[j]); }
+};
+
+inline float reduce_add(__m128 r4)
+{
+    r4 = _mm_add_ps(r4, _mm_shuffle_ps(r4, r4, _MM_SHUFFLE(0, 1, 2, 3)));
+    r4 = _mm_add_ps(r4, _mm_movehl_ps(r4, r4));
+    return _mm_cvtss_f32(r4);
+}
+
+template<typename CoeffsT>
+void DoResampleMulti(const InterpState *state, const size_t m, const size_t l,
+    const al::span<float*const> src, uint frac, uint increment, const al::span<float*const> dst,
+    const size_t dstlen)
+{
+    ASSUME(m > 0);
+    const InterpState istate{*state};
+
+    size_t pos{0};
+    for(size_t i{0};i < dstlen;++i)
+    {
+        const CoeffsT coeffs{istate, frac};
+        size_t c{0};
+        for(;src.size()-c > 1;c += 2)
+        {
+            const float *RESTRICT vals0{src[c] - l + pos};
+            const float *RESTRICT vals1{src[c+1] - l + pos};
+            __m128 r0{_mm_setzero_ps()}, r1{_mm_setzero_ps()};
+            for(size_t j{0u};j < m;j += 4)
+            {
+                /* r += f*src */
+                const __m128 f4{coeffs(j)};
+                r0 = MLA4(r0, f4, _mm_loadu_ps(&vals0[j]));
+                r1 = MLA4(r1, f4, _mm_loadu_ps(&vals1[j]));
+            }
+            dst[c][i] = reduce_add(r0);
+            dst[c+1][i] = reduce_add(r1);
+        }
+        if(c < src.size())
+        {
+            const float *RESTRICT vals{src[c] - l + pos};
+            __m128 r4{_mm_setzero_ps()};
+            for(size_t j{0u};j < m;j += 4)
+                r4 = MLA4(r4, coeffs(j), _mm_loadu_ps(&vals[j]));
+            dst[c][i] = reduce_add(r4);
+        }
+
+        frac += increment;
+        pos  += frac>>MixerFracBits;
+        frac &= MixerFracMask;
+    }
+}
+
 } // namespace
 
 template<>
@@ -167,6 +280,68 @@ float *Resample_<FastBSincTag,SSETag>(const InterpState *state, float *RESTRICT
 }
 
 
+template<>
+float *Resample_<PolyphaseTag,SSETag>(const InterpState *state, float *RESTRICT src, uint frac,
+    uint increment, const al::span<float> dst)
+{
+    const float *const filter{state->polyphase.filter};
+    const uint shift{state->polyphase.shift};
+    const size_t m{state->polyphase.m};
+    ASSUME(m > 0);
+
+    src -= state->polyphase.l;
+    for(float &out_sample : dst)
+    {
+        // Apply the phase's filter.
+        __m128 r4{_mm_setzero_ps()};
+        {
+            const float *RESTRICT fil{filter + m*(frac>>shift)};
+            size_t td{m >> 2};
+            size_t j{0u};
+
+            do {
+                /* r += fil*src */
+                r4 = MLA4(r4, _mm_load_ps(&fil[j]), _mm_loadu_ps(&src[j]));
+                j += 4;
+            } while(--td);
+        }
+        r4 = _mm_add_ps(r4, _mm_shuffle_ps(r4, r4, _MM_SHUFFLE(0, 1, 2, 3)));
+        r4 = _mm_add_ps(r4, _mm_movehl_ps(r4, r4));
+        out_sample = _mm_cvtss_f32(r4);
+
+        frac += increment;
+        src  += frac>>MixerFracBits;
+        frac &= MixerFracMask;
+    }
+    return dst.data();
+}
+
+template<>
+void ResampleMulti_<BSincTag,SSETag>(const InterpState *state, const al::span<float*const> src,
+    uint frac, uint increment, const al::span<float*const> dst, const size_t dstlen)
+{
+    DoResampleMulti<BSincCoeffs>(state, state->bsinc.m, state->bsinc.l, src, frac, increment,
+        dst, dstlen);
+}
+
+template<>
+void ResampleMulti_<FastBSincTag,SSETag>(const InterpState *state,
+    const al::span<float*const> src, uint frac, uint increment, const al::span<float*const> dst,
+    const size_t dstlen)
+{
+    DoResampleMulti<FastBSincCoeffs>(state, state->bsinc.m, state->bsinc.l, src, frac,
+        increment, dst, dstlen);
+}
+
+template<>
+void ResampleMulti_<PolyphaseTag,SSETag>(const InterpState *state,
+    const al::span<float*const> src, uint frac, uint increment, const al::span<float*const> dst,
+    const size_t dstlen)
+{
+    DoResampleMulti<PolyphaseCoeffs>(state, state->polyphase.m, state->polyphase.l, src, frac,
+        increment, dst, dstlen);
+}
+
 template<>
 void MixHrtf_<SSETag>(const float *InSamples, float2 *AccumSamples, const uint IrSize,
     const MixHrtfFilter *hrtfparams, const size_t BufferSize)
@@ -183,10 +358,11 @@ void MixHrtfBlend_<SSETag>(const float *InSamples, float2 *AccumSamples, const u
 template<>
 void MixDirectHrtf_<SSETag>(const FloatBufferSpan LeftOut, const FloatBufferSpan RightOut,
     const al::span<const FloatBufferLine> InSamples, float2 *AccumSamples,
-    float *TempBuf, HrtfChannelState *ChanState, const size_t IrSize, const size_t BufferSize)
+    float *TempBuf, HrtfChannelState *ChanState, HrtfTailConvolver *TailConv, const size_t IrSize,
+    const size_t BufferSize)
 {
     MixDirectHrtfBase<ApplyCoeffs>(LeftOut, RightOut, InSamples, AccumSamples, TempBuf, ChanState,
-        IrSize, BufferSize);
+        TailConv, IrSize, BufferSize);
 }
 
 
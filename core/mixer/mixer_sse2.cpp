@@ -23,17 +23,44 @@
 #include <xmmintrin.h>
 #include <emmintrin.h>
 
+#include <algorithm>
+
 #include "alnumeric.h"
 #include "defs.h"
+#include "loadbase.h"
 
 struct SSE2Tag;
 struct LerpTag;
+struct CubicTag;
 
 
 #if defined(__GNUC__) && !defined(__clang__) && !defined(__SSE2__)
 #pragma GCC target("sse2")
 #endif
 
+namespace {
+
+/* Calculates the cubic interpolation of four sample sets, using the same
+ * operation order as the scalar cubic() so the results match it exactly.
+ */
+inline __m128 cubic4(const __m128 val1, const __m128 val2, const __m128 val3, const __m128 val4,
+    const __m128 mu)
+{
+    const __m128 mu2{_mm_mul_ps(mu, mu)}, mu3{_mm_mul_ps(mu2, mu)};
+    const __m128 a0{_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(-0.5f), mu3), mu2),
+        _mm_mul_ps(_mm_set1_ps(-0.5f), mu))};
+    const __m128 a1{_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(1.5f), mu3),
+        _mm_mul_ps(_mm_set1_ps(-2.5f), mu2)), _mm_set1_ps(1.0f))};
+    const __m128 a2{_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.5f), mu3),
+        _mm_mul_ps(_mm_set1_ps(2.0f), mu2)), _mm_mul_ps(_mm_set1_ps(0.5f), mu))};
+    const __m128 a3{_mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.5f), mu3),
+        _mm_mul_ps(_mm_set1_ps(-0.5f), mu2))};
+    return _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(val1, a0), _mm_mul_ps(val2, a1)),
+        _mm_mul_ps(val3, a2)), _mm_mul_ps(val4, a3));
+}
+
+} // namespace
+
 template<>
 float *Resample_<LerpTag,SSE2Tag>(const InterpState*, float *RESTRICT src, uint frac,
     uint increment, const al::span<float> dst)
@@ -87,3 +114,177 @@ float *Resample_<LerpTag,SSE2Tag>(const InterpState*, float *RESTRICT src, uint
     }
     return dst.data();
 }
+
+template<>
+float *Resample_<CubicTag,SSE2Tag>(const InterpState*, float *RESTRICT src, uint frac,
+    uint increment, const al::span<float> dst)
+{
+    const __m128i increment4{_mm_set1_epi32(static_cast<int>(increment*4))};
+    const __m128 fracOne4{_mm_set1_ps(1.0f/MixerFracOne)};
+    const __m128i fracMask4{_mm_set1_epi32(MixerFracMask)};
+
+    src -= 1;
+    alignas(16) uint pos_[4], frac_[4];
+    InitPosArrays(frac, increment, frac_, pos_);
+    __m128i frac4{_mm_setr_epi32(static_cast<int>(frac_[0]), static_cast<int>(frac_[1]),
+        static_cast<int>(frac_[2]), static_cast<int>(frac_[3]))};
+    __m128i pos4{_mm_setr_epi32(static_cast<int>(pos_[0]), static_cast<int>(pos_[1]),
+        static_cast<int>(pos_[2]), static_cast<int>(pos_[3]))};
+
+    auto dst_iter = dst.begin();
+    for(size_t todo{dst.size()>>2};todo;--todo)
+    {
+        const int pos0{_mm_cvtsi128_si32(pos4)};
+        const int pos1{_mm_cvtsi128_si32(_mm_srli_si128(pos4, 4))};
+        const int pos2{_mm_cvtsi128_si32(_mm_srli_si128(pos4, 8))};
+        const int pos3{_mm_cvtsi128_si32(_mm_srli_si128(pos4, 12))};
+        /* Load the four input samples for each output, and transpose them so
+         * each vector holds the same tap for all four outputs.
+         */
+        __m128 val1{_mm_loadu_ps(&src[pos0])};
+        __m128 val2{_mm_loadu_ps(&src[pos1])};
+        __m128 val3{_mm_loadu_ps(&src[pos2])};
+        __m128 val4{_mm_loadu_ps(&src[pos3])};
+        _MM_TRANSPOSE4_PS(val1, val2, val3, val4);
+
+        const __m128 mu{_mm_mul_ps(_mm_cvtepi32_ps(frac4), fracOne4)};
+        _mm_store_ps(dst_iter, cubic4(val1, val2, val3, val4, mu));
+        dst_iter += 4;
+
+        frac4 = _mm_add_epi32(frac4, increment4);
+        pos4 = _mm_add_epi32(pos4, _mm_srli_epi32(frac4, MixerFracBits));
+        frac4 = _mm_and_si128(frac4, fracMask4);
+    }
+
+    if(size_t todo{dst.size()&3})
+    {
+        src += static_cast<uint>(_mm_cvtsi128_si32(pos4));
+        frac = static_cast<uint>(_mm_cvtsi128_si32(frac4));
+
+        do {
+            *(dst_iter++) = cubic(src[0], src[1], src[2], src[3],
+                static_cast<float>(frac) * (1.0f/MixerFracOne));
+
+            frac += increment;
+            src  += frac>>MixerFracBits;
+            frac &= MixerFracMask;
+        } while(--todo);
+    }
+    return dst.data();
+}
+
+
+namespace {
+
+/* De-interleaves 4 frames at a time. Each pair of channels is loaded 64 bits
+ * at a time from 4 consecutive frames, then shuffled apart.
+ */
+inline void DeinterleaveSSE(const al::span<float*> dst, const size_t dstOffset,
+    const float *RESTRICT src, const size_t frames)
+{
+    const size_t numchans{dst.size()};
+    const size_t todo{frames & ~size_t{3}};
+    for(size_t c{0};c < numchans;c += 2)
+    {
+        float *RESTRICT out0{dst[c] + dstOffset};
+        float *RESTRICT out1{dst[c+1] + dstOffset};
+        const float *in{src + c};
+        for(size_t i{0};i < todo;i += 4)
+        {
+            __m128 ab{_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(in))};
+            ab = _mm_loadh_pi(ab, reinterpret_cast<const __m64*>(in + numchans));
+            __m128 cd{_mm_loadl_pi(_mm_setzero_ps(),
+                reinterpret_cast<const __m64*>(in + numchans*2))};
+            cd = _mm_loadh_pi(cd, reinterpret_cast<const __m64*>(in + numchans*3));
+            _mm_storeu_ps(out0+i, _mm_shuffle_ps(ab, cd, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(out1+i, _mm_shuffle_ps(ab, cd, _MM_SHUFFLE(3, 1, 3, 1)));
+            in += numchans*4;
+        }
+    }
+    DeinterleaveRemainder(dst, dstOffset, src, todo, frames);
+}
+
+inline void ConvertUByte(float *RESTRICT dst, const al::byte *src, const size_t count)
+{
+    const auto *bsrc = reinterpret_cast<const uint8_t*>(src);
+    const __m128 scale4{_mm_set1_ps(1.0f/128.0f)};
+    const __m128 one4{_mm_set1_ps(1.0f)};
+    const __m128i zero{_mm_setzero_si128()};
+    auto convert4 = [scale4,one4](const __m128i i4) -> __m128
+    { return _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(i4), scale4), one4); };
+
+    size_t i{0};
+    for(;count-i >= 16;i += 16)
+    {
+        const __m128i b16{_mm_loadu_si128(reinterpret_cast<const __m128i*>(bsrc+i))};
+        const __m128i lo8{_mm_unpacklo_epi8(b16, zero)};
+        const __m128i hi8{_mm_unpackhi_epi8(b16, zero)};
+        _mm_storeu_ps(dst+i,    convert4(_mm_unpacklo_epi16(lo8, zero)));
+        _mm_storeu_ps(dst+i+4,  convert4(_mm_unpackhi_epi16(lo8, zero)));
+        _mm_storeu_ps(dst+i+8,  convert4(_mm_unpacklo_epi16(hi8, zero)));
+        _mm_storeu_ps(dst+i+12, convert4(_mm_unpackhi_epi16(hi8, zero)));
+    }
+    for(;i < count;++i)
+        dst[i] = al::FmtTypeTraits<FmtUByte>::to<float>(bsrc[i]);
+}
+
+inline void ConvertShort(float *RESTRICT dst, const al::byte *src, const size_t count)
+{
+    const auto *ssrc = reinterpret_cast<const int16_t*>(src);
+    const __m128 scale4{_mm_set1_ps(1.0f/32768.0f)};
+
+    size_t i{0};
+    for(;count-i >= 8;i += 8)
+    {
+        const __m128i s8{_mm_loadu_si128(reinterpret_cast<const __m128i*>(ssrc+i))};
+        /* Sign-extend by putting each sample in the upper half of a 32-bit
+         * lane and shifting it down.
+         */
+        const __m128i lo4{_mm_srai_epi32(_mm_unpacklo_epi16(s8, s8), 16)};
+        const __m128i hi4{_mm_srai_epi32(_mm_unpackhi_epi16(s8, s8), 16)};
+        _mm_storeu_ps(dst+i,   _mm_mul_ps(_mm_cvtepi32_ps(lo4), scale4));
+        _mm_storeu_ps(dst+i+4, _mm_mul_ps(_mm_cvtepi32_ps(hi4), scale4));
+    }
+    for(;i < count;++i)
+        dst[i] = al::FmtTypeTraits<FmtShort>::to<float>(ssrc[i]);
+}
+
+} // namespace
+
+template<>
+void LoadInterleaved_<UByteTag,SSE2Tag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{
+    LoadInterleavedBase<UByteTag,ConvertUByte,DeinterleaveSSE>(dst, dstOffset, src, frames);
+}
+
+template<>
+void LoadInterleaved_<ShortTag,SSE2Tag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{
+    LoadInterleavedBase<ShortTag,ConvertShort,DeinterleaveSSE>(dst, dstOffset, src, frames);
+}
+
+template<>
+void LoadInterleaved_<FloatTag,SSE2Tag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{
+    LoadInterleavedBase<FloatTag,ConvertSamplesBase<FloatTag>,DeinterleaveSSE>(dst, dstOffset,
+        src, frames);
+}
+
+template<>
+void LoadInterleaved_<MulawTag,SSE2Tag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{
+    LoadInterleavedBase<MulawTag,ConvertSamplesBase<MulawTag>,DeinterleaveSSE>(dst, dstOffset,
+        src, frames);
+}
+
+template<>
+void LoadInterleaved_<AlawTag,SSE2Tag>(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames)
+{
+    LoadInterleavedBase<AlawTag,ConvertSamplesBase<AlawTag>,DeinterleaveSSE>(dst, dstOffset,
+        src, frames);
+}
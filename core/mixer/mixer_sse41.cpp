@@ -29,12 +29,36 @@
 
 struct SSE4Tag;
 struct LerpTag;
+struct CubicTag;
 
 
 #if defined(__GNUC__) && !defined(__clang__) && !defined(__SSE4_1__)
 #pragma GCC target("sse4.1")
 #endif
 
+namespace {
+
+/* Calculates the cubic interpolation of four sample sets, using the same
+ * operation order as the scalar cubic() so the results match it exactly.
+ */
+inline __m128 cubic4(const __m128 val1, const __m128 val2, const __m128 val3, const __m128 val4,
+    const __m128 mu)
+{
+    const __m128 mu2{_mm_mul_ps(mu, mu)}, mu3{_mm_mul_ps(mu2, mu)};
+    const __m128 a0{_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(-0.5f), mu3), mu2),
+        _mm_mul_ps(_mm_set1_ps(-0.5f), mu))};
+    const __m128 a1{_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(1.5f), mu3),
+        _mm_mul_ps(_mm_set1_ps(-2.5f), mu2)), _mm_set1_ps(1.0f))};
+    const __m128 a2{_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.5f), mu3),
+        _mm_mul_ps(_mm_set1_ps(2.0f), mu2)), _mm_mul_ps(_mm_set1_ps(0.5f), mu))};
+    const __m128 a3{_mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.5f), mu3),
+        _mm_mul_ps(_mm_set1_ps(-0.5f), mu2))};
+    return _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(val1, a0), _mm_mul_ps(val2, a1)),
+        _mm_mul_ps(val3, a2)), _mm_mul_ps(val4, a3));
+}
+
+} // namespace
+
 template<>
 float *Resample_<LerpTag,SSE4Tag>(const InterpState*, float *RESTRICT src, uint frac,
     uint increment, const al::span<float> dst)
@@ -92,3 +116,61 @@ float *Resample_<LerpTag,SSE4Tag>(const InterpState*, float *RESTRICT src, uint
     }
     return dst.data();
 }
+
+template<>
+float *Resample_<CubicTag,SSE4Tag>(const InterpState*, float *RESTRICT src, uint frac,
+    uint increment, const al::span<float> dst)
+{
+    const __m128i increment4{_mm_set1_epi32(static_cast<int>(increment*4))};
+    const __m128 fracOne4{_mm_set1_ps(1.0f/MixerFracOne)};
+    const __m128i fracMask4{_mm_set1_epi32(MixerFracMask)};
+
+    src -= 1;
+    alignas(16) uint pos_[4], frac_[4];
+    InitPosArrays(frac, increment, frac_, pos_);
+    __m128i frac4{_mm_setr_epi32(static_cast<int>(frac_[0]), static_cast<int>(frac_[1]),
+        static_cast<int>(frac_[2]), static_cast<int>(frac_[3]))};
+    __m128i pos4{_mm_setr_epi32(static_cast<int>(pos_[0]), static_cast<int>(pos_[1]),
+        static_cast<int>(pos_[2]), static_cast<int>(pos_[3]))};
+
+    auto dst_iter = dst.begin();
+    for(size_t todo{dst.size()>>2};todo;--todo)
+    {
+        const int pos0{_mm_extract_epi32(pos4, 0)};
+        const int pos1{_mm_extract_epi32(pos4, 1)};
+        const int pos2{_mm_extract_epi32(pos4, 2)};
+        const int pos3{_mm_extract_epi32(pos4, 3)};
+        /* Load the four input samples for each output, and transpose them so
+         * each vector holds the same tap for all four outputs.
+         */
+        __m128 val1{_mm_loadu_ps(&src[pos0])};
+        __m128 val2{_mm_loadu_ps(&src[pos1])};
+        __m128 val3{_mm_loadu_ps(&src[pos2])};
+        __m128 val4{_mm_loadu_ps(&src[pos3])};
+        _MM_TRANSPOSE4_PS(val1, val2, val3, val4);
+
+        const __m128 mu{_mm_mul_ps(_mm_cvtepi32_ps(frac4), fracOne4)};
+        _mm_store_ps(dst_iter, cubic4(val1, val2, val3, val4, mu));
+        dst_iter += 4;
+
+        frac4 = _mm_add_epi32(frac4, increment4);
+        pos4 = _mm_add_epi32(pos4, _mm_srli_epi32(frac4, MixerFracBits));
+        frac4 = _mm_and_si128(frac4, fracMask4);
+    }
+
+    if(size_t todo{dst.size()&3})
+    {
+        src += static_cast<uint>(_mm_cvtsi128_si32(pos4));
+        frac = static_cast<uint>(_mm_cvtsi128_si32(frac4));
+
+        do {
+            *(dst_iter++) = cubic(src[0], src[1], src[2], src[3],
+                static_cast<float>(frac) * (1.0f/MixerFracOne));
+
+            frac += increment;
+            src  += frac>>MixerFracBits;
+            frac &= MixerFracMask;
+        } while(--todo);
+    }
+    return dst.data();
+}
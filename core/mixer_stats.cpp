@@ -0,0 +1,51 @@
+#include "config.h"
+
+#include "mixer_stats.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+
+void MixerStats::commit(Timer &timer) noexcept
+{
+    timer.mTimes[Total] = Timer::clock::now() - timer.mStart;
+
+    const size_t count{mCount.load(std::memory_order_relaxed)};
+    const size_t idx{count % HistorySize};
+    for(size_t stage{0};stage < StageCount;++stage)
+    {
+        /* The steady clock can't go backwards, so times aren't negative. */
+        const auto ns = static_cast<uint64_t>(timer.mTimes[stage].count());
+        mTimes[stage][idx].store(static_cast<uint32_t>(std::min<uint64_t>(ns,
+            std::numeric_limits<uint32_t>::max())), std::memory_order_relaxed);
+    }
+    mCount.store(count+1, std::memory_order_release);
+}
+
+MixerStats::Summary MixerStats::get(const Stage stage) const noexcept
+{
+    using std::chrono::nanoseconds;
+
+    const size_t count{std::min(mCount.load(std::memory_order_acquire), HistorySize)};
+    if(count == 0)
+        return Summary{nanoseconds{0}, nanoseconds{0}, nanoseconds{0}, nanoseconds{0}};
+
+    std::array<uint32_t,HistorySize> times;
+    std::transform(mTimes[stage].cbegin(), mTimes[stage].cbegin()+count, times.begin(),
+        [](const std::atomic<uint32_t> &t) noexcept -> uint32_t
+        { return t.load(std::memory_order_relaxed); });
+    const auto times_end = times.begin() + count;
+
+    const uint64_t total{std::accumulate(times.begin(), times_end, uint64_t{0})};
+    const auto minmax = std::minmax_element(times.begin(), times_end);
+    const nanoseconds mintime{*minmax.first}, maxtime{*minmax.second};
+
+    /* The 99th percentile is the smallest time that at least 99% of the
+     * renders were at or below.
+     */
+    const auto p99 = times.begin() + (count*99 + 99)/100 - 1;
+    std::nth_element(times.begin(), p99, times_end);
+
+    return Summary{mintime, nanoseconds{total / count}, maxtime, nanoseconds{*p99}};
+}
@@ -0,0 +1,80 @@
+#ifndef CORE_MIXER_STATS_H
+#define CORE_MIXER_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+
+using uint = unsigned int;
+
+
+/* Timing statistics for each stage of rendering a mix, kept over a rolling
+ * window of the most recent renders. The mixer only does a few clock reads
+ * and relaxed stores per render, so it's always enabled. Queries may run
+ * concurrently with the mixer; they may see a partially-recorded render, but
+ * not a torn value.
+ */
+class MixerStats {
+public:
+    enum Stage : uint {
+        ParamUpdates,
+        VoiceMix,
+        Effects,
+        PostProcess,
+        Limiter,
+        DistanceComp,
+        Dither,
+        Write,
+        /* The whole render, including the above stages. */
+        Total,
+
+        StageCount
+    };
+
+    /* The number of renders the statistics are taken over. */
+    static constexpr size_t HistorySize{256};
+
+    struct Summary {
+        std::chrono::nanoseconds Min, Avg, Max, P99;
+    };
+
+    /* Measures the time for consecutive stages of one render. */
+    class Timer {
+        using clock = std::chrono::steady_clock;
+
+        std::array<std::chrono::nanoseconds,StageCount> mTimes{};
+        clock::time_point mStart;
+        clock::time_point mMark;
+
+        friend MixerStats;
+
+    public:
+        Timer() : mStart{clock::now()}, mMark{mStart} { }
+
+        /* Adds the time since the last mark to the given stage. */
+        void mark(const Stage stage) noexcept
+        {
+            const auto now = clock::now();
+            mTimes[stage] += now - mMark;
+            mMark = now;
+        }
+        /* Restarts timing from now, for time that shouldn't go to any stage. */
+        void skip() noexcept { mMark = clock::now(); }
+    };
+
+private:
+    std::array<std::array<std::atomic<uint32_t>,HistorySize>,StageCount> mTimes{};
+    std::atomic<size_t> mCount{0u};
+
+public:
+    /* Records the times from a completed render. Only the mixer may call this. */
+    void commit(Timer &timer) noexcept;
+
+    /* Summarizes the recorded times for the given stage. */
+    Summary get(const Stage stage) const noexcept;
+};
+
+#endif /* CORE_MIXER_STATS_H */
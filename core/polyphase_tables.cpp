@@ -0,0 +1,242 @@
+#include "config.h"
+
+#include "polyphase_tables.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "albit.h"
+#include "aldeque.h"
+#include "bsinc_defs.h"
+#include "device.h"
+#include "logging.h"
+#include "threads.h"
+
+
+namespace {
+
+/* Each table can take up to MixerFracOne * 48 coefficients (768KB), so limit
+ * how many can be in use for the odd steps.
+ */
+constexpr size_t MaxPolyphaseTables{8};
+
+std::mutex PolyphaseTableLock;
+al::vector<std::unique_ptr<PolyphaseTable>> PolyphaseTables;
+
+
+/* Deletes the tables nothing holds anymore. The lock must be held. */
+void DeleteUnusedTables()
+{
+    auto is_unused = [](const std::unique_ptr<PolyphaseTable> &table) noexcept -> bool
+    {
+        if(table->mUseCount.load(std::memory_order_acquire) != 0)
+            return false;
+        TRACE("Deleting unused resampler table for step %u/%d\n", table->mIncrement,
+            MixerFracOne);
+        return true;
+    };
+    PolyphaseTables.erase(std::remove_if(PolyphaseTables.begin(), PolyphaseTables.end(),
+        is_unused), PolyphaseTables.end());
+}
+
+/* Fills in the table's filters. Only the table thread writes them, so this
+ * doesn't need the table lock.
+ */
+void BuildTable(PolyphaseTable &table)
+{
+    const Resampler resampler{table.mResampler};
+    const uint increment{table.mIncrement};
+
+    InterpState istate{};
+    PrepareResampler(resampler, increment, &istate);
+    const BsincState &bsinc = istate.bsinc;
+
+    /* Only BSinc12 and BSinc24 interpolate between filter scales, and only
+     * when downsampling. The others use the nearest scale.
+     */
+    const bool scaleInterp{increment > MixerFracOne
+        && (resampler == Resampler::BSinc12 || resampler == Resampler::BSinc24)};
+    const float sf{scaleInterp ? bsinc.sf : 0.0f};
+
+    constexpr uint FracPhaseBitDiff{MixerFracBits - BSincPhaseBits};
+    constexpr uint FracPhaseDiffOne{1 << FracPhaseBitDiff};
+
+    const uint shift{table.mPhaseShift};
+    const uint numphases{uint{MixerFracOne} >> shift};
+    const size_t m{bsinc.m};
+
+    table.mFilter.resize(numphases * m);
+
+    auto dst = table.mFilter.begin();
+    for(uint phase{0};phase < numphases;++phase)
+    {
+        /* Interpolate the filter the same way as the bsinc resampler. */
+        const uint frac{phase << shift};
+        const uint pi{frac >> FracPhaseBitDiff};
+        const float pf{static_cast<float>(frac & (FracPhaseDiffOne-1)) *
+            (1.0f/FracPhaseDiffOne)};
+
+        const float *fil{bsinc.filter + m*pi*2};
+        const float *phd{fil + m};
+        const float *scd{fil + BSincPhaseCount*2*m};
+        const float *spd{scd + m};
+        for(size_t j{0};j < m;++j)
+            *(dst++) = fil[j] + sf*scd[j] + pf*(phd[j] + sf*spd[j]);
+    }
+    table.mReady.store(true, std::memory_order_release);
+
+    TRACE("Created %u-phase resampler table for step %u/%d (%zu bytes)\n", numphases, increment,
+        MixerFracOne, table.mFilter.size()*sizeof(float));
+}
+
+
+/* Builds tables off the threads playing sources, shared by all devices. Each
+ * queued table is held until built, so it isn't deleted in the mean time.
+ */
+class PolyphaseBuilder {
+    std::condition_variable mCond;
+    al::deque<PolyphaseTable*> mJobs;
+    bool mQuitNow{false};
+    std::thread mThread;
+
+    void threadProc();
+
+public:
+    PolyphaseBuilder();
+    ~PolyphaseBuilder();
+
+    /* Queues the table to be built. Returns false if there's no thread to
+     * build it. The table lock must be held.
+     */
+    bool push(PolyphaseTable *table);
+
+    static PolyphaseBuilder &Get();
+};
+
+PolyphaseBuilder::PolyphaseBuilder()
+{
+    try {
+        mThread = std::thread{std::mem_fn(&PolyphaseBuilder::threadProc), this};
+    }
+    catch(std::exception& e) {
+        ERR("Failed to start %s thread: %s\n", POLYPHASE_THREAD_NAME, e.what());
+    }
+}
+
+PolyphaseBuilder::~PolyphaseBuilder()
+{
+    {
+        std::lock_guard<std::mutex> _{PolyphaseTableLock};
+        mQuitNow = true;
+    }
+    mCond.notify_all();
+    if(mThread.joinable())
+        mThread.join();
+}
+
+bool PolyphaseBuilder::push(PolyphaseTable *table)
+{
+    if UNLIKELY(!mThread.joinable())
+        return false;
+
+    table->mUseCount.fetch_add(1u, std::memory_order_relaxed);
+    mJobs.emplace_back(table);
+    mCond.notify_one();
+    return true;
+}
+
+void PolyphaseBuilder::threadProc()
+{
+    althrd_setname(POLYPHASE_THREAD_NAME);
+
+    std::unique_lock<std::mutex> lock{PolyphaseTableLock};
+    while(true)
+    {
+        mCond.wait(lock, [this]() noexcept { return mQuitNow || !mJobs.empty(); });
+        if(mQuitNow) break;
+
+        PolyphaseTable *table{mJobs.front()};
+        mJobs.pop_front();
+
+        /* Skip building a table no voice holds anymore. */
+        if(table->mUseCount.load(std::memory_order_acquire) > 1)
+        {
+            lock.unlock();
+            BuildTable(*table);
+            lock.lock();
+        }
+        ReleasePolyphaseTable(table);
+    }
+}
+
+PolyphaseBuilder &PolyphaseBuilder::Get()
+{
+    static PolyphaseBuilder builder{};
+    return builder;
+}
+
+} // namespace
+
+
+const PolyphaseTable *GetPolyphaseTable(const Resampler resampler, const uint increment)
+{
+    switch(resampler)
+    {
+    case Resampler::Point:
+    case Resampler::Linear:
+    case Resampler::Cubic:
+        return nullptr;
+    case Resampler::FastBSinc12:
+    case Resampler::BSinc12:
+    case Resampler::FastBSinc24:
+    case Resampler::BSinc24:
+        break;
+    }
+    if(increment == MixerFracOne || increment > (MaxPitch<<MixerFracBits))
+        return nullptr;
+
+    std::lock_guard<std::mutex> _{PolyphaseTableLock};
+    auto matches = [resampler,increment](const std::unique_ptr<PolyphaseTable> &table) noexcept
+    { return table->mResampler == resampler && table->mIncrement == increment; };
+    auto iter = std::find_if(PolyphaseTables.begin(), PolyphaseTables.end(), matches);
+    if(iter != PolyphaseTables.end())
+    {
+        (*iter)->mUseCount.fetch_add(1u, std::memory_order_relaxed);
+        return iter->get();
+    }
+
+    DeleteUnusedTables();
+    if(PolyphaseTables.size() >= MaxPolyphaseTables)
+        return nullptr;
+
+    /* Everything but the filters is set now. Building those can take a while,
+     * so it's left to the table thread.
+     */
+    InterpState istate{};
+    PrepareResampler(resampler, increment, &istate);
+
+    std::unique_ptr<PolyphaseTable> table{new PolyphaseTable{}};
+    table->mResampler = resampler;
+    table->mIncrement = increment;
+    table->mFilterLength = istate.bsinc.m;
+    table->mPhaseShift = static_cast<uint>(std::min(al::countr_zero(increment), MixerFracBits));
+    table->mUseCount.store(1u, std::memory_order_relaxed);
+    if(!PolyphaseBuilder::Get().push(table.get()))
+        return nullptr;
+
+    PolyphaseTables.emplace_back(std::move(table));
+    return PolyphaseTables.back().get();
+}
+
+void ReleasePolyphaseTable(const PolyphaseTable *table)
+{
+    /* The mixer releases tables of voices that stopped, so this can't take
+     * the lock. The table is deleted the next time room is needed for one.
+     */
+    table->mUseCount.fetch_sub(1u, std::memory_order_acq_rel);
+}
@@ -0,0 +1,58 @@
+#ifndef CORE_POLYPHASE_TABLES_H
+#define CORE_POLYPHASE_TABLES_H
+
+#include <atomic>
+
+#include "almalloc.h"
+#include "mixer/defs.h"
+#include "vector.h"
+
+using uint = unsigned int;
+
+
+/* The bsinc filters for one fixed step through the source samples, with a
+ * filter for each fractional position the step lands on. A step of p/q
+ * (MixerFracOne = q) only lands on q/gcd(p,q) distinct positions, each of
+ * which gets the bsinc filter interpolated for it ahead of time. Applying
+ * them takes one multiply-add per coefficient, compared to the two or four
+ * needed to interpolate the bsinc filters for each sample.
+ */
+struct PolyphaseTable {
+    Resampler mResampler;
+    uint mIncrement;
+
+    uint mFilterLength;
+    /* Fractional positions starting on a multiple of 1<<mPhaseShift only
+     * land on such multiples, so shifting them down gives the phase index.
+     * Other positions aren't covered by the table.
+     */
+    uint mPhaseShift;
+    al::vector<float,16> mFilter;
+    /* Set once the filters are built, on the table thread. */
+    std::atomic<bool> mReady{false};
+
+    /* The number of voices holding the table, and the table thread while it's
+     * queued to be built. Only raised with the table lock held.
+     */
+    mutable std::atomic<uint> mUseCount{0u};
+
+    DEF_NEWDEL(PolyphaseTable)
+};
+
+/**
+ * Returns the table for the given bsinc resampler and step, queueing it to be
+ * built if needed, and holds it for the caller. The table can't be used until
+ * it's ready, so the bsinc filters should be used until then. Returns null if
+ * the resampler doesn't use bsinc filters, the step doesn't need resampling,
+ * or too many tables are in use.
+ */
+const PolyphaseTable *GetPolyphaseTable(const Resampler resampler, const uint increment);
+
+/**
+ * Releases a table held by GetPolyphaseTable. Once nothing holds it, it's
+ * deleted when GetPolyphaseTable next needs room. The mixer must be done with
+ * it, but it may be called from the mixer.
+ */
+void ReleasePolyphaseTable(const PolyphaseTable *table);
+
+#endif /* CORE_POLYPHASE_TABLES_H */
@@ -0,0 +1,295 @@
+#include "config.h"
+
+#include "resample_cache.h"
+
+#include <algorithm>
+#include <array>
+#include <exception>
+#include <functional>
+#include <limits>
+
+#include "alnumeric.h"
+#include "bufferline.h"
+#include "device.h"
+#include "fmt_traits.h"
+#include "logging.h"
+#include "threads.h"
+
+
+namespace {
+
+/* How far the device's mix count needs to get past the count taken when a
+ * copy is first found unused, before a voice stopped while playing it is done
+ * reading it. As with a callback stream's retired rings, the stop was sent
+ * before the copy was let go, and the voice fades out during the mix after.
+ */
+constexpr uint RetiredCopyMixes{3u};
+
+/* Converts one channel of the interleaved samples to float. */
+void LoadChannel(float *RESTRICT dst, const al::byte *src, const FmtType type,
+    const size_t channel, const size_t numchans, const size_t samples)
+{
+#define HANDLE_FMT(T) case T:                                                     \
+    al::LoadSampleArray<T>(dst, src + channel*sizeof(al::FmtTypeTraits<T>::Type), \
+        numchans, samples);                                                       \
+    break
+
+    switch(type)
+    {
+    HANDLE_FMT(FmtUByte);
+    HANDLE_FMT(FmtShort);
+    HANDLE_FMT(FmtFloat);
+    HANDLE_FMT(FmtDouble);
+    HANDLE_FMT(FmtMulaw);
+    HANDLE_FMT(FmtAlaw);
+    HANDLE_FMT(FmtHalf);
+    case FmtIMA4:
+    case FmtMSADPCM:
+        break;
+    }
+#undef HANDLE_FMT
+}
+
+/* Returns the number of samples a voice with the given step produces before
+ * passing the given source sample.
+ */
+uint ScaleSampleCount(const uint count, const uint increment)
+{
+    const uint64_t scaled{((uint64_t{count}<<MixerFracBits) + increment-1) / increment};
+    return static_cast<uint>(minu64(scaled, std::numeric_limits<uint>::max()));
+}
+
+} // namespace
+
+
+ResampleCache::ResampleCache(const DeviceBase &device, size_t maxsize)
+    : mDevice{device}, mMaxSize{maxsize}
+{
+    try {
+        mThread = std::thread{std::mem_fn(&ResampleCache::threadProc), this};
+    }
+    catch(std::exception& e) {
+        ERR("Failed to start %s thread: %s\n", RESAMPLE_THREAD_NAME, e.what());
+    }
+}
+
+ResampleCache::~ResampleCache()
+{
+    {
+        std::lock_guard<std::mutex> _{mLock};
+        mQuitNow = true;
+    }
+    mJobCond.notify_all();
+    if(mThread.joinable())
+        mThread.join();
+}
+
+void ResampleCache::threadProc()
+{
+    althrd_setname(RESAMPLE_THREAD_NAME);
+
+    std::unique_lock<std::mutex> lock{mLock};
+    while(true)
+    {
+        mJobCond.wait(lock, [this]() noexcept { return mQuitNow || !mJobs.empty(); });
+        if(mQuitNow) break;
+
+        Job job{std::move(mJobs.front())};
+        mJobs.pop_front();
+
+        /* A copy invalidated while waiting can't read its samples anymore. */
+        if(job.mEntry->mStale.load(std::memory_order_relaxed))
+            continue;
+
+        mBuilding = job.mEntry.get();
+        lock.unlock();
+
+        build(job);
+
+        lock.lock();
+        mBuilding = nullptr;
+        mBuiltCond.notify_all();
+    }
+}
+
+void ResampleCache::build(Job &job)
+{
+    ResampledBuffer *entry{job.mEntry.get()};
+    const size_t numchans{job.mNumChannels};
+    const uint increment{job.mIncrement};
+    const uint srclen{job.mSampleLen};
+    const uint dstlen{ScaleSampleCount(srclen, increment)};
+
+    entry->mData.resize(size_t{dstlen} * numchans);
+
+    /* Each channel is padded at the start with silence, and at the end with
+     * the last sample, like a voice reading past either end.
+     */
+    al::vector<float,16> srcline(srclen + MaxResamplerPadding);
+    alignas(16) std::array<float,BufferLineSize> dstline;
+
+    InterpState state{};
+    const ResamplerFunc Resample{PrepareResampler(entry->mResampler, increment, &state)};
+    for(size_t c{0};c < numchans;++c)
+    {
+        float *RESTRICT src{srcline.data() + MaxResamplerEdge};
+        LoadChannel(src, job.mSamples, job.mType, c, numchans, srclen);
+        std::fill_n(src+srclen, MaxResamplerEdge, src[srclen-1]);
+
+        for(uint pos{0};pos < dstlen;)
+        {
+            /* Stop early if the buffer changed, since the copy won't be used
+             * and invalidating waits for it.
+             */
+            if(entry->mStale.load(std::memory_order_relaxed))
+                return;
+
+            const uint todo{minu(dstlen-pos, BufferLineSize)};
+            const uint64_t srcpos{uint64_t{pos} * increment};
+            const float *resampled{Resample(&state, src + (srcpos>>MixerFracBits),
+                static_cast<uint>(srcpos&MixerFracMask), increment, {dstline.data(), todo})};
+
+            float *dst{entry->mData.data() + size_t{pos}*numchans + c};
+            for(uint i{0};i < todo;++i)
+                dst[i*numchans] = resampled[i];
+            pos += todo;
+        }
+    }
+
+    entry->mItem.mSampleLen = dstlen;
+    entry->mItem.mLoopStart = minu(ScaleSampleCount(job.mLoopStart, increment), dstlen-1);
+    entry->mItem.mLoopEnd = maxu(ScaleSampleCount(job.mLoopEnd, increment),
+        entry->mItem.mLoopStart+1);
+    entry->mItem.mSamples = reinterpret_cast<al::byte*>(entry->mData.data());
+    entry->mReady.store(true, std::memory_order_release);
+
+    TRACE("Resampled buffer %p to %uhz (%zu bytes)\n", entry->mOwner, entry->mSampleRate,
+        entry->byteSize());
+}
+
+bool ResampleCache::isRetired(ResampledBuffer &entry, const uint mixcount)
+{
+    if(ReadRef(entry.mRef) > 1)
+    {
+        entry.mUnused = false;
+        return false;
+    }
+    if(!entry.mUnused)
+    {
+        entry.mUnused = true;
+        entry.mUnusedMix = mixcount;
+    }
+    return mixcount-entry.mUnusedMix >= RetiredCopyMixes;
+}
+
+bool ResampleCache::makeRoom(const size_t size)
+{
+    if(size > mMaxSize)
+        return false;
+
+    /* Check every entry, so ones that were just let go start retiring even if
+     * there's already room.
+     */
+    const uint mixcount{mDevice.MixCount.load(std::memory_order_acquire)};
+    for(ResampledBufferPtr &entry : mEntries)
+        isRetired(*entry, mixcount);
+
+    while(mSize + size > mMaxSize)
+    {
+        /* Stale entries won't be used again, so drop them first. */
+        auto unused_lru = mEntries.end();
+        for(auto iter = mEntries.begin();iter != mEntries.end();++iter)
+        {
+            if(!isRetired(**iter, mixcount))
+                continue;
+            if((*iter)->mStale.load(std::memory_order_relaxed))
+            {
+                unused_lru = iter;
+                break;
+            }
+            if(unused_lru == mEntries.end() || (*iter)->mLastUse < (*unused_lru)->mLastUse)
+                unused_lru = iter;
+        }
+        if(unused_lru == mEntries.end())
+            return false;
+
+        mSize -= (*unused_lru)->byteSize();
+        mEntries.erase(unused_lru);
+    }
+    return true;
+}
+
+ResampledBufferPtr ResampleCache::get(const void *owner, const BufferStorage &storage,
+    const VoiceBufferItem &item, const uint devrate, const Resampler resampler)
+{
+    if(storage.mCallback || storage.isAdpcm() || storage.mSampleRate == devrate
+        || item.mSampleLen == 0 || !mThread.joinable())
+        return nullptr;
+
+    /* Step through the buffer exactly as a voice would at unity pitch, so the
+     * copy matches what would otherwise be resampled as it plays.
+     */
+    const float pitch{static_cast<float>(storage.mSampleRate) / static_cast<float>(devrate)};
+    const uint increment{PitchToStep(pitch)};
+
+    const uint numchans{storage.channelsFromFmt()};
+    const uint dstlen{ScaleSampleCount(item.mSampleLen, increment)};
+
+    std::unique_lock<std::mutex> lock{mLock};
+
+    auto matches = [owner,devrate,resampler](const ResampledBufferPtr &entry) noexcept -> bool
+    {
+        return entry->mOwner == owner && entry->mSampleRate == devrate
+            && entry->mResampler == resampler && !entry->mStale.load(std::memory_order_relaxed);
+    };
+    auto iter = std::find_if(mEntries.begin(), mEntries.end(), matches);
+    if(iter != mEntries.end())
+    {
+        (*iter)->mLastUse = ++mUseCount;
+        (*iter)->mUnused = false;
+        return *iter;
+    }
+
+    const size_t size{size_t{dstlen} * numchans * sizeof(float)};
+    if(!makeRoom(size))
+        return nullptr;
+
+    ResampledBufferPtr entry{new ResampledBuffer{owner, devrate, resampler, size}};
+    entry->mLastUse = ++mUseCount;
+    mSize += size;
+    mEntries.emplace_back(entry);
+
+    mJobs.emplace_back(Job{entry, item.mSamples, storage.mType, numchans, increment,
+        item.mSampleLen, item.mLoopStart, item.mLoopEnd});
+    lock.unlock();
+    mJobCond.notify_one();
+
+    return entry;
+}
+
+void ResampleCache::invalidate(const void *owner)
+{
+    std::unique_lock<std::mutex> lock{mLock};
+
+    /* Copies still in use keep counting toward the size, until they retire
+     * and get dropped to make room.
+     */
+    const uint mixcount{mDevice.MixCount.load(std::memory_order_acquire)};
+    auto is_owned = [this,owner,mixcount](ResampledBufferPtr &entry) noexcept -> bool
+    {
+        if(entry->mOwner != owner)
+            return false;
+        entry->mStale.store(true, std::memory_order_relaxed);
+        if(!isRetired(*entry, mixcount))
+            return false;
+        mSize -= entry->byteSize();
+        return true;
+    };
+    mEntries.erase(std::remove_if(mEntries.begin(), mEntries.end(), is_owned), mEntries.end());
+
+    /* A copy being built is marked stale now, so it stops soon. Queued ones
+     * are skipped without reading the samples.
+     */
+    mBuiltCond.wait(lock, [this,owner]() noexcept
+    { return !mBuilding || mBuilding->mOwner != owner; });
+}
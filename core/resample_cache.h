@@ -0,0 +1,159 @@
+#ifndef CORE_RESAMPLE_CACHE_H
+#define CORE_RESAMPLE_CACHE_H
+
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "aldeque.h"
+#include "almalloc.h"
+#include "atomic.h"
+#include "buffer_storage.h"
+#include "intrusive_ptr.h"
+#include "mixer/defs.h"
+#include "vector.h"
+#include "voice.h"
+
+struct DeviceBase;
+
+using uint = unsigned int;
+
+
+/* A copy of a buffer's samples, resampled to the device rate and converted to
+ * float. A voice playing it at unity pitch steps through it one sample at a
+ * time, so the mixer only needs to copy the samples. The copy is built on the
+ * cache's thread, and can't be played until it's ready.
+ */
+struct ResampledBuffer {
+    RefCount mRef{1u};
+
+    /* The buffer the samples were resampled from, and the device rate and
+     * resampler used.
+     */
+    const void *const mOwner;
+    const uint mSampleRate;
+    const Resampler mResampler;
+    /* Set when the buffer changes, so a copy still in use isn't played again. */
+    std::atomic<bool> mStale{false};
+    /* Set once the samples and loop points are filled in. */
+    std::atomic<bool> mReady{false};
+    /* The size the samples take, counted from when the copy is requested. */
+    const size_t mByteSize;
+
+    /* The resampled samples and loop points, for the voice to play. */
+    VoiceBufferItem mItem;
+    al::vector<float,16> mData;
+
+    uint64_t mLastUse{0u};
+    /* Set with the device's mix count when the cache first finds nothing else
+     * holding the copy, since a voice may still be fading out on it.
+     */
+    bool mUnused{false};
+    uint mUnusedMix{0u};
+
+    ResampledBuffer(const void *owner, uint samplerate, Resampler resampler, size_t bytesize)
+        : mOwner{owner}, mSampleRate{samplerate}, mResampler{resampler}, mByteSize{bytesize}
+    { }
+    ResampledBuffer(const ResampledBuffer&) = delete;
+    ResampledBuffer& operator=(const ResampledBuffer&) = delete;
+
+    void add_ref() noexcept { IncrementRef(mRef); }
+    void release() noexcept
+    {
+        if(DecrementRef(mRef) == 0)
+            delete this;
+    }
+
+    size_t byteSize() const noexcept { return mByteSize; }
+
+    DEF_NEWDEL(ResampledBuffer)
+};
+using ResampledBufferPtr = al::intrusive_ptr<ResampledBuffer>;
+
+
+/* Holds resampled copies of a device's buffers, keyed by the buffer, device
+ * rate, and resampler. Once the cache is full, the least recently used copies
+ * no longer in use are dropped to make room for new ones. A copy is only freed
+ * once the mixer is past any voice still fading out on it. Copies are built on
+ * a thread of the cache's own, one at a time.
+ */
+class ResampleCache {
+    /* What's needed to build a copy, taken from the buffer when requested.
+     * The samples stay valid until the copy is invalidated.
+     */
+    struct Job {
+        ResampledBufferPtr mEntry;
+        const al::byte *mSamples;
+        FmtType mType;
+        uint mNumChannels;
+        uint mIncrement;
+        uint mSampleLen;
+        uint mLoopStart;
+        uint mLoopEnd;
+    };
+
+    const DeviceBase &mDevice;
+
+    std::mutex mLock;
+    /* Each entry holds a reference, so copies still in use, or being built,
+     * have more than one.
+     */
+    al::vector<ResampledBufferPtr> mEntries;
+    const size_t mMaxSize;
+    size_t mSize{0u};
+    uint64_t mUseCount{0u};
+
+    al::deque<Job> mJobs;
+    /* The copy the thread is building, if any, and signaled when it's done. */
+    const ResampledBuffer *mBuilding{nullptr};
+    std::condition_variable mJobCond;
+    std::condition_variable mBuiltCond;
+    bool mQuitNow{false};
+    std::thread mThread;
+
+    void threadProc();
+    static void build(Job &job);
+
+    /* Returns true if nothing but the cache holds the entry, and the mixer is
+     * done with it. The lock must be held.
+     */
+    bool isRetired(ResampledBuffer &entry, const uint mixcount);
+
+    /* Drops retired entries, least recently used first, until the given size
+     * fits. Returns false if there isn't enough retired space to drop. The
+     * lock must be held.
+     */
+    bool makeRoom(const size_t size);
+
+public:
+    ResampleCache(const DeviceBase &device, size_t maxsize);
+    ResampleCache(const ResampleCache&) = delete;
+    ~ResampleCache();
+    ResampleCache& operator=(const ResampleCache&) = delete;
+
+    /**
+     * Returns a copy of the buffer item's samples resampled to the device
+     * rate, queueing it to be built if it isn't already cached. The owner is
+     * the buffer the storage and item describe. Returns null if the buffer
+     * can't be resampled or there's no room for it. The copy can't be played
+     * until it's ready, so the caller should resample as it plays until then.
+     */
+    ResampledBufferPtr get(const void *owner, const BufferStorage &storage,
+        const VoiceBufferItem &item, const uint devrate, const Resampler resampler);
+
+    /**
+     * Drops the cached copies of the given buffer, for when its samples or
+     * loop points change. Copies still in use, or that were until recently,
+     * stay alive and count toward the cache size until retired. Waits if one
+     * is being built, so it must be called before the buffer's samples are
+     * freed or replaced.
+     */
+    void invalidate(const void *owner);
+
+    DEF_NEWDEL(ResampleCache)
+};
+
+#endif /* CORE_RESAMPLE_CACHE_H */
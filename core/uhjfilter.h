@@ -65,6 +65,9 @@ struct DecoderBase {
     virtual void decode(const al::span<float*> samples, const size_t samplesToDo,
         const size_t forwardSamples) = 0;
 
+    /** Clears the filter history, as if nothing was decoded yet. */
+    virtual void clear() noexcept = 0;
+
     /**
      * The width factor for Super Stereo processing. Can be changed in between
      * calls to decode, with valid values being between 0...0.7.
@@ -100,6 +103,12 @@ struct UhjDecoder final : public DecoderBase {
     void decode(const al::span<float*> samples, const size_t samplesToDo,
         const size_t forwardSamples) override;
 
+    void clear() noexcept override
+    {
+        mDTHistory.fill(0.0f);
+        mSHistory.fill(0.0f);
+    }
+
     DEF_NEWDEL(UhjDecoder)
 };
 
@@ -126,6 +135,12 @@ struct UhjStereoDecoder final : public DecoderBase {
     void decode(const al::span<float*> samples, const size_t samplesToDo,
         const size_t forwardSamples) override;
 
+    void clear() noexcept override
+    {
+        mDTHistory.fill(0.0f);
+        mSHistory.fill(0.0f);
+    }
+
     DEF_NEWDEL(UhjStereoDecoder)
 };
 
@@ -9,6 +9,7 @@
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <new>
 #include <stdlib.h>
@@ -23,6 +24,7 @@
 #include "ambidefs.h"
 #include "async_event.h"
 #include "buffer_storage.h"
+#include "callback_stream.h"
 #include "context.h"
 #include "cpu_caps.h"
 #include "devformat.h"
@@ -36,6 +38,7 @@
 #include "mixer/defs.h"
 #include "mixer/hrtfdefs.h"
 #include "opthelpers.h"
+#include "polyphase_tables.h"
 #include "resampler_limits.h"
 #include "ringbuffer.h"
 #include "vector.h"
@@ -45,14 +48,22 @@ struct CTag;
 #ifdef HAVE_SSE
 struct SSETag;
 #endif
+#ifdef HAVE_SSE2
+struct SSE2Tag;
+#endif
+#ifdef HAVE_AVX2
+struct AVX2Tag;
+#endif
 #ifdef HAVE_NEON
 struct NEONTag;
 #endif
 struct CopyTag;
 
 
-static_assert(!(sizeof(DeviceBase::MixerBufferLine)&15),
-    "DeviceBase::MixerBufferLine must be a multiple of 16 bytes");
+static_assert(MixerScratch::MixerFilterLinesMax >= MixerScratch::MixerChannelGroupSize*(1+MAX_SENDS),
+    "MixerScratch::MixerFilterLinesMax is too small for the dry and send paths");
+static_assert(!(sizeof(MixerScratch::MixerBufferLine)&15),
+    "MixerScratch::MixerBufferLine must be a multiple of 16 bytes");
 static_assert(!(MaxResamplerEdge&3), "MaxResamplerEdge is not a multiple of 4");
 
 Resampler ResamplerDefault{Resampler::Linear};
@@ -67,8 +78,28 @@ using HrtfMixerBlendFunc = void(*)(const float *InSamples, float2 *AccumSamples,
     const uint IrSize, const HrtfFilter *oldparams, const MixHrtfFilter *newparams,
     const size_t BufferSize);
 
+using LoadHalfFunc = void(*)(float *RESTRICT dst, const uint16_t *src, const size_t srcstep,
+    const size_t samples);
+using LoadInterleavedFunc = void(*)(const al::span<float*> dst, const size_t dstOffset,
+    const al::byte *src, const size_t frames);
+
 HrtfMixerFunc MixHrtfSamples{MixHrtf_<CTag>};
 HrtfMixerBlendFunc MixHrtfBlendSamples{MixHrtfBlend_<CTag>};
+LoadHalfFunc LoadHalfSamples{LoadHalf_<CTag>};
+
+/* Loaders for whole interleaved frames, for the sample types that have them. */
+template<FmtType Type>
+LoadInterleavedFunc LoadInterleavedSamples{nullptr};
+template<>
+LoadInterleavedFunc LoadInterleavedSamples<FmtUByte>{LoadInterleaved_<UByteTag,CTag>};
+template<>
+LoadInterleavedFunc LoadInterleavedSamples<FmtShort>{LoadInterleaved_<ShortTag,CTag>};
+template<>
+LoadInterleavedFunc LoadInterleavedSamples<FmtFloat>{LoadInterleaved_<FloatTag,CTag>};
+template<>
+LoadInterleavedFunc LoadInterleavedSamples<FmtMulaw>{LoadInterleaved_<MulawTag,CTag>};
+template<>
+LoadInterleavedFunc LoadInterleavedSamples<FmtAlaw>{LoadInterleaved_<AlawTag,CTag>};
 
 inline MixerFunc SelectMixer()
 {
@@ -76,6 +107,10 @@ inline MixerFunc SelectMixer()
     if((CPUCapFlags&CPU_CAP_NEON))
         return Mix_<NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&CPU_CAP_AVX2))
+        return Mix_<AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
     if((CPUCapFlags&CPU_CAP_SSE))
         return Mix_<SSETag>;
@@ -89,6 +124,10 @@ inline HrtfMixerFunc SelectHrtfMixer()
     if((CPUCapFlags&CPU_CAP_NEON))
         return MixHrtf_<NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&CPU_CAP_AVX2))
+        return MixHrtf_<AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
     if((CPUCapFlags&CPU_CAP_SSE))
         return MixHrtf_<SSETag>;
@@ -102,6 +141,10 @@ inline HrtfMixerBlendFunc SelectHrtfBlendMixer()
     if((CPUCapFlags&CPU_CAP_NEON))
         return MixHrtfBlend_<NEONTag>;
 #endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&CPU_CAP_AVX2))
+        return MixHrtfBlend_<AVX2Tag>;
+#endif
 #ifdef HAVE_SSE
     if((CPUCapFlags&CPU_CAP_SSE))
         return MixHrtfBlend_<SSETag>;
@@ -109,6 +152,37 @@ inline HrtfMixerBlendFunc SelectHrtfBlendMixer()
     return MixHrtfBlend_<CTag>;
 }
 
+inline LoadHalfFunc SelectLoadHalf()
+{
+#ifdef HAVE_NEON
+    if((CPUCapFlags&CPU_CAP_NEON))
+        return LoadHalf_<NEONTag>;
+#endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&CPU_CAP_AVX2))
+        return LoadHalf_<AVX2Tag>;
+#endif
+    return LoadHalf_<CTag>;
+}
+
+template<typename TypeTag>
+inline LoadInterleavedFunc SelectLoadInterleaved()
+{
+#ifdef HAVE_NEON
+    if((CPUCapFlags&CPU_CAP_NEON))
+        return LoadInterleaved_<TypeTag,NEONTag>;
+#endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&CPU_CAP_AVX2))
+        return LoadInterleaved_<TypeTag,AVX2Tag>;
+#endif
+#ifdef HAVE_SSE2
+    if((CPUCapFlags&CPU_CAP_SSE2))
+        return LoadInterleaved_<TypeTag,SSE2Tag>;
+#endif
+    return LoadInterleaved_<TypeTag,CTag>;
+}
+
 } // namespace
 
 void Voice::InitMixer(al::optional<std::string> resampler)
@@ -154,6 +228,12 @@ void Voice::InitMixer(al::optional<std::string> resampler)
     MixSamples = SelectMixer();
     MixHrtfBlendSamples = SelectHrtfBlendMixer();
     MixHrtfSamples = SelectHrtfMixer();
+    LoadHalfSamples = SelectLoadHalf();
+    LoadInterleavedSamples<FmtUByte> = SelectLoadInterleaved<UByteTag>();
+    LoadInterleavedSamples<FmtShort> = SelectLoadInterleaved<ShortTag>();
+    LoadInterleavedSamples<FmtFloat> = SelectLoadInterleaved<FloatTag>();
+    LoadInterleavedSamples<FmtMulaw> = SelectLoadInterleaved<MulawTag>();
+    LoadInterleavedSamples<FmtAlaw> = SelectLoadInterleaved<AlawTag>();
 }
 
 
@@ -174,33 +254,90 @@ void SendSourceStoppedEvent(ContextBase *context, uint id)
 }
 
 
-const float *DoFilters(BiquadFilter &lpfilter, BiquadFilter &hpfilter, float *dst,
-    const al::span<const float> src, int type)
-{
-    switch(type)
+/* Collects the filters to apply to a group of resampled voice channels. Single
+ * biquads (low-pass or high-pass) are run two at a time, since each filter's
+ * output depends on its previous output and two independent filters can
+ * overlap their calculations.
+ */
+class FilterBatch {
+    struct FilterJob {
+        BiquadFilter *mFilter;
+        const float *mSrc;
+        float *mDst;
+    };
+    std::array<FilterJob,MixerScratch::MixerFilterLinesMax> mJobs;
+    size_t mNumJobs{0u};
+
+    const al::span<FloatBufferLine,MixerScratch::MixerFilterLinesMax> mLines;
+    size_t mNumLines{0u};
+
+public:
+    FilterBatch(MixerScratch &scratch) : mLines{scratch.FilteredData} { }
+
+    /**
+     * Adds a filter path for the given samples, returning where the filtered
+     * output will be after process() is called.
+     */
+    const float *add(BiquadFilter &lpfilter, BiquadFilter &hpfilter,
+        const al::span<const float> src, int type)
     {
-    case AF_None:
-        lpfilter.clear();
-        hpfilter.clear();
-        break;
+        switch(type)
+        {
+        case AF_None:
+            lpfilter.clear();
+            hpfilter.clear();
+            break;
 
-    case AF_LowPass:
-        lpfilter.process(src, dst);
-        hpfilter.clear();
-        return dst;
-    case AF_HighPass:
-        lpfilter.clear();
-        hpfilter.process(src, dst);
-        return dst;
+        case AF_LowPass:
+            hpfilter.clear();
+            return queue(lpfilter, src.data());
+        case AF_HighPass:
+            lpfilter.clear();
+            return queue(hpfilter, src.data());
+
+        case AF_BandPass:
+            float *dst{mLines[mNumLines++].data()};
+            DualBiquad{lpfilter, hpfilter}.process(src, dst);
+            return dst;
+        }
+        return src.data();
+    }
+
+    /** Runs the queued filters over the given number of samples. */
+    void process(const size_t todo)
+    {
+        size_t i{0u};
+        for(;mNumJobs-i >= 2;i += 2)
+        {
+            FilterJob &job0 = mJobs[i];
+            FilterJob &job1 = mJobs[i+1];
+            job0.mFilter->parallelProcess(*job1.mFilter, {job0.mSrc, todo}, job0.mDst,
+                job1.mSrc, job1.mDst);
+        }
+        if(i < mNumJobs)
+            mJobs[i].mFilter->process({mJobs[i].mSrc, todo}, mJobs[i].mDst);
+    }
 
-    case AF_BandPass:
-        DualBiquad{lpfilter, hpfilter}.process(src, dst);
+private:
+    float *queue(BiquadFilter &filter, const float *src)
+    {
+        float *dst{mLines[mNumLines++].data()};
+        mJobs[mNumJobs++] = FilterJob{&filter, src, dst};
         return dst;
     }
-    return src.data();
-}
+};
 
 
+template<FmtType Type>
+inline void LoadSampleArray(float *RESTRICT dst, const al::byte *src, const size_t srcstep,
+    const size_t samples) noexcept
+{ al::LoadSampleArray<Type>(dst, src, srcstep, samples); }
+
+template<>
+inline void LoadSampleArray<FmtHalf>(float *RESTRICT dst, const al::byte *src,
+    const size_t srcstep, const size_t samples) noexcept
+{ LoadHalfSamples(dst, reinterpret_cast<const uint16_t*>(src), srcstep, samples); }
+
 template<FmtType Type>
 inline void LoadSamples(const al::span<float*> dstSamples, const size_t dstOffset,
     const al::byte *src, const size_t srcOffset, const FmtChannels srcChans, const size_t srcStep,
@@ -208,17 +345,30 @@ inline void LoadSamples(const al::span<float*> dstSamples, const size_t dstOffse
 {
     constexpr size_t sampleSize{sizeof(typename al::FmtTypeTraits<Type>::Type)};
     auto s = src + srcOffset*srcStep*sampleSize;
+
+    /* Whole frames of mono or an even number of channels can be converted
+     * and de-interleaved together. Ambisonic buffers may have more channels
+     * than get mixed, which need to be loaded separately.
+     */
+    const LoadInterleavedFunc loadFrames{LoadInterleavedSamples<Type>};
     if(srcChans == FmtUHJ2 || srcChans == FmtSuperStereo)
     {
-        al::LoadSampleArray<Type>(dstSamples[0]+dstOffset, s, srcStep, samples);
-        al::LoadSampleArray<Type>(dstSamples[1]+dstOffset, s+sampleSize, srcStep, samples);
+        if(loadFrames)
+            loadFrames(dstSamples.first(2), dstOffset, s, samples);
+        else
+        {
+            LoadSampleArray<Type>(dstSamples[0]+dstOffset, s, srcStep, samples);
+            LoadSampleArray<Type>(dstSamples[1]+dstOffset, s+sampleSize, srcStep, samples);
+        }
         std::fill_n(dstSamples[2]+dstOffset, samples, 0.0f);
     }
+    else if(loadFrames && dstSamples.size() == srcStep && (srcStep == 1 || !(srcStep&1)))
+        loadFrames(dstSamples, dstOffset, s, samples);
     else
     {
         for(auto *dst : dstSamples)
         {
-            al::LoadSampleArray<Type>(dst+dstOffset, s, srcStep, samples);
+            LoadSampleArray<Type>(dst+dstOffset, s, srcStep, samples);
             s += sampleSize;
         }
     }
@@ -241,13 +391,72 @@ void LoadSamples(const al::span<float*> dstSamples, const size_t dstOffset, cons
     HANDLE_FMT(FmtDouble);
     HANDLE_FMT(FmtMulaw);
     HANDLE_FMT(FmtAlaw);
+    HANDLE_FMT(FmtHalf);
+    /* ADPCM needs decoder state, and is handled by LoadBufferSamples. */
+    case FmtIMA4:
+    case FmtMSADPCM:
+        break;
     }
 #undef HANDLE_FMT
 }
 
+/* Tracks ADPCM decoding through a mix. The decoder state at the sample the
+ * next mix starts loading from is saved back to the voice, so the next mix
+ * can continue from there.
+ */
+struct AdpcmContext {
+    Voice::AdpcmStateArray &mSaved;
+    Voice::AdpcmStateArray mState;
+    size_t mSaveOffset;
+
+    AdpcmContext(Voice::AdpcmStateArray &saved, const size_t saveOffset)
+      : mSaved{saved}, mState{saved}, mSaveOffset{saveOffset}
+    { }
+};
+
+void LoadBufferSamples(const al::span<float*> dstSamples, size_t dstOffset,
+    const VoiceBufferItem *buffer, size_t srcOffset, const FmtType srcType,
+    const FmtChannels srcChans, const size_t srcStep, const size_t samples, AdpcmContext &adpcm)
+{
+    if(!IsAdpcm(srcType))
+    {
+        LoadSamples(dstSamples, dstOffset, buffer->mSamples, srcOffset, srcType, srcChans,
+            srcStep, samples);
+        return;
+    }
+
+    if(srcChans == FmtUHJ2 || srcChans == FmtSuperStereo)
+        std::fill_n(dstSamples[2]+dstOffset, samples, 0.0f);
+
+    auto decode = [dstSamples,buffer,srcType,srcStep,&adpcm](const size_t dstpos,
+        const size_t srcpos, const size_t count)
+    {
+        for(size_t c{0};c < srcStep;++c)
+            al::LoadAdpcmChannel(dstSamples[c]+dstpos, buffer->mSamples, srcType, c, srcStep,
+                buffer->mBlockAlign, srcpos, count, adpcm.mState[c]);
+    };
+
+    size_t todo{samples};
+    if(adpcm.mSaveOffset >= dstOffset && adpcm.mSaveOffset-dstOffset <= todo)
+    {
+        if(const size_t first{adpcm.mSaveOffset - dstOffset})
+        {
+            decode(dstOffset, srcOffset, first);
+            dstOffset += first;
+            srcOffset += first;
+            todo -= first;
+        }
+        adpcm.mSaved = adpcm.mState;
+        adpcm.mSaveOffset = std::numeric_limits<size_t>::max();
+    }
+    if(todo > 0)
+        decode(dstOffset, srcOffset, todo);
+}
+
 void LoadBufferStatic(VoiceBufferItem *buffer, VoiceBufferItem *bufferLoopItem,
     const size_t dataPosInt, const FmtType sampleType, const FmtChannels sampleChannels,
-    const size_t srcStep, const size_t samplesToLoad, const al::span<float*> voiceSamples)
+    const size_t srcStep, const size_t samplesToLoad, const al::span<float*> voiceSamples,
+    AdpcmContext &adpcm)
 {
     const uint loopStart{buffer->mLoopStart};
     const uint loopEnd{buffer->mLoopEnd};
@@ -258,8 +467,8 @@ void LoadBufferStatic(VoiceBufferItem *buffer, VoiceBufferItem *bufferLoopItem,
     {
         /* Load what's left to play from the buffer */
         const size_t remaining{minz(samplesToLoad, buffer->mSampleLen-dataPosInt)};
-        LoadSamples(voiceSamples, 0, buffer->mSamples, dataPosInt, sampleType, sampleChannels,
-            srcStep, remaining);
+        LoadBufferSamples(voiceSamples, 0, buffer, dataPosInt, sampleType, sampleChannels,
+            srcStep, remaining, adpcm);
 
         if(const size_t toFill{samplesToLoad - remaining})
         {
@@ -274,16 +483,16 @@ void LoadBufferStatic(VoiceBufferItem *buffer, VoiceBufferItem *bufferLoopItem,
     {
         /* Load what's left of this loop iteration */
         const size_t remaining{minz(samplesToLoad, loopEnd-dataPosInt)};
-        LoadSamples(voiceSamples, 0, buffer->mSamples, dataPosInt, sampleType, sampleChannels,
-            srcStep, remaining);
+        LoadBufferSamples(voiceSamples, 0, buffer, dataPosInt, sampleType, sampleChannels,
+            srcStep, remaining, adpcm);
 
         /* Load repeats of the loop to fill the buffer. */
         const auto loopSize = static_cast<size_t>(loopEnd - loopStart);
         size_t samplesLoaded{remaining};
         while(const size_t toFill{minz(samplesToLoad - samplesLoaded, loopSize)})
         {
-            LoadSamples(voiceSamples, samplesLoaded, buffer->mSamples, loopStart, sampleType,
-                sampleChannels, srcStep, toFill);
+            LoadBufferSamples(voiceSamples, samplesLoaded, buffer, loopStart, sampleType,
+                sampleChannels, srcStep, toFill, adpcm);
             samplesLoaded += toFill;
         }
     }
@@ -308,9 +517,38 @@ void LoadBufferCallback(VoiceBufferItem *buffer, const size_t numCallbackSamples
     }
 }
 
+void LoadBufferStream(const RingBuffer *ring, const FmtType sampleType,
+    const FmtChannels sampleChannels, const size_t srcStep, const size_t samplesToLoad,
+    const al::span<float*> voiceSamples)
+{
+    /* Load what's been read ahead, straight from the ring buffer. It's only
+     * consumed once the mix knows how many samples it used.
+     */
+    const auto data = ring->getReadVector();
+    size_t samplesLoaded{0};
+    for(const auto &segment : {data.first, data.second})
+    {
+        const size_t todo{minz(samplesToLoad-samplesLoaded, segment.len)};
+        if(todo == 0) break;
+        LoadSamples(voiceSamples, samplesLoaded, segment.buf, 0, sampleType, sampleChannels,
+            srcStep, todo);
+        samplesLoaded += todo;
+    }
+
+    if(const size_t toFill{samplesToLoad - samplesLoaded})
+    {
+        for(auto *chanbuffer : voiceSamples)
+        {
+            auto srcsamples = chanbuffer + samplesLoaded - 1;
+            std::fill_n(srcsamples + 1, toFill, *srcsamples);
+        }
+    }
+}
+
 void LoadBufferQueue(VoiceBufferItem *buffer, VoiceBufferItem *bufferLoopItem,
     size_t dataPosInt, const FmtType sampleType, const FmtChannels sampleChannels,
-    const size_t srcStep, const size_t samplesToLoad, const al::span<float*> voiceSamples)
+    const size_t srcStep, const size_t samplesToLoad, const al::span<float*> voiceSamples,
+    AdpcmContext &adpcm)
 {
     /* Crawl the buffer queue to fill in the temp buffer */
     size_t samplesLoaded{0};
@@ -325,8 +563,8 @@ void LoadBufferQueue(VoiceBufferItem *buffer, VoiceBufferItem *bufferLoopItem,
         }
 
         const size_t remaining{minz(samplesToLoad-samplesLoaded, buffer->mSampleLen-dataPosInt)};
-        LoadSamples(voiceSamples, samplesLoaded, buffer->mSamples, dataPosInt, sampleType,
-            sampleChannels, srcStep, remaining);
+        LoadBufferSamples(voiceSamples, samplesLoaded, buffer, dataPosInt, sampleType,
+            sampleChannels, srcStep, remaining, adpcm);
 
         samplesLoaded += remaining;
         if(samplesLoaded == samplesToLoad)
@@ -351,11 +589,11 @@ void LoadBufferQueue(VoiceBufferItem *buffer, VoiceBufferItem *bufferLoopItem,
 
 void DoHrtfMix(const float *samples, const uint DstBufferSize, DirectParams &parms,
     const float TargetGain, const uint Counter, uint OutPos, const bool IsPlaying,
-    DeviceBase *Device)
+    DeviceBase *Device, MixerScratch &scratch)
 {
     const uint IrSize{Device->mIrSize};
-    auto &HrtfSamples = Device->HrtfSourceData;
-    auto &AccumSamples = Device->HrtfAccumData;
+    auto &HrtfSamples = scratch.HrtfSourceData;
+    auto &AccumSamples = scratch.HrtfAccumData;
 
     /* Copy the HRTF history and new input samples into a temp buffer. */
     auto src_iter = std::copy(parms.Hrtf.History.begin(), parms.Hrtf.History.end(),
@@ -425,7 +663,8 @@ void DoHrtfMix(const float *samples, const uint DstBufferSize, DirectParams &par
 }
 
 void DoNfcMix(const al::span<const float> samples, FloatBufferLine *OutBuffer, DirectParams &parms,
-    const float *TargetGains, const uint Counter, const uint OutPos, DeviceBase *Device)
+    const float *TargetGains, const uint Counter, const uint OutPos, DeviceBase *Device,
+    MixerScratch &scratch)
 {
     using FilterProc = void (NfcFilter::*)(const al::span<const float>, float*);
     static constexpr FilterProc NfcProcess[MaxAmbiOrder+1]{
@@ -437,7 +676,7 @@ void DoNfcMix(const al::span<const float> samples, FloatBufferLine *OutBuffer, D
     ++CurrentGains;
     ++TargetGains;
 
-    const al::span<float> nfcsamples{Device->NfcSampleData, samples.size()};
+    const al::span<float> nfcsamples{scratch.NfcSampleData, samples.size()};
     size_t order{1};
     while(const size_t chancount{Device->NumChannelsPerOrder[order]})
     {
@@ -453,12 +692,31 @@ void DoNfcMix(const al::span<const float> samples, FloatBufferLine *OutBuffer, D
 
 } // namespace
 
-void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo)
+Voice::~Voice()
+{
+    releasePolyphase();
+}
+
+void Voice::releasePolyphase() noexcept
+{
+    if(const PolyphaseTable *table{std::exchange(mPolyphase, nullptr)})
+    {
+        ReleasePolyphaseTable(table);
+        mFlags.reset(VoiceUsesPolyphase);
+        mFlags.reset(VoicePolyphasePending);
+    }
+}
+
+void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo,
+    MixerScratch &scratch)
 {
     static constexpr std::array<float,MAX_OUTPUT_CHANNELS> SilentTarget{};
 
     ASSUME(SamplesToDo > 0);
 
+    mEvtBuffersDone = 0u;
+    mEvtStopped = false;
+
     /* Get voice info */
     uint DataPosInt{mPosition.load(std::memory_order_relaxed)};
     uint DataPosFrac{mPositionFrac.load(std::memory_order_relaxed)};
@@ -471,15 +729,120 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
          * stop it before bailing.
          */
         if(vstate == Stopping)
+        {
+            if(mSourceID.load(std::memory_order_relaxed) == 0)
+                releasePolyphase();
             mPlayState.store(Stopped, std::memory_order_release);
+        }
         return;
     }
 
+    /* A voice playing a callback stream waits for the callback threads to
+     * first fill its ring, rather than starting with an underrun.
+     */
+    if(mFlags.test(VoiceStreamStarting))
+    {
+        CallbackStream *stream{BufferListItem ? BufferListItem->mStream : nullptr};
+        if(vstate == Playing && stream && mStreamRing->readSpace() == 0
+            && !stream->mEnded.load(std::memory_order_acquire))
+            return;
+        mFlags.reset(VoiceStreamStarting);
+    }
+
+    /* Inaudible or culled voices that have already faded out don't need to
+     * be mixed.
+     */
+    const bool IsSilenced{mFlags.test(VoiceIsInaudible) || mFlags.test(VoiceIsCulled)};
+    if(mFlags.test(VoiceIsVirtual) && IsSilenced && vstate == Playing && BufferListItem)
+        return mixVirtual(SamplesToDo);
+    /* Culled voices fade out, as if stopping, while still playing. */
+    const bool IsAudible{vstate == Playing && !mFlags.test(VoiceIsCulled)};
+
     DeviceBase *Device{Context->mDevice};
     const uint NumSends{Device->NumAuxSends};
 
+    /* Mixer workers write to their own copies of the output buffers, which
+     * get added together after all voices are mixed.
+     */
+    al::span<FloatBufferLine> DirectBuffer{mDirect.Buffer};
+    std::array<al::span<FloatBufferLine>,MAX_SENDS> SendBuffers;
+    std::transform(mSend.cbegin(), mSend.cend(), SendBuffers.begin(),
+        [](const TargetData &send) noexcept { return send.Buffer; });
+    if(const uint widx{scratch.mWorkerIdx})
+    {
+        if(!DirectBuffer.empty())
+        {
+            const auto diroffset = DirectBuffer.data() - Device->MixBuffer.data();
+            DirectBuffer = {scratch.mMixBuffer.data() + diroffset, DirectBuffer.size()};
+        }
+        for(auto &sendbuf : SendBuffers)
+        {
+            if(!sendbuf.empty())
+                sendbuf = {sendbuf.data() + sendbuf.size()*widx, sendbuf.size()};
+        }
+    }
+
+    /* Switch to the polyphase table once it's built, if the position is
+     * still on one of its phases.
+     */
+    if(mFlags.test(VoicePolyphasePending) && mPolyphase->mReady.load(std::memory_order_acquire))
+    {
+        if(mPolyphase->mIncrement == increment
+            && !(DataPosFrac & ((1u<<mPolyphase->mPhaseShift) - 1)))
+        {
+            mResampler = PreparePolyphase(*mPolyphase, &mResampleState);
+            mResamplerMulti = PreparePolyphaseMulti();
+            mFlags.set(VoiceUsesPolyphase);
+        }
+        mFlags.reset(VoicePolyphasePending);
+    }
+
+    /* The polyphase table only has filters for the phases its step lands on.
+     * If the position has been moved between them since the resampler was
+     * prepared, switch back to the bsinc filters.
+     */
+    if(mFlags.test(VoiceUsesPolyphase)
+        && (DataPosFrac & ((1u<<mPolyphase->mPhaseShift) - 1)) != 0)
+    {
+        mResampler = PrepareResampler(mPolyphase->mResampler, increment, &mResampleState);
+        mResamplerMulti = nullptr;
+        mFlags.reset(VoiceUsesPolyphase);
+    }
+
     ResamplerFunc Resample{(increment == MixerFracOne && DataPosFrac == 0) ?
                            Resample_<CopyTag,CTag> : mResampler};
+    const ResamplerMultiFunc ResampleMulti{(Resample == mResampler) ? mResamplerMulti : nullptr};
+
+    /* A voice that was virtual has history from before it skipped ahead, so
+     * clear it and fade in from silence.
+     */
+    if(mFlags.test(VoiceWasVirtual))
+    {
+        std::fill(mPrevSamples.begin(), mPrevSamples.end(), HistoryLine{});
+        if(mDecoder)
+            mDecoder->clear();
+        for(auto &chandata : mChans)
+        {
+            chandata.mAmbiSplitter.clear();
+
+            DirectParams &parms = chandata.mDryParams;
+            parms.LowPass.clear();
+            parms.HighPass.clear();
+            parms.NFCtrlFilter.clear();
+            parms.Hrtf.History.fill(0.0f);
+            parms.Hrtf.Old.Gain = 0.0f;
+            parms.Gains.Current.fill(0.0f);
+            for(uint send{0};send < NumSends;++send)
+            {
+                SendParams &wetparms = chandata.mWetParams[send];
+                wetparms.LowPass.clear();
+                wetparms.HighPass.clear();
+                wetparms.Gains.Current.fill(0.0f);
+            }
+        }
+        mFlags.reset(VoiceWasVirtual);
+        mFlags.set(VoiceIsFading);
+    }
 
     uint Counter{mFlags.test(VoiceIsFading) ? SamplesToDo : 0};
     if(!Counter)
@@ -507,11 +870,31 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
     else if UNLIKELY(!BufferListItem)
         Counter = std::min(Counter, 64u);
 
-    std::array<float*,DeviceBase::MixerChannelsMax> SamplePointers;
+    /* When the voice switches between its own HRIRs and the ambisonic mix,
+     * the old path fades out while the new one fades in from silence.
+     */
+    const bool HrtfCrossfade{Counter && mFlags.test(VoiceWantsHrtf)
+        && mFlags.test(VoiceHasHrtf) != mFlags.test(VoiceHadHrtf)};
+    if(HrtfCrossfade)
+    {
+        for(auto &chandata : mChans)
+        {
+            DirectParams &parms = chandata.mDryParams;
+            if(mFlags.test(VoiceHasHrtf))
+            {
+                parms.Hrtf.History.fill(0.0f);
+                parms.Hrtf.Old.Gain = 0.0f;
+            }
+            else
+                parms.Gains.Current.fill(0.0f);
+        }
+    }
+
+    std::array<float*,MixerScratch::MixerChannelsMax> SamplePointers;
     const al::span<float*> MixingSamples{SamplePointers.data(), mChans.size()};
-    auto offset_bufferline = [](DeviceBase::MixerBufferLine &bufline) noexcept -> float*
+    auto offset_bufferline = [](MixerScratch::MixerBufferLine &bufline) noexcept -> float*
     { return bufline.data() + MaxResamplerEdge; };
-    std::transform(Device->mSampleData.end() - mChans.size(), Device->mSampleData.end(),
+    std::transform(scratch.mSampleData.end() - mChans.size(), scratch.mSampleData.end(),
         MixingSamples.begin(), offset_bufferline);
 
     const uint PostPadding{MaxResamplerEdge + mDecoderPadding};
@@ -543,14 +926,14 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
             DataSize64 = (DataSize64*increment + DataPosFrac) >> MixerFracBits;
             DataSize64 += PostPadding;
 
-            if(DataSize64 <= DeviceBase::MixerLineSize - MaxResamplerEdge)
+            if(DataSize64 <= MixerScratch::MixerLineSize - MaxResamplerEdge)
                 SrcBufferSize = static_cast<uint>(DataSize64);
             else
             {
                 /* If the source size got saturated, we can't fill the desired
                  * dst size. Figure out how many samples we can actually mix.
                  */
-                SrcBufferSize = DeviceBase::MixerLineSize - MaxResamplerEdge;
+                SrcBufferSize = MixerScratch::MixerLineSize - MaxResamplerEdge;
 
                 DataSize64 = SrcBufferSize - PostPadding;
                 DataSize64 = ((DataSize64<<MixerFracBits) - DataPosFrac) / increment;
@@ -603,9 +986,17 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
                 std::copy_n(prevSamples->data(), MaxResamplerEdge, chanbuffer-MaxResamplerEdge);
                 ++prevSamples;
             }
+            const size_t srcOffset{(increment*DstBufferSize + DataPosFrac)>>MixerFracBits};
+            AdpcmContext adpcm{mAdpcmState, srcOffset};
             if(mFlags.test(VoiceIsStatic))
-                LoadBufferStatic(BufferListItem, BufferLoopItem, DataPosInt, mFmtType,
-                    mFmtChannels, mFrameStep, SrcBufferSize, MixingSamples);
+            {
+                VoiceBufferItem *item{mResampledItem ? mResampledItem : BufferListItem};
+                LoadBufferStatic(item, BufferLoopItem, DataPosInt, mFmtType, mFmtChannels,
+                    mFrameStep, SrcBufferSize, MixingSamples, adpcm);
+            }
+            else if(BufferListItem->mStream)
+                LoadBufferStream(mStreamRing, mFmtType, mFmtChannels, mFrameStep, SrcBufferSize,
+                    MixingSamples);
             else if(mFlags.test(VoiceIsCallback))
             {
                 if(!mFlags.test(VoiceCallbackStopped) && SrcBufferSize > mNumCallbackSamples)
@@ -630,9 +1021,8 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
             }
             else
                 LoadBufferQueue(BufferListItem, BufferLoopItem, DataPosInt, mFmtType, mFmtChannels,
-                    mFrameStep, SrcBufferSize, MixingSamples);
+                    mFrameStep, SrcBufferSize, MixingSamples, adpcm);
 
-            const size_t srcOffset{(increment*DstBufferSize + DataPosFrac)>>MixerFracBits};
             if(mDecoder)
             {
                 SrcBufferSize = SrcBufferSize - PostPadding + MaxResamplerEdge;
@@ -653,57 +1043,110 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
             }
         }
 
-        auto voiceSamples = MixingSamples.begin();
-        for(auto &chandata : mChans)
+        constexpr size_t GroupSize{MixerScratch::MixerChannelGroupSize};
+        for(size_t chanidx{0};chanidx < mChans.size();chanidx += GroupSize)
         {
-            /* Resample, then apply ambisonic upsampling as needed. */
-            float *ResampledData{Resample(&mResampleState, *voiceSamples, DataPosFrac, increment,
-                {Device->ResampledData, DstBufferSize})};
-            ++voiceSamples;
+            const auto groupChans = al::span<ChannelData>{mChans}.subspan(chanidx,
+                minz(mChans.size()-chanidx, GroupSize));
+            const auto groupSamples = MixingSamples.subspan(chanidx, groupChans.size());
 
+            /* Resample, then apply ambisonic upsampling as needed. When the
+             * group has multiple channels, the resampler can find each output
+             * sample's filter once for all of them.
+             */
+            std::array<float*,GroupSize> ResampledData;
+            if(ResampleMulti && groupChans.size() > 1)
+            {
+                for(size_t i{0};i < groupChans.size();++i)
+                    ResampledData[i] = scratch.ResampledData[i].data();
+                ResampleMulti(&mResampleState, groupSamples, DataPosFrac, increment,
+                    {ResampledData.data(), groupChans.size()}, DstBufferSize);
+            }
+            else
+            {
+                for(size_t i{0};i < groupChans.size();++i)
+                    ResampledData[i] = Resample(&mResampleState, groupSamples[i], DataPosFrac,
+                        increment, {scratch.ResampledData[i].data(), DstBufferSize});
+            }
             if(mFlags.test(VoiceIsAmbisonic))
-                chandata.mAmbiSplitter.processScale({ResampledData, DstBufferSize},
-                    chandata.mAmbiHFScale, chandata.mAmbiLFScale);
-
-            /* Now filter and mix to the appropriate outputs. */
-            const al::span<float,BufferLineSize> FilterBuf{Device->FilteredData};
             {
-                DirectParams &parms = chandata.mDryParams;
-                const float *samples{DoFilters(parms.LowPass, parms.HighPass, FilterBuf.data(),
-                    {ResampledData, DstBufferSize}, mDirect.FilterType)};
-
-                if(mFlags.test(VoiceHasHrtf))
+                for(size_t i{0};i < groupChans.size();++i)
                 {
-                    const float TargetGain{parms.Hrtf.Target.Gain * likely(vstate == Playing)};
-                    DoHrtfMix(samples, DstBufferSize, parms, TargetGain, Counter, OutPos,
-                        (vstate == Playing), Device);
+                    ChannelData &chandata = groupChans[i];
+                    chandata.mAmbiSplitter.processScale({ResampledData[i], DstBufferSize},
+                        chandata.mAmbiHFScale, chandata.mAmbiLFScale);
                 }
-                else
+            }
+
+            /* Filter the group's dry and send paths together. */
+            FilterBatch filters{scratch};
+            std::array<const float*,GroupSize> DrySamples;
+            std::array<std::array<const float*,MAX_SENDS>,GroupSize> WetSamples;
+            for(size_t i{0};i < groupChans.size();++i)
+            {
+                ChannelData &chandata = groupChans[i];
+                const al::span<const float> resampled{ResampledData[i], DstBufferSize};
+
+                DirectParams &parms = chandata.mDryParams;
+                DrySamples[i] = filters.add(parms.LowPass, parms.HighPass, resampled,
+                    mDirect.FilterType);
+                for(uint send{0};send < NumSends;++send)
                 {
-                    const float *TargetGains{likely(vstate == Playing) ? parms.Gains.Target.data()
-                        : SilentTarget.data()};
-                    if(mFlags.test(VoiceHasNfc))
-                        DoNfcMix({samples, DstBufferSize}, mDirect.Buffer.data(), parms,
-                            TargetGains, Counter, OutPos, Device);
-                    else
-                        MixSamples({samples, DstBufferSize}, mDirect.Buffer,
-                            parms.Gains.Current.data(), TargetGains, Counter, OutPos);
+                    if(mSend[send].Buffer.empty())
+                        continue;
+                    SendParams &wetparms = chandata.mWetParams[send];
+                    WetSamples[i][send] = filters.add(wetparms.LowPass, wetparms.HighPass,
+                        resampled, mSend[send].FilterType);
                 }
             }
+            filters.process(DstBufferSize);
 
-            for(uint send{0};send < NumSends;++send)
+            /* Now mix to the appropriate outputs. */
+            for(size_t i{0};i < groupChans.size();++i)
             {
-                if(mSend[send].Buffer.empty())
-                    continue;
+                ChannelData &chandata = groupChans[i];
+                {
+                    DirectParams &parms = chandata.mDryParams;
+                    const float *samples{DrySamples[i]};
 
-                SendParams &parms = chandata.mWetParams[send];
-                const float *samples{DoFilters(parms.LowPass, parms.HighPass, FilterBuf.data(),
-                    {ResampledData, DstBufferSize}, mSend[send].FilterType)};
+                    if(mFlags.test(VoiceHasHrtf))
+                    {
+                        if(HrtfCrossfade)
+                            MixSamples({samples, DstBufferSize}, DirectBuffer,
+                                parms.Gains.Current.data(), SilentTarget.data(), Counter, OutPos);
+
+                        const float TargetGain{parms.Hrtf.Target.Gain * likely(IsAudible)};
+                        DoHrtfMix(samples, DstBufferSize, parms, TargetGain, Counter, OutPos,
+                            (vstate == Playing), Device, scratch);
+                    }
+                    else
+                    {
+                        if(HrtfCrossfade)
+                            DoHrtfMix(samples, DstBufferSize, parms, 0.0f, Counter, OutPos,
+                                (vstate == Playing), Device, scratch);
+
+                        const float *TargetGains{likely(IsAudible) ? parms.Gains.Target.data()
+                            : SilentTarget.data()};
+                        if(mFlags.test(VoiceHasNfc))
+                            DoNfcMix({samples, DstBufferSize}, DirectBuffer.data(), parms,
+                                TargetGains, Counter, OutPos, Device, scratch);
+                        else
+                            MixSamples({samples, DstBufferSize}, DirectBuffer,
+                                parms.Gains.Current.data(), TargetGains, Counter, OutPos);
+                    }
+                }
 
-                const float *TargetGains{likely(vstate == Playing) ? parms.Gains.Target.data()
-                    : SilentTarget.data()};
-                MixSamples({samples, DstBufferSize}, mSend[send].Buffer,
-                    parms.Gains.Current.data(), TargetGains, Counter, OutPos);
+                for(uint send{0};send < NumSends;++send)
+                {
+                    if(mSend[send].Buffer.empty())
+                        continue;
+
+                    SendParams &parms = chandata.mWetParams[send];
+                    const float *TargetGains{likely(IsAudible) ? parms.Gains.Target.data()
+                        : SilentTarget.data()};
+                    MixSamples({WetSamples[i][send], DstBufferSize}, SendBuffers[send],
+                        parms.Gains.Current.data(), TargetGains, Counter, OutPos);
+                }
             }
         }
         /* If the voice is stopping, we're now done. */
@@ -725,11 +1168,12 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
         }
         else if(mFlags.test(VoiceIsStatic))
         {
+            const VoiceBufferItem *item{mResampledItem ? mResampledItem : BufferListItem};
             if(BufferLoopItem)
             {
                 /* Handle looping static source */
-                const uint LoopStart{BufferListItem->mLoopStart};
-                const uint LoopEnd{BufferListItem->mLoopEnd};
+                const uint LoopStart{item->mLoopStart};
+                const uint LoopEnd{item->mLoopEnd};
                 if(DataPosInt >= LoopEnd)
                 {
                     assert(LoopEnd > LoopStart);
@@ -739,13 +1183,37 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
             else
             {
                 /* Handle non-looping static source */
-                if(DataPosInt >= BufferListItem->mSampleLen)
+                if(DataPosInt >= item->mSampleLen)
                 {
                     BufferListItem = nullptr;
                     break;
                 }
             }
         }
+        else if(CallbackStream *stream{BufferListItem->mStream})
+        {
+            /* Handle callback buffer source read ahead by another thread. The
+             * end is checked before the available samples so the last ones
+             * written before the end are seen. A stopping voice leaves the
+             * stream alone, since it may be restarting on another voice with
+             * another ring.
+             */
+            const bool ended{stream->mEnded.load(std::memory_order_acquire)};
+            const size_t available{mStreamRing->readSpace()};
+            if(likely(vstate == Playing))
+            {
+                if(SrcSamplesDone < available)
+                    mStreamRing->readAdvance(SrcSamplesDone);
+                else
+                {
+                    mStreamRing->readAdvance(available);
+                    if(ended) BufferListItem = nullptr;
+                }
+                if(!ended && available < SrcBufferSize)
+                    stream->mUnderruns.fetch_add(1u, std::memory_order_relaxed);
+                stream->consumed(mStreamRing);
+            }
+        }
         else if(mFlags.test(VoiceIsCallback))
         {
             /* Handle callback buffer source */
@@ -780,10 +1248,21 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
     } while(OutPos < SamplesToDo);
 
     mFlags.set(VoiceIsFading);
+    mFlags.set(VoiceHadHrtf, mFlags.test(VoiceHasHrtf));
+    /* If the voice is inaudible or culled, it's now faded out and can be
+     * virtual for the next mix. Callback buffers still need to be read, so
+     * they always mix.
+     */
+    mFlags.set(VoiceIsVirtual, IsSilenced && !mFlags.test(VoiceIsCallback));
 
     /* Don't update positions and buffers if we were stopping. */
     if(unlikely(vstate == Stopping))
     {
+        /* A voice that was stopped, rather than paused, won't resume with the
+         * table it had, so don't keep it from other voices while idle.
+         */
+        if(mSourceID.load(std::memory_order_relaxed) == 0)
+            releasePolyphase();
         mPlayState.store(Stopped, std::memory_order_release);
         return;
     }
@@ -802,9 +1281,99 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
     }
     std::atomic_thread_fence(std::memory_order_release);
 
-    /* Send any events now, after the position/buffer info was updated. */
+    /* Hold onto any events until sendEvents, which happens after the
+     * position/buffer info was updated.
+     */
+    mEvtSourceID = SourceID;
+    mEvtBuffersDone = buffers_done;
+
+    if(!BufferListItem)
+    {
+        /* If the voice just ended, set it to Stopping so the next render
+         * ensures any residual noise fades to 0 amplitude.
+         */
+        mPlayState.store(Stopping, std::memory_order_release);
+        mEvtStopped = true;
+    }
+}
+
+void Voice::mixVirtual(const uint SamplesToDo)
+{
+    uint DataPosInt{mPosition.load(std::memory_order_relaxed)};
+    uint DataPosFrac{mPositionFrac.load(std::memory_order_relaxed)};
+    VoiceBufferItem *BufferListItem{mCurrentBuffer.load(std::memory_order_relaxed)};
+    VoiceBufferItem *BufferLoopItem{mLoopBuffer.load(std::memory_order_relaxed)};
+
+    /* Nothing is loaded, resampled, or mixed. The voice's history is cleared
+     * when it becomes audible again, since it skipped past what's in it, and
+     * it fades in from silence.
+     */
+    mFlags.set(VoiceWasVirtual);
+    DataPosFrac += mStep*SamplesToDo;
+    DataPosInt  += DataPosFrac>>MixerFracBits;
+    DataPosFrac &= MixerFracMask;
+
+    uint buffers_done{0u};
+    if(mFlags.test(VoiceIsStatic))
+    {
+        const VoiceBufferItem *item{mResampledItem ? mResampledItem : BufferListItem};
+        if(BufferLoopItem)
+        {
+            const uint LoopStart{item->mLoopStart};
+            const uint LoopEnd{item->mLoopEnd};
+            if(DataPosInt >= LoopEnd)
+            {
+                assert(LoopEnd > LoopStart);
+                DataPosInt = ((DataPosInt-LoopStart)%(LoopEnd-LoopStart)) + LoopStart;
+            }
+        }
+        else if(DataPosInt >= item->mSampleLen)
+            BufferListItem = nullptr;
+    }
+    else
+    {
+        do {
+            if(BufferListItem->mSampleLen > DataPosInt)
+                break;
+
+            DataPosInt -= BufferListItem->mSampleLen;
+
+            ++buffers_done;
+            BufferListItem = BufferListItem->mNext.load(std::memory_order_relaxed);
+            if(!BufferListItem) BufferListItem = BufferLoopItem;
+        } while(BufferListItem);
+    }
+
+    const uint SourceID{mSourceID.load(std::memory_order_relaxed)};
+
+    mPosition.store(DataPosInt, std::memory_order_relaxed);
+    mPositionFrac.store(DataPosFrac, std::memory_order_relaxed);
+    mCurrentBuffer.store(BufferListItem, std::memory_order_relaxed);
+    if(!BufferListItem)
+    {
+        mLoopBuffer.store(nullptr, std::memory_order_relaxed);
+        mSourceID.store(0u, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    mEvtSourceID = SourceID;
+    mEvtBuffersDone = buffers_done;
+
+    if(!BufferListItem)
+    {
+        /* The voice ended while virtual. Stopping it will be silent anyway. */
+        mPlayState.store(Stopping, std::memory_order_release);
+        mEvtStopped = true;
+    }
+}
+
+void Voice::sendEvents(ContextBase *Context)
+{
+    if(!mEvtBuffersDone && !mEvtStopped)
+        return;
+
     const uint enabledevt{Context->mEnabledEvts.load(std::memory_order_acquire)};
-    if(buffers_done > 0 && (enabledevt&AsyncEvent::BufferCompleted))
+    if(mEvtBuffersDone > 0 && (enabledevt&AsyncEvent::BufferCompleted))
     {
         RingBuffer *ring{Context->mAsyncEvents.get()};
         auto evt_vec = ring->getWriteVector();
@@ -812,21 +1381,17 @@ void Voice::mix(const State vstate, ContextBase *Context, const uint SamplesToDo
         {
             AsyncEvent *evt{al::construct_at(reinterpret_cast<AsyncEvent*>(evt_vec.first.buf),
                 AsyncEvent::BufferCompleted)};
-            evt->u.bufcomp.id = SourceID;
-            evt->u.bufcomp.count = buffers_done;
+            evt->u.bufcomp.id = mEvtSourceID;
+            evt->u.bufcomp.count = mEvtBuffersDone;
             ring->writeAdvance(1);
         }
     }
 
-    if(!BufferListItem)
-    {
-        /* If the voice just ended, set it to Stopping so the next render
-         * ensures any residual noise fades to 0 amplitude.
-         */
-        mPlayState.store(Stopping, std::memory_order_release);
-        if((enabledevt&AsyncEvent::SourceStateChange))
-            SendSourceStoppedEvent(Context, SourceID);
-    }
+    if(mEvtStopped && (enabledevt&AsyncEvent::SourceStateChange))
+        SendSourceStoppedEvent(Context, mEvtSourceID);
+
+    mEvtBuffersDone = 0u;
+    mEvtStopped = false;
 }
 
 void Voice::prepare(DeviceBase *device)
@@ -836,11 +1401,11 @@ void Voice::prepare(DeviceBase *device)
      */
     uint num_channels{(mFmtChannels == FmtUHJ2 || mFmtChannels == FmtSuperStereo) ? 3 :
         ChannelsFromFmt(mFmtChannels, minu(mAmbiOrder, device->mAmbiOrder))};
-    if(unlikely(num_channels > device->mSampleData.size()))
+    if(unlikely(num_channels > MixerScratch::MixerChannelsMax))
     {
         ERR("Unexpected channel count: %u (limit: %zu, %d:%d)\n", num_channels,
-            device->mSampleData.size(), mFmtChannels, mAmbiOrder);
-        num_channels = static_cast<uint>(device->mSampleData.size());
+            MixerScratch::MixerChannelsMax, mFmtChannels, mAmbiOrder);
+        num_channels = static_cast<uint>(MixerScratch::MixerChannelsMax);
     }
     if(mChans.capacity() > 2 && num_channels < mChans.capacity())
     {
@@ -891,6 +1456,7 @@ void Voice::prepare(DeviceBase *device)
 
     /* Make sure the sample history is cleared. */
     std::fill(mPrevSamples.begin(), mPrevSamples.end(), HistoryLine{});
+    mAdpcmState.fill(al::AdpcmState{});
 
     /* Don't need to set the VoiceIsAmbisonic flag if the device is not higher
      * order than the voice. No HF scaling is necessary to mix it.
@@ -15,26 +15,29 @@
 #include "bufferline.h"
 #include "buffer_storage.h"
 #include "devformat.h"
+#include "device.h"
 #include "filters/biquad.h"
 #include "filters/nfc.h"
 #include "filters/splitter.h"
+#include "fmt_traits.h"
 #include "mixer/defs.h"
 #include "mixer/hrtfdefs.h"
 #include "resampler_limits.h"
 #include "uhjfilter.h"
 #include "vector.h"
 
+struct CallbackStream;
 struct ContextBase;
 struct DeviceBase;
 struct EffectSlot;
+struct MixerScratch;
+struct PolyphaseTable;
+struct RingBuffer;
 enum class DistanceModel : unsigned char;
 
 using uint = unsigned int;
 
 
-#define MAX_SENDS  6
-
-
 enum class SpatializeMode : unsigned char {
     Off,
     On,
@@ -96,10 +99,13 @@ struct VoiceBufferItem {
 
     CallbackType mCallback{nullptr};
     void *mUserData{nullptr};
+    CallbackStream *mStream{nullptr};
 
     uint mSampleLen{0u};
     uint mLoopStart{0u};
     uint mLoopEnd{0u};
+    /* Sample frames per block. Only ADPCM formats have more than 1. */
+    uint mBlockAlign{1u};
 
     al::byte *mSamples{nullptr};
 };
@@ -141,6 +147,7 @@ struct VoiceProps {
 
     float Radius;
     float EnhWidth;
+    float Priority;
 
     /** Direct filter and auxiliary send info. */
     struct {
@@ -171,9 +178,27 @@ enum : uint {
     VoiceIsCallback,
     VoiceIsAmbisonic,
     VoiceCallbackStopped,
+    /* The voice's callback stream ring hasn't been filled since it started. */
+    VoiceStreamStarting,
     VoiceIsFading,
     VoiceHasHrtf,
+    /* The voice could use HRIRs (the device does full HRTF rendering, and
+     * the voice is panned), but is limited to the ambisonic mix when set.
+     */
+    VoiceWantsHrtf,
+    VoiceHrtfLowDetail,
+    /* The voice was last mixed with HRIRs, to crossfade when that changes. */
+    VoiceHadHrtf,
     VoiceHasNfc,
+    VoiceIsInaudible,
+    VoiceIsCulled,
+    VoiceIsVirtual,
+    /* The voice skipped mixing while virtual, so its history is stale. */
+    VoiceWasVirtual,
+    /* The voice resamples with its polyphase table. */
+    VoiceUsesPolyphase,
+    /* The voice can use its polyphase table once it's built. */
+    VoicePolyphasePending,
 
     VoiceFlagCount
 };
@@ -220,18 +245,57 @@ struct Voice {
     AmbiScaling mAmbiScaling;
     uint mAmbiOrder;
 
+    /* A pre-resampled copy of a static voice's buffer, played in its place at
+     * the device rate. The voice's position is in the copy's sample frames.
+     */
+    VoiceBufferItem *mResampledItem{nullptr};
+
     std::unique_ptr<DecoderBase> mDecoder;
     uint mDecoderPadding{};
 
+    /* ADPCM decoder state for each channel, as of where the next mix starts
+     * reading, so sequential playback can continue decoding from there.
+     */
+    using AdpcmStateArray = std::array<al::AdpcmState,al::MaxAdpcmChannels>;
+    AdpcmStateArray mAdpcmState{};
+
     /** Current target parameters used for mixing. */
     uint mStep{0};
 
     ResamplerFunc mResampler;
+    /* Resamples multiple channels at once, if available for the resampler. */
+    ResamplerMultiFunc mResamplerMulti{nullptr};
 
     InterpState mResampleState;
 
+    /* Precomputed bsinc filters for the step the voice started with, used
+     * while the step stays the same. The voice holds the table until it's
+     * stopped, played again or deleted.
+     */
+    const PolyphaseTable *mPolyphase{nullptr};
+
     std::bitset<VoiceFlagCount> mFlags{};
     uint mNumCallbackSamples{0};
+    /* The ring a callback stream was started with for this voice, which stays
+     * the one the voice reads even if the stream restarts on another voice.
+     */
+    RingBuffer *mStreamRing{nullptr};
+
+    /**
+     * The loudest the voice can be on any output, given its current gains and
+     * filters. When below the device's virtual voice threshold, the voice is
+     * marked inaudible, and once faded out it's only advanced instead of
+     * being mixed. Scaled by the priority, it also ranks the voice against
+     * others when the context limits how many voices can be mixed.
+     */
+    float mAudibility{1.0f};
+
+    /* Events resulting from the last mix, which are held until sendEvents is
+     * called so the mix can run on a worker thread.
+     */
+    uint mEvtSourceID{0u};
+    uint mEvtBuffersDone{0u};
+    bool mEvtStopped{false};
 
     struct TargetData {
         int FilterType;
@@ -258,12 +322,18 @@ struct Voice {
     al::vector<ChannelData> mChans{2};
 
     Voice() = default;
-    ~Voice() = default;
+    ~Voice();
+
+    /* Gives up the voice's polyphase table, if it has one. */
+    void releasePolyphase() noexcept;
 
     Voice(const Voice&) = delete;
     Voice& operator=(const Voice&) = delete;
 
-    void mix(const State vstate, ContextBase *Context, const uint SamplesToDo);
+    void mix(const State vstate, ContextBase *Context, const uint SamplesToDo,
+        MixerScratch &scratch);
+    void mixVirtual(const uint SamplesToDo);
+    void sendEvents(ContextBase *Context);
 
     void prepare(DeviceBase *device);
 
@@ -0,0 +1,111 @@
+#include "config.h"
+
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+
+#include "fpu_ctrl.h"
+#include "helpers.h"
+#include "logging.h"
+
+
+WorkerPool::~WorkerPool()
+{
+    mKillNow.store(true, std::memory_order_release);
+    for(auto &worker : mWorkers)
+        worker->mSem.post();
+    for(auto &worker : mWorkers)
+    {
+        if(worker->mThread.joinable())
+            worker->mThread.join();
+    }
+}
+
+
+void WorkerPool::runTasks() noexcept
+{
+    size_t task{mNextTask.fetch_add(1u, std::memory_order_acq_rel)};
+    while(task < mNumTasks)
+    {
+        mTask(mUserData, task);
+        task = mNextTask.fetch_add(1u, std::memory_order_acq_rel);
+    }
+}
+
+void WorkerPool::workerProc(Worker *self)
+{
+    althrd_setname(mName);
+    if(!mForMixer)
+    {
+        workerLoop(self);
+        return;
+    }
+
+    SetRTPriority();
+    /* Keep the same FPU mode as the mixer thread for the life of the worker. */
+    FPUCtl mixer_mode{};
+    workerLoop(self);
+}
+
+void WorkerPool::workerLoop(Worker *self)
+{
+    while(true)
+    {
+        self->mSem.wait();
+        if(mKillNow.load(std::memory_order_acquire))
+            break;
+
+        runTasks();
+        mDoneSem.post();
+    }
+}
+
+
+void WorkerPool::run(TaskFunc func, void *userdata, const size_t numtasks)
+{
+    mTask = func;
+    mUserData = userdata;
+    mNumTasks = numtasks;
+    mNextTask.store(0u, std::memory_order_release);
+
+    /* Only wake as many workers as there are tasks left for them. The post
+     * synchronizes the task info with the woken threads.
+     */
+    const size_t numwake{std::min(mWorkers.size(), numtasks ? numtasks-1 : 0u)};
+    for(size_t i{0u};i < numwake;++i)
+        mWorkers[i]->mSem.post();
+
+    runTasks();
+
+    for(size_t i{0u};i < numwake;++i)
+        mDoneSem.wait();
+}
+
+
+std::unique_ptr<WorkerPool> WorkerPool::Create(const uint numthreads, const char *name,
+    const bool formixer)
+{
+    std::unique_ptr<WorkerPool> pool{new WorkerPool{name, formixer}};
+    pool->mWorkers.reserve(numthreads);
+    for(uint i{0u};i < numthreads;++i)
+    {
+        auto worker = std::make_unique<Worker>();
+        try {
+            worker->mThread = std::thread{std::mem_fn(&WorkerPool::workerProc), pool.get(),
+                worker.get()};
+        }
+        catch(std::exception& e) {
+            ERR("Failed to start %s thread: %s\n", name, e.what());
+            break;
+        }
+        pool->mWorkers.emplace_back(std::move(worker));
+    }
+    if(pool->mWorkers.empty())
+        return nullptr;
+
+    TRACE("Started %zu %s thread%s\n", pool->mWorkers.size(), name,
+        (pool->mWorkers.size() == 1) ? "" : "s");
+    return pool;
+}
@@ -0,0 +1,80 @@
+#ifndef CORE_WORKER_POOL_H
+#define CORE_WORKER_POOL_H
+
+#include <stddef.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "almalloc.h"
+#include "threads.h"
+#include "vector.h"
+
+using uint = unsigned int;
+
+
+/* A small pool of threads the mixer can hand independent pieces of work to.
+ * The calling thread participates in the work, and run() doesn't return
+ * until every task has completed, so tasks may freely reference the caller's
+ * stack. Mixer worker threads inherit the mixer's real-time priority and FPU
+ * mode, and all worker threads stay asleep on a semaphore between runs.
+ */
+class WorkerPool {
+public:
+    using TaskFunc = void(*)(void *userdata, const size_t task);
+
+private:
+    struct Worker {
+        al::semaphore mSem;
+        std::thread mThread;
+    };
+    al::vector<std::unique_ptr<Worker>> mWorkers;
+
+    TaskFunc mTask{nullptr};
+    void *mUserData{nullptr};
+    size_t mNumTasks{0u};
+    std::atomic<size_t> mNextTask{0u};
+
+    al::semaphore mDoneSem;
+    std::atomic<bool> mKillNow{false};
+
+    const char *mName;
+    const bool mForMixer;
+
+    void workerProc(Worker *self);
+    void workerLoop(Worker *self);
+    void runTasks() noexcept;
+
+    WorkerPool(const char *name, const bool formixer) : mName{name}, mForMixer{formixer} { }
+
+public:
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /** Returns the number of extra threads available to run tasks. */
+    size_t numWorkers() const noexcept { return mWorkers.size(); }
+
+    /**
+     * Calls func(userdata, task) for each task in [0, numtasks), spreading
+     * the calls over the calling thread and the worker threads. Returns once
+     * all tasks are done. Must not be called concurrently.
+     */
+    void run(TaskFunc func, void *userdata, const size_t numtasks);
+
+    /**
+     * Creates a pool with the given number of worker threads (not counting
+     * the calling thread), named with the given string literal. Returns null
+     * if no threads could be started. Pools not for the mixer keep the normal
+     * thread priority and FPU mode, so they give the same results as the
+     * calling thread would on its own.
+     */
+    static std::unique_ptr<WorkerPool> Create(const uint numthreads, const char *name,
+        const bool formixer=true);
+
+    DEF_NEWDEL(WorkerPool)
+};
+
+#endif /* CORE_WORKER_POOL_H */
@@ -0,0 +1,136 @@
+/* Checks the SIMD versions of the cubic resampler against the C version,
+ * which they should match exactly. Returns non-zero on a mismatch.
+ */
+
+#include "config.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "alspan.h"
+#include "core/cpu_caps.h"
+#include "core/mixer/defs.h"
+#include "vector.h"
+
+
+struct CTag;
+struct SSE2Tag;
+struct SSE4Tag;
+struct AVX2Tag;
+struct NEONTag;
+struct CubicTag;
+
+namespace {
+
+struct Kernel {
+    const char *name;
+    ResamplerFunc func;
+    int caps;
+};
+
+int CheckKernel(const Kernel &kernel, const al::span<float> src, const uint increment,
+    const uint frac, const size_t dstlen)
+{
+    /* Each output line is given padding on both ends, to catch writes past
+     * the requested length.
+     */
+    constexpr float Marker{12345.0f};
+    constexpr size_t Guard{16};
+    al::vector<float,16> ref(dstlen + Guard*2, Marker);
+    al::vector<float,16> out(dstlen + Guard*2, Marker);
+
+    float *srcstart{src.data() + MaxResamplerEdge};
+    const al::span<float> refspan{ref.data()+Guard, dstlen};
+    const al::span<float> outspan{out.data()+Guard, dstlen};
+    const float *refret{Resample_<CubicTag,CTag>(nullptr, srcstart, frac, increment, refspan)};
+    const float *outret{kernel.func(nullptr, srcstart, frac, increment, outspan)};
+
+    int errors{0};
+    if(refret != refspan.data() || outret != outspan.data())
+    {
+        fprintf(stderr, "%s: unexpected return (step %u, frac %u, length %zu)\n", kernel.name,
+            increment, frac, dstlen);
+        ++errors;
+    }
+    for(size_t i{0};i < ref.size();++i)
+    {
+        const bool isguard{i < Guard || i >= Guard+dstlen};
+        const bool ok{out[i] == (isguard ? Marker : ref[i])};
+        if(!ok && errors++ < 8)
+            fprintf(stderr, "%s: sample %td is %.9g, expected %.9g (step %u, frac %u,"
+                " length %zu)\n", kernel.name, static_cast<ptrdiff_t>(i)-ptrdiff_t{Guard},
+                out[i], isguard ? Marker : ref[i], increment, frac, dstlen);
+    }
+    return errors;
+}
+
+} // namespace
+
+
+int main()
+{
+    const auto cpuinfo = GetCPUInfo();
+    const int caps{cpuinfo ? cpuinfo->mCaps : 0};
+
+    const Kernel kernels[]{
+#ifdef HAVE_SSE2
+        {"SSE2", Resample_<CubicTag,SSE2Tag>, CPU_CAP_SSE2},
+#endif
+#ifdef HAVE_SSE4_1
+        {"SSE4.1", Resample_<CubicTag,SSE4Tag>, CPU_CAP_SSE4_1},
+#endif
+#ifdef HAVE_AVX2
+        {"AVX2", Resample_<CubicTag,AVX2Tag>, CPU_CAP_AVX2},
+#endif
+#ifdef HAVE_NEON
+        {"NEON", Resample_<CubicTag,NEONTag>, CPU_CAP_NEON},
+#endif
+        {nullptr, nullptr, 0}
+    };
+
+    /* Steps below, at, and above 1:1, including ones that don't divide evenly
+     * into the fractional position, up to the maximum pitch.
+     */
+    constexpr uint increments[]{1, 7, 1000, 2047, 2048, 3763, 4095, MixerFracOne, 4097, 5645,
+        8192, 12345, MaxPitch*MixerFracOne};
+    constexpr uint fracs[]{0, 1, 1234, MixerFracOne/2, MixerFracMask};
+    constexpr size_t MaxLength{67};
+
+    /* Normalized noise, with room for the resampler's padding on each end. */
+    std::mt19937 rng{20261016u};
+    std::uniform_real_distribution<float> dist{-1.0f, 1.0f};
+    std::vector<float> src(MaxLength*MaxPitch + MaxResamplerPadding + 2);
+    std::generate(src.begin(), src.end(), [&rng,&dist]() { return dist(rng); });
+
+    int errors{0};
+    int checked{0};
+    for(const Kernel &kernel : kernels)
+    {
+        if(!kernel.name) break;
+        if((caps&kernel.caps) != kernel.caps)
+        {
+            printf("Skipping %s, unsupported by this CPU\n", kernel.name);
+            continue;
+        }
+
+        int kernelerrors{0};
+        for(const uint increment : increments)
+        {
+            for(const uint frac : fracs)
+            {
+                for(size_t dstlen{1};dstlen <= MaxLength;++dstlen)
+                    kernelerrors += CheckKernel(kernel, src, increment, frac, dstlen);
+            }
+        }
+        printf("%s: %s\n", kernel.name, kernelerrors ? "FAILED" : "ok");
+        errors += kernelerrors;
+        ++checked;
+    }
+    if(!checked)
+        printf("No SIMD cubic resamplers to check\n");
+
+    return errors ? 1 : 0;
+}